@@ -8,6 +8,7 @@ option(WITH_ALUGRID "Have Alugrid" OFF)
 option(WITH_MKL "Use Intel MKL for BLAS and LAPACK functionality" OFF)
 option(WITH_GOTOBLAS "Use GotoBLAS for BLAS and LAPACK functionality" OFF)
 option(WITH_OPENBLAS "Use OpenBLAS for BLAS and LAPACK functionality" OFF)
+option(WITH_NATIVE_SIMD "Optimise for the instruction set of the build machine (enables the AVX2/AVX-512 kernel evaluation paths)" OFF)
 
 option(ENABLE_SINGLE_PRECISION "Enable support for single-precision calculations" ON)
 option(ENABLE_DOUBLE_PRECISION "Enable support for double-precision calculations" ON)
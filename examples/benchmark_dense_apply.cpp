@@ -0,0 +1,110 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Compares the throughput of products of dense discrete operators with
+// vectors and matrices, evaluated by BLAS through
+// DiscreteDenseBoundaryOperator::apply(), against the Armadillo expressions
+// used previously. Usage: benchmark_dense_apply [matrix size] [rhs count]
+
+#include "assembly/discrete_dense_boundary_operator.hpp"
+
+#include "common/armadillo_fwd.hpp"
+
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <tbb/tick_count.h>
+
+typedef std::complex<double> RT; // result type
+
+namespace
+{
+
+const char* modeName(Bempp::TranspositionMode trans)
+{
+    switch (trans) {
+    case Bempp::NO_TRANSPOSE: return "NO_TRANSPOSE";
+    case Bempp::CONJUGATE: return "CONJUGATE";
+    case Bempp::TRANSPOSE: return "TRANSPOSE";
+    default: return "CONJUGATE_TRANSPOSE";
+    }
+}
+
+// The product evaluated as before, with temporaries created by Armadillo
+void armadilloApply(Bempp::TranspositionMode trans, const arma::Mat<RT>& mat,
+                    const arma::Mat<RT>& x, arma::Mat<RT>& y,
+                    RT alpha, RT beta)
+{
+    y *= beta;
+    switch (trans) {
+    case Bempp::NO_TRANSPOSE: y += alpha * mat * x; break;
+    case Bempp::CONJUGATE: y += alpha * arma::conj(mat) * x; break;
+    case Bempp::TRANSPOSE: y += alpha * mat.st() * x; break;
+    default: y += alpha * mat.t() * x; break;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace Bempp;
+
+    const int size = argc > 1 ? std::atoi(argv[1]) : 4000;
+    const int rhsCount = argc > 2 ? std::atoi(argv[2]) : 1;
+    const int repetitionCount = 5;
+
+    arma::Mat<RT> mat(size, size);
+    mat.randu();
+    DiscreteDenseBoundaryOperator<RT> op(mat);
+
+    arma::Mat<RT> x(size, rhsCount);
+    x.randu();
+    arma::Mat<RT> yOld(size, rhsCount), yNew(size, rhsCount);
+    const RT alpha(2., 1.), beta(0.5, -0.5);
+    // Each complex multiply-add costs 8 real floating-point operations
+    const double gflop = 8. * size * size * rhsCount * repetitionCount * 1e-9;
+
+    std::cout << "Matrix size: " << size << ", right-hand sides: "
+              << rhsCount << std::endl;
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, CONJUGATE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+    for (int m = 0; m < 4; ++m) {
+        yOld.fill(1.);
+        tbb::tick_count start = tbb::tick_count::now();
+        for (int i = 0; i < repetitionCount; ++i)
+            armadilloApply(modes[m], mat, x, yOld, alpha, beta);
+        const double oldTime = (tbb::tick_count::now() - start).seconds();
+
+        yNew.fill(1.);
+        start = tbb::tick_count::now();
+        for (int i = 0; i < repetitionCount; ++i)
+            op.apply(modes[m], x, yNew, alpha, beta);
+        const double newTime = (tbb::tick_count::now() - start).seconds();
+
+        const double error = arma::max(arma::max(arma::abs(yNew - yOld))) /
+                arma::max(arma::max(arma::abs(yOld)));
+        std::cout << modeName(modes[m]) << ": Armadillo "
+                  << gflop / oldTime << " GFLOP/s, BLAS "
+                  << gflop / newTime << " GFLOP/s (speedup "
+                  << oldTime / newTime << "), relative difference "
+                  << error << std::endl;
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Measures the scaling of dense-mode weak-form assembly with the number of
+// threads. Usage: benchmark_dense_assembly [mesh file] [max thread count]
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+
+#include "common/boost_make_shared_fwd.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tick_count.h>
+
+typedef double BFT; // basis function type
+typedef double RT; // result type (type used to represent discrete operators)
+
+int main(int argc, char* argv[])
+{
+    using namespace Bempp;
+
+    const char* meshFile = argc > 1 ? argv[1] : "meshes/sphere-h-0.1.msh";
+    const int maxThreadCount = argc > 2 ?
+                std::atoi(argv[2]) : tbb::task_scheduler_init::default_num_threads();
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(params, meshFile);
+
+    PiecewiseLinearContinuousScalarSpace<BFT> pwiseLinears(grid);
+    std::cout << "Mesh: " << meshFile << ", "
+              << pwiseLinears.globalDofCount() << " DOFs" << std::endl;
+
+    AccuracyOptions accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+
+    double serialTime = 0.;
+    for (int threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2) {
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.setMaxThreadCount(threadCount);
+        Context<BFT, RT> context(make_shared_from_ref(quadStrategy),
+                                 assemblyOptions);
+
+        BoundaryOperator<BFT, RT> slpOp =
+                laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    make_shared_from_ref(context),
+                    make_shared_from_ref(pwiseLinears),
+                    make_shared_from_ref(pwiseLinears),
+                    make_shared_from_ref(pwiseLinears));
+
+        tbb::tick_count start = tbb::tick_count::now();
+        slpOp.weakForm();
+        tbb::tick_count end = tbb::tick_count::now();
+        const double time = (end - start).seconds();
+        if (threadCount == 1)
+            serialTime = time;
+        std::cout << threadCount << " thread(s): " << time << " s, speedup "
+                  << serialTime / time << std::endl;
+    }
+}
@@ -0,0 +1,123 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Measures the number of kernel evaluations per second achieved by
+// DefaultCollectionOfKernels::evaluateOnGrid(), which uses the batched
+// evaluateBatch() entry point of kernel functors when available, and by
+// calling the functors' pointwise evaluate() member for each point pair.
+// Usage: benchmark_kernel_evaluation [test point count] [repetition count]
+
+#include "fiber/collection_of_4d_arrays.hpp"
+#include "fiber/default_collection_of_kernels.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_maxwell_3d_double_layer_operators_kernel_functor.hpp"
+
+#include "common/armadillo_fwd.hpp"
+
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tbb/tick_count.h>
+
+namespace
+{
+
+template <typename Functor>
+void benchmark(const std::string& name, const Functor& functor,
+               int testPointCount, int repetitionCount)
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+
+    // Quadrature points of a pair of well-separated elements
+    const int trialPointCount = testPointCount;
+    Fiber::GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    testGeomData.globals = arma::randu<arma::Mat<CoordinateType> >(
+                3, testPointCount);
+    testGeomData.normals = arma::randu<arma::Mat<CoordinateType> >(
+                3, testPointCount);
+    trialGeomData.globals = arma::randu<arma::Mat<CoordinateType> >(
+                3, trialPointCount);
+    trialGeomData.globals += 2.;
+    trialGeomData.normals = arma::randu<arma::Mat<CoordinateType> >(
+                3, trialPointCount);
+
+    Fiber::DefaultCollectionOfKernels<Functor> kernels(functor);
+    Fiber::CollectionOf4dArrays<ValueType> result;
+    kernels.evaluateOnGrid(testGeomData, trialGeomData, result); // warm-up
+
+    tbb::tick_count start = tbb::tick_count::now();
+    for (int r = 0; r < repetitionCount; ++r)
+        kernels.evaluateOnGrid(testGeomData, trialGeomData, result);
+    const double batchedTime = (tbb::tick_count::now() - start).seconds();
+
+    start = tbb::tick_count::now();
+    for (int r = 0; r < repetitionCount; ++r)
+        for (int trialIndex = 0; trialIndex < trialPointCount; ++trialIndex)
+            for (int testIndex = 0; testIndex < testPointCount; ++testIndex)
+                functor.evaluate(testGeomData.const_slice(testIndex),
+                                 trialGeomData.const_slice(trialIndex),
+                                 result.slice(testIndex, trialIndex).self());
+    const double pointwiseTime = (tbb::tick_count::now() - start).seconds();
+
+    const double evaluationCount =
+            double(repetitionCount) * testPointCount * trialPointCount;
+    std::cout << name << ": pointwise " << evaluationCount / pointwiseTime
+              << " evaluations/s, batched " << evaluationCount / batchedTime
+              << " evaluations/s, speedup " << pointwiseTime / batchedTime
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace Fiber;
+
+    const int testPointCount = argc > 1 ? std::atoi(argv[1]) : 256;
+    const int repetitionCount = argc > 2 ? std::atoi(argv[2]) : 200;
+    const std::complex<double> waveNumber(0.5, -2.);
+
+    benchmark("Laplace SLP (double)",
+              Laplace3dSingleLayerPotentialKernelFunctor<double>(),
+              testPointCount, repetitionCount);
+    benchmark("Laplace SLP (float)",
+              Laplace3dSingleLayerPotentialKernelFunctor<float>(),
+              testPointCount, repetitionCount);
+    benchmark("Laplace DLP (double)",
+              Laplace3dDoubleLayerPotentialKernelFunctor<double>(),
+              testPointCount, repetitionCount);
+    benchmark("Modified Helmholtz SLP (double)",
+              ModifiedHelmholtz3dSingleLayerPotentialKernelFunctor<double>(
+                  waveNumber.real()),
+              testPointCount, repetitionCount);
+    benchmark("Modified Helmholtz SLP (complex double)",
+              ModifiedHelmholtz3dSingleLayerPotentialKernelFunctor<
+                  std::complex<double> >(waveNumber),
+              testPointCount, repetitionCount);
+    benchmark("Modified Maxwell DLP (complex double)",
+              ModifiedMaxwell3dDoubleLayerOperatorsKernelFunctor<
+                  std::complex<double> >(waveNumber),
+              testPointCount, repetitionCount);
+}
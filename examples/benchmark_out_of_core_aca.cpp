@@ -0,0 +1,134 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Compares the matrix-vector product throughput of an H-matrix stored in
+// memory with that of the same H-matrix stored out of core. Usage:
+// benchmark_out_of_core_aca [mesh file] [memory budget in MB]
+//                           [scratch directory] [product count]
+
+#include "bempp/common/config_ahmed.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_aca_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/out_of_core_mblock_store.hpp"
+
+#include "common/boost_make_shared_fwd.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tbb/tick_count.h>
+
+typedef double BFT; // basis function type
+typedef double RT; // result type (type used to represent discrete operators)
+
+#ifdef WITH_AHMED
+
+using namespace Bempp;
+
+// Return the average time (in seconds) of productCount products with dop
+static double timeProducts(const DiscreteBoundaryOperator<RT>& dop,
+                           int productCount)
+{
+    arma::Col<RT> x(dop.columnCount());
+    x.fill(1.);
+    arma::Col<RT> y(dop.rowCount());
+    y.fill(0.);
+
+    tbb::tick_count start = tbb::tick_count::now();
+    for (int i = 0; i < productCount; ++i)
+        dop.apply(NO_TRANSPOSE, x, y, 1., 0.);
+    tbb::tick_count end = tbb::tick_count::now();
+    return (end - start).seconds() / productCount;
+}
+
+static shared_ptr<const DiscreteAcaBoundaryOperator<RT> > assembleWeakForm(
+        const shared_ptr<Space<BFT> >& space, const AcaOptions& acaOptions)
+{
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptions.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    BoundaryOperator<BFT, RT> slpOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, space, space, space);
+    return DiscreteAcaBoundaryOperator<RT>::castToAca(slpOp.weakForm());
+}
+
+int main(int argc, char* argv[])
+{
+    const char* meshFile = argc > 1 ? argv[1] : "meshes/sphere-h-0.1.msh";
+    const size_t memoryBudget =
+            size_t(argc > 2 ? std::atoi(argv[2]) : 64) << 20;
+    const std::string scratchDirectory = argc > 3 ? argv[3] : "";
+    const int productCount = argc > 4 ? std::atoi(argv[4]) : 10;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(params, meshFile);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    std::cout << "Mesh: " << meshFile << ", "
+              << pwiseLinears->globalDofCount() << " DOFs" << std::endl;
+
+    AcaOptions acaOptions;
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > inCoreOp =
+            assembleWeakForm(pwiseLinears, acaOptions);
+    const double inCoreTime = timeProducts(*inCoreOp, productCount);
+    std::cout << "In core: " << inCoreOp->memoryUsage() / 1048576. << " MB, "
+              << inCoreTime << " s per product" << std::endl;
+    inCoreOp.reset();
+
+    acaOptions.outOfCore = true;
+    acaOptions.outOfCoreDirectory = scratchDirectory;
+    acaOptions.outOfCoreMemoryBudget = memoryBudget;
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > outOfCoreOp =
+            assembleWeakForm(pwiseLinears, acaOptions);
+    const double outOfCoreTime = timeProducts(*outOfCoreOp, productCount);
+    std::cout << "Out of core: " << outOfCoreOp->memoryUsage() / 1048576.
+              << " MB on disk, budget " << memoryBudget / 1048576. << " MB, "
+              << outOfCoreTime << " s per product, slowdown "
+              << outOfCoreTime / inCoreTime << std::endl;
+}
+
+#else // WITH_AHMED
+
+int main()
+{
+    std::cout << "This benchmark requires BEM++ to be compiled with AHMED"
+              << std::endl;
+}
+
+#endif // WITH_AHMED
@@ -0,0 +1,142 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Compares the time and accuracy of direct and hierarchical evaluation of
+// the Laplace single-layer potential at points surrounding a surface.
+// Usage: benchmark_potential_evaluation [mesh file] [point count]
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/evaluation_options.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/laplace_3d_single_layer_potential_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/surface_normal_independent_function.hpp"
+
+#include "common/boost_make_shared_fwd.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <armadillo>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <tbb/tick_count.h>
+
+typedef double BFT; // basis function type
+typedef double RT; // result type (type used to represent discrete operators)
+typedef double CT; // coordinate type
+
+class DensityFunctor
+{
+public:
+    typedef RT ValueType;
+    typedef CT CoordinateType;
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = std::cos(point(0)) + point(1) * point(2);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    using namespace Bempp;
+
+    const char* meshFile = argc > 1 ? argv[1] : "meshes/sphere-h-0.1.msh";
+    const int pointCount = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(params, meshFile);
+
+    PiecewiseLinearContinuousScalarSpace<BFT> pwiseLinears(grid);
+    std::cout << "Mesh: " << meshFile << ", "
+              << pwiseLinears.globalDofCount() << " DOFs, "
+              << pointCount << " evaluation points" << std::endl;
+
+    AccuracyOptions accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    Context<BFT, RT> context(make_shared_from_ref(quadStrategy),
+                             assemblyOptions);
+
+    GridFunction<BFT, RT> density(
+                make_shared_from_ref(context),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                surfaceNormalIndependentFunction(DensityFunctor()));
+
+    // Scatter the evaluation points uniformly in a box twice as large as the
+    // bounding box of the surface
+    arma::Mat<CT> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    std::auto_ptr<GridView> view = grid->leafView();
+    view->getRawElementData(vertices, elementCorners, auxData);
+    arma::Col<CT> lower = arma::min(vertices, 1);
+    arma::Col<CT> upper = arma::max(vertices, 1);
+    arma::Col<CT> centre = 0.5 * (lower + upper);
+    arma::Col<CT> halfSize = upper - lower;
+    arma::Mat<CT> points(3, pointCount);
+    std::srand(1);
+    for (int i = 0; i < pointCount; ++i)
+        for (int d = 0; d < 3; ++d)
+            points(d, i) = centre(d) + halfSize(d) *
+                    (2. * std::rand() / RAND_MAX - 1.);
+
+    Laplace3dSingleLayerPotentialOperator<BFT, RT> slPotOp;
+
+    EvaluationOptions directOptions;
+    tbb::tick_count start = tbb::tick_count::now();
+    arma::Mat<RT> reference = slPotOp.evaluateAtPoints(
+                density, points, quadStrategy, directOptions);
+    tbb::tick_count end = tbb::tick_count::now();
+    const double directTime = (end - start).seconds();
+    std::cout << "Direct evaluation: " << directTime << " s" << std::endl;
+    const double referenceNorm = arma::norm(reference, "fro");
+
+    const int orders[] = {3, 4, 5, 6, 8};
+    for (size_t i = 0; i < sizeof(orders) / sizeof(orders[0]); ++i) {
+        HierarchicalEvaluationOptions hierarchicalOptions;
+        hierarchicalOptions.interpolationOrder = orders[i];
+        EvaluationOptions options;
+        options.switchToHierarchicalMode(hierarchicalOptions);
+
+        start = tbb::tick_count::now();
+        arma::Mat<RT> result = slPotOp.evaluateAtPoints(
+                    density, points, quadStrategy, options);
+        end = tbb::tick_count::now();
+        const double time = (end - start).seconds();
+        std::cout << "Hierarchical evaluation, order " << orders[i] << ": "
+                  << time << " s, speedup " << directTime / time
+                  << ", relative error "
+                  << arma::norm(result - reference, "fro") / referenceNorm
+                  << std::endl;
+    }
+}
@@ -19,7 +19,9 @@
 // THE SOFTWARE.
 
 #include "abstract_boundary_operator.hpp"
+#include "context.hpp"
 #include "discrete_boundary_operator.hpp"
+#include "local_assembler_construction_data_cache.hpp"
 #include "local_assembler_construction_helper.hpp"
 
 #include "../common/to_string.hpp"
@@ -181,6 +183,30 @@ AbstractBoundaryOperator<BasisFunctionType, ResultType>::collectDataForAssembler
                 openClHandler, cacheSingularIntegrals);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void
+AbstractBoundaryOperator<BasisFunctionType, ResultType>::collectDataForAssemblerConstruction(
+        const Context<BasisFunctionType, ResultType>& context,
+        shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& testRawGeometry,
+        shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& trialRawGeometry,
+        shared_ptr<GeometryFactory>& testGeometryFactory,
+        shared_ptr<GeometryFactory>& trialGeometryFactory,
+        shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType>*> >& testShapesets,
+        shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType>*> >& trialShapesets,
+        shared_ptr<Fiber::OpenClHandler>& openClHandler,
+        bool& cacheSingularIntegrals) const
+{
+    collectOptionsIndependentDataForAssemblerConstruction(
+                context,
+                testRawGeometry, trialRawGeometry,
+                testGeometryFactory, trialGeometryFactory,
+                testShapesets, trialShapesets);
+    collectOptionsDependentDataForAssemblerConstruction(
+                context.assemblyOptions(),
+                testRawGeometry, trialRawGeometry,
+                openClHandler, cacheSingularIntegrals);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 void
 AbstractBoundaryOperator<BasisFunctionType, ResultType>::
@@ -212,6 +238,34 @@ collectOptionsIndependentDataForAssemblerConstruction(
         Helper::collectShapesets(*m_domain, trialShapesets);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void
+AbstractBoundaryOperator<BasisFunctionType, ResultType>::
+collectOptionsIndependentDataForAssemblerConstruction(
+        const Context<BasisFunctionType, ResultType>& context,
+        shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& testRawGeometry,
+        shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& trialRawGeometry,
+        shared_ptr<GeometryFactory>& testGeometryFactory,
+        shared_ptr<GeometryFactory>& trialGeometryFactory,
+        shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType>*> >& testShapesets,
+        shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType>*> >& trialShapesets) const
+{
+    const shared_ptr<LocalAssemblerConstructionDataCache<BasisFunctionType> >
+            cache = context.localAssemblerConstructionDataCache();
+    const AssemblyOptions& options = context.assemblyOptions();
+
+    // Collect grid data. Spaces defined on the same grid get the same raw
+    // geometry.
+    cache->getGridData(*m_dualToRange, options,
+                       testRawGeometry, testGeometryFactory);
+    cache->getGridData(*m_domain, options,
+                       trialRawGeometry, trialGeometryFactory);
+
+    // Get pointers to test and trial shapesets of each element
+    cache->getShapesets(m_dualToRange, testShapesets);
+    cache->getShapesets(m_domain, trialShapesets);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 void
 AbstractBoundaryOperator<BasisFunctionType, ResultType>::
@@ -227,6 +281,11 @@ collectOptionsDependentDataForAssemblerConstruction(
     Helper::makeOpenClHandler(options.parallelizationOptions().openClOptions(),
                               testRawGeometry, trialRawGeometry, openClHandler);
     cacheSingularIntegrals = options.isSingularIntegralCachingEnabled();
+    // Singular integrals are cached for pairs of adjacent elements; let all
+    // operators defined on the same grid share the adjacency lists
+    if (cacheSingularIntegrals && testRawGeometry == trialRawGeometry)
+        Helper::attachElementAdjacency(*m_dualToRange, testRawGeometry,
+                                       options.parallelizationOptions());
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(AbstractBoundaryOperator);
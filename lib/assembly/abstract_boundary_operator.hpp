@@ -239,6 +239,24 @@ protected:
             shared_ptr<Fiber::OpenClHandler>& openClHandler,
             bool& cacheSingularIntegrals) const;
 
+    /** \brief Given a Context object, construct objects necessary for
+     *  subsequent local assembler construction.
+     *
+     *  Grid and space data are taken from the cache owned by \p context, so
+     *  that they are shared by all operators assembled with that context. */
+    void collectDataForAssemblerConstruction(
+            const Context<BasisFunctionType_, ResultType_>& context,
+            shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& testRawGeometry,
+            shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& trialRawGeometry,
+            shared_ptr<GeometryFactory>& testGeometryFactory,
+            shared_ptr<GeometryFactory>& trialGeometryFactory,
+            shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_>*> >&
+                testShapesets,
+            shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_>*> >&
+                trialShapesets,
+            shared_ptr<Fiber::OpenClHandler>& openClHandler,
+            bool& cacheSingularIntegrals) const;
+
     /** \brief Construct those objects necessary for subsequent local
      *  assembler construction that are independent from assembly options. */
     void collectOptionsIndependentDataForAssemblerConstruction(
@@ -251,6 +269,20 @@ protected:
             shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_>*> >&
                 trialShapesets) const;
 
+    /** \brief Construct those objects necessary for subsequent local
+     *  assembler construction that are independent from assembly options,
+     *  taking them from the cache owned by \p context. */
+    void collectOptionsIndependentDataForAssemblerConstruction(
+            const Context<BasisFunctionType_, ResultType_>& context,
+            shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& testRawGeometry,
+            shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& trialRawGeometry,
+            shared_ptr<GeometryFactory>& testGeometryFactory,
+            shared_ptr<GeometryFactory>& trialGeometryFactory,
+            shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_>*> >&
+                testShapesets,
+            shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_>*> >&
+                trialShapesets) const;
+
     /** \brief Construct those objects necessary for
      *  subsequent local assembler construction that depend on assembly options. */
     void collectOptionsDependentDataForAssemblerConstruction(
@@ -375,6 +375,7 @@ assembleJointOperatorWeakFormInAcaMode(
         if (verbose)
             std::cout << "Collecting data for assembler construction..." << std::endl;
         this->collectOptionsIndependentDataForAssemblerConstruction(
+                    context,
                     testRawGeometry, trialRawGeometry,
                     testGeometryFactory, trialGeometryFactory,
                     testShapesets, trialShapesets);
@@ -63,8 +63,11 @@ AcaApproximateLuInverse<ValueType>::AcaApproximateLuInverse(
         std::cout << "Starting H-LU decomposition..." << std::endl;
     tbb::tick_count start = tbb::tick_count::now();
     const blcluster* fwdBlockCluster = fwdOp.m_blockCluster.get();
+    // Loads the mblocks into memory if they are stored out of core
+    typename DiscreteAcaBoundaryOperator<ValueType>::AhmedMblockArray
+            fwdBlocks = fwdOp.blocks();
     bool result = genLUprecond(const_cast<blcluster*>(fwdBlockCluster),
-                               fwdOp.m_blocks.get(),
+                               fwdBlocks.get(),
                                delta, fwdOp.m_maximumRank,
                                m_blockCluster, m_blocksL, m_blocksU, true);
     tbb::tick_count end = tbb::tick_count::now();
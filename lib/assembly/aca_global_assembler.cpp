@@ -23,6 +23,7 @@
 
 #include "aca_global_assembler.hpp"
 
+#include "aca_recompression.hpp"
 #include "assembly_options.hpp"
 #include "block_coalescer.hpp"
 #include "cluster_construction_helper.hpp"
@@ -31,12 +32,15 @@
 #include "index_permutation.hpp"
 #include "discrete_boundary_operator_composition.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
+#include "weak_form_cache_key.hpp"
 
 #include "../common/armadillo_fwd.hpp"
 #include "../common/auto_timer.hpp"
+#include "../common/boost_make_shared_fwd.hpp"
 #include "../common/boost_shared_array_fwd.hpp"
 #include "../common/chunk_statistics.hpp"
 #include "../common/to_string.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
 #include "../fiber/local_assembler_for_potential_operators.hpp"
@@ -44,15 +48,16 @@
 #include "../fiber/scalar_traits.hpp"
 #include "../space/space.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <fstream>
 #include <iostream>
 
 #include <boost/type_traits/is_complex.hpp>
+#include <boost/type_traits/is_same.hpp>
 
 #include <tbb/atomic.h>
-#include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
+#include <tbb/blocked_range.h>
 #include <tbb/concurrent_queue.h>
 
 #ifdef WITH_AHMED
@@ -69,7 +74,10 @@
 #endif
 
 #include "discrete_aca_boundary_operator.hpp"
+#include "discrete_operator_serialization.hpp"
+#include "mixed_precision_mblock_array.hpp"
 #include "modified_aca.hpp"
+#include "out_of_core_mblock_store.hpp"
 #include "potential_operator_aca_assembly_helper.hpp"
 #include "scattered_range.hpp"
 #include "weak_form_aca_assembly_helper.hpp"
@@ -125,8 +133,10 @@ public:
             boost::shared_array<AhmedMblock*> blocks,
             boost::shared_array<AhmedMblock*> flatLocalBlocks,
             BlockCoalescer<ResultType>* coalescer,
+            OutOfCoreMblockStore<ResultType>* outOfCoreStore,
             const AcaOptions& options,
             tbb::atomic<size_t>& done,
+            tbb::atomic<size_t>& truncatedValueCount,
             bool verbose,
             bool symmetric,
             std::vector<ChunkStatistics>& stats) :
@@ -137,7 +147,9 @@ public:
         m_blocks(blocks),
         m_flatLocalBlocks(flatLocalBlocks),
         m_coalescer(coalescer),
-        m_options(options), m_done(done), m_verbose(verbose),
+        m_outOfCoreStore(outOfCoreStore),
+        m_options(options), m_done(done),
+        m_truncatedValueCount(truncatedValueCount), m_verbose(verbose),
         m_leafClusterIndexQueue(leafClusterIndexQueue),
         m_symmetric(symmetric),
         m_stats(stats)
@@ -209,8 +221,21 @@ public:
             }
             if (!globalAssembly)
                 m_coalescer->coalesceBlock(cluster->getidx());
+            if (m_options.recompress) {
+                AhmedMblock* block = m_blocks[cluster->getidx()];
+                const size_t valueCount = block->nvals();
+                if (truncateLowRankMblock<ResultType>(block, m_options.eps))
+                    m_truncatedValueCount += valueCount - block->nvals();
+            }
+            if (m_outOfCoreStore) {
+                // Move the block to the scratch file
+                const unsigned int index =
+                        m_leafClusters[leafClusterIndex]->getidx();
+                m_outOfCoreStore->storeMblock(index, *m_blocks[index]);
+                delete m_blocks[index];
+                m_blocks[index] = 0;
+            }
             m_stats[leafClusterIndex].endTime = tbb::tick_count::now();
-            // TODO: recompress
             const int HASH_COUNT = 20;
             if (m_verbose)
                 progressbar(std::cout, TEXT, (++m_done) - 1,
@@ -227,8 +252,10 @@ private:
     boost::shared_array<AhmedMblock*> m_blocks;
     boost::shared_array<AhmedMblock*> m_flatLocalBlocks;
     BlockCoalescer<ResultType>* m_coalescer;
+    OutOfCoreMblockStore<ResultType>* m_outOfCoreStore;
     const AcaOptions& m_options;
     tbb::atomic<size_t>& m_done;
+    tbb::atomic<size_t>& m_truncatedValueCount;
     bool m_verbose;
     LeafClusterIndexQueue& m_leafClusterIndexQueue;
     bool m_symmetric;
@@ -406,6 +433,42 @@ void reorderIdentically(AhmedLeafClusterArray& leafClusters,
         assert(leafClusters[i]->getidx() == refLeafClusters[i]->getidx());
 }
 
+/** Return true if some mblocks of H-matrices assembled with the given options
+ *  are to be stored in single precision. */
+template <typename ResultType>
+bool isMixedPrecisionStorageRequested(const AcaOptions& acaOptions)
+{
+    typedef typename SinglePrecisionTraits<ResultType>::Type SingleResultType;
+    return acaOptions.storagePrecision != AcaOptions::FULL_PRECISION &&
+            !acaOptions.outOfCore &&
+            !boost::is_same<SingleResultType, ResultType>::value;
+}
+
+/** Add to the cache key a few entries of the matrix to be approximated.
+ *  They depend on the kernel parameters of the operator and on any sparse
+ *  terms added to it, which cannot be inspected directly. */
+template <typename ResultType, typename AcaAssemblyHelper>
+void addMatrixEntrySample(WeakFormCacheKey& key,
+                          const AcaAssemblyHelper& helper,
+                          unsigned int rowCount, unsigned int columnCount)
+{
+    const unsigned int SAMPLE_SIZE = 4;
+    const unsigned int n1 = std::min(SAMPLE_SIZE, rowCount);
+    const unsigned int n2 = std::min(SAMPLE_SIZE, columnCount);
+    if (n1 == 0 || n2 == 0)
+        return;
+    // The first block lies on the diagonal (in the permuted ordering, the
+    // first DOFs belong to the same cluster) and involves singular
+    // integrals; the second one is typically far from the diagonal
+    const unsigned int rowStarts[] = { 0, rowCount - n1 };
+    std::vector<ResultType> data(n1 * n2);
+    for (int i = 0; i < 2; ++i) {
+        helper.cmpbl(rowStarts[i], n1, 0, n2, ahmedCast(&data[0]),
+                     0, 0, false /* countAccessedEntries */);
+        key.add(data);
+    }
+}
+
 template <typename AcaAssemblyHelper,
           typename BasisFunctionType, typename ResultType>
 std::auto_ptr<DiscreteAcaBoundaryOperator<ResultType> >
@@ -424,7 +487,9 @@ assembleAcaOperator(
         const shared_ptr<IndexPermutation>& test_o2pPermutation,
         const shared_ptr<IndexPermutation>& trial_o2pPermutation,
         const shared_ptr<const Epetra_CrsMatrix>& permutedTestGlobalToLocalMap,
-        const shared_ptr<const Epetra_CrsMatrix>& permutedTrialGlobalToLocalMap
+        const shared_ptr<const Epetra_CrsMatrix>& permutedTrialGlobalToLocalMap,
+        const std::string& cacheFileName,
+        const std::string& cacheKey
 #ifdef DUMP_DENSE_BLOCKS
         ,
         const shared_ptr<IndexPermutation>& test_p2oPermutation,
@@ -459,17 +524,10 @@ assembleAcaOperator(
     AhmedLeafClusterArray localLeafClusters(localBlclusterTree.get());
     reorderIdentically(localLeafClusters, leafClusters);
 
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled())
-    {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
     tbb::atomic<size_t> done;
     done = 0;
+    tbb::atomic<size_t> truncatedValueCount;
+    truncatedValueCount = 0;
 
 #ifdef DUMP_DENSE_BLOCKS
     if (acaOptions.firstClusterIndex >= 0)
@@ -482,50 +540,114 @@ assembleAcaOperator(
 
     std::vector<ChunkStatistics> chunkStats(leafClusterCount);
 
-    typedef AcaAssemblerLoopBody<
-            BasisFunctionType, ResultType, AcaAssemblyHelper> Body;
-    typename Body::LeafClusterIndexQueue leafClusterIndexQueue;
-    for (size_t i = 0; i < leafClusterCount; ++i)
-        leafClusterIndexQueue.push(i);
-
-    std::auto_ptr<BlockCoalescer<ResultType> > coalescer;
-    if (!indexWithGlobalDofs)
-        coalescer.reset(new BlockCoalescer<ResultType>(
-                            blclusterTree.get(),
-                            localBlclusterTree.get(),
-                            permutedTestGlobalToLocalMap,
-                            permutedTrialGlobalToLocalMap,
-                            blocks, decomposedBlocks,
-                            acaOptions));
-    if (verbosityAtLeastDefault)
-        std::cout << "About to start the ACA assembly loop" << std::endl;
-    tbb::tick_count loopStart = tbb::tick_count::now();
-    {
-        Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is single-threaded
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, leafClusterCount),
-                          Body(helper, admissibleHelper,
-                               leafClusters, localLeafClusters,
-                               leafClusterIndexQueue,
-                               blocks, decomposedBlocks,
-                               coalescer.get(),
-                               acaOptions, done, verbosityAtLeastDefault,
-                               symmetric, chunkStats));
+    // If requested, the mblocks are moved to a scratch file as soon as they
+    // have been assembled. The complete set of mblocks is then never
+    // available in memory, so they can be neither cached nor agglomerated.
+    shared_ptr<OutOfCoreMblockStore<ResultType> > outOfCoreStore;
+    if (acaOptions.outOfCore) {
+        outOfCoreStore = boost::make_shared<OutOfCoreMblockStore<ResultType> >(
+                    acaOptions.outOfCoreDirectory, blclusterTree->nleaves(),
+                    acaOptions.outOfCoreMemoryBudget);
+        if (verbosityAtLeastDefault)
+            std::cout << "Storing mblocks in " << outOfCoreStore->fileName()
+                      << std::endl;
     }
-    tbb::tick_count loopEnd = tbb::tick_count::now();
-    if (verbosityAtLeastDefault) {
-        std::cout << "\n"; // the progress bar doesn't print the final \n
-        std::cout << "ACA loop took " << (loopEnd - loopStart).seconds() << " s"
-                  << std::endl;
+    const bool useCache = !cacheFileName.empty() && !outOfCoreStore;
+
+    // Try to load the mblocks from the on-disk cache. They are stored before
+    // agglomeration, which may change the block cluster tree.
+    bool loadedFromCache = false;
+    if (useCache) {
+        try {
+            loadedFromCache = loadAhmedMblocks<ResultType>(
+                        *blclusterTree, blocks.get(), cacheFileName, cacheKey);
+        }
+        catch (std::exception& e) {
+            if (verbosityAtLeastDefault)
+                std::cout << "Warning: " << e.what() << std::endl;
+        }
+        if (loadedFromCache && verbosityAtLeastDefault)
+            std::cout << "Loaded mblocks from " << cacheFileName << std::endl;
     }
 
-    // TODO: parallelise!
-    if (acaOptions.recompress) {
+    if (!loadedFromCache) {
+        typedef AcaAssemblerLoopBody<
+                BasisFunctionType, ResultType, AcaAssemblyHelper> Body;
+        typename Body::LeafClusterIndexQueue leafClusterIndexQueue;
+        for (size_t i = 0; i < leafClusterCount; ++i)
+            leafClusterIndexQueue.push(i);
+
+        std::auto_ptr<BlockCoalescer<ResultType> > coalescer;
+        if (!indexWithGlobalDofs)
+            coalescer.reset(new BlockCoalescer<ResultType>(
+                                blclusterTree.get(),
+                                localBlclusterTree.get(),
+                                permutedTestGlobalToLocalMap,
+                                permutedTrialGlobalToLocalMap,
+                                blocks, decomposedBlocks,
+                                acaOptions));
         if (verbosityAtLeastDefault)
+            std::cout << "About to start the ACA assembly loop" << std::endl;
+        tbb::tick_count loopStart = tbb::tick_count::now();
+        {
+            Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is single-threaded
+            Fiber::ExecutionContext::instance().parallelFor(
+                        parallelOptions,
+                        tbb::blocked_range<size_t>(0, leafClusterCount),
+                        Body(helper, admissibleHelper,
+                             leafClusters, localLeafClusters,
+                             leafClusterIndexQueue,
+                             blocks, decomposedBlocks,
+                             coalescer.get(), outOfCoreStore.get(),
+                             acaOptions, done, truncatedValueCount,
+                             verbosityAtLeastDefault,
+                             symmetric, chunkStats));
+        }
+        tbb::tick_count loopEnd = tbb::tick_count::now();
+        if (verbosityAtLeastDefault) {
+            std::cout << "\n"; // the progress bar doesn't print the final \n
+            std::cout << "ACA loop took " << (loopEnd - loopStart).seconds() << " s"
+                      << std::endl;
+        }
+
+        if (useCache) {
+            try {
+                saveAhmedMblocks<ResultType>(*blclusterTree, blocks.get(),
+                                             cacheFileName, cacheKey);
+            }
+            catch (std::exception& e) {
+                if (verbosityAtLeastDefault)
+                    std::cout << "Warning: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    if (acaOptions.recompress && !outOfCoreStore) {
+        // The low-rank blocks have already been truncated in the loop above
+        size_t truncatedMemory = 0;
+        if (verbosityAtLeastDefault) {
+            truncatedMemory = sizeH(blclusterTree.get(), blocks.get());
             std::cout << "About to start ACA agglomeration" << std::endl;
-        agglH(blclusterTree.get(), blocks.get(),
-              acaOptions.eps, acaOptions.maximumRank);
-        if (verbosityAtLeastDefault)
-            std::cout << "Agglomeration finished" << std::endl;
+        }
+        tbb::tick_count agglomerationStart = tbb::tick_count::now();
+        agglomerateMblocks<ResultType>(blclusterTree.get(), blocks.get(),
+                                       acaOptions.eps, acaOptions.maximumRank,
+                                       parallelOptions);
+        tbb::tick_count agglomerationEnd = tbb::tick_count::now();
+        if (verbosityAtLeastDefault) {
+            const size_t uncompressedMemory = truncatedMemory +
+                    truncatedValueCount * sizeof(ResultType);
+            std::cout << "Agglomeration took "
+                      << (agglomerationEnd - agglomerationStart).seconds()
+                      << " s\n"
+                      << "Storage before recompression: "
+                      << uncompressedMemory / 1024. / 1024. << " MB.\n"
+                      << "After truncation of low-rank blocks: "
+                      << truncatedMemory / 1024. / 1024. << " MB.\n"
+                      << "After agglomeration: "
+                      << sizeH(blclusterTree.get(), blocks.get()) / 1024. / 1024.
+                      << " MB." << std::endl;
+        }
     }
 
     // // Dump timing data of individual chunks
@@ -550,8 +672,12 @@ assembleAcaOperator(
 #endif
         size_t totalEntryCount = testDofCount * trialDofCount;
         size_t origMemory = sizeof(ResultType) * totalEntryCount;
-        size_t ahmedMemory = sizeH(blclusterTree.get(), blocks.get());
-        int maximumRank = Hmax_rank(blclusterTree.get(), blocks.get());
+        size_t ahmedMemory = outOfCoreStore ?
+                    outOfCoreStore->storedBytes() :
+                    sizeH(blclusterTree.get(), blocks.get());
+        int maximumRank = outOfCoreStore ?
+                    outOfCoreStore->maximumRank() :
+                    Hmax_rank(blclusterTree.get(), blocks.get());
         size_t accessedEntryCount = helper->accessedEntryCount();
         double accessedFraction = double(accessedEntryCount) / totalEntryCount;
         std::cout << "\nNeeded storage: "
@@ -592,7 +718,7 @@ assembleAcaOperator(
         std::cout << std::endl;
     }
 
-    if (acaOptions.outputPostscript) {
+    if (acaOptions.outputPostscript && !outOfCoreStore) {
         if (verbosityAtLeastDefault)
             std::cout << "Writing matrix partition ..." << std::flush;
         std::ofstream os(acaOptions.outputFname.c_str());
@@ -615,6 +741,36 @@ assembleAcaOperator(
             outSymmetry |= HERMITIAN;
     }
     typedef DiscreteAcaBoundaryOperator<ResultType> DiscreteAcaLinOp;
+    if (isMixedPrecisionStorageRequested<ResultType>(acaOptions)) {
+        // The weak-form cache, if any, has already been written in full
+        // precision
+        shared_ptr<MixedPrecisionMblockArray<ResultType> > mixedPrecisionBlocks =
+                boost::make_shared<MixedPrecisionMblockArray<ResultType> >(
+                    blocks, blclusterTree->nleaves(),
+                    acaOptions.storagePrecision ==
+                    AcaOptions::SINGLE_PRECISION_ALL_BLOCKS);
+        if (verbosityAtLeastDefault)
+            std::cout << "Storage after conversion to mixed precision: "
+                      << mixedPrecisionBlocks->memoryUsage() / 1024. / 1024.
+                      << " MB." << std::endl;
+        return std::auto_ptr<DiscreteAcaLinOp>(
+                    new DiscreteAcaLinOp(testDofCount, trialDofCount,
+                                         acaOptions.eps,
+                                         acaOptions.maximumRank,
+                                         blclusterTree, mixedPrecisionBlocks,
+                                         *trial_o2pPermutation, // domain
+                                         *test_o2pPermutation, // range
+                                         parallelOptions));
+    }
+    if (outOfCoreStore)
+        return std::auto_ptr<DiscreteAcaLinOp>(
+                    new DiscreteAcaLinOp(testDofCount, trialDofCount,
+                                         acaOptions.eps,
+                                         acaOptions.maximumRank,
+                                         blclusterTree, outOfCoreStore,
+                                         *trial_o2pPermutation, // domain
+                                         *test_o2pPermutation, // range
+                                         parallelOptions));
     std::auto_ptr<DiscreteAcaLinOp> acaOp(
                 new DiscreteAcaLinOp(testDofCount, trialDofCount,
                                      acaOptions.eps,
@@ -674,6 +830,20 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
         std::cout << "Warning: assembly of non-symmetric Hermitian H-matrices "
                      "is not supported yet. A general H-matrix will be assembled"
                   << std::endl;
+    if (symmetric && acaOptions.outOfCore) {
+        symmetric = false;
+        if (verbosityAtLeastDefault)
+            std::cout << "Warning: out-of-core storage of symmetric H-matrices "
+                         "is not supported. A general H-matrix will be assembled"
+                      << std::endl;
+    }
+    if (symmetric && isMixedPrecisionStorageRequested<ResultType>(acaOptions)) {
+        symmetric = false;
+        if (verbosityAtLeastDefault)
+            std::cout << "Warning: mixed-precision storage of symmetric "
+                         "H-matrices is not supported. A general H-matrix will "
+                         "be assembled" << std::endl;
+    }
 
 #ifndef WITH_TRILINOS
     if (!indexWithGlobalDofs)
@@ -858,6 +1028,36 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
         }
     }
 
+    // Name of the file storing the mblocks in the on-disk cache and the
+    // contents of the key stored with them
+    std::string cacheFileName, cacheKey;
+    if (!options.weakFormCacheDirectory().empty()) {
+        WeakFormCacheKey key;
+        key.addType<ResultType>();
+        key.addSpace(testSpace);
+        key.addSpace(trialSpace);
+        key.addAcaOptions(acaOptions);
+        key.addAssemblyOptions(options);
+        key.add(symmetric);
+        for (size_t i = 0; i < localAssemblers.size(); ++i)
+            key.add(localAssemblers[i]->signature());
+        for (size_t i = 0; i < localAssemblersForAdmissibleBlocks.size(); ++i)
+            key.add(localAssemblersForAdmissibleBlocks[i]->signature());
+        key.add(denseTermMultipliers);
+        key.add(sparseTermMultipliers);
+        addMatrixEntrySample<ResultType>(key, *helper,
+                                         test_o2pPermutation->size(),
+                                         trial_o2pPermutation->size());
+        if (!indexWithGlobalDofs)
+            addMatrixEntrySample<ResultType>(
+                        key, *admissibleHelper,
+                        testLocal_o2pPermutation->size(),
+                        trialLocal_o2pPermutation->size());
+        cacheFileName = key.fileName(options.weakFormCacheDirectory(),
+                                     "aca");
+        cacheKey = key.contents();
+    }
+
     std::auto_ptr<DiscreteAcaBoundaryOperator<ResultType> > acaOp =
     assembleAcaOperator<AcaAssemblyHelper, BasisFunctionType, ResultType>(
                 helper.get(), admissibleHelper.get(),
@@ -865,7 +1065,8 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
                 options.parallelizationOptions(), acaOptions,
                 verbosityAtLeastDefault, verbosityAtLeastHigh, symmetric,
                 test_o2pPermutation, trial_o2pPermutation,
-                testGlobalToLocal, trialGlobalToLocal
+                testGlobalToLocal, trialGlobalToLocal,
+                cacheFileName, cacheKey
 #ifdef DUMP_DENSE_BLOCKS
                 ,
                 test_p2oPermutation, trial_p2oPermutation,
@@ -1005,7 +1206,8 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assemblePotentialOperator(
                 options.parallelizationOptions(), options.acaOptions(),
                 verbosityAtLeastDefault, verbosityAtLeastHigh, symmetric,
                 test_o2pPermutation, trial_o2pPermutation,
-                testGlobalToLocal, trialGlobalToLocal
+                testGlobalToLocal, trialGlobalToLocal,
+                std::string() // potential operators are not cached
 #ifdef DUMP_DENSE_BLOCKS
                 ,
                 test_p2oPermutation, trial_p2oPermutation,
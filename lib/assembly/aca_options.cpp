@@ -38,6 +38,9 @@ AcaOptions::AcaOptions() :
     scaling(1.0),
     useAhmedAca(false),
     firstClusterIndex(-1),
+    outOfCore(false),
+    outOfCoreMemoryBudget(256 << 20),
+    storagePrecision(FULL_PRECISION),
     globalAssemblyBeforeCompression(true)
 {
 }
@@ -23,6 +23,7 @@
 
 #include "../common/common.hpp"
 
+#include <cstddef>
 #include <string>
 
 namespace Bempp
@@ -201,11 +202,14 @@ struct AcaOptions
 
     /** \brief Recompress ACA matrix after construction?
      *
-     *  If true, blocks of H matrices are agglomerated in an attempt to reduce
+     *  If true, the rank of each low-rank block is reduced, right after the
+     *  block has been approximated, by a truncated SVD of its factors (with
+     *  relative accuracy \p eps). Once all blocks have been assembled,
+     *  blocks of H matrices are agglomerated in an attempt to further reduce
      *  memory consumption.
      *
-     *  Warning: this procedure is not parallelised yet, therefore it may be
-     *  slow.
+     *  The same procedure can be applied to an existing H-matrix with
+     *  DiscreteAcaBoundaryOperator::recompress().
      *
      *  Default value: false. */
     bool recompress;
@@ -255,6 +259,78 @@ struct AcaOptions
      */
     int firstClusterIndex;
 
+    /** \brief Store the H-matrix blocks out of core?
+     *
+     *  If true, each block is written to a scratch file as soon as it has
+     *  been approximated and its memory is released. Matrix-vector products
+     *  read the blocks back in the order of the cluster tree, overlapping
+     *  reading with computations; blocks that fit in the budget
+     *  #outOfCoreMemoryBudget are kept in memory between products. This
+     *  makes it possible to handle H-matrices larger than the available
+     *  memory, at the cost of slower matrix-vector products.
+     *
+     *  Operators declared as symmetric are assembled as general H-matrices
+     *  in this mode. Agglomeration of blocks (see #recompress)
+     *  and the on-disk cache of weak forms (see
+     *  AssemblyOptions::setWeakFormCacheDirectory()) are not used in this
+     *  mode, and #outputPostscript is ignored.
+     *
+     *  Default value: false. */
+    bool outOfCore;
+
+    /** \brief Directory in which the scratch files of H-matrices stored out
+     *  of core are created.
+     *
+     *  Should be located on a fast local disk. The files are deleted when
+     *  the corresponding operators are destroyed.
+     *
+     *  Default value: "" (the current working directory). */
+    std::string outOfCoreDirectory;
+
+    /** \brief Maximum number of bytes occupied by the blocks of an
+     *  H-matrix stored out of core that are kept in memory between
+     *  matrix-vector products.
+     *
+     *  Default value: 256 MB. */
+    size_t outOfCoreMemoryBudget;
+
+    /** \brief Precision in which the H-matrix blocks are stored. See
+     *  documentation of the member \p storagePrecision for more
+     *  information. */
+    enum StoragePrecision {
+        MIN_STORAGE_PRECISION,
+        FULL_PRECISION = MIN_STORAGE_PRECISION,
+        SINGLE_PRECISION_LOW_RANK_BLOCKS,
+        SINGLE_PRECISION_ALL_BLOCKS,
+        MAX_STORAGE_PRECISION = SINGLE_PRECISION_ALL_BLOCKS
+    };
+
+    /** \brief Precision in which the H-matrix blocks are stored.
+     *
+     *  If set to \p FULL_PRECISION (default), all blocks are stored in the
+     *  precision of the operator's value type.
+     *
+     *  If set to \p SINGLE_PRECISION_LOW_RANK_BLOCKS, the factors of
+     *  low-rank blocks of double-precision operators are stored in single
+     *  precision; if set to \p SINGLE_PRECISION_ALL_BLOCKS, dense blocks are
+     *  stored in single precision, too. Matrix-vector products convert the
+     *  values back to double precision on the fly and accumulate the results
+     *  in double precision. This halves the memory occupied by the converted
+     *  blocks and typically speeds up matrix-vector products, which are
+     *  limited by memory bandwidth. The relative error introduced by the
+     *  conversion (about 1e-7) is negligible as long as #eps is much larger;
+     *  dense blocks should only be converted if this holds also for the
+     *  accuracy required from the near-field interactions.
+     *
+     *  This option has no effect on single-precision operators and on
+     *  operators stored out of core (see #outOfCore). Operators declared as
+     *  symmetric are assembled as general H-matrices if any blocks are
+     *  stored in single precision. DiscreteAcaBoundaryOperator::recompress()
+     *  is not supported for such operators.
+     *
+     *  Default value: FULL_PRECISION. */
+    StoragePrecision storagePrecision;
+
     /** \brief Do global assembly before ACA?
      *
      *  \deprecated This parameter is deprecated and should not be used in new code.
@@ -0,0 +1,270 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "aca_recompression.hpp"
+
+#include "ahmed_aux.hpp"
+#include "ahmed_leaf_cluster_array.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/execution_context.hpp"
+#include "../fiber/parallelization_options.hpp"
+#include "../fiber/scalar_traits.hpp"
+#include "../fiber/serial_blas_region.hpp"
+
+#include <limits>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/task_scheduler_init.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Requested number of independent subtrees per thread processed during
+// agglomeration (to help load balancing)
+const size_t SUBTREES_PER_THREAD = 8;
+
+template <typename ValueType>
+class TruncationLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    TruncationLoopBody(const AhmedLeafClusterArray& leafClusters,
+                       AhmedMblock** blocks, double eps) :
+        m_leafClusters(leafClusters), m_blocks(blocks), m_eps(eps)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t leaf = r.begin(); leaf != r.end(); ++leaf)
+            truncateLowRankMblock<ValueType>(
+                        m_blocks[m_leafClusters[leaf]->getidx()], m_eps);
+    }
+
+private:
+    const AhmedLeafClusterArray& m_leafClusters;
+    AhmedMblock** m_blocks;
+    double m_eps;
+};
+
+template <typename ValueType>
+class AgglomerationLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    AgglomerationLoopBody(const std::vector<blcluster*>& subtrees,
+                          AhmedMblock** blocks, double eps,
+                          unsigned int maximumRank) :
+        m_subtrees(subtrees), m_blocks(blocks), m_eps(eps),
+        m_maximumRank(maximumRank)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t i = r.begin(); i != r.end(); ++i)
+            if (!m_subtrees[i]->isleaf())
+                agglH(m_subtrees[i], m_blocks, m_eps, m_maximumRank);
+    }
+
+private:
+    const std::vector<blcluster*>& m_subtrees;
+    AhmedMblock** m_blocks;
+    double m_eps;
+    unsigned int m_maximumRank;
+};
+
+bool allSonsAreLeaves(const blcluster* cluster)
+{
+    for (unsigned int r = 0; r < cluster->getnrs(); ++r)
+        for (unsigned int c = 0; c < cluster->getncs(); ++c) {
+            const blcluster* son = cluster->getson(r, c);
+            if (son && !son->isleaf())
+                return false;
+        }
+    return true;
+}
+
+} // namespace
+
+template <typename ValueType>
+bool truncateLowRankMblock(
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* block, double eps)
+{
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+    if (!block->isLrM())
+        return false;
+    const unsigned int n1 = block->getn1();
+    const unsigned int n2 = block->getn2();
+    const unsigned int rank = block->rank();
+    if (rank <= 1)
+        return false;
+
+    // The block is stored as U V^H, with U (n1 x rank) followed by
+    // V (n2 x rank)
+    const ValueType* data = reinterpret_cast<const ValueType*>(block->getdata());
+    const arma::Mat<ValueType> U(const_cast<ValueType*>(data), n1, rank,
+                                 false /* copy_aux_mem */);
+    const arma::Mat<ValueType> V(const_cast<ValueType*>(data + n1 * rank),
+                                 n2, rank, false /* copy_aux_mem */);
+
+    // U V^H = Qu (Ru Rv^H) Qv^H = (Qu W S) (Qv Z)^H, where W S Z^H is the SVD
+    // of the small matrix Ru Rv^H
+    arma::Mat<ValueType> Qu, Ru, Qv, Rv;
+    if (!arma::qr_econ(Qu, Ru, U) || !arma::qr_econ(Qv, Rv, V))
+        return false;
+    arma::Mat<ValueType> W, Z;
+    arma::Col<CoordinateType> s;
+    if (!arma::svd(W, s, Z, arma::Mat<ValueType>(Ru * Rv.t())))
+        return false;
+
+    unsigned int newRank = 1;
+    while (newRank < s.n_rows && s(newRank) > eps * s(0))
+        ++newRank;
+    if (newRank >= rank)
+        return false;
+
+    arma::Mat<ValueType> newU = Qu * W.cols(0, newRank - 1);
+    for (unsigned int k = 0; k < newRank; ++k)
+        newU.col(k) *= s(k);
+    arma::Mat<ValueType> newV = Qv * Z.cols(0, newRank - 1);
+    block->cpyLrM(newRank, ahmedCast(newU.memptr()), ahmedCast(newV.memptr()));
+    return true;
+}
+
+template <typename ValueType>
+void truncateLowRankMblocks(
+        blcluster* blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        double eps,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    AhmedLeafClusterArray leafClusters(blockCluster);
+    // Largest blocks first, so that they do not end up at the tail of the loop
+    leafClusters.sortAccordingToClusterSize();
+
+    Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is single-threaded
+    Fiber::ExecutionContext::instance().parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, leafClusters.size(), 1),
+                TruncationLoopBody<ValueType>(leafClusters, blocks, eps));
+}
+
+template <typename ValueType>
+void agglomerateMblocks(
+        blcluster* blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        double eps, int maximumRank,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    // Split the tree breadth-first into disjoint subtrees until there are
+    // enough of them to keep all threads busy. The nodes expanded on the
+    // way are stored in "ancestors", parents always before their sons.
+    const int maxThreadCount = parallelizationOptions.maxThreadCount();
+    const size_t threadCount = maxThreadCount == ParallelizationOptions::AUTO ?
+                tbb::task_scheduler_init::default_num_threads() :
+                maxThreadCount;
+    const size_t requestedSubtreeCount = SUBTREES_PER_THREAD * threadCount;
+
+    std::vector<blcluster*> ancestors;
+    std::vector<blcluster*> subtrees(1, blockCluster);
+    while (subtrees.size() < requestedSubtreeCount) {
+        std::vector<blcluster*> sons;
+        bool expanded = false;
+        for (size_t i = 0; i < subtrees.size(); ++i) {
+            blcluster* cluster = subtrees[i];
+            if (cluster->isleaf()) {
+                sons.push_back(cluster);
+                continue;
+            }
+            ancestors.push_back(cluster);
+            expanded = true;
+            for (unsigned int r = 0; r < cluster->getnrs(); ++r)
+                for (unsigned int c = 0; c < cluster->getncs(); ++c)
+                    if (blcluster* son = cluster->getson(r, c))
+                        sons.push_back(son);
+        }
+        subtrees.swap(sons);
+        if (!expanded)
+            break;
+    }
+
+    const unsigned int rankLimit = maximumRank < 0 ?
+                std::numeric_limits<int>::max() : maximumRank;
+    {
+        Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is single-threaded
+        Fiber::ExecutionContext::instance().parallelFor(
+                    parallelizationOptions,
+                    tbb::blocked_range<size_t>(0, subtrees.size(), 1),
+                    AgglomerationLoopBody<ValueType>(
+                        subtrees, blocks, eps, rankLimit));
+    }
+
+    // Now process the nodes lying above the subtrees, sons before parents.
+    // A node whose sons are all leaves can be handled by agglH() without
+    // revisiting the subtrees; otherwise some of its sons could not be
+    // coarsened and neither can it.
+    for (size_t i = ancestors.size(); i > 0; --i)
+        if (allSonsAreLeaves(ancestors[i - 1]))
+            agglH(ancestors[i - 1], blocks, eps, rankLimit);
+}
+
+#define INSTANTIATE_FREE_FUNCTIONS(RESULT) \
+    template bool truncateLowRankMblock<RESULT>( \
+            mblock<AhmedTypeTraits<RESULT>::Type>* block, double eps); \
+    template void truncateLowRankMblocks<RESULT>( \
+            blcluster* blockCluster, \
+            mblock<AhmedTypeTraits<RESULT>::Type>** blocks, \
+            double eps, \
+            const ParallelizationOptions& parallelizationOptions); \
+    template void agglomerateMblocks<RESULT>( \
+            blcluster* blockCluster, \
+            mblock<AhmedTypeTraits<RESULT>::Type>** blocks, \
+            double eps, int maximumRank, \
+            const ParallelizationOptions& parallelizationOptions)
+
+#if defined(ENABLE_SINGLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(float);
+#endif
+
+#if defined(ENABLE_SINGLE_PRECISION) && (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) || defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<float>);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(double);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION) && (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) || defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<double>);
+#endif
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
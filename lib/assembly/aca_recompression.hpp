@@ -0,0 +1,95 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_aca_recompression_hpp
+#define bempp_aca_recompression_hpp
+
+#include "../common/common.hpp"
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_aux_fwd.hpp"
+
+/** \cond FORWARD_DECL */
+class blcluster;
+namespace Fiber
+{
+class ParallelizationOptions;
+} // namespace Fiber
+/** \endcond */
+
+namespace Bempp
+{
+
+using Fiber::ParallelizationOptions;
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Reduce the rank of a low-rank mblock.
+ *
+ *  The factors \f$U\f$ and \f$V\f$ of the block \f$UV^H\f$ are orthogonalised
+ *  by QR decompositions and the product of their triangular factors is
+ *  truncated by a singular value decomposition, discarding the singular
+ *  values smaller than \p eps times the largest one.
+ *
+ *  Blocks that are not stored in the low-rank format are left untouched.
+ *
+ *  \return True if the rank of the block has been reduced. */
+template <typename ValueType>
+bool truncateLowRankMblock(
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* block, double eps);
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Reduce the ranks of all low-rank leaves of an H-matrix.
+ *
+ *  The leaves are processed in parallel, with truncateLowRankMblock() applied
+ *  to each of them. The structure of \p blockCluster is not changed. */
+template <typename ValueType>
+void truncateLowRankMblocks(
+        blcluster* blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        double eps,
+        const ParallelizationOptions& parallelizationOptions);
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Coarsen the block structure of an H-matrix.
+ *
+ *  Sibling leaves are replaced by a single low-rank block wherever this
+ *  reduces the storage and the rank of the merged block, approximated to
+ *  accuracy \p eps, does not exceed \p maximumRank. This is done by AHMED's
+ *  agglH() routine, applied concurrently to disjoint subtrees of \p
+ *  blockCluster; the few nodes lying above these subtrees are processed
+ *  afterwards, bottom-up.
+ *
+ *  \note \p blockCluster is modified. Any data derived from its leaves, such
+ *  as matrix-vector product schedules, must be rebuilt afterwards. */
+template <typename ValueType>
+void agglomerateMblocks(
+        blcluster* blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        double eps, int maximumRank,
+        const ParallelizationOptions& parallelizationOptions);
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
+
+#endif
@@ -0,0 +1,155 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ahmed_matvec_schedule.hpp"
+
+#ifdef WITH_AHMED
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/task_scheduler_init.h>
+
+#define BASMOD // prevent inclusion of Ahmed's basmod.h, which contains
+               // a conflicting definition of swap()
+using std::min;
+using std::max;
+inline unsigned pow2(unsigned k)
+{
+  return (1 << k);
+}
+#include <blcluster.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Minimum number of target indices per chunk
+const unsigned int MIN_CHUNK_SIZE = 64;
+// Requested number of chunks per thread (to help load balancing)
+const unsigned int CHUNKS_PER_THREAD = 16;
+
+} // namespace
+
+AhmedMatvecSchedule::AhmedMatvecSchedule(
+        blcluster* clusterTree, bool transposed,
+        unsigned int targetSize, unsigned int chunkSize,
+        const std::vector<unsigned int>& blockRanks) :
+    m_leafClusters(clusterTree), m_transposed(transposed)
+{
+    if (chunkSize == 0)
+        throw std::invalid_argument("AhmedMatvecSchedule::"
+                                    "AhmedMatvecSchedule(): "
+                                    "chunkSize must be positive");
+    const size_t leafCount = m_leafClusters.size();
+    if (blockRanks.size() != leafCount)
+        throw std::invalid_argument("AhmedMatvecSchedule::"
+                                    "AhmedMatvecSchedule(): "
+                                    "blockRanks must have one element per "
+                                    "leaf cluster");
+    m_coefficientOffsets.resize(leafCount + 1);
+    m_coefficientOffsets[0] = 0;
+    for (size_t i = 0; i < leafCount; ++i)
+        m_coefficientOffsets[i + 1] = m_coefficientOffsets[i] +
+                blockRanks[m_leafClusters[i]->getidx()];
+    std::vector<unsigned int> leafBegins(leafCount), leafEnds(leafCount);
+    for (size_t i = 0; i < leafCount; ++i) {
+        const blcluster* cluster = m_leafClusters[i];
+        leafBegins[i] = transposed ? cluster->getb2() : cluster->getb1();
+        leafEnds[i] = leafBegins[i] +
+                (transposed ? cluster->getn2() : cluster->getn1());
+        if (leafEnds[i] > targetSize)
+            throw std::invalid_argument("AhmedMatvecSchedule::"
+                                        "AhmedMatvecSchedule(): "
+                                        "leaf cluster exceeds target size");
+    }
+
+    // Leaf cluster boundaries are the preferred chunk boundaries
+    std::vector<unsigned int> boundaries(leafBegins);
+    boundaries.push_back(targetSize);
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+                     boundaries.end());
+
+    m_chunkBegins.push_back(0);
+    while (m_chunkBegins.back() < targetSize) {
+        const unsigned int ideal = m_chunkBegins.back() + chunkSize;
+        if (ideal >= targetSize) {
+            m_chunkBegins.push_back(targetSize);
+            break;
+        }
+        unsigned int next = *std::lower_bound(boundaries.begin(),
+                                              boundaries.end(), ideal);
+        // Leaf boundaries are too sparse here; a leaf will be split
+        if (next > ideal + chunkSize)
+            next = ideal;
+        m_chunkBegins.push_back(next);
+    }
+    const size_t chunkCount = m_chunkBegins.size() - 1;
+
+    // Find the chunk containing the first target index of each leaf; the
+    // leaf overlaps this chunk and possibly some of its successors
+    std::vector<size_t> firstChunks(leafCount);
+    m_sliceOffsets.assign(chunkCount + 1, 0);
+    for (size_t i = 0; i < leafCount; ++i) {
+        size_t chunk = std::upper_bound(m_chunkBegins.begin(),
+                                        m_chunkBegins.end(),
+                                        leafBegins[i]) -
+                m_chunkBegins.begin() - 1;
+        firstChunks[i] = chunk;
+        for (; chunk < chunkCount && m_chunkBegins[chunk] < leafEnds[i];
+             ++chunk)
+            ++m_sliceOffsets[chunk + 1];
+    }
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        m_sliceOffsets[chunk + 1] += m_sliceOffsets[chunk];
+
+    m_slices.resize(m_sliceOffsets.back());
+    std::vector<size_t> fillPositions(m_sliceOffsets.begin(),
+                                      m_sliceOffsets.end() - 1);
+    for (size_t i = 0; i < leafCount; ++i)
+        for (size_t chunk = firstChunks[i];
+             chunk < chunkCount && m_chunkBegins[chunk] < leafEnds[i];
+             ++chunk) {
+            Slice& slice = m_slices[fillPositions[chunk]++];
+            slice.leaf = i;
+            slice.begin = std::max(leafBegins[i], m_chunkBegins[chunk]);
+            slice.end = std::min(leafEnds[i], m_chunkBegins[chunk + 1]);
+        }
+}
+
+std::auto_ptr<AhmedMatvecSchedule>
+AhmedMatvecScheduleInitializer::operator()() const
+{
+    const unsigned int threadCount =
+            tbb::task_scheduler_init::default_num_threads();
+    const unsigned int chunkSize =
+            std::max(MIN_CHUNK_SIZE,
+                     m_targetSize / (CHUNKS_PER_THREAD * threadCount));
+    return std::auto_ptr<AhmedMatvecSchedule>(
+                new AhmedMatvecSchedule(m_clusterTree, m_transposed,
+                                        m_targetSize, chunkSize,
+                                        m_blockRanks));
+}
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
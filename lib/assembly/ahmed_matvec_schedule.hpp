@@ -0,0 +1,178 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_ahmed_matvec_schedule_hpp
+#define bempp_ahmed_matvec_schedule_hpp
+
+#include "../common/common.hpp"
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_leaf_cluster_array.hpp"
+
+#include <memory>
+#include <vector>
+
+/** \cond FORWARD_DECL */
+class blcluster;
+/** \endcond */
+
+namespace Bempp
+{
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Assignment of the leaves of an H-matrix to disjoint ranges of
+ *  target indices.
+ *
+ *  The target indices are the row indices of the H-matrix or, for
+ *  (conjugate-)transposed products, its column indices. The target index
+ *  range is split into chunks whose boundaries coincide with those of leaf
+ *  clusters whenever possible. Each chunk holds a list of slices, i.e. the
+ *  parts of the leaves whose target ranges overlap the chunk. A
+ *  matrix-vector product can then be evaluated by processing the chunks
+ *  concurrently, each writing only to its own part of the result vector.
+ *
+ *  The schedule also assigns each low-rank leaf a fixed place in the buffer
+ *  of low-rank coefficients (see lowRankCoefficientOffset()), so that
+ *  products need not recompute it.
+ */
+class AhmedMatvecSchedule
+{
+public:
+    /** \brief Part of a leaf block restricted to a range of target indices. */
+    struct Slice
+    {
+        /** \brief Index of the leaf cluster in leafClusters(). */
+        size_t leaf;
+        /** \brief First target index covered by the slice. */
+        unsigned int begin;
+        /** \brief One past the last target index covered by the slice. */
+        unsigned int end;
+    };
+
+    /** \brief Constructor.
+     *
+     *  \param[in] clusterTree Block cluster tree of the H-matrix.
+     *  \param[in] transposed If true, the schedule partitions the column
+     *    indices of the H-matrix, otherwise its row indices.
+     *  \param[in] targetSize Number of rows (columns if \p transposed is
+     *    true) of the H-matrix.
+     *  \param[in] chunkSize Requested number of target indices per chunk.
+     *  \param[in] blockRanks Vector whose <em>i</em>th element is the rank
+     *    of the mblock with index \e i if that block is low-rank, and zero
+     *    otherwise. */
+    AhmedMatvecSchedule(blcluster* clusterTree, bool transposed,
+                        unsigned int targetSize, unsigned int chunkSize,
+                        const std::vector<unsigned int>& blockRanks);
+
+    /** \brief Return the array of leaf clusters referenced by the slices. */
+    const AhmedLeafClusterArray& leafClusters() const {
+        return m_leafClusters;
+    }
+
+    /** \brief Return true if the schedule partitions column indices. */
+    bool transposed() const {
+        return m_transposed;
+    }
+
+    /** \brief Return the number of chunks. */
+    size_t chunkCount() const {
+        return m_chunkBegins.size() - 1;
+    }
+
+    /** \brief Return the first target index of chunk \p chunk. */
+    unsigned int chunkBegin(size_t chunk) const {
+        return m_chunkBegins[chunk];
+    }
+
+    /** \brief Return the one-past-last target index of chunk \p chunk. */
+    unsigned int chunkEnd(size_t chunk) const {
+        return m_chunkBegins[chunk + 1];
+    }
+
+    /** \brief Return a pointer to the first slice of chunk \p chunk. */
+    const Slice* chunkSlicesBegin(size_t chunk) const {
+        return m_slices.empty() ? 0 : &m_slices[0] + m_sliceOffsets[chunk];
+    }
+
+    /** \brief Return a pointer past the last slice of chunk \p chunk. */
+    const Slice* chunkSlicesEnd(size_t chunk) const {
+        return m_slices.empty() ? 0 : &m_slices[0] + m_sliceOffsets[chunk + 1];
+    }
+
+    /** \brief Return the rank of the block of leaf \p leaf if it is
+     *  low-rank, and zero otherwise. */
+    unsigned int leafRank(size_t leaf) const {
+        return m_coefficientOffsets[leaf + 1] - m_coefficientOffsets[leaf];
+    }
+
+    /** \brief Return the offset of the low-rank coefficients of leaf \p
+     *  leaf in a coefficient buffer, per column of the argument.
+     *
+     *  In a product with a matrix of \e k columns the coefficients of leaf
+     *  \p leaf form a <tt>leafRank(leaf)</tt> x \e k block starting at
+     *  position <tt>k * lowRankCoefficientOffset(leaf)</tt>. */
+    size_t lowRankCoefficientOffset(size_t leaf) const {
+        return m_coefficientOffsets[leaf];
+    }
+
+    /** \brief Return the number of low-rank coefficients per column of the
+     *  argument. */
+    size_t lowRankCoefficientCount() const {
+        return m_coefficientOffsets.back();
+    }
+
+private:
+    AhmedLeafClusterArray m_leafClusters;
+    bool m_transposed;
+    std::vector<size_t> m_coefficientOffsets;
+    std::vector<unsigned int> m_chunkBegins;
+    std::vector<size_t> m_sliceOffsets;
+    std::vector<Slice> m_slices;
+};
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Functor constructing an AhmedMatvecSchedule, for use with Lazy. */
+class AhmedMatvecScheduleInitializer
+{
+public:
+    AhmedMatvecScheduleInitializer(blcluster* clusterTree, bool transposed,
+                                   unsigned int targetSize,
+                                   const std::vector<unsigned int>& blockRanks) :
+        m_clusterTree(clusterTree), m_transposed(transposed),
+        m_targetSize(targetSize), m_blockRanks(blockRanks) {
+    }
+
+    std::auto_ptr<AhmedMatvecSchedule> operator()() const;
+
+private:
+    blcluster* m_clusterTree;
+    bool m_transposed;
+    unsigned int m_targetSize;
+    std::vector<unsigned int> m_blockRanks;
+};
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
+
+#endif
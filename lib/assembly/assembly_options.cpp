@@ -56,6 +56,10 @@ void AssemblyOptions::switchToAcaMode(const AcaOptions& acaOptions)
         (int)canonicalAcaOptions.reactionToUnsupportedMode > AcaOptions::MAX_REACTION)
         throw std::invalid_argument("AssemblyOptions::switchToAcaMode(): "
                                     "invalid reaction to unsupported mode");
+    if ((int)canonicalAcaOptions.storagePrecision < AcaOptions::MIN_STORAGE_PRECISION ||
+        (int)canonicalAcaOptions.storagePrecision > AcaOptions::MAX_STORAGE_PRECISION)
+        throw std::invalid_argument("AssemblyOptions::switchToAcaMode(): "
+                                    "invalid storage precision");
     m_assemblyMode = ACA;
     m_acaOptions = canonicalAcaOptions;
 }
@@ -171,4 +175,14 @@ bool AssemblyOptions::isQuadratureOrderUniformInEachCluster() const
     return m_uniformQuadrature;
 }
 
+void AssemblyOptions::setWeakFormCacheDirectory(const std::string& directory)
+{
+    m_weakFormCacheDirectory = directory;
+}
+
+const std::string& AssemblyOptions::weakFormCacheDirectory() const
+{
+    return m_weakFormCacheDirectory;
+}
+
 } // namespace Bempp
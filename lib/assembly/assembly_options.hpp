@@ -30,6 +30,8 @@
 #include "../fiber/parallelization_options.hpp"
 #include "../fiber/verbosity_level.hpp"
 
+#include <string>
+
 namespace Bempp
 {
 
@@ -235,6 +237,28 @@ public:
      *  See makeQuadratureOrderUniformInEachCluster() for more information. */
     bool isQuadratureOrderUniformInEachCluster() const;
 
+    /** \brief Set the directory of the on-disk cache of discrete weak forms.
+     *
+     *  If \p directory is not empty, discrete weak forms of integral
+     *  operators assembled in the dense mode or in the ACA mode are stored in
+     *  files placed in this directory, and later assemblies of the same weak
+     *  form (even in a different process) load them instead of repeating the
+     *  computation. The file names are content hashes of the type of matrix
+     *  entries, the grids, spaces, assembly and ACA options, the signature of
+     *  the operator and of a small sample of matrix entries, which depend on
+     *  its kernel parameters; the hashed data are stored in the files and
+     *  compared on loading (see WeakFormCacheKey). The directory must
+     *  exist.
+     *
+     *  By default the cache is disabled (\p directory is empty). */
+    void setWeakFormCacheDirectory(const std::string& directory);
+
+    /** \brief Return the directory of the on-disk cache of discrete weak
+     *  forms, or an empty string if the cache is disabled.
+     *
+     *  See setWeakFormCacheDirectory() for more information. */
+    const std::string& weakFormCacheDirectory() const;
+
     /** @} */
 
 private:
@@ -248,6 +272,7 @@ private:
     bool m_jointAssembly;
     bool m_uniformQuadrature;
     Value m_blasInQuadrature;
+    std::string m_weakFormCacheDirectory;
     /** \endcond */
 };
 
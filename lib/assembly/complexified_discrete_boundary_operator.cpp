@@ -91,26 +91,38 @@ void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInImpl(
         arma::Col<ValueType>& y_inout,
         const ValueType alpha,
         const ValueType beta) const
+{
+    applyBuiltInMultiVectorImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename RealType>
+void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
 {
     if (beta == static_cast<ValueType>(0.))
         y_inout.fill(static_cast<ValueType>(0.));
     else
         y_inout *= beta;
 
-    arma::Col<RealType> x_re = arma::real(x_in);
-    arma::Col<RealType> x_im = arma::imag(x_in);
-
-    arma::Col<RealType> y_re = arma::real(y_inout);
-    arma::Col<RealType> y_im = arma::imag(y_inout);
-
-    m_operator->apply(trans, x_re, y_re, alpha.real(), 1.);
-    m_operator->apply(trans, x_im, y_re, -alpha.imag(), 1.);
-
-    m_operator->apply(trans, x_re, y_im, alpha.imag(), 1.);
-    m_operator->apply(trans, x_im, y_im, alpha.real(), 1.);
-
-    y_inout.set_real(y_re);
-    y_inout.set_imag(y_im);
+    const size_t vectorCount = x_in.n_cols;
+    if (vectorCount == 0)
+        return;
+
+    // Apply the real operator to the real and imaginary parts of all the
+    // vectors in a single call
+    arma::Mat<RealType> x_re_im = arma::join_rows(arma::real(x_in),
+                                                  arma::imag(x_in));
+    arma::Mat<RealType> y_re_im(y_inout.n_rows, 2 * vectorCount);
+    m_operator->apply(trans, x_re_im, y_re_im, 1., 0.);
+
+    arma::Mat<ValueType> product(
+                y_re_im.cols(0, vectorCount - 1),
+                y_re_im.cols(vectorCount, 2 * vectorCount - 1));
+    y_inout += alpha * product;
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT_REAL_ONLY(
@@ -34,7 +34,10 @@ Context<BasisFunctionType, ResultType>::Context(
         const shared_ptr<const QuadratureStrategy>& quadStrategy,
         const AssemblyOptions& assemblyOptions) :
     m_quadStrategy(quadStrategy),
-    m_assemblyOptions(assemblyOptions)
+    m_assemblyOptions(assemblyOptions),
+    m_localAssemblerConstructionDataCache(
+        boost::make_shared<LocalAssemblerConstructionDataCache<
+        BasisFunctionType> >())
 {
     if (quadStrategy.get() == 0)
         throw std::invalid_argument("Context::Context(): "
@@ -6,6 +6,7 @@
 #include "../fiber/quadrature_strategy.hpp"
 #include "assembly_options.hpp"
 #include "discrete_boundary_operator_cache.hpp"
+#include "local_assembler_construction_data_cache.hpp"
 
 namespace Bempp
 {
@@ -75,9 +76,20 @@ public:
         return m_quadStrategy;
     }
 
+    /** \brief Return the cache of grid and space data shared by all local
+     *  assemblers constructed with this Context.
+     *
+     *  This function is intended for internal use of the library. */
+    shared_ptr<LocalAssemblerConstructionDataCache<BasisFunctionType> >
+    localAssemblerConstructionDataCache() const {
+        return m_localAssemblerConstructionDataCache;
+    }
+
 private:
     shared_ptr<const QuadratureStrategy> m_quadStrategy;
     AssemblyOptions m_assemblyOptions;
+    shared_ptr<LocalAssemblerConstructionDataCache<BasisFunctionType> >
+    m_localAssemblerConstructionDataCache;
 };
 
 } // namespace Bempp
@@ -0,0 +1,332 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "csr_assembly_helper.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/execution_context.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/parallelization_options.hpp"
+
+#include <algorithm>
+#include <boost/type_traits/is_complex.hpp>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+#include <tbb/blocked_range.h>
+
+#ifdef WITH_TRILINOS
+#include "../common/boost_make_shared_fwd.hpp"
+// This is a workaround of the problem of the abs() function being declared
+// both in Epetra and in AHMED. It relies of the implementation detail (!) that
+// in Epetra the declaration of abs is put between #ifndef __IBMCPP__ ...
+// #endif. So it may well break in future versions of Trilinos. The ideal
+// solution would be for AHMED to use namespaces.
+#ifndef __IBMCPP__
+#define __IBMCPP__
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+#undef __IBMCPP__
+#else
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+#endif
+#endif // WITH_TRILINOS
+
+namespace Bempp
+{
+
+namespace
+{
+
+typedef std::vector<std::vector<GlobalDofIndex> > GlobalDofLists;
+typedef std::vector<std::pair<int, int> > ContributionList;
+
+/** Store in \p columns the sorted, unique global trial DOFs coupled to
+ *  global test DOF \p row. */
+inline void collectRowColumns(
+        size_t row,
+        const std::vector<size_t>& contributionOffsets,
+        const ContributionList& contributions,
+        const GlobalDofLists& trialGlobalDofs,
+        std::vector<int>& columns)
+{
+    columns.clear();
+    for (size_t i = contributionOffsets[row];
+         i < contributionOffsets[row + 1]; ++i) {
+        const std::vector<GlobalDofIndex>& elementTrialDofs =
+                trialGlobalDofs[contributions[i].first];
+        for (size_t j = 0; j < elementTrialDofs.size(); ++j)
+            if (elementTrialDofs[j] >= 0)
+                columns.push_back(elementTrialDofs[j]);
+    }
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+}
+
+/** Loop body counting the nonzero entries in each row. */
+class RowLengthLoopBody
+{
+public:
+    RowLengthLoopBody(
+            const std::vector<size_t>& contributionOffsets,
+            const ContributionList& contributions,
+            const GlobalDofLists& trialGlobalDofs,
+            std::vector<size_t>& rowLengths) :
+        m_contributionOffsets(contributionOffsets),
+        m_contributions(contributions),
+        m_trialGlobalDofs(trialGlobalDofs),
+        m_rowLengths(rowLengths)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> columns;
+        for (size_t row = r.begin(); row != r.end(); ++row) {
+            collectRowColumns(row, m_contributionOffsets, m_contributions,
+                              m_trialGlobalDofs, columns);
+            m_rowLengths[row] = columns.size();
+        }
+    }
+
+private:
+    const std::vector<size_t>& m_contributionOffsets;
+    const ContributionList& m_contributions;
+    const GlobalDofLists& m_trialGlobalDofs;
+    std::vector<size_t>& m_rowLengths;
+};
+
+/** Loop body filling the column indices and values of each row. */
+template <typename BasisFunctionType, typename ResultType>
+class RowFillLoopBody
+{
+public:
+    RowFillLoopBody(
+            const std::vector<size_t>& contributionOffsets,
+            const ContributionList& contributions,
+            const GlobalDofLists& trialGlobalDofs,
+            const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
+            const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
+            const std::vector<arma::Mat<ResultType> >& localWeakForms,
+            const std::vector<size_t>& rowOffsets,
+            std::vector<int>& columnIndices,
+            std::vector<ResultType>& values) :
+        m_contributionOffsets(contributionOffsets),
+        m_contributions(contributions),
+        m_trialGlobalDofs(trialGlobalDofs),
+        m_testLocalDofWeights(testLocalDofWeights),
+        m_trialLocalDofWeights(trialLocalDofWeights),
+        m_localWeakForms(localWeakForms),
+        m_rowOffsets(rowOffsets),
+        m_columnIndices(columnIndices),
+        m_values(values)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> columns;
+        for (size_t row = r.begin(); row != r.end(); ++row) {
+            collectRowColumns(row, m_contributionOffsets, m_contributions,
+                              m_trialGlobalDofs, columns);
+            const size_t rowBegin = m_rowOffsets[row];
+            assert(m_rowOffsets[row + 1] - rowBegin == columns.size());
+            std::copy(columns.begin(), columns.end(),
+                      m_columnIndices.begin() + rowBegin);
+            std::fill(m_values.begin() + rowBegin,
+                      m_values.begin() + rowBegin + columns.size(),
+                      static_cast<ResultType>(0.));
+
+            for (size_t i = m_contributionOffsets[row];
+                 i < m_contributionOffsets[row + 1]; ++i) {
+                const int element = m_contributions[i].first;
+                const int testLdof = m_contributions[i].second;
+                const std::vector<GlobalDofIndex>& elementTrialDofs =
+                        m_trialGlobalDofs[element];
+                const BasisFunctionType testWeight =
+                        conj(m_testLocalDofWeights[element][testLdof]);
+                const arma::Mat<ResultType>& localWeakForm =
+                        m_localWeakForms[element];
+                for (size_t trialLdof = 0; trialLdof < elementTrialDofs.size();
+                     ++trialLdof) {
+                    const int column = elementTrialDofs[trialLdof];
+                    if (column < 0)
+                        continue;
+                    const size_t position = rowBegin + (std::lower_bound(
+                        columns.begin(), columns.end(), column) -
+                        columns.begin());
+                    m_values[position] +=
+                            testWeight *
+                            m_trialLocalDofWeights[element][trialLdof] *
+                            localWeakForm(testLdof, trialLdof);
+                }
+            }
+        }
+    }
+
+private:
+    const std::vector<size_t>& m_contributionOffsets;
+    const ContributionList& m_contributions;
+    const GlobalDofLists& m_trialGlobalDofs;
+    const std::vector<std::vector<BasisFunctionType> >& m_testLocalDofWeights;
+    const std::vector<std::vector<BasisFunctionType> >& m_trialLocalDofWeights;
+    const std::vector<arma::Mat<ResultType> >& m_localWeakForms;
+    const std::vector<size_t>& m_rowOffsets;
+    std::vector<int>& m_columnIndices;
+    std::vector<ResultType>& m_values;
+};
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+void CsrAssemblyHelper<BasisFunctionType, ResultType>::assembleFromLocalWeakForms(
+        const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
+        const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
+        const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
+        const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
+        const std::vector<arma::Mat<ResultType> >& localWeakForms,
+        size_t testGlobalDofCount,
+        const ParallelizationOptions& parallelizationOptions,
+        std::vector<size_t>& rowOffsets,
+        std::vector<int>& columnIndices,
+        std::vector<ResultType>& values)
+{
+    const size_t elementCount = testGlobalDofs.size();
+    if (trialGlobalDofs.size() != elementCount ||
+            testLocalDofWeights.size() != elementCount ||
+            trialLocalDofWeights.size() != elementCount ||
+            localWeakForms.size() != elementCount)
+        throw std::invalid_argument(
+                "CsrAssemblyHelper::assembleFromLocalWeakForms(): "
+                "all element-level arrays must have the same length");
+
+    // List the (element, local DOF) pairs contributing to each global test
+    // DOF. Negative global DOF indices denote constrained (unused) local DOFs.
+    std::vector<size_t> contributionOffsets(testGlobalDofCount + 1, 0);
+    for (size_t e = 0; e < elementCount; ++e)
+        for (size_t i = 0; i < testGlobalDofs[e].size(); ++i)
+            if (testGlobalDofs[e][i] >= 0)
+                ++contributionOffsets[testGlobalDofs[e][i] + 1];
+    for (size_t dof = 0; dof < testGlobalDofCount; ++dof)
+        contributionOffsets[dof + 1] += contributionOffsets[dof];
+    ContributionList contributions(contributionOffsets[testGlobalDofCount]);
+    {
+        std::vector<size_t> positions(contributionOffsets.begin(),
+                                      contributionOffsets.end() - 1);
+        for (size_t e = 0; e < elementCount; ++e)
+            for (size_t i = 0; i < testGlobalDofs[e].size(); ++i)
+                if (testGlobalDofs[e][i] >= 0)
+                    contributions[positions[testGlobalDofs[e][i]]++] =
+                            std::make_pair(int(e), int(i));
+    }
+
+    Fiber::ExecutionContext& executionContext =
+            Fiber::ExecutionContext::instance();
+    const size_t grainSize =
+            Fiber::ExecutionContext::grainSize(parallelizationOptions);
+
+    // Determine the number of nonzero entries in each row
+    std::vector<size_t> rowLengths(testGlobalDofCount);
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, testGlobalDofCount, grainSize),
+                RowLengthLoopBody(contributionOffsets, contributions,
+                                  trialGlobalDofs, rowLengths));
+    rowOffsets.resize(testGlobalDofCount + 1);
+    rowOffsets[0] = 0;
+    for (size_t row = 0; row < testGlobalDofCount; ++row)
+        rowOffsets[row + 1] = rowOffsets[row] + rowLengths[row];
+
+    // Fill the rows
+    columnIndices.resize(rowOffsets[testGlobalDofCount]);
+    values.resize(rowOffsets[testGlobalDofCount]);
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, testGlobalDofCount, grainSize),
+                RowFillLoopBody<BasisFunctionType, ResultType>(
+                    contributionOffsets, contributions, trialGlobalDofs,
+                    testLocalDofWeights, trialLocalDofWeights, localWeakForms,
+                    rowOffsets, columnIndices, values));
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+shared_ptr<Epetra_CrsMatrix> createEpetraCrsMatrix(
+        size_t rowCount, size_t columnCount,
+        const std::vector<size_t>& rowOffsets,
+        const std::vector<int>& columnIndices,
+        const std::vector<ValueType>& values)
+{
+    assert(rowOffsets.size() == rowCount + 1);
+    assert(columnIndices.size() == rowOffsets[rowCount]);
+    assert(values.size() == rowOffsets[rowCount]);
+
+    if (boost::is_complex<ValueType>::value)
+        for (size_t i = 0; i < values.size(); ++i)
+            if (imagPart(values[i]) != 0.)
+                throw std::invalid_argument(
+                        "createEpetraCrsMatrix(): Epetra matrices cannot "
+                        "store entries with nonzero imaginary parts");
+
+    std::vector<int> rowLengths(rowCount);
+    for (size_t row = 0; row < rowCount; ++row)
+        rowLengths[row] = rowOffsets[row + 1] - rowOffsets[row];
+
+    Epetra_SerialComm comm; // To be replaced once we begin to use MPI
+    Epetra_LocalMap rowMap(int(rowCount), 0 /* index_base */, comm);
+    Epetra_LocalMap colMap(int(columnCount), 0 /* index_base */, comm);
+    shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+                Copy, rowMap, colMap,
+                rowLengths.empty() ? 0 : &rowLengths[0],
+                true /* static profile */);
+
+    std::vector<double> rowValues;
+    std::vector<int> rowIndices;
+    for (size_t row = 0; row < rowCount; ++row) {
+        const int length = rowLengths[row];
+        if (length == 0)
+            continue;
+        const size_t begin = rowOffsets[row];
+        rowValues.resize(length);
+        rowIndices.assign(columnIndices.begin() + begin,
+                          columnIndices.begin() + begin + length);
+        for (int entry = 0; entry < length; ++entry)
+            rowValues[entry] = realPart(values[begin + entry]);
+        result->InsertGlobalValues(int(row), length,
+                                   &rowValues[0], &rowIndices[0]);
+    }
+    result->FillComplete(colMap /* domain map */, rowMap /* range map */);
+    return result;
+}
+
+#define INSTANTIATE_CREATE_EPETRA_CRS_MATRIX(VALUE) \
+    template shared_ptr<Epetra_CrsMatrix> createEpetraCrsMatrix( \
+        size_t rowCount, size_t columnCount, \
+        const std::vector<size_t>& rowOffsets, \
+        const std::vector<int>& columnIndices, \
+        const std::vector<VALUE>& values)
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_CREATE_EPETRA_CRS_MATRIX);
+#endif // WITH_TRILINOS
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(CsrAssemblyHelper);
+
+} // namespace Bempp
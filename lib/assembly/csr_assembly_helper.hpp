@@ -0,0 +1,130 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_csr_assembly_helper_hpp
+#define bempp_csr_assembly_helper_hpp
+
+#include "../common/common.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../common/types.hpp"
+
+#include <vector>
+
+/** \cond FORWARD_DECL */
+namespace Fiber
+{
+class ParallelizationOptions;
+} // namespace Fiber
+
+#ifdef WITH_TRILINOS
+class Epetra_CrsMatrix;
+#endif
+/** \endcond */
+
+namespace Bempp
+{
+
+using Fiber::ParallelizationOptions;
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Assembly of sparse matrices in the compressed sparse row (CSR)
+ *  format from element-level contributions.
+ *
+ *  The nonzero entries of row \p i of a matrix stored in the CSR format are
+ *  <tt>values[rowOffsets[i]]</tt>, ...,
+ *  <tt>values[rowOffsets[i + 1] - 1]</tt>; they lie in the columns
+ *  <tt>columnIndices[rowOffsets[i]]</tt>, ...,
+ *  <tt>columnIndices[rowOffsets[i + 1] - 1]</tt>, which are sorted in
+ *  ascending order. */
+template <typename BasisFunctionType, typename ResultType>
+struct CsrAssemblyHelper
+{
+    /** \brief Assemble a sparse matrix from the weak forms of an operator on
+     *  individual elements.
+     *
+     *  \param[in] testGlobalDofs
+     *    Vector whose <em>e</em>th element contains the global test DOF
+     *    indices corresponding to the local test DOFs on element \p e.
+     *    Negative indices denote local DOFs not associated with any global
+     *    DOF.
+     *  \param[in] trialGlobalDofs
+     *    Analogous vector of global trial DOF indices.
+     *  \param[in] testLocalDofWeights
+     *    Weights of the local test DOFs on each element.
+     *  \param[in] trialLocalDofWeights
+     *    Weights of the local trial DOFs on each element.
+     *  \param[in] localWeakForms
+     *    Vector whose <em>e</em>th element contains the weak form of the
+     *    operator on element \p e, with rows corresponding to local test
+     *    DOFs and columns to local trial DOFs.
+     *  \param[in] testGlobalDofCount
+     *    Number of rows of the matrix.
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used.
+     *  \param[out] rowOffsets, columnIndices, values
+     *    The assembled matrix in the CSR format.
+     *
+     *  The sparsity pattern is obtained from the element-DOF connectivity:
+     *  entry (\p i, \p j) is stored if there is an element on which global
+     *  test DOF \p i and global trial DOF \p j both have a local DOF. Each
+     *  row is then filled by a single task, which gathers the contributions
+     *  of all elements adjacent to the corresponding test DOF. Hence no
+     *  locking is needed and the result does not depend on the number of
+     *  threads. */
+    static void assembleFromLocalWeakForms(
+            const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
+            const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
+            const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
+            const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
+            const std::vector<arma::Mat<ResultType> >& localWeakForms,
+            size_t testGlobalDofCount,
+            const ParallelizationOptions& parallelizationOptions,
+            std::vector<size_t>& rowOffsets,
+            std::vector<int>& columnIndices,
+            std::vector<ResultType>& values);
+};
+
+#ifdef WITH_TRILINOS
+/** \ingroup weak_form_assembly_internal
+ *  \brief Create an Epetra_CrsMatrix from a matrix stored in the CSR format.
+ *
+ *  The row lengths are known in advance, so the matrix is created with a
+ *  static profile, filled one row at a time and completed with explicit
+ *  domain and range maps.
+ *
+ *  Epetra stores real numbers in double precision only. Matrices of complex
+ *  type are accepted only if all their entries are real, as those of local
+ *  operators on spaces of real basis functions are; otherwise a
+ *  std::invalid_argument exception is thrown rather than the imaginary
+ *  parts being discarded. */
+template <typename ValueType>
+shared_ptr<Epetra_CrsMatrix> createEpetraCrsMatrix(
+        size_t rowCount, size_t columnCount,
+        const std::vector<size_t>& rowOffsets,
+        const std::vector<int>& columnIndices,
+        const std::vector<ValueType>& values);
+#endif // WITH_TRILINOS
+
+} // namespace Bempp
+
+#endif
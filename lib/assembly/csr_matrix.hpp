@@ -0,0 +1,67 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_csr_matrix_hpp
+#define bempp_csr_matrix_hpp
+
+#include "../common/common.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace Bempp
+{
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Sparse matrix stored in the compressed sparse row (CSR) format.
+ *
+ *  The nonzero entries of row \p i are <tt>values[rowOffsets[i]]</tt>, ...,
+ *  <tt>values[rowOffsets[i + 1] - 1]</tt>; they lie in the columns
+ *  <tt>columnIndices[rowOffsets[i]]</tt>, ...,
+ *  <tt>columnIndices[rowOffsets[i + 1] - 1]</tt>, which should be sorted in
+ *  ascending order. The vector \p rowOffsets has <tt>rowCount + 1</tt>
+ *  elements. */
+template <typename ValueType>
+struct CsrMatrix
+{
+    CsrMatrix() :
+        rowCount(0), columnCount(0), rowOffsets(1, 0)
+    {}
+
+    CsrMatrix(size_t rowCount_, size_t columnCount_) :
+        rowCount(rowCount_), columnCount(columnCount_),
+        rowOffsets(rowCount_ + 1, 0)
+    {}
+
+    /** \brief Number of stored entries. */
+    size_t nonzeroCount() const {
+        return columnIndices.size();
+    }
+
+    size_t rowCount;
+    size_t columnCount;
+    std::vector<size_t> rowOffsets;
+    std::vector<int> columnIndices;
+    std::vector<ValueType> values;
+};
+
+} // namespace Bempp
+
+#endif
@@ -24,11 +24,14 @@
 
 #include "assembly_options.hpp"
 #include "discrete_dense_boundary_operator.hpp"
+#include "discrete_operator_serialization.hpp"
 #include "context.hpp"
+#include "weak_form_cache_key.hpp"
 
 #include "../common/auto_timer.hpp"
 #include "../common/multidimensional_arrays.hpp"
 #include "../common/not_implemented_error.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/serial_blas_region.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
@@ -44,9 +47,8 @@
 #include <stdexcept>
 #include <iostream>
 
-#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <tbb/spin_mutex.h>
-#include <tbb/task_scheduler_init.h>
 //#include <tbb/tick_count.h>
 
 namespace Bempp
@@ -65,15 +67,22 @@ class DenseWeakFormAssemblerLoopBody
 public:
     typedef tbb::spin_mutex MutexType;
 
+    /** \brief Constructor.
+     *
+     *  The loop runs over the elements listed in \p trialIndices. If \p mutex
+     *  is null, the caller guarantees that no two elements in this list share
+     *  a global DOF, so that the contributions of different elements go to
+     *  disjoint columns of \p result and can be added without locking. */
     DenseWeakFormAssemblerLoopBody(
             const std::vector<int>& testIndices,
+            const std::vector<int>& trialIndices,
             const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
             const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
             const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
             const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
             Fiber::LocalAssemblerForIntegralOperators<ResultType>& assembler,
-            arma::Mat<ResultType>& result, MutexType& mutex) :
-        m_testIndices(testIndices),
+            arma::Mat<ResultType>& result, MutexType* mutex) :
+        m_testIndices(testIndices), m_trialIndices(trialIndices),
         m_testGlobalDofs(testGlobalDofs), m_trialGlobalDofs(trialGlobalDofs),
         m_testLocalDofWeights(testLocalDofWeights),
         m_trialLocalDofWeights(trialLocalDofWeights),
@@ -81,45 +90,53 @@ public:
     }
 
     void operator() (const tbb::blocked_range<size_t>& r) const {
-        const int elementCount = m_testIndices.size();
         std::vector<arma::Mat<ResultType> > localResult;
-        for (size_t trialIndex = r.begin(); trialIndex != r.end(); ++trialIndex) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            const int trialIndex = m_trialIndices[i];
             // Evaluate integrals over pairs of the current trial element and
             // all the test elements
             m_assembler.evaluateLocalWeakForms(TEST_TRIAL, m_testIndices, trialIndex,
                                                ALL_DOFS, localResult);
 
-            const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
             // Global assembly
-            {
-                MutexType::scoped_lock lock(m_mutex);
-                // Loop over test indices
-                for (int testIndex = 0; testIndex < elementCount; ++testIndex) {
-                    const int testDofCount = m_testGlobalDofs[testIndex].size();
-                    // Add the integrals to appropriate entries in the operator's matrix
-                    for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
-                        int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
-                        if (trialGlobalDof < 0)
-                            continue;
-                        for (int testDof = 0; testDof < testDofCount; ++testDof) {
-                            int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
-                            if (testGlobalDof < 0)
-                                continue;
-                            assert(std::abs(m_testLocalDofWeights[testIndex][testDof]) > 0.);
-                            assert(std::abs(m_trialLocalDofWeights[trialIndex][trialDof]) > 0.);
-                            m_result(testGlobalDof, trialGlobalDof) +=
-                                    conj(m_testLocalDofWeights[testIndex][testDof]) *
-                                    m_trialLocalDofWeights[trialIndex][trialDof] *
-                                    localResult[testIndex](testDof, trialDof);
-                        }
-                    }
+            if (m_mutex) {
+                MutexType::scoped_lock lock(*m_mutex);
+                scatter(trialIndex, localResult);
+            } else
+                scatter(trialIndex, localResult);
+        }
+    }
+
+private:
+    void scatter(int trialIndex,
+                 const std::vector<arma::Mat<ResultType> >& localResult) const {
+        const int elementCount = m_testIndices.size();
+        const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
+        // Loop over test indices
+        for (int testIndex = 0; testIndex < elementCount; ++testIndex) {
+            const int testDofCount = m_testGlobalDofs[testIndex].size();
+            // Add the integrals to appropriate entries in the operator's matrix
+            for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
+                int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
+                if (trialGlobalDof < 0)
+                    continue;
+                for (int testDof = 0; testDof < testDofCount; ++testDof) {
+                    int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
+                    if (testGlobalDof < 0)
+                        continue;
+                    assert(std::abs(m_testLocalDofWeights[testIndex][testDof]) > 0.);
+                    assert(std::abs(m_trialLocalDofWeights[trialIndex][trialDof]) > 0.);
+                    m_result(testGlobalDof, trialGlobalDof) +=
+                            conj(m_testLocalDofWeights[testIndex][testDof]) *
+                            m_trialLocalDofWeights[trialIndex][trialDof] *
+                            localResult[testIndex](testDof, trialDof);
                 }
             }
         }
     }
 
-private:
     const std::vector<int>& m_testIndices;
+    const std::vector<int>& m_trialIndices;
     const std::vector<std::vector<GlobalDofIndex> >& m_testGlobalDofs;
     const std::vector<std::vector<GlobalDofIndex> >& m_trialGlobalDofs;
     const std::vector<std::vector<BasisFunctionType> >& m_testLocalDofWeights;
@@ -127,13 +144,46 @@ private:
     // mutable OK because Assembler is thread-safe. (Alternative to "mutable" here:
     // make assembler's internal integrator map mutable)
     typename Fiber::LocalAssemblerForIntegralOperators<ResultType>& m_assembler;
-    // mutable OK because write access to this matrix is protected by a mutex
+    // mutable OK because write access to this matrix is either protected by
+    // a mutex or restricted to columns owned by a single thread
     arma::Mat<ResultType>& m_result;
 
-    // mutex must be mutable because we need to lock and unlock it
-    MutexType& m_mutex;
+    // null if the elements in m_trialIndices do not share any global DOFs
+    MutexType* m_mutex;
 };
 
+/** Partition elements into groups ("colours") such that no two elements of
+ *  the same colour share a global DOF. Elements are coloured greedily in
+ *  index order. */
+void colourElementsByGlobalDofs(
+    const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+    size_t globalDofCount,
+    std::vector<std::vector<int> >& colours)
+{
+    colours.clear();
+    // Colours of the elements already processed that contain a given DOF
+    std::vector<std::vector<int> > dofColours(globalDofCount);
+    std::vector<char> isColourTaken;
+    const size_t elementCount = globalDofs.size();
+    for (size_t e = 0; e < elementCount; ++e) {
+        const std::vector<GlobalDofIndex>& dofs = globalDofs[e];
+        isColourTaken.assign(colours.size() + 1, false);
+        for (size_t i = 0; i < dofs.size(); ++i)
+            if (dofs[i] >= 0)
+                for (size_t c = 0; c < dofColours[dofs[i]].size(); ++c)
+                    isColourTaken[dofColours[dofs[i]][c]] = true;
+        size_t colour = 0;
+        while (isColourTaken[colour])
+            ++colour;
+        if (colour == colours.size())
+            colours.push_back(std::vector<int>());
+        colours[colour].push_back(e);
+        for (size_t i = 0; i < dofs.size(); ++i)
+            if (dofs[i] >= 0)
+                dofColours[dofs[i]].push_back(colour);
+    }
+}
+
 /** Build a list of lists of global DOF indices corresponding to the local DOFs
  *  on each element of space.grid(). */
 template <typename BasisFunctionType>
@@ -165,6 +215,33 @@ void gatherGlobalDofs(
     }
 }
 
+/** Add to the cache key the local weak forms of a few pairs of test and trial
+ *  elements. They depend on the kernel parameters of the operator, which
+ *  cannot be inspected directly. */
+template <typename ResultType>
+void addLocalWeakFormSample(
+    WeakFormCacheKey& key,
+    Fiber::LocalAssemblerForIntegralOperators<ResultType>& assembler,
+    int testElementCount, int trialElementCount)
+{
+    if (testElementCount == 0 || trialElementCount == 0)
+        return;
+    std::vector<int> testIndices;
+    testIndices.push_back(0);
+    testIndices.push_back(testElementCount / 2);
+    testIndices.push_back(testElementCount - 1);
+    const int trialIndices[] = {
+        0, trialElementCount / 2, trialElementCount - 1 };
+    std::vector<arma::Mat<ResultType> > localResult;
+    for (int i = 0; i < 3; ++i) {
+        assembler.evaluateLocalWeakForms(TEST_TRIAL, testIndices,
+                                         trialIndices[i], ALL_DOFS,
+                                         localResult);
+        for (size_t j = 0; j < localResult.size(); ++j)
+            key.add(localResult[j]);
+    }
+}
+
 } // namespace
 
 template <typename BasisFunctionType, typename ResultType>
@@ -191,6 +268,41 @@ assembleDetachedWeakForm(
     const size_t testElementCount = testGlobalDofs.size();
     const size_t trialElementCount = trialGlobalDofs.size();
 
+    // Look the weak form up in the on-disk cache
+    std::string cacheFileName, cacheKey;
+    if (!options.weakFormCacheDirectory().empty()) {
+        WeakFormCacheKey key;
+        key.addType<ResultType>();
+        key.addSpace(testSpace);
+        key.addSpace(trialSpace);
+        key.addAssemblyOptions(options);
+        key.add(assembler.signature());
+        addLocalWeakFormSample(key, assembler,
+                               testElementCount, trialElementCount);
+        cacheFileName = key.fileName(options.weakFormCacheDirectory(),
+                                     "dense");
+        cacheKey = key.contents();
+        try {
+            std::auto_ptr<DiscreteDenseBoundaryOperator<ResultType> > op =
+                    loadCachedDiscreteDenseBoundaryOperator<ResultType>(
+                        cacheFileName, cacheKey,
+                        options.parallelizationOptions());
+            if (op.get() &&
+                    op->rowCount() == testSpace.globalDofCount() &&
+                    op->columnCount() == trialSpace.globalDofCount()) {
+                if (options.verbosityLevel() >= VerbosityLevel::DEFAULT)
+                    std::cout << "Loaded weak form from "
+                              << cacheFileName << std::endl;
+                return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
+                            op.release());
+            }
+        }
+        catch (std::exception& e) {
+            if (options.verbosityLevel() >= VerbosityLevel::DEFAULT)
+                std::cout << "Warning: " << e.what() << std::endl;
+        }
+    }
+
     // Make a vector of all element indices
     std::vector<int> testIndices(testElementCount);
     for (int i = 0; i < testElementCount; ++i)
@@ -201,25 +313,52 @@ assembleDetachedWeakForm(
                                  trialSpace.globalDofCount());
     result.fill(0.);
 
+    // Group trial elements so that elements of the same colour never
+    // contribute to the same column of the matrix. The scatter of local
+    // weak forms can then proceed without locking, one colour at a time.
+    std::vector<std::vector<int> > trialColours;
+    colourElementsByGlobalDofs(trialGlobalDofs, trialSpace.globalDofCount(),
+                               trialColours);
+    // If the colours are too small (e.g. if all elements share a DOF), the
+    // synchronisation between colours would cost more than the mutex
+    const size_t MIN_AVERAGE_COLOUR_SIZE = 32;
+    const bool useColouring =
+            trialColours.size() * MIN_AVERAGE_COLOUR_SIZE <= trialElementCount;
+
     typedef DenseWeakFormAssemblerLoopBody<BasisFunctionType, ResultType> Body;
     typename Body::MutexType mutex;
 
     const ParallelizationOptions& parallelOptions =
             options.parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    Fiber::ExecutionContext& executionContext =
+            Fiber::ExecutionContext::instance();
+    const size_t grainSize =
+            Fiber::ExecutionContext::grainSize(parallelOptions);
     {
         Fiber::SerialBlasRegion region;
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, trialElementCount),
-                          Body(testIndices, testGlobalDofs, trialGlobalDofs,
-                               testLocalDofWeights, trialLocalDofWeights,
-                               assembler, result, mutex));
+        if (useColouring) {
+            for (size_t c = 0; c < trialColours.size(); ++c)
+                executionContext.parallelFor(
+                            parallelOptions,
+                            tbb::blocked_range<size_t>(
+                                0, trialColours[c].size(), grainSize),
+                            Body(testIndices, trialColours[c],
+                                 testGlobalDofs, trialGlobalDofs,
+                                 testLocalDofWeights, trialLocalDofWeights,
+                                 assembler, result, 0 /* no mutex */));
+        } else {
+            std::vector<int> trialIndices(trialElementCount);
+            for (size_t i = 0; i < trialElementCount; ++i)
+                trialIndices[i] = i;
+            executionContext.parallelFor(
+                        parallelOptions,
+                        tbb::blocked_range<size_t>(
+                            0, trialElementCount, grainSize),
+                        Body(testIndices, trialIndices,
+                             testGlobalDofs, trialGlobalDofs,
+                             testLocalDofWeights, trialLocalDofWeights,
+                             assembler, result, &mutex));
+        }
     }
 
     //// Old serial code (TODO: decide whether to keep it behind e.g. #ifndef PARALLEL)
@@ -244,8 +383,20 @@ assembleDetachedWeakForm(
 
     // Create and return a discrete operator represented by the matrix that
     // has just been calculated
-    return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
-                new DiscreteDenseBoundaryOperator<ResultType>(result));
+    std::auto_ptr<DiscreteDenseBoundaryOperator<ResultType> > op(
+                new DiscreteDenseBoundaryOperator<ResultType>(
+                    result, options.parallelizationOptions()));
+    if (!cacheFileName.empty()) {
+        try {
+            saveCachedDiscreteDenseBoundaryOperator(*op, cacheFileName,
+                                                    cacheKey);
+        }
+        catch (std::exception& e) {
+            if (options.verbosityLevel() >= VerbosityLevel::DEFAULT)
+                std::cout << "Warning: " << e.what() << std::endl;
+        }
+    }
+    return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(op.release());
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DenseGlobalAssembler);
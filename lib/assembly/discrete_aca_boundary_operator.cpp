@@ -27,20 +27,29 @@
 
 #include "ahmed_aux.hpp"
 #include "aca_approximate_lu_inverse.hpp"
+#include "aca_recompression.hpp"
+#include "mixed_precision_mblock_array.hpp"
+#include "out_of_core_mblock_store.hpp"
 
+#include "../common/boost_make_shared_fwd.hpp"
 #include "../common/chunk_statistics.hpp"
 #include "../common/complex_aux.hpp"
+#include "../common/not_implemented_error.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/serial_blas_region.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/type_traits/is_complex.hpp>
 
 #include <tbb/blocked_range.h>
 #include <tbb/concurrent_queue.h>
-#include <tbb/parallel_reduce.h>
+#include <tbb/pipeline.h>
 #include <tbb/task_scheduler_init.h>
 
 #ifdef WITH_TRILINOS
@@ -68,6 +77,81 @@ void dumpblcluster(const blcluster* bl, const std::string& indent)
 namespace
 {
 
+inline void mltaSyHVec(double d, blcluster* bl, mblock<double>** A, double* x,
+                       double* y)
+{
+    mltaHeHVec(d, bl, A, x, y);
+}
+
+inline void mltaSyHVec(float d, blcluster* bl, mblock<float>** A, float* x,
+                       float* y)
+{
+    mltaHeHVec(d, bl, A, x, y);
+}
+
+inline void mltaSyHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
+                       scomp* y)
+{
+    throw std::runtime_error("mltaSyHVec(): the overload of this function for "
+                             "complex single-precision numbers does not exist "
+                             "in AHMED");
+}
+
+/** Add alpha * op(A) * x to y, where A is the matrix stored in an mblock and
+ *  x and y consist of several columns. Low-rank and general dense blocks are
+ *  handled with matrix-matrix products; other blocks (e.g. triangular ones)
+ *  are multiplied column by column with AHMED's routines. */
+template <typename ValueType>
+void mltaMblockMat(TranspositionMode trans, ValueType alpha,
+                   mblock<typename AhmedTypeTraits<ValueType>::Type>* block,
+                   const arma::Mat<ValueType>& x, arma::Mat<ValueType>& y)
+{
+    const unsigned n1 = block->getn1();
+    const unsigned n2 = block->getn2();
+    ValueType* data = reinterpret_cast<ValueType*>(block->getdata());
+    if (block->isLrM()) {
+        // The block is stored as U V^H, with U (n1 x rank) followed by
+        // V (n2 x rank)
+        const unsigned rank = block->rank();
+        if (rank == 0)
+            return;
+        const arma::Mat<ValueType> U(data, n1, rank, false /* copy_aux_mem */);
+        const arma::Mat<ValueType> V(data + n1 * rank, n2, rank, false);
+        if (trans == NO_TRANSPOSE)
+            y += alpha * (U * (V.t() * x));
+        else if (trans == TRANSPOSE)
+            y += alpha * (arma::conj(V) * (U.st() * x));
+        else // trans == CONJUGATE_TRANSPOSE
+            y += alpha * (V * (U.t() * x));
+    } else if (!block->isHeM() && !block->isSyM() &&
+               !block->isLtM() && !block->isUtM()) {
+        const arma::Mat<ValueType> A(data, n1, n2, false /* copy_aux_mem */);
+        if (trans == NO_TRANSPOSE)
+            y += alpha * A * x;
+        else if (trans == TRANSPOSE)
+            y += alpha * A.st() * x;
+        else // trans == CONJUGATE_TRANSPOSE
+            y += alpha * A.t() * x;
+    } else {
+        arma::Col<ValueType> xCol(x.n_rows);
+        arma::Col<ValueType> yCol(y.n_rows);
+        for (size_t c = 0; c < x.n_cols; ++c) {
+            xCol = x.col(c);
+            yCol = y.col(c);
+            if (trans == NO_TRANSPOSE)
+                block->mltaVec(ahmedCast(alpha), ahmedCast(xCol.memptr()),
+                               ahmedCast(yCol.memptr()));
+            else if (trans == TRANSPOSE)
+                block->mltatVec(ahmedCast(alpha), ahmedCast(xCol.memptr()),
+                                ahmedCast(yCol.memptr()));
+            else // trans == CONJUGATE_TRANSPOSE
+                block->mltahVec(ahmedCast(alpha), ahmedCast(xCol.memptr()),
+                                ahmedCast(yCol.memptr()));
+            y.col(c) = yCol;
+        }
+    }
+}
+
 template <typename ValueType>
 class MblockMultiplicationLoopBody
 {
@@ -75,16 +159,21 @@ class MblockMultiplicationLoopBody
 public:
     typedef tbb::concurrent_queue<size_t> LeafClusterIndexQueue;
 
+    // Each column of x and y is a separate vector. If symmetry includes
+    // SYMMETRIC or HERMITIAN, only the upper block triangle of the H-matrix is
+    // stored and trans is ignored: each leaf contributes both its own product
+    // and that of its mirror image below the diagonal.
     MblockMultiplicationLoopBody(
+            int symmetry,
             TranspositionMode trans,
             ValueType multiplier,
-            arma::Col<ValueType>& x,
-            arma::Col<ValueType>& y,
+            arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
             AhmedLeafClusterArray& leafClusters,
             boost::shared_array<AhmedMblock*> blocks,
             LeafClusterIndexQueue& leafClusterIndexQueue,
             std::vector<ChunkStatistics>& stats) :
-        m_trans(trans),
+        m_symmetry(symmetry), m_trans(trans),
         m_multiplier(multiplier), m_x(x), m_local_y(y),
         m_leafClusters(leafClusters), m_blocks(blocks),
         m_leafClusterIndexQueue(leafClusterIndexQueue),
@@ -99,9 +188,10 @@ public:
     }
 
     MblockMultiplicationLoopBody(MblockMultiplicationLoopBody& other, tbb::split) :
-        m_trans(other.m_trans),
+        m_symmetry(other.m_symmetry), m_trans(other.m_trans),
         m_multiplier(other.m_multiplier),
-        m_x(other.m_x), m_local_y(other.m_local_y.n_rows),
+        m_x(other.m_x), m_local_y(other.m_local_y.n_rows,
+                                  other.m_local_y.n_cols),
         m_leafClusters(other.m_leafClusters), m_blocks(other.m_blocks),
         m_leafClusterIndexQueue(other.m_leafClusterIndexQueue),
         m_stats(other.m_stats)
@@ -125,21 +215,54 @@ public:
             m_stats[leafClusterIndex].startTime = tbb::tick_count::now();
 
             blcluster* cluster = m_leafClusters[leafClusterIndex];
-            if (m_trans == NO_TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltaVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb2())),
-                    ahmedCast(&m_local_y(cluster->getb1())));
-            else if (m_trans == TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltatVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb1())),
-                    ahmedCast(&m_local_y(cluster->getb2())));
-            else // m_trans == CONJUGATE_TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltahVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb1())),
-                    ahmedCast(&m_local_y(cluster->getb2())));
+            if (m_symmetry & (SYMMETRIC | HERMITIAN)) {
+                // Applied to a single leaf, AHMED's routines for symmetric
+                // and Hermitian H-matrices handle both the diagonal blocks
+                // and the mirrored contributions of the off-diagonal ones
+                for (size_t c = 0; c < m_x.n_cols; ++c)
+                    if (m_symmetry & SYMMETRIC)
+                        mltaSyHVec(ahmedCast(m_multiplier), cluster,
+                                   m_blocks.get(),
+                                   ahmedCast(m_x.colptr(c)),
+                                   ahmedCast(m_local_y.colptr(c)));
+                    else
+                        mltaHeHVec(ahmedCast(m_multiplier), cluster,
+                                   m_blocks.get(),
+                                   ahmedCast(m_x.colptr(c)),
+                                   ahmedCast(m_local_y.colptr(c)));
+            } else if (m_x.n_cols == 1) {
+                if (m_trans == NO_TRANSPOSE)
+                    m_blocks[cluster->getidx()]->mltaVec(
+                        ahmedCast(m_multiplier),
+                        ahmedCast(&m_x(cluster->getb2())),
+                        ahmedCast(&m_local_y(cluster->getb1())));
+                else if (m_trans == TRANSPOSE)
+                    m_blocks[cluster->getidx()]->mltatVec(
+                        ahmedCast(m_multiplier),
+                        ahmedCast(&m_x(cluster->getb1())),
+                        ahmedCast(&m_local_y(cluster->getb2())));
+                else // m_trans == CONJUGATE_TRANSPOSE)
+                    m_blocks[cluster->getidx()]->mltahVec(
+                        ahmedCast(m_multiplier),
+                        ahmedCast(&m_x(cluster->getb1())),
+                        ahmedCast(&m_local_y(cluster->getb2())));
+            } else {
+                const unsigned xStart = (m_trans == NO_TRANSPOSE) ?
+                            cluster->getb2() : cluster->getb1();
+                const unsigned xCount = (m_trans == NO_TRANSPOSE) ?
+                            cluster->getn2() : cluster->getn1();
+                const unsigned yStart = (m_trans == NO_TRANSPOSE) ?
+                            cluster->getb1() : cluster->getb2();
+                const unsigned yCount = (m_trans == NO_TRANSPOSE) ?
+                            cluster->getn1() : cluster->getn2();
+                arma::Mat<ValueType> xBlock =
+                        m_x.rows(xStart, xStart + xCount - 1);
+                arma::Mat<ValueType> yBlock(yCount, m_x.n_cols);
+                yBlock.fill(static_cast<ValueType>(0.));
+                mltaMblockMat(m_trans, m_multiplier,
+                              m_blocks[cluster->getidx()], xBlock, yBlock);
+                m_local_y.rows(yStart, yStart + yCount - 1) += yBlock;
+            }
             m_stats[leafClusterIndex].endTime = tbb::tick_count::now();
         }
     }
@@ -149,11 +272,12 @@ public:
     }
 
 private:
+    int m_symmetry;
     TranspositionMode m_trans;
     ValueType m_multiplier;
-    arma::Col<ValueType>& m_x;
+    arma::Mat<ValueType>& m_x;
 public:
-    arma::Col<ValueType> m_local_y;
+    arma::Mat<ValueType> m_local_y;
 private:
     AhmedLeafClusterArray& m_leafClusters;
     boost::shared_array<AhmedMblock*> m_blocks;
@@ -161,61 +285,1016 @@ private:
     std::vector<ChunkStatistics>& m_stats;
 };
 
-bool areEqual(const blcluster* op1, const blcluster* op2)
+/** Add alpha * op(A(rowBegin:rowBegin+rowCount-1, 0:k-1)) * T to the
+ *  rowCount x colCount matrix Y, where op is complex conjugation if
+ *  conjugate is true and identity otherwise. All matrices are stored in
+ *  column-major order with the leading dimensions lda, ldt and ldy. The
+ *  entries of A may be stored in lower precision than ValueType; they are
+ *  converted to ValueType before use. */
+template <typename ValueType, typename StorageType>
+void addRowSliceProduct(ValueType alpha, bool conjugate,
+                        const StorageType* a, size_t lda,
+                        size_t rowBegin, size_t rowCount, size_t k,
+                        const ValueType* t, size_t ldt,
+                        ValueType* y, size_t ldy, size_t colCount)
 {
-    if (!op1 || !op2)
-        return (!op1 && !op2);
-    if (op1->getnrs() != op2->getnrs() || op1->getncs() != op2->getncs())
-        return false;
-    if (op1->isleaf())
-        return (op1->getb1() == op2->getb1() && op1->getb2() == op2->getb2() &&
-                op1->getn1() == op2->getn1() && op1->getn2() == op2->getn2());
-    for (unsigned int rs = 0; rs < op1->getnrs(); ++rs)
-        for (unsigned int cs = 0; cs < op1->getncs(); ++cs)
-            if (!areEqual(op1->getson(rs, cs), op2->getson(rs, cs)))
-                return false;
-    return true;
+    for (size_t c = 0; c < colCount; ++c) {
+        ValueType* yCol = y + c * ldy;
+        for (size_t j = 0; j < k; ++j) {
+            const ValueType coeff = alpha * t[j + c * ldt];
+            const StorageType* aCol = a + j * lda + rowBegin;
+            if (conjugate)
+                for (size_t r = 0; r < rowCount; ++r)
+                    yCol[r] += coeff * ValueType(conj(aCol[r]));
+            else
+                for (size_t r = 0; r < rowCount; ++r)
+                    yCol[r] += coeff * ValueType(aCol[r]);
+        }
+    }
 }
 
-inline void mltaSyHVec(double d, blcluster* bl, mblock<double>** A, double* x,
-                       double* y)
+/** Add alpha * op(A(0:k-1, colBegin:colBegin+colCount-1))^T * X to the
+ *  colCount x rhsCount matrix Y, where op is complex conjugation if
+ *  conjugate is true and identity otherwise. All matrices are stored in
+ *  column-major order with the leading dimensions lda, ldx and ldy. As in
+ *  addRowSliceProduct(), A may be stored in lower precision. */
+template <typename ValueType, typename StorageType>
+void addColumnSliceTransposedProduct(ValueType alpha, bool conjugate,
+                                     const StorageType* a, size_t lda,
+                                     size_t colBegin, size_t colCount, size_t k,
+                                     const ValueType* x, size_t ldx,
+                                     ValueType* y, size_t ldy, size_t rhsCount)
 {
-    mltaHeHVec(d, bl, A, x, y);
+    for (size_t c = 0; c < rhsCount; ++c) {
+        const ValueType* xCol = x + c * ldx;
+        for (size_t r = 0; r < colCount; ++r) {
+            const StorageType* aCol = a + (colBegin + r) * lda;
+            ValueType sum = static_cast<ValueType>(0.);
+            if (conjugate)
+                for (size_t i = 0; i < k; ++i)
+                    sum += ValueType(conj(aCol[i])) * xCol[i];
+            else
+                for (size_t i = 0; i < k; ++i)
+                    sum += ValueType(aCol[i]) * xCol[i];
+            y[r + c * ldy] += alpha * sum;
+        }
+    }
 }
 
-inline void mltaSyHVec(float d, blcluster* bl, mblock<float>** A, float* x,
-                       float* y)
+#ifdef ARMA_USE_BLAS
+// Maximum number of conjugated low-rank coefficients held on the stack
+const size_t CONJUGATION_BUFFER_SIZE = 1024;
+
+/** Add alpha * op(A) * X to Y, where A is an m x n matrix, X and Y have
+ *  rhsCount columns and op(A) is A, A^T or A^H for transA equal to 'N', 'T'
+ *  or 'C'. */
+template <typename ValueType>
+void addBlasProduct(char transA, size_t m, size_t n, size_t rhsCount,
+                    ValueType alpha, const ValueType* a, size_t lda,
+                    const ValueType* x, size_t ldx,
+                    ValueType* y, size_t ldy)
 {
-    mltaHeHVec(d, bl, A, x, y);
+    const ValueType one = static_cast<ValueType>(1.);
+    const arma::blas_int blasM = m, blasN = n;
+    const arma::blas_int ldA = lda, ldX = ldx, ldY = ldy, inc = 1;
+    if (rhsCount == 1)
+        arma::blas::gemv(&transA, &blasM, &blasN, &alpha, a, &ldA, x, &inc,
+                         &one, y, &inc);
+    else {
+        const char transX = 'N';
+        const arma::blas_int outRowCount = (transA == 'N') ? blasM : blasN;
+        const arma::blas_int innerCount = (transA == 'N') ? blasN : blasM;
+        const arma::blas_int blasRhsCount = rhsCount;
+        arma::blas::gemm(&transA, &transX, &outRowCount, &blasRhsCount,
+                         &innerCount, &alpha, a, &ldA, x, &ldX,
+                         &one, y, &ldY);
+    }
 }
 
-inline void mltaSyHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
-                       scomp* y)
+/** Overload of addRowSliceProduct() for matrices stored in the precision of
+ *  ValueType, which calls BLAS. conj(A) * T is evaluated as
+ *  conj(A * conj(T)): the rows of Y are conjugated in place and T is
+ *  conjugated in small blocks. */
+template <typename ValueType>
+void addRowSliceProduct(ValueType alpha, bool conjugate,
+                        const ValueType* a, size_t lda,
+                        size_t rowBegin, size_t rowCount, size_t k,
+                        const ValueType* t, size_t ldt,
+                        ValueType* y, size_t ldy, size_t colCount)
 {
-    throw std::runtime_error("mltaSyHVec(): the overload of this function for "
-                             "complex single-precision numbers does not exist "
-                             "in AHMED");
+    if (rowCount == 0 || k == 0 || colCount == 0)
+        return;
+    if (!conjugate || !boost::is_complex<ValueType>::value) {
+        addBlasProduct('N', rowCount, k, colCount, alpha,
+                       a + rowBegin, lda, t, ldt, y, ldy);
+        return;
+    }
+
+    ValueType stackBuffer[CONJUGATION_BUFFER_SIZE];
+    std::vector<ValueType> heapBuffer;
+    ValueType* buffer = stackBuffer;
+    if (colCount > CONJUGATION_BUFFER_SIZE) {
+        heapBuffer.resize(colCount);
+        buffer = &heapBuffer[0];
+    }
+    const size_t chunkSize =
+            std::max<size_t>(1, CONJUGATION_BUFFER_SIZE / colCount);
+
+    for (size_t c = 0; c < colCount; ++c)
+        for (size_t r = 0; r < rowCount; ++r)
+            y[r + c * ldy] = Fiber::conj(y[r + c * ldy]);
+    for (size_t start = 0; start < k; start += chunkSize) {
+        const size_t count = std::min(chunkSize, k - start);
+        for (size_t c = 0; c < colCount; ++c)
+            for (size_t j = 0; j < count; ++j)
+                buffer[j + c * count] = Fiber::conj(t[start + j + c * ldt]);
+        addBlasProduct('N', rowCount, count, colCount, Fiber::conj(alpha),
+                       a + rowBegin + start * lda, lda, buffer, count,
+                       y, ldy);
+    }
+    for (size_t c = 0; c < colCount; ++c)
+        for (size_t r = 0; r < rowCount; ++r)
+            y[r + c * ldy] = Fiber::conj(y[r + c * ldy]);
 }
 
-// For real types, SyHh = SyH
-inline void mltaSyHhVec(double d, blcluster* bl, mblock<double>** A, double* x,
-                        double* y)
+/** Overload of addColumnSliceTransposedProduct() for matrices stored in the
+ *  precision of ValueType, which calls BLAS. */
+template <typename ValueType>
+void addColumnSliceTransposedProduct(ValueType alpha, bool conjugate,
+                                     const ValueType* a, size_t lda,
+                                     size_t colBegin, size_t colCount, size_t k,
+                                     const ValueType* x, size_t ldx,
+                                     ValueType* y, size_t ldy, size_t rhsCount)
 {
-    mltaSyHVec(d, bl, A, x, y);
+    if (colCount == 0 || k == 0 || rhsCount == 0)
+        return;
+    addBlasProduct(conjugate ? 'C' : 'T', k, colCount, rhsCount, alpha,
+                   a + colBegin * lda, lda, x, ldx, y, ldy);
 }
+#endif // ARMA_USE_BLAS
 
-inline void mltaSyHhVec(float d, blcluster* bl, mblock<float>** A, float* x,
-                        float* y)
+/** Return true if the scheduled H-matrix-vector product supports the given
+ *  block, i.e. if it is a low-rank or general dense block. */
+template <typename ValueType>
+bool isSupportedByMatvecSchedule(
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* block)
 {
-    mltaSyHVec(d, bl, A, x, y);
+    return block->isLrM() || (!block->isHeM() && !block->isSyM() &&
+                               !block->isLtM() && !block->isUtM());
 }
 
-inline void mltaSyHhVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
-                        scomp* y)
+/** Buffer for the low-rank coefficients of an H-matrix-vector product,
+ *  borrowed from a pool for the duration of the product. Repeated products
+ *  reuse the memory of earlier ones, while concurrent products use different
+ *  buffers. */
+template <typename ValueType>
+class CoefficientBuffer
 {
-    throw std::runtime_error("mltaSyHhVec(): the overload of this function for "
-                             "complex single-precision numbers does not exist "
-                             "in AHMED");
+public:
+    typedef tbb::concurrent_queue<shared_ptr<std::vector<ValueType> > > Pool;
+
+    CoefficientBuffer(Pool& pool, size_t size) :
+        m_pool(pool)
+    {
+        if (!m_pool.try_pop(m_buffer))
+            m_buffer = boost::make_shared<std::vector<ValueType> >();
+        m_buffer->assign(size, static_cast<ValueType>(0.));
+    }
+
+    ~CoefficientBuffer() {
+        m_pool.push(m_buffer);
+    }
+
+    std::vector<ValueType>& get() {
+        return *m_buffer;
+    }
+
+private:
+    CoefficientBuffer(const CoefficientBuffer&);
+    CoefficientBuffer& operator=(const CoefficientBuffer&);
+
+    Pool& m_pool;
+    shared_ptr<std::vector<ValueType> > m_buffer;
+};
+
+/** Workspace borrowed from a pool for the duration of a product. As with
+ *  CoefficientBuffer, repeated products reuse the workspaces of earlier ones,
+ *  while concurrent products use different workspaces. */
+template <typename Workspace>
+class PooledWorkspace
+{
+public:
+    typedef tbb::concurrent_queue<shared_ptr<Workspace> > Pool;
+
+    explicit PooledWorkspace(Pool& pool) :
+        m_pool(pool)
+    {
+        if (!m_pool.try_pop(m_workspace))
+            m_workspace = boost::make_shared<Workspace>();
+    }
+
+    ~PooledWorkspace() {
+        m_pool.push(m_workspace);
+    }
+
+    Workspace& get() {
+        return *m_workspace;
+    }
+
+private:
+    PooledWorkspace(const PooledWorkspace&);
+    PooledWorkspace& operator=(const PooledWorkspace&);
+
+    Pool& m_pool;
+    shared_ptr<Workspace> m_workspace;
+};
+
+/** Return the position of the low-rank coefficients of leaf \p leaf in the
+ *  coefficient buffer of a product with \p columnCount right-hand sides. */
+inline size_t coefficientPosition(const AhmedMatvecSchedule& schedule,
+                                  size_t leaf, size_t columnCount)
+{
+    return schedule.lowRankCoefficientOffset(leaf) * columnCount;
+}
+
+/** Add to the rank x x.n_cols matrix T the product of the "inner" factor of
+ *  the low-rank block of the leaf \p cluster with the appropriate part of x:
+ *  V^H x for untransposed products, U^T x or U^H x for transposed and
+ *  conjugate-transposed ones, where U V^H is the low-rank representation of
+ *  the block. \p factor points to V in the first case and to U otherwise. */
+template <typename ValueType, typename StorageType>
+void addLowRankCoefficients(TranspositionMode trans, const blcluster* cluster,
+                            size_t rank, const StorageType* factor,
+                            const arma::Mat<ValueType>& x, ValueType* t)
+{
+    if (trans == NO_TRANSPOSE) {
+        const size_t n2 = cluster->getn2();
+        addColumnSliceTransposedProduct(
+                    static_cast<ValueType>(1.), true, factor, n2, 0, rank,
+                    n2, x.colptr(0) + cluster->getb2(), x.n_rows,
+                    t, rank, x.n_cols);
+    } else {
+        const size_t n1 = cluster->getn1();
+        addColumnSliceTransposedProduct(
+                    static_cast<ValueType>(1.),
+                    trans == CONJUGATE_TRANSPOSE, factor, n1, 0, rank,
+                    n1, x.colptr(0) + cluster->getb1(), x.n_rows,
+                    t, rank, x.n_cols);
+    }
+}
+
+/** Add alpha * op(A) * x, restricted to the target indices covered by \p
+ *  slice, to y, where A is the block of the leaf \p cluster. If A is
+ *  low-rank, \p data points to its "outer" factor (U for untransposed
+ *  products, V otherwise) and \p t to the coefficients computed by
+ *  addLowRankCoefficients(); otherwise \p data points to the dense block. */
+template <typename ValueType, typename StorageType>
+void addSliceContribution(TranspositionMode trans, ValueType alpha,
+                          const blcluster* cluster,
+                          const AhmedMatvecSchedule::Slice& slice,
+                          bool lowRank, size_t rank,
+                          const StorageType* data, const ValueType* t,
+                          const arma::Mat<ValueType>& x,
+                          arma::Mat<ValueType>& y)
+{
+    const bool transposed = (trans != NO_TRANSPOSE);
+    const bool conjugated = (trans == CONJUGATE_TRANSPOSE);
+    const size_t n1 = cluster->getn1(), n2 = cluster->getn2();
+    const size_t sliceBegin = slice.begin -
+            (transposed ? cluster->getb2() : cluster->getb1());
+    const size_t sliceSize = slice.end - slice.begin;
+    ValueType* ySlice = y.colptr(0) + slice.begin;
+    if (lowRank) {
+        if (!transposed) // y += alpha U t
+            addRowSliceProduct(alpha, false, data, n1, sliceBegin, sliceSize,
+                               rank, t, rank, ySlice, y.n_rows, y.n_cols);
+        else // y += alpha conj(V) t or alpha V t
+            addRowSliceProduct(alpha, !conjugated, data, n2,
+                               sliceBegin, sliceSize, rank, t, rank,
+                               ySlice, y.n_rows, y.n_cols);
+    } else {
+        if (!transposed)
+            addRowSliceProduct(alpha, false, data, n1, sliceBegin, sliceSize,
+                               n2, x.colptr(0) + cluster->getb2(), x.n_rows,
+                               ySlice, y.n_rows, y.n_cols);
+        else
+            addColumnSliceTransposedProduct(
+                        alpha, conjugated, data, n1, sliceBegin, sliceSize,
+                        n1, x.colptr(0) + cluster->getb1(), x.n_rows,
+                        ySlice, y.n_rows, y.n_cols);
+    }
+}
+
+/** Loop body computing the products of the "inner" factors of the low-rank
+ *  blocks with the appropriate parts of x: V^H x for untransposed products,
+ *  U^T x or U^H x for transposed and conjugate-transposed ones, where U V^H
+ *  is the low-rank representation of a block. */
+template <typename ValueType>
+class LowRankCoefficientLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    LowRankCoefficientLoopBody(
+            TranspositionMode trans,
+            const arma::Mat<ValueType>& x,
+            const AhmedMatvecSchedule& schedule,
+            const boost::shared_array<AhmedMblock*>& blocks,
+            std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_x(x), m_schedule(schedule), m_blocks(blocks),
+        m_coefficients(coefficients)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        for (size_t leaf = r.begin(); leaf != r.end(); ++leaf) {
+            const blcluster* cluster = leafClusters[leaf];
+            AhmedMblock* block = m_blocks[cluster->getidx()];
+            if (!block->isLrM() || block->rank() == 0)
+                continue;
+            const size_t rank = block->rank();
+            const ValueType* u =
+                    reinterpret_cast<const ValueType*>(block->getdata());
+            const ValueType* v = u + block->getn1() * rank;
+            addLowRankCoefficients(
+                        m_trans, cluster, rank,
+                        m_trans == NO_TRANSPOSE ? v : u, m_x,
+                        &m_coefficients[coefficientPosition(
+                                m_schedule, leaf, m_x.n_cols)]);
+        }
+    }
+
+private:
+    TranspositionMode m_trans;
+    const arma::Mat<ValueType>& m_x;
+    const AhmedMatvecSchedule& m_schedule;
+    const boost::shared_array<AhmedMblock*>& m_blocks;
+    std::vector<ValueType>& m_coefficients;
+};
+
+/** Loop body adding the contributions of all leaf slices of a range of
+ *  chunks of an AhmedMatvecSchedule to the corresponding rows of y. Chunks
+ *  cover disjoint sets of rows, hence no synchronisation is needed. */
+template <typename ValueType>
+class ScheduledMblockMultiplicationLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    ScheduledMblockMultiplicationLoopBody(
+            TranspositionMode trans,
+            ValueType multiplier,
+            const arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
+            const AhmedMatvecSchedule& schedule,
+            const boost::shared_array<AhmedMblock*>& blocks,
+            const std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_multiplier(multiplier), m_x(x), m_y(y),
+        m_schedule(schedule), m_blocks(blocks),
+        m_coefficients(coefficients)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        for (size_t chunk = r.begin(); chunk != r.end(); ++chunk)
+            for (const AhmedMatvecSchedule::Slice* slice =
+                 m_schedule.chunkSlicesBegin(chunk);
+                 slice != m_schedule.chunkSlicesEnd(chunk); ++slice) {
+                const blcluster* cluster = leafClusters[slice->leaf];
+                AhmedMblock* block = m_blocks[cluster->getidx()];
+                const ValueType* data =
+                        reinterpret_cast<const ValueType*>(block->getdata());
+                const bool lowRank = block->isLrM();
+                const size_t rank = lowRank ? block->rank() : 0;
+                if (lowRank && rank == 0)
+                    continue;
+                if (lowRank && m_trans != NO_TRANSPOSE)
+                    data += block->getn1() * rank; // use V rather than U
+                addSliceContribution(
+                            m_trans, m_multiplier, cluster, *slice,
+                            lowRank, rank, data,
+                            lowRank ? &m_coefficients[
+                                coefficientPosition(
+                                    m_schedule, slice->leaf, m_x.n_cols)] : 0,
+                            m_x, m_y);
+            }
+    }
+
+private:
+    TranspositionMode m_trans;
+    ValueType m_multiplier;
+    const arma::Mat<ValueType>& m_x;
+    arma::Mat<ValueType>& m_y;
+    const AhmedMatvecSchedule& m_schedule;
+    const boost::shared_array<AhmedMblock*>& m_blocks;
+    const std::vector<ValueType>& m_coefficients;
+};
+
+/** Add alpha * op(A) * x to y, where A is a general H-matrix, using a
+ *  precomputed partition of its leaves by target clusters. x and y should
+ *  already be permuted. All leaves of A must be supported by this algorithm
+ *  (see isSupportedByMatvecSchedule()) and have the ranks the schedule was
+ *  constructed for; DiscreteAcaBoundaryOperator checks this whenever it
+ *  (re)creates its schedules. */
+template <typename ValueType>
+void mltaGeHMatScheduled(
+        TranspositionMode trans, ValueType alpha,
+        const AhmedMatvecSchedule& schedule,
+        const boost::shared_array<
+            mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+        const ParallelizationOptions& parallelizationOptions,
+        typename CoefficientBuffer<ValueType>::Pool& coefficientBuffers,
+        const arma::Mat<ValueType>& x, arma::Mat<ValueType>& y)
+{
+    const size_t leafClusterCount = schedule.leafClusters().size();
+    CoefficientBuffer<ValueType> coefficients(
+                coefficientBuffers,
+                schedule.lowRankCoefficientCount() * x.n_cols);
+
+    Fiber::ExecutionContext& executionContext =
+            Fiber::ExecutionContext::instance();
+    Fiber::SerialBlasRegion region;
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, leafClusterCount),
+                LowRankCoefficientLoopBody<ValueType>(
+                    trans, x, schedule, blocks, coefficients.get()));
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, schedule.chunkCount()),
+                ScheduledMblockMultiplicationLoopBody<ValueType>(
+                    trans, alpha, x, y, schedule, blocks,
+                    coefficients.get()));
+}
+
+/** Loop body computing the low-rank coefficients (see
+ *  LowRankCoefficientLoopBody) of H-matrices stored in mixed precision. */
+template <typename ValueType>
+class MixedPrecisionLowRankCoefficientLoopBody
+{
+    typedef MixedPrecisionMblockArray<ValueType> Blocks;
+public:
+    MixedPrecisionLowRankCoefficientLoopBody(
+            TranspositionMode trans,
+            const arma::Mat<ValueType>& x,
+            const AhmedMatvecSchedule& schedule,
+            const Blocks& blocks,
+            std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_x(x), m_schedule(schedule), m_blocks(blocks),
+        m_coefficients(coefficients)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        for (size_t leaf = r.begin(); leaf != r.end(); ++leaf) {
+            const blcluster* cluster = leafClusters[leaf];
+            const size_t index = cluster->getidx();
+            const size_t rank = m_blocks.rank(index);
+            if (!m_blocks.isLowRank(index) || rank == 0)
+                continue;
+            // V follows U
+            const size_t offset =
+                    m_trans == NO_TRANSPOSE ? cluster->getn1() * rank : 0;
+            ValueType* t = &m_coefficients[
+                    coefficientPosition(m_schedule, leaf, m_x.n_cols)];
+            if (m_blocks.isConverted(index))
+                addLowRankCoefficients(
+                            m_trans, cluster, rank,
+                            m_blocks.singlePrecisionData(index) + offset,
+                            m_x, t);
+            else
+                addLowRankCoefficients(
+                            m_trans, cluster, rank,
+                            m_blocks.fullPrecisionData(index) + offset,
+                            m_x, t);
+        }
+    }
+
+private:
+    TranspositionMode m_trans;
+    const arma::Mat<ValueType>& m_x;
+    const AhmedMatvecSchedule& m_schedule;
+    const Blocks& m_blocks;
+    std::vector<ValueType>& m_coefficients;
+};
+
+/** Loop body adding the contributions of all leaf slices of a range of
+ *  chunks (see ScheduledMblockMultiplicationLoopBody) for H-matrices stored
+ *  in mixed precision. */
+template <typename ValueType>
+class MixedPrecisionScheduledMultiplicationLoopBody
+{
+    typedef MixedPrecisionMblockArray<ValueType> Blocks;
+public:
+    MixedPrecisionScheduledMultiplicationLoopBody(
+            TranspositionMode trans,
+            ValueType multiplier,
+            const arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
+            const AhmedMatvecSchedule& schedule,
+            const Blocks& blocks,
+            const std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_multiplier(multiplier), m_x(x), m_y(y),
+        m_schedule(schedule), m_blocks(blocks),
+        m_coefficients(coefficients)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        for (size_t chunk = r.begin(); chunk != r.end(); ++chunk)
+            for (const AhmedMatvecSchedule::Slice* slice =
+                 m_schedule.chunkSlicesBegin(chunk);
+                 slice != m_schedule.chunkSlicesEnd(chunk); ++slice) {
+                const blcluster* cluster = leafClusters[slice->leaf];
+                const size_t index = cluster->getidx();
+                const bool lowRank = m_blocks.isLowRank(index);
+                const size_t rank = m_blocks.rank(index);
+                if (lowRank && rank == 0)
+                    continue;
+                // Use V rather than U for transposed products
+                const size_t offset = (lowRank && m_trans != NO_TRANSPOSE) ?
+                            cluster->getn1() * rank : 0;
+                const ValueType* t = lowRank ?
+                            &m_coefficients[coefficientPosition(
+                                    m_schedule, slice->leaf, m_x.n_cols)] :
+                            0;
+                if (m_blocks.isConverted(index))
+                    addSliceContribution(
+                                m_trans, m_multiplier, cluster, *slice,
+                                lowRank, rank,
+                                m_blocks.singlePrecisionData(index) + offset,
+                                t, m_x, m_y);
+                else
+                    addSliceContribution(
+                                m_trans, m_multiplier, cluster, *slice,
+                                lowRank, rank,
+                                m_blocks.fullPrecisionData(index) + offset,
+                                t, m_x, m_y);
+            }
+    }
+
+private:
+    TranspositionMode m_trans;
+    ValueType m_multiplier;
+    const arma::Mat<ValueType>& m_x;
+    arma::Mat<ValueType>& m_y;
+    const AhmedMatvecSchedule& m_schedule;
+    const Blocks& m_blocks;
+    const std::vector<ValueType>& m_coefficients;
+};
+
+/** Add alpha * op(A) * x to y, where A is a general H-matrix whose mblocks
+ *  are stored in mixed precision. x and y should already be permuted. The
+ *  values of single-precision mblocks are converted to ValueType as they are
+ *  used, so that all sums are accumulated in the precision of ValueType. */
+template <typename ValueType>
+void mltaMixedPrecisionHMat(
+        TranspositionMode trans, ValueType alpha,
+        const AhmedMatvecSchedule& schedule,
+        const MixedPrecisionMblockArray<ValueType>& blocks,
+        const ParallelizationOptions& parallelizationOptions,
+        typename CoefficientBuffer<ValueType>::Pool& coefficientBuffers,
+        const arma::Mat<ValueType>& x, arma::Mat<ValueType>& y)
+{
+    CoefficientBuffer<ValueType> coefficients(
+                coefficientBuffers,
+                schedule.lowRankCoefficientCount() * x.n_cols);
+
+    Fiber::ExecutionContext& executionContext =
+            Fiber::ExecutionContext::instance();
+    Fiber::SerialBlasRegion region;
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, schedule.leafClusters().size()),
+                MixedPrecisionLowRankCoefficientLoopBody<ValueType>(
+                    trans, x, schedule, blocks, coefficients.get()));
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(0, schedule.chunkCount()),
+                MixedPrecisionScheduledMultiplicationLoopBody<ValueType>(
+                    trans, alpha, x, y, schedule, blocks,
+                    coefficients.get()));
+}
+
+/** Item processed by the pipelines evaluating products of H-matrices stored
+ *  out of core: a range of leaves or schedule chunks together with the mblock
+ *  segments pinned for their processing, in the order of use. */
+template <typename ValueType>
+struct OutOfCoreMatvecItem
+{
+    typedef typename OutOfCoreMblockStore<ValueType>::Part Part;
+
+    size_t begin, end;
+    std::vector<std::pair<size_t, Part> > segments;
+    std::vector<const ValueType*> data;
+};
+
+template <typename ValueType>
+void releaseSegments(const OutOfCoreMblockStore<ValueType>& store,
+                     const OutOfCoreMatvecItem<ValueType>& item)
+{
+    for (size_t i = 0; i < item.segments.size(); ++i)
+        store.release(item.segments[i].first, item.segments[i].second);
+}
+
+template <typename ValueType>
+size_t pinSegment(const OutOfCoreMblockStore<ValueType>& store,
+                  size_t index, typename OutOfCoreMblockStore<ValueType>::Part part,
+                  OutOfCoreMatvecItem<ValueType>& item)
+{
+    item.data.push_back(store.acquire(index, part));
+    item.segments.push_back(std::make_pair(index, part));
+    return store.valueCount(index, part) * sizeof(ValueType);
+}
+
+/** Pipeline stage computing the products of the "inner" factors of the
+ *  low-rank blocks stored out of core with the appropriate parts of x (see
+ *  addLowRankCoefficients()). Items are ranges of leaves. */
+template <typename ValueType>
+class OutOfCoreLowRankCoefficientStage
+{
+public:
+    typedef OutOfCoreMblockStore<ValueType> Store;
+    typedef OutOfCoreMatvecItem<ValueType> Item;
+
+    OutOfCoreLowRankCoefficientStage(
+            TranspositionMode trans,
+            const arma::Mat<ValueType>& x,
+            const AhmedMatvecSchedule& schedule,
+            const Store& store,
+            std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_x(x), m_schedule(schedule), m_store(store),
+        m_coefficients(coefficients)
+    {
+    }
+
+    size_t itemCount() const {
+        return m_schedule.leafClusters().size();
+    }
+
+    size_t pin(size_t leaf, Item& item) const {
+        const size_t index = m_schedule.leafClusters()[leaf]->getidx();
+        if (!m_store.isLowRank(index) || m_store.rank(index) == 0)
+            return 0;
+        return pinSegment(m_store, index, innerFactor(), item);
+    }
+
+    void process(const Item& item) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        size_t segment = 0;
+        for (size_t leaf = item.begin; leaf != item.end; ++leaf) {
+            const blcluster* cluster = leafClusters[leaf];
+            const size_t index = cluster->getidx();
+            if (!m_store.isLowRank(index) || m_store.rank(index) == 0)
+                continue;
+            addLowRankCoefficients(
+                        m_trans, cluster, m_store.rank(index),
+                        item.data[segment++], m_x,
+                        &m_coefficients[coefficientPosition(
+                                m_schedule, leaf, m_x.n_cols)]);
+        }
+    }
+
+private:
+    typename Store::Part innerFactor() const {
+        return m_trans == NO_TRANSPOSE ? Store::SECOND_FACTOR
+                                       : Store::FIRST_FACTOR;
+    }
+
+    TranspositionMode m_trans;
+    const arma::Mat<ValueType>& m_x;
+    const AhmedMatvecSchedule& m_schedule;
+    const Store& m_store;
+    std::vector<ValueType>& m_coefficients;
+};
+
+/** Pipeline stage adding the contributions of the leaf slices of schedule
+ *  chunks to the corresponding rows of y, for H-matrices stored out of core.
+ *  Items are ranges of chunks, which cover disjoint sets of rows. */
+template <typename ValueType>
+class OutOfCoreScheduledMultiplicationStage
+{
+public:
+    typedef OutOfCoreMblockStore<ValueType> Store;
+    typedef OutOfCoreMatvecItem<ValueType> Item;
+
+    OutOfCoreScheduledMultiplicationStage(
+            TranspositionMode trans,
+            ValueType multiplier,
+            const arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
+            const AhmedMatvecSchedule& schedule,
+            const Store& store,
+            const std::vector<ValueType>& coefficients) :
+        m_trans(trans), m_multiplier(multiplier), m_x(x), m_y(y),
+        m_schedule(schedule), m_store(store),
+        m_coefficients(coefficients)
+    {
+    }
+
+    size_t itemCount() const {
+        return m_schedule.chunkCount();
+    }
+
+    size_t pin(size_t chunk, Item& item) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        size_t bytes = 0;
+        for (const AhmedMatvecSchedule::Slice* slice =
+             m_schedule.chunkSlicesBegin(chunk);
+             slice != m_schedule.chunkSlicesEnd(chunk); ++slice) {
+            const size_t index = leafClusters[slice->leaf]->getidx();
+            const bool lowRank = m_store.isLowRank(index);
+            if (lowRank && m_store.rank(index) == 0)
+                continue;
+            bytes += pinSegment(m_store, index, outerFactor(lowRank), item);
+        }
+        return bytes;
+    }
+
+    void process(const Item& item) const {
+        const AhmedLeafClusterArray& leafClusters = m_schedule.leafClusters();
+        size_t segment = 0;
+        for (size_t chunk = item.begin; chunk != item.end; ++chunk)
+            for (const AhmedMatvecSchedule::Slice* slice =
+                 m_schedule.chunkSlicesBegin(chunk);
+                 slice != m_schedule.chunkSlicesEnd(chunk); ++slice) {
+                const blcluster* cluster = leafClusters[slice->leaf];
+                const size_t index = cluster->getidx();
+                const bool lowRank = m_store.isLowRank(index);
+                const size_t rank = m_store.rank(index);
+                if (lowRank && rank == 0)
+                    continue;
+                addSliceContribution(
+                            m_trans, m_multiplier, cluster, *slice,
+                            lowRank, rank, item.data[segment++],
+                            lowRank ? &m_coefficients[
+                                coefficientPosition(
+                                    m_schedule, slice->leaf, m_x.n_cols)] : 0,
+                            m_x, m_y);
+            }
+    }
+
+private:
+    typename Store::Part outerFactor(bool lowRank) const {
+        return (lowRank && m_trans != NO_TRANSPOSE) ? Store::SECOND_FACTOR
+                                                    : Store::FIRST_FACTOR;
+    }
+
+    TranspositionMode m_trans;
+    ValueType m_multiplier;
+    const arma::Mat<ValueType>& m_x;
+    arma::Mat<ValueType>& m_y;
+    const AhmedMatvecSchedule& m_schedule;
+    const Store& m_store;
+    const std::vector<ValueType>& m_coefficients;
+};
+
+// Approximate amount of mblock data pinned by a single pipeline item
+const size_t OUT_OF_CORE_ITEM_BYTES = 1 << 20;
+
+/** First pipeline filter: pins (reading from the scratch file if necessary)
+ *  the segments needed by consecutive items, in the order of the schedule.
+ *  As the pipeline runs several items at a time, this filter keeps reading
+ *  ahead while the previous items are being processed. */
+template <typename Stage>
+class OutOfCoreLoadFilter : public tbb::filter
+{
+public:
+    typedef typename Stage::Item Item;
+
+    explicit OutOfCoreLoadFilter(const Stage& stage,
+                                 const typename Stage::Store& store) :
+        tbb::filter(tbb::filter::serial_in_order),
+        m_stage(stage), m_store(store), m_next(0)
+    {
+    }
+
+    virtual void* operator()(void*) {
+        const size_t itemCount = m_stage.itemCount();
+        if (m_next == itemCount)
+            return 0;
+        std::auto_ptr<Item> item(new Item);
+        item->begin = m_next;
+        try {
+            size_t bytes = 0;
+            do {
+                bytes += m_stage.pin(m_next++, *item);
+            } while (m_next != itemCount && bytes < OUT_OF_CORE_ITEM_BYTES);
+        }
+        catch (...) {
+            releaseSegments(m_store, *item);
+            throw;
+        }
+        item->end = m_next;
+        return item.release();
+    }
+
+private:
+    const Stage& m_stage;
+    const typename Stage::Store& m_store;
+    size_t m_next;
+};
+
+template <typename Stage>
+class OutOfCoreProcessFilter : public tbb::filter
+{
+public:
+    typedef typename Stage::Item Item;
+
+    explicit OutOfCoreProcessFilter(const Stage& stage) :
+        tbb::filter(tbb::filter::parallel), m_stage(stage)
+    {
+    }
+
+    virtual void* operator()(void* item) {
+        m_stage.process(*static_cast<Item*>(item));
+        return item;
+    }
+
+private:
+    const Stage& m_stage;
+};
+
+template <typename Stage>
+class OutOfCoreReleaseFilter : public tbb::filter
+{
+public:
+    typedef typename Stage::Item Item;
+
+    explicit OutOfCoreReleaseFilter(const typename Stage::Store& store) :
+        tbb::filter(tbb::filter::serial_out_of_order), m_store(store)
+    {
+    }
+
+    virtual void* operator()(void* item) {
+        std::auto_ptr<Item> ownedItem(static_cast<Item*>(item));
+        releaseSegments(m_store, *ownedItem);
+        return 0;
+    }
+
+private:
+    const typename Stage::Store& m_store;
+};
+
+class PipelineRunner
+{
+public:
+    PipelineRunner(tbb::pipeline& pipeline, size_t tokenCount) :
+        m_pipeline(pipeline), m_tokenCount(tokenCount) {
+    }
+
+    void operator()() const {
+        m_pipeline.run(m_tokenCount);
+    }
+
+private:
+    tbb::pipeline& m_pipeline;
+    size_t m_tokenCount;
+};
+
+/** Process all items of \p stage with a pipeline overlapping reading of
+ *  mblock segments with computations. */
+template <typename Stage>
+void runOutOfCorePipeline(const ParallelizationOptions& parallelizationOptions,
+                          const Stage& stage,
+                          const typename Stage::Store& store)
+{
+    OutOfCoreLoadFilter<Stage> loadFilter(stage, store);
+    OutOfCoreProcessFilter<Stage> processFilter(stage);
+    OutOfCoreReleaseFilter<Stage> releaseFilter(store);
+    tbb::pipeline pipeline;
+    pipeline.add_filter(loadFilter);
+    pipeline.add_filter(processFilter);
+    pipeline.add_filter(releaseFilter);
+
+    int threadCount = parallelizationOptions.maxThreadCount();
+    if (threadCount == ParallelizationOptions::AUTO)
+        threadCount = tbb::task_scheduler_init::default_num_threads();
+    // One item being processed and one being read ahead per thread
+    PipelineRunner runner(pipeline, 2 * threadCount);
+    Fiber::ExecutionContext::instance().execute(parallelizationOptions, runner);
+    pipeline.clear();
+}
+
+/** Add alpha * op(A) * x to y, where A is a general H-matrix whose mblocks
+ *  are stored out of core, using a precomputed partition of its leaves by
+ *  target clusters. x and y should already be permuted.
+ *
+ *  The product is evaluated in two passes, each reading every mblock part
+ *  needed at most once: the first computes the coefficients of the low-rank
+ *  blocks, the second adds the contributions of all blocks to y. */
+template <typename ValueType>
+void mltaOutOfCoreHMat(
+        TranspositionMode trans, ValueType alpha,
+        const AhmedMatvecSchedule& schedule,
+        const OutOfCoreMblockStore<ValueType>& store,
+        const ParallelizationOptions& parallelizationOptions,
+        typename CoefficientBuffer<ValueType>::Pool& coefficientBuffers,
+        const arma::Mat<ValueType>& x, arma::Mat<ValueType>& y)
+{
+    CoefficientBuffer<ValueType> coefficients(
+                coefficientBuffers,
+                schedule.lowRankCoefficientCount() * x.n_cols);
+
+    Fiber::SerialBlasRegion region;
+    runOutOfCorePipeline(
+                parallelizationOptions,
+                OutOfCoreLowRankCoefficientStage<ValueType>(
+                    trans, x, schedule, store, coefficients.get()),
+                store);
+    runOutOfCorePipeline(
+                parallelizationOptions,
+                OutOfCoreScheduledMultiplicationStage<ValueType>(
+                    trans, alpha, x, y, schedule, store,
+                    coefficients.get()),
+                store);
+}
+
+/** Add alpha * op(A) * x to y, where A is an H-matrix with the given
+ *  symmetry. x and y should already be permuted.
+ *
+ *  If a schedule (partitioning the leaves by row clusters of op(A)) is
+ *  given and A is a general H-matrix, each thread writes only to its own
+ *  rows of y. Otherwise the leaf blocks are distributed among threads, each
+ *  of which accumulates its contributions in a private copy of y. In both
+ *  cases each leaf is visited only once, regardless of the number of
+ *  columns of x and y. On output x may be overwritten.
+ *
+ *  Symmetric and Hermitian H-matrices always take the second path: only one
+ *  triangle of their leaves is stored, and each off-diagonal leaf
+ *  contributes both to its own rows and, transposed, to its columns, which
+ *  the schedule does not describe. */
+template <typename ValueType>
+void mltaHMat(int symmetry, TranspositionMode trans, ValueType alpha,
+              blcluster* blockCluster,
+              const boost::shared_array<
+                  mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+              const AhmedMatvecSchedule* schedule,
+              const ParallelizationOptions& parallelizationOptions,
+              typename CoefficientBuffer<ValueType>::Pool& coefficientBuffers,
+              arma::Mat<ValueType>& x, arma::Mat<ValueType>& y)
+{
+    // If A is symmetric, op(A) is either A or conj(A), and the same holds if
+    // A is Hermitian. In the latter case we use
+    // alpha conj(A) x + y = (alpha^* A x^* + y^*)^*
+    bool conjugated = false;
+    if (symmetry & SYMMETRIC)
+        conjugated = (trans == CONJUGATE_TRANSPOSE);
+    else if (symmetry & HERMITIAN)
+        conjugated = (trans == TRANSPOSE);
+    if (conjugated) {
+        x = arma::conj(x);
+        y = arma::conj(y);
+        alpha = conj(alpha);
+    }
+
+    if (schedule && !(symmetry & (SYMMETRIC | HERMITIAN))) {
+        mltaGeHMatScheduled(trans, alpha, *schedule, blocks,
+                            parallelizationOptions, coefficientBuffers, x, y);
+        return;
+    }
+
+    AhmedLeafClusterArray leafClusters(blockCluster);
+    leafClusters.sortAccordingToClusterSize();
+    const size_t leafClusterCount = leafClusters.size();
+
+    std::vector<ChunkStatistics> chunkStats(leafClusterCount);
+
+    typedef MblockMultiplicationLoopBody<ValueType> Body;
+    typename Body::LeafClusterIndexQueue leafClusterIndexQueue;
+    for (size_t i = 0; i < leafClusterCount; ++i)
+        leafClusterIndexQueue.push(i);
+
+    Body body(symmetry, trans, alpha, x, y, leafClusters, blocks,
+              leafClusterIndexQueue, chunkStats);
+    {
+        Fiber::SerialBlasRegion region;
+        Fiber::ExecutionContext::instance().parallelReduce(
+                    parallelizationOptions,
+                    tbb::blocked_range<size_t>(0, leafClusterCount), body);
+    }
+    if (conjugated)
+        y = arma::conj(body.m_local_y);
+    else
+        y = body.m_local_y;
+}
+
+bool areEqual(const blcluster* op1, const blcluster* op2)
+{
+    if (!op1 || !op2)
+        return (!op1 && !op2);
+    if (op1->getnrs() != op2->getnrs() || op1->getncs() != op2->getncs())
+        return false;
+    if (op1->isleaf())
+        return (op1->getb1() == op2->getb1() && op1->getb2() == op2->getb2() &&
+                op1->getn1() == op2->getn1() && op1->getn2() == op2->getn2());
+    for (unsigned int rs = 0; rs < op1->getnrs(); ++rs)
+        for (unsigned int cs = 0; cs < op1->getncs(); ++cs)
+            if (!areEqual(op1->getson(rs, cs), op2->getson(rs, cs)))
+                return false;
+    return true;
 }
 
 } // namespace
@@ -256,6 +1335,8 @@ DiscreteAcaBoundaryOperator(
         std::cout << "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
                      "warning: suspicious value of maximumRank ("
                   << maximumRank_ << ")" << std::endl;
+    initializeMatvecSchedules();
+    createPermutationWorkspace();
 }
 
 template <typename ValueType>
@@ -285,6 +1366,8 @@ DiscreteAcaBoundaryOperator(
     m_parallelizationOptions(parallelizationOptions_),
     m_sharedBlocks(sharedBlocks_)
 {
+    initializeMatvecSchedules();
+    createPermutationWorkspace();
 }
 
 template <typename ValueType>
@@ -314,6 +1397,133 @@ DiscreteAcaBoundaryOperator(
     m_parallelizationOptions(parallelizationOptions_),
     m_sharedBlocks(sharedBlocks_)
 {
+    initializeMatvecSchedules();
+    createPermutationWorkspace();
+}
+
+template <typename ValueType>
+DiscreteAcaBoundaryOperator<ValueType>::
+DiscreteAcaBoundaryOperator(
+        unsigned int rowCount, unsigned int columnCount,
+        double eps_,
+        int maximumRank_,
+        const shared_ptr<const AhmedBemBlcluster>& blockCluster_,
+        const shared_ptr<const OutOfCoreMblockStore<ValueType> >&
+            outOfCoreStore_,
+        const IndexPermutation& domainPermutation_,
+        const IndexPermutation& rangePermutation_,
+        const ParallelizationOptions& parallelizationOptions_) :
+#ifdef WITH_TRILINOS
+    m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(columnCount)),
+    m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(rowCount)),
+#else
+    m_rowCount(rowCount), m_columnCount(columnCount),
+#endif
+    m_eps(eps_),
+    m_maximumRank(maximumRank_),
+    m_symmetry(NO_SYMMETRY),
+    m_blockCluster(blockCluster_),
+    m_outOfCoreStore(outOfCoreStore_),
+    m_domainPermutation(domainPermutation_),
+    m_rangePermutation(rangePermutation_),
+    m_parallelizationOptions(parallelizationOptions_)
+{
+    if (!outOfCoreStore_)
+        throw std::invalid_argument(
+                "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
+                "outOfCoreStore must not be null");
+    if (outOfCoreStore_->blockCount() != blockCluster_->nleaves())
+        throw std::invalid_argument(
+                "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
+                "the number of mblocks in outOfCoreStore does not match the "
+                "number of leaves of blockCluster");
+    initializeMatvecSchedules();
+    createPermutationWorkspace();
+}
+
+template <typename ValueType>
+DiscreteAcaBoundaryOperator<ValueType>::
+DiscreteAcaBoundaryOperator(
+        unsigned int rowCount, unsigned int columnCount,
+        double eps_,
+        int maximumRank_,
+        const shared_ptr<const AhmedBemBlcluster>& blockCluster_,
+        const shared_ptr<const MixedPrecisionMblockArray<ValueType> >&
+            mixedPrecisionBlocks_,
+        const IndexPermutation& domainPermutation_,
+        const IndexPermutation& rangePermutation_,
+        const ParallelizationOptions& parallelizationOptions_) :
+#ifdef WITH_TRILINOS
+    m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(columnCount)),
+    m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(rowCount)),
+#else
+    m_rowCount(rowCount), m_columnCount(columnCount),
+#endif
+    m_eps(eps_),
+    m_maximumRank(maximumRank_),
+    m_symmetry(NO_SYMMETRY),
+    m_blockCluster(blockCluster_),
+    m_mixedPrecisionBlocks(mixedPrecisionBlocks_),
+    m_domainPermutation(domainPermutation_),
+    m_rangePermutation(rangePermutation_),
+    m_parallelizationOptions(parallelizationOptions_)
+{
+    if (!mixedPrecisionBlocks_)
+        throw std::invalid_argument(
+                "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
+                "mixedPrecisionBlocks must not be null");
+    if (mixedPrecisionBlocks_->blockCount() != blockCluster_->nleaves())
+        throw std::invalid_argument(
+                "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
+                "the number of mblocks in mixedPrecisionBlocks does not match "
+                "the number of leaves of blockCluster");
+    initializeMatvecSchedules();
+    createPermutationWorkspace();
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+initializeMatvecSchedules()
+{
+    blcluster* nonconstBlockCluster = const_cast<blcluster*>(
+                static_cast<const blcluster*>(m_blockCluster.get()));
+
+    // Ranks of the low-rank blocks, which determine the layout of the
+    // low-rank coefficients in scheduled products
+    const size_t blockCount = m_blockCluster->nleaves();
+    std::vector<unsigned int> blockRanks(blockCount, 0);
+    for (size_t i = 0; i < blockCount; ++i)
+        if (m_outOfCoreStore) {
+            if (m_outOfCoreStore->isLowRank(i))
+                blockRanks[i] = m_outOfCoreStore->rank(i);
+        } else if (m_mixedPrecisionBlocks) {
+            if (m_mixedPrecisionBlocks->isLowRank(i))
+                blockRanks[i] = m_mixedPrecisionBlocks->rank(i);
+        } else if (m_blocks[i]->isLrM())
+            blockRanks[i] = m_blocks[i]->rank();
+
+    // Scheduled products of H-matrices stored in memory are possible only if
+    // they are general and all their leaves are low-rank or general dense
+    // blocks; this is checked here rather than in every product, since the
+    // blocks change only when the schedules are recreated
+    if (m_blocks) {
+        bool supported = !(m_symmetry & (SYMMETRIC | HERMITIAN));
+        for (size_t i = 0; supported && i < blockCount; ++i)
+            supported = isSupportedByMatvecSchedule<ValueType>(m_blocks[i]);
+        if (!supported) {
+            m_matvecSchedule.reset();
+            m_transposedMatvecSchedule.reset();
+            return;
+        }
+    }
+
+    m_matvecSchedule.reset(new LazyMatvecSchedule(
+        AhmedMatvecScheduleInitializer(nonconstBlockCluster, false,
+                                       rowCount(), blockRanks)));
+    m_transposedMatvecSchedule.reset(new LazyMatvecSchedule(
+        AhmedMatvecScheduleInitializer(nonconstBlockCluster, true,
+                                       columnCount(), blockRanks)));
 }
 
 template <typename ValueType>
@@ -325,6 +1535,7 @@ asMatrix() const
     const unsigned int nCols = columnCount();
     const blcluster* blockCluster = m_blockCluster.get();
     blcluster* nonconstBlockCluster = const_cast<blcluster*>(blockCluster);
+    AhmedMblockArray allBlocks = blocks();
 
     arma::Mat<ValueType> permutedOutput(nRows, nCols );
     permutedOutput.fill(0.);
@@ -337,15 +1548,15 @@ asMatrix() const
             unit(col - 1) = 0.;
         unit(col) = 1.;
         if (m_symmetry & SYMMETRIC)
-            mltaSyHVec(1., nonconstBlockCluster, m_blocks.get(),
+            mltaSyHVec(1., nonconstBlockCluster, allBlocks.get(),
                        ahmedCast(unit.memptr()),
                        ahmedCast(permutedOutput.colptr(col)));
         else if (m_symmetry & HERMITIAN)
-            mltaHeHVec(1., nonconstBlockCluster, m_blocks.get(),
+            mltaHeHVec(1., nonconstBlockCluster, allBlocks.get(),
                        ahmedCast(unit.memptr()),
                        ahmedCast(permutedOutput.colptr(col)));
         else
-            mltaGeHVec(1., nonconstBlockCluster, m_blocks.get(),
+            mltaGeHVec(1., nonconstBlockCluster, allBlocks.get(),
                        ahmedCast(unit.memptr()),
                        ahmedCast(permutedOutput.colptr(col)));
     }
@@ -470,9 +1681,6 @@ applyBuiltInImpl(const TranspositionMode trans,
                 "CONJUGATE_TRANSPOSE are not supported");
     bool transposed = (trans & TRANSPOSE);
 
-    const blcluster* blockCluster = m_blockCluster.get();
-    blcluster* nonconstBlockCluster = const_cast<blcluster*>(blockCluster);
-
     if ((!transposed && (columnCount() != x_in.n_rows ||
                          rowCount() != y_inout.n_rows)) ||
             (transposed && (rowCount() != x_in.n_rows ||
@@ -481,100 +1689,104 @@ applyBuiltInImpl(const TranspositionMode trans,
                 "DiscreteAcaBoundaryOperator::applyBuiltInImpl(): "
                 "incorrect vector length");
 
+    applyToPermutedCopies(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                            const arma::Mat<ValueType>& x_in,
+                            arma::Mat<ValueType>& y_inout,
+                            const ValueType alpha,
+                            const ValueType beta) const
+{
+    if (trans != NO_TRANSPOSE && trans != TRANSPOSE && trans != CONJUGATE_TRANSPOSE)
+        throw std::runtime_error(
+                "DiscreteAcaBoundaryOperator::applyBuiltInMultiVectorImpl(): "
+                "transposition modes other than NO_TRANSPOSE, TRANSPOSE and "
+                "CONJUGATE_TRANSPOSE are not supported");
+    bool transposed = (trans & TRANSPOSE);
+
+    if ((!transposed && (columnCount() != x_in.n_rows ||
+                         rowCount() != y_inout.n_rows)) ||
+            (transposed && (rowCount() != x_in.n_rows ||
+                            columnCount() != y_inout.n_rows)) ||
+            x_in.n_cols != y_inout.n_cols)
+        throw std::invalid_argument(
+                "DiscreteAcaBoundaryOperator::applyBuiltInMultiVectorImpl(): "
+                "incorrect matrix dimensions");
+
+    applyToPermutedCopies(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+applyToPermutedCopies(const TranspositionMode trans,
+                      const arma::Mat<ValueType>& x_in,
+                      arma::Mat<ValueType>& y_inout,
+                      const ValueType alpha,
+                      const ValueType beta) const
+{
+    bool transposed = (trans & TRANSPOSE);
+
+    const blcluster* blockCluster = m_blockCluster.get();
+    blcluster* nonconstBlockCluster = const_cast<blcluster*>(blockCluster);
+
     if (beta == static_cast<ValueType>(0.))
         y_inout.fill(static_cast<ValueType>(0.));
     else
         y_inout *= beta;
 
-    arma::Col<ValueType> permutedArgument;
-    if (!transposed)
-        m_domainPermutation.permuteVector(x_in, permutedArgument);
+    const IndexPermutation& xPermutation =
+            transposed ? m_rangePermutation : m_domainPermutation;
+    const IndexPermutation& yPermutation =
+            transposed ? m_domainPermutation : m_rangePermutation;
+
+    // The permuted copies of x and y are held in a workspace reused by
+    // subsequent products, so that they are reallocated only when the
+    // number of columns changes
+    PooledWorkspace<PermutationWorkspace> workspace(m_permutationWorkspaces);
+    arma::Mat<ValueType>& permutedArgument =
+            transposed ? workspace.get().rangeData : workspace.get().domainData;
+    arma::Mat<ValueType>& permutedResult =
+            transposed ? workspace.get().domainData : workspace.get().rangeData;
+    xPermutation.permuteMatrixRows(x_in, permutedArgument);
+    yPermutation.permuteMatrixRows(y_inout, permutedResult);
+
+    const shared_ptr<LazyMatvecSchedule>& lazySchedule =
+            transposed ? m_transposedMatvecSchedule : m_matvecSchedule;
+    const AhmedMatvecSchedule* schedule =
+            lazySchedule ? &lazySchedule->get() : 0;
+    if (m_outOfCoreStore)
+        mltaOutOfCoreHMat(trans, alpha, *schedule, *m_outOfCoreStore,
+                          m_parallelizationOptions, m_coefficientBuffers,
+                          permutedArgument, permutedResult);
+    else if (m_mixedPrecisionBlocks)
+        mltaMixedPrecisionHMat(trans, alpha, *schedule, *m_mixedPrecisionBlocks,
+                               m_parallelizationOptions, m_coefficientBuffers,
+                               permutedArgument, permutedResult);
     else
-        m_rangePermutation.permuteVector(x_in, permutedArgument);
+        mltaHMat(m_symmetry, trans, alpha, nonconstBlockCluster, m_blocks,
+                 schedule, m_parallelizationOptions, m_coefficientBuffers,
+                 permutedArgument, permutedResult);
 
-    arma::Col<ValueType> permutedResult;
-    if (!transposed)
-        m_rangePermutation.permuteVector(y_inout, permutedResult);
-    else
-        m_domainPermutation.permuteVector(y_inout, permutedResult);
-
-    if (m_symmetry & SYMMETRIC) {
-        // TODO: parallelise
-        if (trans == NO_TRANSPOSE || trans == TRANSPOSE)
-            mltaSyHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-        else // trans == CONJUGATE_TRANSPOSE
-            mltaSyHhVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-    }
-    else if (m_symmetry & HERMITIAN) {
-        // NO_TRANSPOSE and CONJUGATE_TRANSPOSE are equivalent
-        if (trans == NO_TRANSPOSE || trans == CONJUGATE_TRANSPOSE)
-            mltaHeHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-        else { // trans == TRANSPOSE
-            // alpha A^T x + beta y = (alpha^* A^H x^* + beta^* y^*)^*
-            // = (alpha^* A x^* + beta^* y^*)^*
-            permutedArgument = arma::conj(permutedArgument);
-            permutedResult = arma::conj(permutedResult);
-            ValueType alphaConj = conj(alpha);
-            mltaHeHVec(ahmedCast(alphaConj), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-            permutedResult = arma::conj(permutedResult);
-        }
-    }
-    else {
-//        if (trans == NO_TRANSPOSE)
-//            mltaGeHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-//                       ahmedCast(permutedArgument.memptr()),
-//                       ahmedCast(permutedResult.memptr()));
-//        else // trans == CONJUGATE_TRANSPOSE
-//            mltaGeHhVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-//                        ahmedCast(permutedArgument.memptr()),
-//                        ahmedCast(permutedResult.memptr()));
-
-        AhmedLeafClusterArray leafClusters(nonconstBlockCluster);
-        leafClusters.sortAccordingToClusterSize();
-        const size_t leafClusterCount = leafClusters.size();
-
-        int maxThreadCount = 1;
-        if (!m_parallelizationOptions.isOpenClEnabled()) {
-            if (m_parallelizationOptions.maxThreadCount() ==
-                    ParallelizationOptions::AUTO)
-                maxThreadCount = tbb::task_scheduler_init::automatic;
-            else
-                maxThreadCount = m_parallelizationOptions.maxThreadCount();
-        }
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-
-        std::vector<ChunkStatistics> chunkStats(leafClusterCount);
-
-        typedef MblockMultiplicationLoopBody<ValueType> Body;
-        typename Body::LeafClusterIndexQueue leafClusterIndexQueue;
-        for (size_t i = 0; i < leafClusterCount; ++i)
-            leafClusterIndexQueue.push(i);
-
-        // std::cout << "----------------------------\nperm Arg\n" << permutedArgument;
-        // std::cout << "perm Res\n" << permutedResult;
-        Body body(trans,
-                  alpha, permutedArgument, permutedResult,
-                  leafClusters, m_blocks,
-                  leafClusterIndexQueue, chunkStats);
-        {
-            Fiber::SerialBlasRegion region;
-            tbb::parallel_reduce(tbb::blocked_range<size_t>(0, leafClusterCount),
-                                 body);
-        }
-        permutedResult = body.m_local_y;
-    }
-    if (!transposed)
-        m_rangePermutation.unpermuteVector(permutedResult, y_inout);
-    else
-        m_domainPermutation.unpermuteVector(permutedResult, y_inout);
+    yPermutation.unpermuteMatrixRows(permutedResult, y_inout);
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+createPermutationWorkspace()
+{
+    // Products with a single vector, the most common ones, need no
+    // allocation of permuted copies
+    shared_ptr<PermutationWorkspace> workspace =
+            boost::make_shared<PermutationWorkspace>();
+    workspace->domainData.set_size(columnCount(), 1);
+    workspace->rangeData.set_size(rowCount(), 1);
+    m_permutationWorkspaces.push(workspace);
 }
 
 template <typename ValueType>
@@ -582,9 +1794,62 @@ void
 DiscreteAcaBoundaryOperator<ValueType>::
 makeAllMblocksDense()
 {
+    if (!m_blocks)
+        throw NotImplementedError(
+                "DiscreteAcaBoundaryOperator::makeAllMblocksDense(): "
+                "not supported for operators stored out of core or in "
+                "mixed precision");
     for (unsigned int i = 0; i < m_blockCluster->nleaves(); ++i)
         if (m_blocks[i]->isLrM())
             m_blocks[i]->convLrM_toGeM();
+    // The blocks are no longer low-rank
+    initializeMatvecSchedules();
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+recompress(double eps, int maximumRank, bool agglomerate)
+{
+    if (!m_blocks)
+        throw NotImplementedError(
+                "DiscreteAcaBoundaryOperator::recompress(): "
+                "not supported for operators stored out of core or in "
+                "mixed precision");
+    if (eps < 0.)
+        eps = m_eps;
+    if (maximumRank < 0)
+        maximumRank = m_maximumRank;
+    if (agglomerate && !m_blockCluster.unique())
+        throw std::runtime_error(
+                "DiscreteAcaBoundaryOperator::recompress(): the block cluster "
+                "tree is shared with other objects and so cannot be modified "
+                "by agglomeration");
+
+    // const_cast because Ahmed is not const-correct
+    blcluster* nonconstBlockCluster = const_cast<blcluster*>(
+                static_cast<const blcluster*>(m_blockCluster.get()));
+    truncateLowRankMblocks<ValueType>(nonconstBlockCluster, m_blocks.get(),
+                                      eps, m_parallelizationOptions);
+    if (agglomerate)
+        agglomerateMblocks<ValueType>(nonconstBlockCluster, m_blocks.get(),
+                                      eps, maximumRank,
+                                      m_parallelizationOptions);
+    // The block ranks and, after agglomeration, the leaves have changed
+    initializeMatvecSchedules();
+}
+
+template <typename ValueType>
+size_t
+DiscreteAcaBoundaryOperator<ValueType>::memoryUsage() const
+{
+    if (m_outOfCoreStore)
+        return m_outOfCoreStore->storedBytes();
+    if (m_mixedPrecisionBlocks)
+        return m_mixedPrecisionBlocks->memoryUsage();
+    // const_cast because Ahmed is not const-correct
+    return sizeH(const_cast<AhmedBemBlcluster*>(m_blockCluster.get()),
+                 m_blocks.get());
 }
 
 template <typename ValueType>
@@ -605,6 +1870,10 @@ template <typename ValueType>
 int
 DiscreteAcaBoundaryOperator<ValueType>::actualMaximumRank() const
 {
+    if (m_outOfCoreStore)
+        return m_outOfCoreStore->maximumRank();
+    if (m_mixedPrecisionBlocks)
+        return m_mixedPrecisionBlocks->maximumRank();
     // const_cast because Ahmed is not const-correct
     return Hmax_rank(const_cast<AhmedBemBlcluster*>(m_blockCluster.get()),
                      m_blocks.get());
@@ -628,7 +1897,42 @@ template <typename ValueType>
 typename DiscreteAcaBoundaryOperator<ValueType>::AhmedMblockArray
 DiscreteAcaBoundaryOperator<ValueType>::blocks() const
 {
-    return m_blocks;
+    if (m_blocks)
+        return m_blocks;
+    const size_t blockCount = m_blockCluster->nleaves();
+    AhmedMblockArray result = allocateAhmedMblockArray<ValueType>(blockCount);
+    for (size_t i = 0; i < blockCount; ++i)
+        result[i] = m_outOfCoreStore ? m_outOfCoreStore->loadMblock(i)
+                                     : m_mixedPrecisionBlocks->loadMblock(i);
+    return result;
+}
+
+template <typename ValueType>
+bool
+DiscreteAcaBoundaryOperator<ValueType>::isOutOfCore() const
+{
+    return m_outOfCoreStore.get() != 0;
+}
+
+template <typename ValueType>
+shared_ptr<const OutOfCoreMblockStore<ValueType> >
+DiscreteAcaBoundaryOperator<ValueType>::outOfCoreStore() const
+{
+    return m_outOfCoreStore;
+}
+
+template <typename ValueType>
+bool
+DiscreteAcaBoundaryOperator<ValueType>::isMixedPrecision() const
+{
+    return m_mixedPrecisionBlocks.get() != 0;
+}
+
+template <typename ValueType>
+shared_ptr<const MixedPrecisionMblockArray<ValueType> >
+DiscreteAcaBoundaryOperator<ValueType>::mixedPrecisionBlocks() const
+{
+    return m_mixedPrecisionBlocks;
 }
 
 template <typename ValueType>
@@ -709,8 +2013,8 @@ shared_ptr<const DiscreteBoundaryOperator<ValueType> > acaOperatorSum(
                                         sumBlockCluster.get()));
     boost::shared_array<AhmedMblock*> sumBlocks =
             allocateAhmedMblockArray<ValueType>(sumBlockCluster.get());
-    copyH(nonConstSumBlockCluster, acaOp1->m_blocks.get(), sumBlocks.get());
-    addGeHGeH(nonConstSumBlockCluster, sumBlocks.get(), acaOp2->m_blocks.get(),
+    copyH(nonConstSumBlockCluster, acaOp1->blocks().get(), sumBlocks.get());
+    addGeHGeH(nonConstSumBlockCluster, sumBlocks.get(), acaOp2->blocks().get(),
               eps, maximumRank);
     shared_ptr<const DiscreteBoundaryOperator<ValueType> > result(
                 new DiscreteAcaBoundaryOperator<ValueType> (
@@ -30,13 +30,17 @@
 
 #include "discrete_boundary_operator.hpp"
 #include "ahmed_aux_fwd.hpp"
+#include "ahmed_matvec_schedule.hpp"
 #include "assembly_options.hpp" // actually only ParallelizationOptions are needed
 #include "index_permutation.hpp"
 #include "symmetry.hpp"
+#include "../common/lazy.hpp"
 #include "../fiber/scalar_traits.hpp"
 
 #include <iostream>
+#include <vector>
 #include "../common/boost_shared_array_fwd.hpp"
+#include <tbb/concurrent_queue.h>
 
 #ifdef WITH_TRILINOS
 #include <Teuchos_RCP.hpp>
@@ -53,6 +57,8 @@ void dumpblcluster(const blcluster* bl, const std::string& indent);
 /** \cond FORWARD_DECL */
 template <typename ValueType> class AcaApproximateLuInverse;
 template <typename ValueType> class DiscreteAcaBoundaryOperator;
+template <typename ValueType> class MixedPrecisionMblockArray;
+template <typename ValueType> class OutOfCoreMblockStore;
 /** \endcond */
 
 // Global functions
@@ -218,6 +224,87 @@ public:
             const std::vector<AhmedConstMblockArray>& sharedBlocks_ =
                 std::vector<AhmedConstMblockArray>());
 
+    /** \brief Constructor of an operator whose mblocks are stored out of
+     *  core.
+     *
+     *  \param[in] rowCount
+     *    Number of rows.
+     *  \param[in] columnCount
+     *    Number of columns.
+     *  \param[in] epsUsedInAssembly
+     *    The epsilon parameter used during assembly of the H-matrix.
+     *  \param[in] maximumRankUsedInAssembly
+     *    The limit on block rank used during assembly of the H-matrix.
+     *  \param[in] blockCluster_
+     *    Block cluster defining the structure of the H-matrix.
+     *  \param[in] outOfCoreStore_
+     *    Scratch-file storage containing all the H-matrix blocks, which must
+     *    be low-rank or general dense mblocks.
+     *  \param[in] domainPermutation_
+     *    Mapping from original to permuted column indices.
+     *  \param[in] rangePermutation_
+     *    Mapping from original to permuted row indices.
+     *  \param[in] parallelizationOptions_
+     *    Options determining the maximum number of threads used in
+     *    the apply() routine for the H-matrix-vector product.
+     *
+     *  The H-matrix must be general (not symmetric nor Hermitian). Its
+     *  mblocks are read from \p outOfCoreStore_ during each matrix-vector
+     *  product, with at most the store's memory budget of them kept
+     *  resident between products. Functions that need all mblocks at once,
+     *  such as blocks() and asMatrix(), load them into memory; recompress()
+     *  and makeAllMblocksDense() are not supported. */
+    DiscreteAcaBoundaryOperator(
+            unsigned int rowCount, unsigned int columnCount,
+            double epsUsedInAssembly,
+            int maximumRankUsedInAssembly,
+            const shared_ptr<const AhmedBemBlcluster>& blockCluster_,
+            const shared_ptr<const OutOfCoreMblockStore<ValueType> >&
+                outOfCoreStore_,
+            const IndexPermutation& domainPermutation_,
+            const IndexPermutation& rangePermutation_,
+            const ParallelizationOptions& parallelizationOptions_);
+
+    /** \brief Constructor of an operator whose mblocks are stored in mixed
+     *  precision.
+     *
+     *  \param[in] rowCount
+     *    Number of rows.
+     *  \param[in] columnCount
+     *    Number of columns.
+     *  \param[in] epsUsedInAssembly
+     *    The epsilon parameter used during assembly of the H-matrix.
+     *  \param[in] maximumRankUsedInAssembly
+     *    The limit on block rank used during assembly of the H-matrix.
+     *  \param[in] blockCluster_
+     *    Block cluster defining the structure of the H-matrix.
+     *  \param[in] mixedPrecisionBlocks_
+     *    Array containing the H-matrix blocks, some of them stored in single
+     *    precision.
+     *  \param[in] domainPermutation_
+     *    Mapping from original to permuted column indices.
+     *  \param[in] rangePermutation_
+     *    Mapping from original to permuted row indices.
+     *  \param[in] parallelizationOptions_
+     *    Options determining the maximum number of threads used in
+     *    the apply() routine for the H-matrix-vector product.
+     *
+     *  The H-matrix must be general (not symmetric nor Hermitian).
+     *  Matrix-vector products are evaluated in the precision of \p
+     *  ValueType. Functions that need all mblocks as AHMED objects, such as
+     *  blocks() and asMatrix(), create full-precision copies of them;
+     *  recompress() and makeAllMblocksDense() are not supported. */
+    DiscreteAcaBoundaryOperator(
+            unsigned int rowCount, unsigned int columnCount,
+            double epsUsedInAssembly,
+            int maximumRankUsedInAssembly,
+            const shared_ptr<const AhmedBemBlcluster>& blockCluster_,
+            const shared_ptr<const MixedPrecisionMblockArray<ValueType> >&
+                mixedPrecisionBlocks_,
+            const IndexPermutation& domainPermutation_,
+            const IndexPermutation& rangePermutation_,
+            const ParallelizationOptions& parallelizationOptions_);
+
     /** \brief Constructor.
      *
      *  \param[in] rowCount
@@ -334,6 +421,41 @@ public:
      *  Sometimes useful for debugging. */
     void makeAllMblocksDense();
 
+    /** \brief Recompress the H-matrix in place.
+     *
+     *  The ranks of all low-rank blocks are first reduced by a truncated SVD
+     *  of their factors, discarding singular values smaller than \p eps
+     *  times the largest one. If \p agglomerate is true, sibling blocks are
+     *  then merged into single low-rank blocks wherever this reduces the
+     *  storage. Both passes are parallelised according to the options
+     *  returned by parallelizationOptions().
+     *
+     *  \param[in] eps
+     *    Accuracy of the recompression. If negative, the value returned by
+     *    eps() is used.
+     *  \param[in] maximumRank
+     *    Maximum rank of blocks produced by agglomeration. If negative, the
+     *    value returned by maximumRank() is used.
+     *  \param[in] agglomerate
+     *    Whether to coarsen the block structure after truncating the blocks.
+     *
+     *  Agglomeration modifies the block cluster tree, so it is only possible
+     *  if this tree is not shared with any other object; otherwise a
+     *  std::runtime_error is thrown.
+     *
+     *  \note Objects sharing the mblocks of this operator (see blocks())
+     *  see the recompressed blocks, too. */
+    void recompress(double eps = -1., int maximumRank = -1,
+                    bool agglomerate = true);
+
+    /** \brief Return the number of bytes occupied by the mblocks of this
+     *  operator.
+     *
+     *  For operators stored out of core, this is the size of the mblocks in
+     *  the scratch file. For operators stored in mixed precision, only the
+     *  values of the mblocks are counted. */
+    size_t memoryUsage() const;
+
     /** \brief Downcast a reference to a DiscreteBoundaryOperator object to
      *  DiscreteAcaBoundaryOperator.
      *
@@ -373,9 +495,31 @@ public:
      *
      *  \note This function returns a shared array of pointers to
      *  *non-constant* blocks. However, you must not modify it! This is just
-     *  a workaround for AHMED's lack of const-correctness. */
+     *  a workaround for AHMED's lack of const-correctness.
+     *
+     *  For operators stored out of core, a new array of mblocks is loaded
+     *  from the scratch file on each call. For operators stored in mixed
+     *  precision, a new array of full-precision copies of the mblocks is
+     *  created on each call. */
     AhmedMblockArray blocks() const;
 
+    /** \brief Return true if the mblocks of this operator are stored out of
+     *  core. */
+    bool isOutOfCore() const;
+
+    /** \brief Return the scratch-file storage of the mblocks of this
+     *  operator, or a null pointer if they are stored in memory. */
+    shared_ptr<const OutOfCoreMblockStore<ValueType> > outOfCoreStore() const;
+
+    /** \brief Return true if some mblocks of this operator are stored in
+     *  single precision. */
+    bool isMixedPrecision() const;
+
+    /** \brief Return the mixed-precision storage of the mblocks of this
+     *  operator, or a null pointer if they are stored in full precision. */
+    shared_ptr<const MixedPrecisionMblockArray<ValueType> >
+    mixedPrecisionBlocks() const;
+
     /** \brief Return the number of mblocks making up this operator. */
     size_t blockCount() const;
 
@@ -408,9 +552,35 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                                             const arma::Mat<ValueType>& x_in,
+                                             arma::Mat<ValueType>& y_inout,
+                                             const ValueType alpha,
+                                             const ValueType beta) const;
+    void applyToPermutedCopies(const TranspositionMode trans,
+                               const arma::Mat<ValueType>& x_in,
+                               arma::Mat<ValueType>& y_inout,
+                               const ValueType alpha,
+                               const ValueType beta) const;
+    void initializeMatvecSchedules();
+    void createPermutationWorkspace();
 
 private:
     /** \cond PRIVATE */
+    typedef Lazy<AhmedMatvecSchedule, AhmedMatvecScheduleInitializer>
+    LazyMatvecSchedule;
+    typedef tbb::concurrent_queue<shared_ptr<std::vector<ValueType> > >
+    CoefficientBufferPool;
+    // Permuted copies of the argument and result of a product, stored in the
+    // ordering of the domain and range clusters
+    struct PermutationWorkspace
+    {
+        arma::Mat<ValueType> domainData;
+        arma::Mat<ValueType> rangeData;
+    };
+    typedef tbb::concurrent_queue<shared_ptr<PermutationWorkspace> >
+    PermutationWorkspacePool;
+
 #ifdef WITH_TRILINOS
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_rangeSpace;
@@ -423,12 +593,26 @@ private:
     int m_symmetry;
 
     shared_ptr<const AhmedBemBlcluster> m_blockCluster;
-    AhmedMblockArray m_blocks;
+    AhmedMblockArray m_blocks; // null if stored out of core or in mixed precision
+    shared_ptr<const OutOfCoreMblockStore<ValueType> > m_outOfCoreStore;
+    shared_ptr<const MixedPrecisionMblockArray<ValueType> > m_mixedPrecisionBlocks;
 
     IndexPermutation m_domainPermutation;
     IndexPermutation m_rangePermutation;
     ParallelizationOptions m_parallelizationOptions;
     std::vector<AhmedConstMblockArray> m_sharedBlocks;
+    // Partitions of the leaves by row and column clusters, constructed on the
+    // first untransposed and (conjugate-)transposed product, respectively;
+    // null if the H-matrix is symmetric or Hermitian or has leaves that
+    // scheduled products do not support
+    shared_ptr<LazyMatvecSchedule> m_matvecSchedule;
+    shared_ptr<LazyMatvecSchedule> m_transposedMatvecSchedule;
+    // Buffers for the low-rank coefficients of products, reused by
+    // subsequent products
+    mutable CoefficientBufferPool m_coefficientBuffers;
+    // Workspaces for the permuted copies of the argument and result of
+    // products, one of them allocated at construction
+    mutable PermutationWorkspacePool m_permutationWorkspaces;
     /** \endcond */
 };
 
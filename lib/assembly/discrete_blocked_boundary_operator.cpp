@@ -916,6 +916,51 @@ applyBuiltInImpl(const TranspositionMode trans,
     }
 }
 
+template <typename ValueType>
+void DiscreteBlockedBoundaryOperator<ValueType>::
+applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                            const arma::Mat<ValueType>& x_in,
+                            arma::Mat<ValueType>& y_inout,
+                            const ValueType alpha,
+                            const ValueType beta) const
+{
+    bool transpose = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+    size_t y_count = transpose ? m_columnCounts.size() : m_rowCounts.size();
+    size_t x_count = transpose ? m_rowCounts.size() : m_columnCounts.size();
+
+    for (int yi = 0, y_start = 0; yi < y_count; ++yi) {
+        size_t y_chunk_size = transpose ? m_columnCounts[yi] : m_rowCounts[yi];
+        // Rows of a multi-column matrix are not contiguous in memory, so
+        // the chunk needs to be copied
+        arma::Mat<ValueType> y_chunk =
+                y_inout.rows(y_start, y_start + y_chunk_size - 1);
+        for (int xi = 0, x_start = 0; xi < x_count; ++xi) {
+            size_t x_chunk_size = transpose ? m_rowCounts[xi] : m_columnCounts[xi];
+            shared_ptr<const Base> op =
+                    transpose ? m_blocks(xi, yi) : m_blocks(yi, xi);
+            if (xi == 0) {
+                // This branch ensures that the "y += beta * y" part is done
+                if (op)
+                    op->apply(trans, x_in.rows(x_start, x_start + x_chunk_size - 1),
+                              y_chunk, alpha, beta);
+                else {
+                    if (beta == static_cast<ValueType>(0.))
+                        y_chunk.fill(0.);
+                    else
+                        y_chunk *= beta;
+                }
+            }
+            else
+                if (op)
+                    op->apply(trans, x_in.rows(x_start, x_start + x_chunk_size - 1),
+                              y_chunk, alpha, 1.);
+            x_start += x_chunk_size;
+        }
+        y_inout.rows(y_start, y_start + y_chunk_size - 1) = y_chunk;
+        y_start += y_chunk_size;
+    }
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteBlockedBoundaryOperator);
 
 } // namespace Bempp
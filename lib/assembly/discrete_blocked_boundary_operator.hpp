@@ -129,6 +129,11 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                                             const arma::Mat<ValueType>& x_in,
+                                             arma::Mat<ValueType>& y_inout,
+                                             const ValueType alpha,
+                                             const ValueType beta) const;
 
 #ifdef WITH_AHMED
     void mergeHMatrices(
@@ -31,6 +31,7 @@
 
 #include "../fiber/explicit_instantiation.hpp"
 
+#include <Thyra_DetachedMultiVectorView.hpp>
 #include <Thyra_DetachedSpmdVectorView.hpp>
 
 namespace Bempp
@@ -80,6 +81,18 @@ DiscreteBoundaryOperator<ValueType>::apply(
                                     "vectors x_in and y_inout must have "
                                     "the same number of columns");
 
+    applyBuiltInMultiVectorImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void
+DiscreteBoundaryOperator<ValueType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
     for (size_t i = 0; i < x_in.n_cols; ++i) {
         const arma::Col<ValueType> x_in_col = x_in.unsafe_col(i);
         arma::Col<ValueType> y_inout_col = y_inout.unsafe_col(i);
@@ -133,6 +146,26 @@ void DiscreteBoundaryOperator<ValueType>::applyImpl(
 
     const Ordinal colCount = X_in.domain()->dim();
 
+    if (colCount > 1) {
+        // Pass all the columns at once, so that operators supporting
+        // multi-vector products need to traverse their data only once
+        Thyra::ConstDetachedMultiVectorView<ValueType> xView(X_in);
+        Thyra::DetachedMultiVectorView<ValueType> yView(*Y_inout);
+        if (xView.leadingDim() == xView.subDim() &&
+                yView.leadingDim() == yView.subDim()) {
+            const arma::Mat<ValueType> xMat(
+                        const_cast<ValueType*>(xView.values().get()),
+                        xView.subDim(), xView.numSubCols(),
+                        false /* copy_aux_mem */);
+            arma::Mat<ValueType> yMat(yView.values().get(),
+                                      yView.subDim(), yView.numSubCols(),
+                                      false /* copy_aux_mem */);
+            applyBuiltInMultiVectorImpl(static_cast<TranspositionMode>(M_trans),
+                                        xMat, yMat, alpha, beta);
+            return;
+        }
+    }
+
     // Loop over the input columns
 
     for (Ordinal col = 0; col < colCount; ++col) {
@@ -238,6 +238,21 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const = 0;
+
+    /** \brief Apply the operator to several vectors at once.
+     *
+     *  Set <tt>y_inout := alpha * trans(L) * x_in + beta * y_inout</tt>, where
+     *  each column of \p x_in and \p y_inout is a separate vector.
+     *
+     *  The default implementation calls applyBuiltInImpl() for each column
+     *  separately. Subclasses that can process all the columns in a single
+     *  pass over their data (e.g. by matrix-matrix products) should override
+     *  this function. */
+    virtual void applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                                             const arma::Mat<ValueType>& x_in,
+                                             arma::Mat<ValueType>& y_inout,
+                                             const ValueType alpha,
+                                             const ValueType beta) const;
 };
 
 /** \relates DiscreteBoundaryOperator
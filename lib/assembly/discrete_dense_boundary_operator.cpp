@@ -22,10 +22,18 @@
 
 #include "discrete_dense_boundary_operator.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
+#include "../common/complex_aux.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/parallelization_options.hpp"
+#include "../fiber/serial_blas_region.hpp"
 
+#include <algorithm>
+#include <boost/type_traits/is_complex.hpp>
 #include <iostream>
 #include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <vector>
 
 #ifdef WITH_TRILINOS
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
@@ -34,10 +42,158 @@
 namespace Bempp
 {
 
+namespace
+{
+
+// Minimum number of matrix elements multiplied by a single task
+const size_t MIN_ELEMENTS_PER_TASK = 1 << 16;
+// Maximum number of conjugated entries of the argument held on the stack
+const size_t CONJUGATION_BUFFER_SIZE = 1024;
+
+// Calculate y := alpha * op(A) * x + beta * y, where A is a rowCount x
+// colCount matrix, x and y have rhsCount columns and op(A) is A, A^T or
+// A^H for transA equal to 'N', 'T' or 'C'. As in BLAS, y is not read if
+// beta is zero.
+template <typename ValueType>
+void multiply(char transA, int rowCount, int colCount, int rhsCount,
+              ValueType alpha, const ValueType* a, int lda,
+              const ValueType* x, int ldx,
+              ValueType beta, ValueType* y, int ldy)
+{
+#ifdef ARMA_USE_BLAS
+    const arma::blas_int m = rowCount, n = colCount, k = rhsCount;
+    const arma::blas_int ldA = lda, ldX = ldx, ldY = ldy, inc = 1;
+    if (rhsCount == 1)
+        arma::blas::gemv(&transA, &m, &n, &alpha, a, &ldA, x, &inc,
+                         &beta, y, &inc);
+    else {
+        const char transX = 'N';
+        const arma::blas_int outRowCount = (transA == 'N') ? m : n;
+        const arma::blas_int innerCount = (transA == 'N') ? n : m;
+        arma::blas::gemm(&transA, &transX, &outRowCount, &k, &innerCount,
+                         &alpha, a, &ldA, x, &ldX, &beta, y, &ldY);
+    }
+#else
+    const int outRowCount = (transA == 'N') ? rowCount : colCount;
+    const int innerCount = (transA == 'N') ? colCount : rowCount;
+    for (int j = 0; j < rhsCount; ++j)
+        for (int i = 0; i < outRowCount; ++i) {
+            ValueType sum = 0.;
+            for (int l = 0; l < innerCount; ++l) {
+                const ValueType aElement = (transA == 'N') ?
+                        a[i + l * lda] : a[l + i * lda];
+                sum += ((transA == 'C') ? Fiber::conj(aElement) : aElement) *
+                        x[l + j * ldx];
+            }
+            y[i + j * ldy] = (beta == static_cast<ValueType>(0.)) ?
+                        alpha * sum : alpha * sum + beta * y[i + j * ldy];
+        }
+#endif
+}
+
+// Multiplies the rows r.begin(), ..., r.end() - 1 of op(mat) by x
+template <typename ValueType>
+class DenseApplyLoopBody
+{
+public:
+    DenseApplyLoopBody(TranspositionMode trans,
+                       const arma::Mat<ValueType>& mat,
+                       const arma::Mat<ValueType>& x,
+                       ValueType alpha, ValueType beta,
+                       arma::Mat<ValueType>& y) :
+        m_trans(trans), m_mat(mat), m_x(x),
+        m_alpha(alpha), m_beta(beta), m_y(y)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const int rowCount = r.end() - r.begin();
+        const int lda = m_mat.n_rows;
+        switch (m_trans) {
+        case NO_TRANSPOSE:
+            multiply('N', rowCount, m_mat.n_cols, m_x.n_cols,
+                     m_alpha, m_mat.memptr() + r.begin(), lda,
+                     m_x.memptr(), m_x.n_rows,
+                     m_beta, m_y.memptr() + r.begin(), m_y.n_rows);
+            break;
+        case TRANSPOSE:
+        case CONJUGATE_TRANSPOSE:
+            multiply(m_trans == TRANSPOSE ? 'T' : 'C',
+                     m_mat.n_rows, rowCount, m_x.n_cols,
+                     m_alpha, m_mat.memptr() + r.begin() * lda, lda,
+                     m_x.memptr(), m_x.n_rows,
+                     m_beta, m_y.memptr() + r.begin(), m_y.n_rows);
+            break;
+        case CONJUGATE:
+            applyConjugate(r);
+            break;
+        }
+    }
+
+private:
+    // conj(A) * x is evaluated as conj(A * conj(x)): the rows of y are
+    // conjugated in place, and x is conjugated in small blocks, so that
+    // neither the matrix nor the whole argument needs to be copied
+    void applyConjugate(const tbb::blocked_range<size_t>& r) const {
+        const int rowCount = r.end() - r.begin();
+        const int colCount = m_mat.n_cols;
+        const int rhsCount = m_x.n_cols;
+        const int lda = m_mat.n_rows;
+        ValueType* y = m_y.memptr() + r.begin();
+        const int ldy = m_y.n_rows;
+
+        ValueType stackBuffer[CONJUGATION_BUFFER_SIZE];
+        std::vector<ValueType> heapBuffer;
+        ValueType* buffer = stackBuffer;
+        if (static_cast<size_t>(rhsCount) > CONJUGATION_BUFFER_SIZE) {
+            heapBuffer.resize(rhsCount);
+            buffer = &heapBuffer[0];
+        }
+        const int chunkSize =
+                std::max<int>(1, CONJUGATION_BUFFER_SIZE / rhsCount);
+
+        if (m_beta != static_cast<ValueType>(0.))
+            conjugateRows(y, rowCount, rhsCount, ldy);
+        for (int start = 0; start < colCount; start += chunkSize) {
+            const int count = std::min(chunkSize, colCount - start);
+            for (int j = 0; j < rhsCount; ++j)
+                for (int k = 0; k < count; ++k)
+                    buffer[k + j * count] =
+                            Fiber::conj(m_x(start + k, j));
+            multiply('N', rowCount, count, rhsCount,
+                     Fiber::conj(m_alpha),
+                     m_mat.memptr() + r.begin() + start * lda, lda,
+                     buffer, count,
+                     start == 0 ? Fiber::conj(m_beta) :
+                                  static_cast<ValueType>(1.),
+                     y, ldy);
+        }
+        conjugateRows(y, rowCount, rhsCount, ldy);
+    }
+
+    static void conjugateRows(ValueType* y, int rowCount, int colCount,
+                              int ldy) {
+        for (int j = 0; j < colCount; ++j)
+            for (int i = 0; i < rowCount; ++i)
+                y[i + j * ldy] = Fiber::conj(y[i + j * ldy]);
+    }
+
+    TranspositionMode m_trans;
+    const arma::Mat<ValueType>& m_mat;
+    const arma::Mat<ValueType>& m_x;
+    ValueType m_alpha;
+    ValueType m_beta;
+    arma::Mat<ValueType>& m_y;
+};
+
+} // namespace
+
 template <typename ValueType>
 DiscreteDenseBoundaryOperator<ValueType>::
-DiscreteDenseBoundaryOperator(const arma::Mat<ValueType>& mat) :
-    m_mat(mat)
+DiscreteDenseBoundaryOperator(
+        const arma::Mat<ValueType>& mat,
+        const ParallelizationOptions& parallelizationOptions) :
+    m_mat(mat), m_parallelizationOptions(parallelizationOptions)
 #ifdef WITH_TRILINOS
   , m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_cols)),
     m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_rows))
@@ -117,29 +273,67 @@ void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
         const ValueType alpha,
         const ValueType beta) const
 {
-    if (beta == static_cast<ValueType>(0.))
-        y_inout.fill(static_cast<ValueType>(0.));
-    else
-        y_inout *= beta;
+    applyBuiltInMultiVectorImpl(trans, x_in, y_inout, alpha, beta);
+}
 
-    switch (trans)
-    {
-    case NO_TRANSPOSE:
-        y_inout += alpha * m_mat * x_in;
-        break;
-    case CONJUGATE:
-        y_inout += alpha * arma::conj(m_mat) * x_in;
-        break;
-    case TRANSPOSE:
-        y_inout += alpha * m_mat.st() * x_in;
-        break;
-    case CONJUGATE_TRANSPOSE:
-        y_inout += alpha * m_mat.t() * x_in;
-        break;
-    default:
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    if (trans != NO_TRANSPOSE && trans != TRANSPOSE &&
+            trans != CONJUGATE && trans != CONJUGATE_TRANSPOSE)
         throw std::invalid_argument(
-                "DiscreteDenseBoundaryOperator::applyBuiltInImpl(): "
+                "DiscreteDenseBoundaryOperator::applyBuiltInMultiVectorImpl(): "
                 "invalid transposition mode");
+    // Complex conjugation does not affect real matrices
+    TranspositionMode effectiveTrans = trans;
+    if (!boost::is_complex<ValueType>()) {
+        if (trans == CONJUGATE)
+            effectiveTrans = NO_TRANSPOSE;
+        else if (trans == CONJUGATE_TRANSPOSE)
+            effectiveTrans = TRANSPOSE;
+    }
+
+    const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+    const size_t innerCount = transposed ? m_mat.n_rows : m_mat.n_cols;
+    if (y_inout.n_elem == 0)
+        return;
+    if (innerCount == 0 || alpha == static_cast<ValueType>(0.)) {
+        // BLAS routines do not scale y in these cases
+        if (beta == static_cast<ValueType>(0.))
+            y_inout.fill(static_cast<ValueType>(0.));
+        else
+            y_inout *= beta;
+        return;
+    }
+
+    // The products are evaluated directly by BLAS, which writes into y as it
+    // reads x; protect against the two sharing storage
+    arma::Mat<ValueType> x_copy;
+    const bool aliased = (x_in.memptr() == y_inout.memptr());
+    if (aliased)
+        x_copy = x_in;
+    const arma::Mat<ValueType>& x = aliased ? x_copy : x_in;
+
+    // Split y into blocks of rows multiplied by separate tasks, unless the
+    // matrix is too small to make this worthwhile
+    const size_t rowCount = y_inout.n_rows;
+    const size_t grainSize = std::max<size_t>(
+                1, MIN_ELEMENTS_PER_TASK / (innerCount * x.n_cols));
+    typedef DenseApplyLoopBody<ValueType> Body;
+    Body body(effectiveTrans, m_mat, x, alpha, beta, y_inout);
+    if (rowCount < 2 * grainSize)
+        body(tbb::blocked_range<size_t>(0, rowCount));
+    else {
+        Fiber::SerialBlasRegion region;
+        Fiber::ExecutionContext::instance().parallelFor(
+                    m_parallelizationOptions,
+                    tbb::blocked_range<size_t>(0, rowCount, grainSize),
+                    body);
     }
 }
 
@@ -28,6 +28,7 @@
 #include "discrete_boundary_operator.hpp"
 
 #include "../common/shared_ptr.hpp"
+#include "../fiber/parallelization_options.hpp"
 
 #ifdef WITH_TRILINOS
 #include <Teuchos_RCP.hpp>
@@ -37,6 +38,8 @@
 namespace Bempp
 {
 
+using Fiber::ParallelizationOptions;
+
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator stored as a dense matrix. */
 template <typename ValueType>
@@ -46,8 +49,13 @@ class DiscreteDenseBoundaryOperator :
 public:
     /** \brief Constructor.
      *
-     *  Construct a discrete boundary operator represented by the matrix \p mat. */
-    explicit DiscreteDenseBoundaryOperator(const arma::Mat<ValueType>& mat);
+     *  Construct a discrete boundary operator represented by the matrix \p mat.
+     *  \p parallelizationOptions control the number of threads used to
+     *  apply the operator. */
+    explicit DiscreteDenseBoundaryOperator(
+            const arma::Mat<ValueType>& mat,
+            const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
 
     virtual void dump() const;
 
@@ -76,10 +84,16 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                                             const arma::Mat<ValueType>& x_in,
+                                             arma::Mat<ValueType>& y_inout,
+                                             const ValueType alpha,
+                                             const ValueType beta) const;
 
 private:
     /** \cond PRIVATE */
     arma::Mat<ValueType> m_mat;
+    ParallelizationOptions m_parallelizationOptions;
 #ifdef WITH_TRILINOS
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_rangeSpace;
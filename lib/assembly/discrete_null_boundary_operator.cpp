@@ -118,6 +118,17 @@ void DiscreteNullBoundaryOperator<ValueType>::applyBuiltInImpl(
         arma::Col<ValueType>& y_inout,
         const ValueType alpha,
         const ValueType beta) const
+{
+    applyBuiltInMultiVectorImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteNullBoundaryOperator<ValueType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
 {
     if (beta == static_cast<ValueType>(0.))
         y_inout.fill(static_cast<ValueType>(0.));
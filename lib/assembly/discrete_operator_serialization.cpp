@@ -0,0 +1,567 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "discrete_operator_serialization.hpp"
+
+#include "discrete_dense_boundary_operator.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/not_implemented_error.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WITH_AHMED
+#include "ahmed_aux.hpp"
+#include "index_permutation.hpp"
+#endif
+
+namespace Bempp
+{
+
+namespace
+{
+
+const char MAGIC[8] = "BEMPPOP";
+const int FORMAT_VERSION = 2;
+const unsigned int BYTE_ORDER_MARK = 0x01020304u;
+
+enum ContentType {
+    DENSE_MATRIX = 1,
+    H_MATRIX = 2,
+    MBLOCKS = 3
+};
+
+template <typename ValueType> struct ValueTypeCode;
+template <> struct ValueTypeCode<float> { enum { value = 1 }; };
+template <> struct ValueTypeCode<double> { enum { value = 2 }; };
+template <> struct ValueTypeCode<std::complex<float> > { enum { value = 3 }; };
+template <> struct ValueTypeCode<std::complex<double> > { enum { value = 4 }; };
+
+// The data are written to a temporary file, which is renamed when complete.
+// Thus readers never see partially written files, even if several processes
+// write the same file at the same time.
+class OutputFile
+{
+public:
+    OutputFile(const std::string& fileName, const char* caller) :
+        m_fileName(fileName), m_temporaryFileName(fileName + ".part"),
+        m_caller(caller),
+        m_stream(m_temporaryFileName.c_str(), std::ios::out | std::ios::binary) {
+        if (!m_stream)
+            fail("cannot open file");
+    }
+
+    ~OutputFile() {
+        if (m_stream.is_open()) { // close() has not been called
+            m_stream.close();
+            std::remove(m_temporaryFileName.c_str());
+        }
+    }
+
+    template <typename T>
+    void write(const T* values, size_t count) {
+        m_stream.write(reinterpret_cast<const char*>(values),
+                       count * sizeof(T));
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        write(&value, 1);
+    }
+
+    void writeHeader(ContentType contentType, int valueTypeCode,
+                     const std::string& cacheKey) {
+        write(MAGIC, sizeof(MAGIC));
+        write(FORMAT_VERSION);
+        write(static_cast<int>(contentType));
+        write(valueTypeCode);
+        write(BYTE_ORDER_MARK);
+        const unsigned int cacheKeySize = cacheKey.size();
+        write(cacheKeySize);
+        write(cacheKey.data(), cacheKeySize);
+    }
+
+    void close() {
+        m_stream.close();
+        if (!m_stream) {
+            std::remove(m_temporaryFileName.c_str());
+            fail("error while writing file");
+        }
+        if (std::rename(m_temporaryFileName.c_str(), m_fileName.c_str()) != 0) {
+            std::remove(m_temporaryFileName.c_str());
+            fail("cannot create file");
+        }
+    }
+
+    void fail(const std::string& message) const {
+        throw std::runtime_error(std::string(m_caller) + ": " + message +
+                                 " '" + m_fileName + "'");
+    }
+
+private:
+    std::string m_fileName;
+    std::string m_temporaryFileName;
+    const char* m_caller;
+    std::ofstream m_stream;
+};
+
+class InputFile
+{
+public:
+    InputFile(const std::string& fileName, const char* caller) :
+        m_fileName(fileName), m_caller(caller),
+        m_stream(fileName.c_str(), std::ios::in | std::ios::binary) {
+        if (!m_stream)
+            fail("cannot open file");
+    }
+
+    template <typename T>
+    void read(T* values, size_t count) {
+        const std::streamsize size = count * sizeof(T);
+        if (m_stream.rdbuf()->sgetn(reinterpret_cast<char*>(values), size) !=
+                size)
+            fail("unexpected end of file");
+    }
+
+    template <typename T>
+    void read(T& value) {
+        read(&value, 1);
+    }
+
+    void readHeader(ContentType contentType, int valueTypeCode,
+                    std::string& cacheKey) {
+        char magic[sizeof(MAGIC)];
+        read(magic, sizeof(magic));
+        if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+            fail("not a BEM++ discrete operator file");
+        int version, storedContentType, storedValueTypeCode;
+        unsigned int byteOrderMark;
+        read(version);
+        read(storedContentType);
+        read(storedValueTypeCode);
+        read(byteOrderMark);
+        if (byteOrderMark != BYTE_ORDER_MARK)
+            fail("incompatible byte order in file");
+        if (version != FORMAT_VERSION)
+            fail("unsupported format version in file");
+        if (storedContentType != contentType)
+            fail("unexpected type of object stored in file");
+        if (storedValueTypeCode != valueTypeCode)
+            fail("unexpected type of matrix entries in file");
+        unsigned int cacheKeySize;
+        read(cacheKeySize);
+        std::vector<char> buffer(cacheKeySize);
+        if (cacheKeySize > 0)
+            read(&buffer[0], cacheKeySize);
+        cacheKey.assign(buffer.begin(), buffer.end());
+    }
+
+    void fail(const std::string& message) const {
+        throw std::runtime_error(std::string(m_caller) + ": " + message +
+                                 " '" + m_fileName + "'");
+    }
+
+private:
+    std::string m_fileName;
+    const char* m_caller;
+    std::ifstream m_stream;
+};
+
+#ifdef WITH_AHMED
+
+enum MblockType {
+    LOW_RANK_MBLOCK = 0,
+    GENERAL_MBLOCK,
+    HERMITIAN_MBLOCK,
+    LOWER_TRIANGULAR_MBLOCK,
+    UPPER_TRIANGULAR_MBLOCK
+};
+
+// Number of integers describing an mblock in the file: b1, n1, b2, n2,
+// storage type and rank
+const size_t MBLOCK_RECORD_SIZE = 6;
+
+// Return the leaves of a block cluster tree ordered by their indices
+void getLeavesInIndexOrder(const blcluster& blockCluster,
+                           std::vector<blcluster*>& leaves)
+{
+    // const_cast because Ahmed is not const-correct
+    AhmedLeafClusterArray leafClusters(const_cast<blcluster*>(&blockCluster));
+    leaves.assign(leafClusters.size(), 0);
+    for (size_t i = 0; i < leafClusters.size(); ++i) {
+        const unsigned int index = leafClusters[i]->getidx();
+        if (index >= leaves.size())
+            throw std::invalid_argument("getLeavesInIndexOrder(): "
+                                        "invalid cluster index encountered");
+        leaves[index] = leafClusters[i];
+    }
+}
+
+template <typename ValueType>
+MblockType mblockType(mblock<ValueType>& block)
+{
+    if (block.isLrM())
+        return LOW_RANK_MBLOCK;
+    else if (block.isHeM())
+        return HERMITIAN_MBLOCK;
+    else if (block.isLtM())
+        return LOWER_TRIANGULAR_MBLOCK;
+    else if (block.isUtM())
+        return UPPER_TRIANGULAR_MBLOCK;
+    else if (block.isSyM())
+        throw NotImplementedError(
+                "mblockType(): storage of complex symmetric mblocks "
+                "is not supported yet");
+    else
+        return GENERAL_MBLOCK;
+}
+
+template <typename ValueType>
+void writeMblocks(OutputFile& file, const blcluster& blockCluster,
+                  mblock<typename AhmedTypeTraits<ValueType>::Type>* const* blocks)
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+
+    std::vector<blcluster*> leaves;
+    getLeavesInIndexOrder(blockCluster, leaves);
+    const unsigned int blockCount = leaves.size();
+    file.write(blockCount);
+    for (unsigned int i = 0; i < blockCount; ++i) {
+        AhmedMblock* block = blocks[i];
+        if (!block)
+            file.fail("missing mblock; cannot write file");
+        const unsigned int record[MBLOCK_RECORD_SIZE] = {
+            leaves[i]->getb1(), leaves[i]->getn1(),
+            leaves[i]->getb2(), leaves[i]->getn2(),
+            mblockType(*block), block->isLrM() ? block->rank() : 0
+        };
+        file.write(record, MBLOCK_RECORD_SIZE);
+        file.write(block->getdata(), block->nvals());
+    }
+}
+
+template <typename ValueType>
+void deleteMblocks(std::vector<mblock<ValueType>*>& blocks)
+{
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        delete blocks[i];
+        blocks[i] = 0;
+    }
+}
+
+// Return false if the stored mblocks do not match the leaves of blockCluster
+template <typename ValueType>
+bool readMblocks(InputFile& file, const blcluster& blockCluster,
+                 mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks)
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+
+    std::vector<blcluster*> leaves;
+    getLeavesInIndexOrder(blockCluster, leaves);
+    unsigned int blockCount;
+    file.read(blockCount);
+    if (blockCount != leaves.size())
+        return false;
+
+    std::vector<AhmedMblock*> loadedBlocks(blockCount, 0);
+    try {
+        for (unsigned int i = 0; i < blockCount; ++i) {
+            unsigned int record[MBLOCK_RECORD_SIZE];
+            file.read(record, MBLOCK_RECORD_SIZE);
+            if (record[0] != leaves[i]->getb1() ||
+                    record[1] != leaves[i]->getn1() ||
+                    record[2] != leaves[i]->getb2() ||
+                    record[3] != leaves[i]->getn2()) {
+                deleteMblocks(loadedBlocks);
+                return false;
+            }
+            AhmedMblock* block = new AhmedMblock(record[1], record[3]);
+            loadedBlocks[i] = block;
+            switch (record[4]) {
+            case LOW_RANK_MBLOCK: block->setrank(record[5]); break;
+            case GENERAL_MBLOCK: block->setGeM(); break;
+            case HERMITIAN_MBLOCK: block->setHeM(); break;
+            case LOWER_TRIANGULAR_MBLOCK: block->setLtM(); break;
+            case UPPER_TRIANGULAR_MBLOCK: block->setUtM(); break;
+            default: file.fail("invalid mblock type in file");
+            }
+            // Read the data straight into the storage of the mblock
+            file.read(block->getdata(), block->nvals());
+        }
+    }
+    catch (...) {
+        deleteMblocks(loadedBlocks);
+        throw;
+    }
+    for (unsigned int i = 0; i < blockCount; ++i)
+        blocks[i] = loadedBlocks[i];
+    return true;
+}
+
+void writePermutation(OutputFile& file, const IndexPermutation& permutation)
+{
+    const std::vector<unsigned int>& indices = permutation.permutedIndices();
+    const unsigned int size = indices.size();
+    file.write(size);
+    if (size > 0)
+        file.write(&indices[0], size);
+}
+
+void readPermutation(InputFile& file, unsigned int expectedSize,
+                     std::vector<unsigned int>& indices)
+{
+    unsigned int size;
+    file.read(size);
+    if (size != expectedSize)
+        file.fail("inconsistent permutation size in file");
+    indices.resize(size);
+    if (size > 0)
+        file.read(&indices[0], size);
+}
+
+#endif // WITH_AHMED
+
+} // namespace
+
+template <typename ValueType>
+void writeDenseMatrix(const DiscreteDenseBoundaryOperator<ValueType>& op,
+                      const std::string& fileName, const char* caller,
+                      const std::string& cacheKey)
+{
+    const arma::Mat<ValueType> mat = op.asMatrix();
+    OutputFile file(fileName, caller);
+    file.writeHeader(DENSE_MATRIX, ValueTypeCode<ValueType>::value, cacheKey);
+    file.write(static_cast<unsigned int>(mat.n_rows));
+    file.write(static_cast<unsigned int>(mat.n_cols));
+    file.write(mat.memptr(), mat.n_elem);
+    file.close();
+}
+
+// Return a null pointer if expectedCacheKey is not null and differs from the
+// cache key stored in the file
+template <typename ValueType>
+std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> > readDenseMatrix(
+        const std::string& fileName, const char* caller,
+        const std::string* expectedCacheKey,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    typedef DiscreteDenseBoundaryOperator<ValueType> DiscreteDenseLinOp;
+
+    InputFile file(fileName, caller);
+    std::string cacheKey;
+    file.readHeader(DENSE_MATRIX, ValueTypeCode<ValueType>::value, cacheKey);
+    if (expectedCacheKey && cacheKey != *expectedCacheKey)
+        return std::auto_ptr<DiscreteDenseLinOp>();
+    unsigned int rowCount, columnCount;
+    file.read(rowCount);
+    file.read(columnCount);
+    arma::Mat<ValueType> mat(rowCount, columnCount);
+    file.read(mat.memptr(), mat.n_elem);
+    return std::auto_ptr<DiscreteDenseLinOp>(
+                new DiscreteDenseLinOp(mat, parallelizationOptions));
+}
+
+template <typename ValueType>
+void saveDiscreteDenseBoundaryOperator(
+        const DiscreteDenseBoundaryOperator<ValueType>& op,
+        const std::string& fileName)
+{
+    writeDenseMatrix(op, fileName, "saveDiscreteDenseBoundaryOperator()",
+                     std::string());
+}
+
+template <typename ValueType>
+std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> >
+loadDiscreteDenseBoundaryOperator(
+        const std::string& fileName,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    return readDenseMatrix<ValueType>(
+                fileName, "loadDiscreteDenseBoundaryOperator()",
+                0 /* expectedCacheKey */, parallelizationOptions);
+}
+
+template <typename ValueType>
+void saveCachedDiscreteDenseBoundaryOperator(
+        const DiscreteDenseBoundaryOperator<ValueType>& op,
+        const std::string& fileName,
+        const std::string& cacheKey)
+{
+    writeDenseMatrix(op, fileName, "saveCachedDiscreteDenseBoundaryOperator()",
+                     cacheKey);
+}
+
+template <typename ValueType>
+std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> >
+loadCachedDiscreteDenseBoundaryOperator(
+        const std::string& fileName,
+        const std::string& cacheKey,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    if (!std::ifstream(fileName.c_str()))
+        return std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> >();
+    return readDenseMatrix<ValueType>(
+                fileName, "loadCachedDiscreteDenseBoundaryOperator()",
+                &cacheKey, parallelizationOptions);
+}
+
+#ifdef WITH_AHMED
+
+template <typename ValueType>
+void saveDiscreteAcaBoundaryOperator(
+        const DiscreteAcaBoundaryOperator<ValueType>& op,
+        const std::string& fileName)
+{
+    OutputFile file(fileName, "saveDiscreteAcaBoundaryOperator()");
+    file.writeHeader(H_MATRIX, ValueTypeCode<ValueType>::value,
+                     std::string() /* cacheKey */);
+    file.write(op.rowCount());
+    file.write(op.columnCount());
+    file.write(op.eps());
+    file.write(op.maximumRank());
+    file.write(op.symmetry());
+    writePermutation(file, op.domainPermutation());
+    writePermutation(file, op.rangePermutation());
+    writeMblocks<ValueType>(file, *op.blockCluster(), op.blocks().get());
+    file.close();
+}
+
+template <typename ValueType>
+std::auto_ptr<DiscreteAcaBoundaryOperator<ValueType> >
+loadDiscreteAcaBoundaryOperator(
+        const std::string& fileName,
+        const shared_ptr<const typename DiscreteAcaBoundaryOperator<ValueType>::
+            AhmedBemBlcluster>& blockCluster,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    typedef DiscreteAcaBoundaryOperator<ValueType> DiscreteAcaLinOp;
+
+    if (!blockCluster)
+        throw std::invalid_argument("loadDiscreteAcaBoundaryOperator(): "
+                                    "blockCluster must not be null");
+    InputFile file(fileName, "loadDiscreteAcaBoundaryOperator()");
+    std::string cacheKey;
+    file.readHeader(H_MATRIX, ValueTypeCode<ValueType>::value, cacheKey);
+    unsigned int rowCount, columnCount;
+    double eps;
+    int maximumRank, symmetry;
+    file.read(rowCount);
+    file.read(columnCount);
+    file.read(eps);
+    file.read(maximumRank);
+    file.read(symmetry);
+    std::vector<unsigned int> domainIndices, rangeIndices;
+    readPermutation(file, columnCount, domainIndices);
+    readPermutation(file, rowCount, rangeIndices);
+
+    typename DiscreteAcaLinOp::AhmedMblockArray blocks =
+            allocateAhmedMblockArray<ValueType>(blockCluster.get());
+    if (!readMblocks<ValueType>(file, *blockCluster, blocks.get()))
+        file.fail("the leaves of the block cluster tree do not match "
+                  "the mblocks stored in file");
+    return std::auto_ptr<DiscreteAcaLinOp>(
+                new DiscreteAcaLinOp(rowCount, columnCount, eps, maximumRank,
+                                     symmetry, blockCluster, blocks,
+                                     IndexPermutation(domainIndices),
+                                     IndexPermutation(rangeIndices),
+                                     parallelizationOptions));
+}
+
+template <typename ValueType>
+void saveAhmedMblocks(
+        const blcluster& blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* const* blocks,
+        const std::string& fileName,
+        const std::string& cacheKey)
+{
+    OutputFile file(fileName, "saveAhmedMblocks()");
+    file.writeHeader(MBLOCKS, ValueTypeCode<ValueType>::value, cacheKey);
+    writeMblocks<ValueType>(file, blockCluster, blocks);
+    file.close();
+}
+
+template <typename ValueType>
+bool loadAhmedMblocks(
+        const blcluster& blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        const std::string& fileName,
+        const std::string& cacheKey)
+{
+    if (!std::ifstream(fileName.c_str()))
+        return false;
+    InputFile file(fileName, "loadAhmedMblocks()");
+    std::string storedCacheKey;
+    file.readHeader(MBLOCKS, ValueTypeCode<ValueType>::value, storedCacheKey);
+    if (storedCacheKey != cacheKey)
+        return false;
+    return readMblocks<ValueType>(file, blockCluster, blocks);
+}
+
+#endif // WITH_AHMED
+
+#define INSTANTIATE_DENSE_FUNCTIONS(VALUE) \
+    template void saveDiscreteDenseBoundaryOperator( \
+        const DiscreteDenseBoundaryOperator<VALUE>& op, \
+        const std::string& fileName); \
+    template std::auto_ptr<DiscreteDenseBoundaryOperator<VALUE> > \
+    loadDiscreteDenseBoundaryOperator( \
+        const std::string& fileName, \
+        const ParallelizationOptions& parallelizationOptions); \
+    template void saveCachedDiscreteDenseBoundaryOperator( \
+        const DiscreteDenseBoundaryOperator<VALUE>& op, \
+        const std::string& fileName, \
+        const std::string& cacheKey); \
+    template std::auto_ptr<DiscreteDenseBoundaryOperator<VALUE> > \
+    loadCachedDiscreteDenseBoundaryOperator( \
+        const std::string& fileName, \
+        const std::string& cacheKey, \
+        const ParallelizationOptions& parallelizationOptions)
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_DENSE_FUNCTIONS);
+
+#ifdef WITH_AHMED
+#define INSTANTIATE_ACA_FUNCTIONS(VALUE) \
+    template void saveDiscreteAcaBoundaryOperator( \
+        const DiscreteAcaBoundaryOperator<VALUE>& op, \
+        const std::string& fileName); \
+    template std::auto_ptr<DiscreteAcaBoundaryOperator<VALUE> > \
+    loadDiscreteAcaBoundaryOperator( \
+        const std::string& fileName, \
+        const shared_ptr<const DiscreteAcaBoundaryOperator<VALUE>:: \
+            AhmedBemBlcluster>& blockCluster, \
+        const ParallelizationOptions& parallelizationOptions); \
+    template void saveAhmedMblocks<VALUE>( \
+        const blcluster& blockCluster, \
+        mblock<AhmedTypeTraits<VALUE>::Type>* const* blocks, \
+        const std::string& fileName, \
+        const std::string& cacheKey); \
+    template bool loadAhmedMblocks<VALUE>( \
+        const blcluster& blockCluster, \
+        mblock<AhmedTypeTraits<VALUE>::Type>** blocks, \
+        const std::string& fileName, \
+        const std::string& cacheKey)
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_ACA_FUNCTIONS);
+#endif // WITH_AHMED
+
+} // namespace Bempp
@@ -0,0 +1,196 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifndef bempp_discrete_operator_serialization_hpp
+#define bempp_discrete_operator_serialization_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/shared_ptr.hpp"
+#include "../fiber/parallelization_options.hpp"
+
+#ifdef WITH_AHMED
+#include "ahmed_aux_fwd.hpp"
+#include "discrete_aca_boundary_operator.hpp"
+#endif
+
+#include <memory>
+#include <string>
+
+/** \file
+ *  \brief Binary files storing discrete boundary operators.
+ *
+ *  All files start with a header made of the string "BEMPPOP", the format
+ *  version, the kind of the stored object, the code of its value type, a
+ *  byte-order mark and a cache key, which is empty except in the files of
+ *  the weak-form cache (see WeakFormCacheKey); the functions below refuse
+ *  files whose header does not match. Numbers are stored in the native binary representation, so the
+ *  files are meant to be read on the machine (or a machine of the same
+ *  architecture) that wrote them. Matrix entries and mblock data are stored
+ *  in contiguous records so that they can be read straight into the memory
+ *  of the loaded objects, without intermediate copies. Files are written
+ *  under a temporary name and renamed once complete, so a file that exists
+ *  is never only partially written. */
+
+namespace Bempp
+{
+
+using Fiber::ParallelizationOptions;
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteDenseBoundaryOperator;
+/** \endcond */
+
+/** \relates DiscreteDenseBoundaryOperator
+ *  \brief Write the matrix of a dense discrete boundary operator to the file
+ *  \p fileName.
+ *
+ *  A std::runtime_error is thrown if the file cannot be written. */
+template <typename ValueType>
+void saveDiscreteDenseBoundaryOperator(
+        const DiscreteDenseBoundaryOperator<ValueType>& op,
+        const std::string& fileName);
+
+/** \relates DiscreteDenseBoundaryOperator
+ *  \brief Read a dense discrete boundary operator from the file \p fileName
+ *  written by saveDiscreteDenseBoundaryOperator().
+ *
+ *  \p parallelizationOptions are passed to the constructor of the returned
+ *  operator. A std::runtime_error is thrown if the file cannot be read or
+ *  does not contain a dense operator with entries of type \p ValueType. */
+template <typename ValueType>
+std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> >
+loadDiscreteDenseBoundaryOperator(
+        const std::string& fileName,
+        const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Write the matrix of a dense discrete boundary operator to the file
+ *  \p fileName of the weak-form cache, together with the contents of its
+ *  cache key \p cacheKey.
+ *
+ *  A std::runtime_error is thrown if the file cannot be written. */
+template <typename ValueType>
+void saveCachedDiscreteDenseBoundaryOperator(
+        const DiscreteDenseBoundaryOperator<ValueType>& op,
+        const std::string& fileName,
+        const std::string& cacheKey);
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Read a dense discrete boundary operator from the file \p fileName
+ *  written by saveCachedDiscreteDenseBoundaryOperator().
+ *
+ *  Returns a null pointer if the file does not exist or if the cache key
+ *  stored in it differs from \p cacheKey. A std::runtime_error is thrown if
+ *  the file exists but is corrupted. */
+template <typename ValueType>
+std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> >
+loadCachedDiscreteDenseBoundaryOperator(
+        const std::string& fileName,
+        const std::string& cacheKey,
+        const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+#ifdef WITH_AHMED
+
+/** \relates DiscreteAcaBoundaryOperator
+ *  \brief Write an H-matrix to the file \p fileName.
+ *
+ *  The file stores the dimensions of the H-matrix, the parameters returned
+ *  by eps(), maximumRank() and symmetry(), the domain and range permutations
+ *  and the contents of all mblocks together with the position of the
+ *  corresponding leaves of the block cluster tree. The block cluster tree
+ *  itself is not stored, since AHMED provides no means of reconstructing it
+ *  from its leaves; see loadDiscreteAcaBoundaryOperator().
+ *
+ *  General, Hermitian and triangular dense mblocks and low-rank mblocks are
+ *  supported. A std::runtime_error is thrown if the file cannot be
+ *  written. */
+template <typename ValueType>
+void saveDiscreteAcaBoundaryOperator(
+        const DiscreteAcaBoundaryOperator<ValueType>& op,
+        const std::string& fileName);
+
+/** \relates DiscreteAcaBoundaryOperator
+ *  \brief Read an H-matrix from the file \p fileName written by
+ *  saveDiscreteAcaBoundaryOperator().
+ *
+ *  \param[in] fileName
+ *    Name of the file.
+ *  \param[in] blockCluster
+ *    Block cluster tree of the H-matrix. Its leaves must coincide with those
+ *    of the tree of the saved operator; in practice, this means it must have
+ *    been constructed from the same spaces and with the same ACA options
+ *    (and it must not have been agglomerated unless the saved operator had
+ *    been agglomerated in the same way).
+ *  \param[in] parallelizationOptions
+ *    Options passed to the constructor of the returned operator.
+ *
+ *  A std::runtime_error is thrown if the file cannot be read, if it does not
+ *  contain an H-matrix with entries of type \p ValueType or if the leaves of
+ *  \p blockCluster do not match the stored mblocks. */
+template <typename ValueType>
+std::auto_ptr<DiscreteAcaBoundaryOperator<ValueType> >
+loadDiscreteAcaBoundaryOperator(
+        const std::string& fileName,
+        const shared_ptr<const typename DiscreteAcaBoundaryOperator<ValueType>::
+            AhmedBemBlcluster>& blockCluster,
+        const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Write the mblocks \p blocks of the H-matrix with block cluster tree
+ *  \p blockCluster to the file \p fileName, together with the contents of
+ *  the cache key \p cacheKey.
+ *
+ *  This is used by the ACA assembler to cache the assembled mblocks before
+ *  they are agglomerated. A std::runtime_error is thrown if the file cannot
+ *  be written. */
+template <typename ValueType>
+void saveAhmedMblocks(
+        const blcluster& blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* const* blocks,
+        const std::string& fileName,
+        const std::string& cacheKey);
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Read the mblocks of the H-matrix with block cluster tree \p
+ *  blockCluster from the file \p fileName written by saveAhmedMblocks().
+ *
+ *  The array \p blocks must have blockCluster.nleaves() elements, all of
+ *  them null. Returns false, leaving \p blocks untouched, if the file does
+ *  not exist, if the cache key stored in it differs from \p cacheKey or if
+ *  the stored mblocks do not match the leaves of \p blockCluster. A std::runtime_error is thrown if the file exists but is
+ *  corrupted. */
+template <typename ValueType>
+bool loadAhmedMblocks(
+        const blcluster& blockCluster,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        const std::string& fileName,
+        const std::string& cacheKey);
+
+#endif // WITH_AHMED
+
+} // namespace Bempp
+
+#endif
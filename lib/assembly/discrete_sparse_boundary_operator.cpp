@@ -20,27 +20,34 @@
 
 #include "bempp/common/config_trilinos.hpp"
 #include "bempp/common/config_ahmed.hpp"
-#ifdef WITH_TRILINOS
 
 #include "discrete_sparse_boundary_operator.hpp"
 
 #include "ahmed_mblock_array_deleter.hpp"
+#include "csr_assembly_helper.hpp"
 #include "discrete_aca_boundary_operator.hpp"
 #include "index_permutation.hpp"
 #include "sparse_to_h_matrix_converter.hpp"
 
+#include "../common/boost_make_shared_fwd.hpp"
 #include "../common/boost_shared_array_fwd.hpp"
+#include "../common/complex_aux.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/parallelization_options.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
+
+#include <tbb/blocked_range.h>
 
-#include <Epetra_Map.h>
-#include <Epetra_Vector.h>
+#ifdef WITH_TRILINOS
 #include <Epetra_CrsMatrix.h>
-#include <Epetra_SerialComm.h>
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#endif
 
 namespace Bempp
 {
@@ -49,157 +56,230 @@ namespace Bempp
 namespace
 {
 
-template <typename ValueType>
-void reallyApplyBuiltInImpl(const Epetra_CrsMatrix& mat,
-                            const TranspositionMode trans,
-                            const arma::Col<ValueType>& x_in,
-                            arma::Col<ValueType>& y_inout,
-                            const ValueType alpha,
-                            const ValueType beta);
+// Number of rows processed by a single task in matrix-vector products,
+// unless a grain size is set explicitly in ParallelizationOptions
+const size_t DEFAULT_ROW_CHUNK_SIZE = 256;
+
+template <bool conjugate>
+struct Conjugator
+{
+    template <typename ValueType>
+    static ValueType apply(const ValueType& x) { return x; }
+};
 
 template <>
-void reallyApplyBuiltInImpl<double>(const Epetra_CrsMatrix& mat,
-                                    const TranspositionMode trans,
-                                    const arma::Col<double>& x_in,
-                                    arma::Col<double>& y_inout,
-                                    const double alpha,
-                                    const double beta)
+struct Conjugator<true>
 {
-    if (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE) {
-        assert(mat.NumGlobalRows() == static_cast<int>(x_in.n_rows));
-        assert(mat.NumGlobalCols() == static_cast<int>(y_inout.n_rows));
-    } else {
-        assert(mat.NumGlobalCols() == static_cast<int>(x_in.n_rows));
-        assert(mat.NumGlobalRows() == static_cast<int>(y_inout.n_rows));
+    template <typename ValueType>
+    static ValueType apply(const ValueType& x) { return conj(x); }
+};
+
+/** Loop body evaluating y := alpha * A * x + beta * y for the rows of a
+ *  CSR matrix A in a given range. Each column of x and y is treated as a
+ *  separate vector. If conjugate is true, the entries of A are
+ *  complex-conjugated. */
+template <typename ValueType, bool conjugate>
+class CsrMatVecLoopBody
+{
+public:
+    CsrMatVecLoopBody(const CsrMatrix<ValueType>& mat,
+                      const arma::Mat<ValueType>& x,
+                      arma::Mat<ValueType>& y,
+                      ValueType alpha, ValueType beta) :
+        m_mat(mat), m_x(x), m_y(y), m_alpha(alpha), m_beta(beta)
+    {
     }
 
-    Epetra_Map map_x((int) x_in.n_rows, 0, Epetra_SerialComm());
-    Epetra_Map map_y((int) y_inout.n_rows, 0, Epetra_SerialComm());
-
-    Epetra_Vector vec_x(View, map_x, const_cast<double*>(x_in.memptr()));
-    // vec_temp will store the result of matrix * x_in
-    Epetra_Vector vec_temp(map_y, false /* no need to initialise to zero */);
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const size_t* rowOffsets = &m_mat.rowOffsets[0];
+        const int* columnIndices =
+                m_mat.columnIndices.empty() ? 0 : &m_mat.columnIndices[0];
+        const ValueType* values =
+                m_mat.values.empty() ? 0 : &m_mat.values[0];
+        const ValueType zero = static_cast<ValueType>(0.);
+        for (size_t c = 0; c < m_x.n_cols; ++c) {
+            const ValueType* x = m_x.colptr(c);
+            ValueType* y = m_y.colptr(c);
+            for (size_t row = r.begin(); row != r.end(); ++row) {
+                ValueType sum = zero;
+                for (size_t k = rowOffsets[row]; k < rowOffsets[row + 1]; ++k)
+                    sum += Conjugator<conjugate>::apply(values[k]) *
+                            x[columnIndices[k]];
+                // If beta is zero, y is not read, so it may contain NaNs
+                if (m_beta == zero)
+                    y[row] = m_alpha * sum;
+                else
+                    y[row] = m_alpha * sum + m_beta * y[row];
+            }
+        }
+    }
 
-    mat.Multiply(trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE,
-                 vec_x, vec_temp);
+private:
+    const CsrMatrix<ValueType>& m_mat;
+    const arma::Mat<ValueType>& m_x;
+    arma::Mat<ValueType>& m_y;
+    ValueType m_alpha;
+    ValueType m_beta;
+};
 
-    if (beta == 0.)
-        for (size_t i = 0; i < y_inout.n_rows; ++i)
-            y_inout(i) = alpha * vec_temp[i];
+template <typename ValueType>
+void csrMatVec(const CsrMatrix<ValueType>& mat,
+               bool conjugate,
+               const arma::Mat<ValueType>& x_in,
+               arma::Mat<ValueType>& y_inout,
+               const ValueType alpha,
+               const ValueType beta,
+               const ParallelizationOptions& options)
+{
+    assert(mat.columnCount == x_in.n_rows);
+    assert(mat.rowCount == y_inout.n_rows);
+    assert(x_in.n_cols == y_inout.n_cols);
+
+    const size_t chunkSize =
+            options.grainSize() == ParallelizationOptions::AUTO ?
+                DEFAULT_ROW_CHUNK_SIZE : options.grainSize();
+    tbb::blocked_range<size_t> range(0, mat.rowCount, chunkSize);
+    if (conjugate)
+        Fiber::ExecutionContext::instance().parallelFor(
+                    options, range,
+                    CsrMatVecLoopBody<ValueType, true>(
+                        mat, x_in, y_inout, alpha, beta));
     else
-        for (size_t i = 0; i < y_inout.n_rows; ++i)
-            y_inout(i) = alpha * vec_temp[i] + beta * y_inout(i);
+        Fiber::ExecutionContext::instance().parallelFor(
+                    options, range,
+                    CsrMatVecLoopBody<ValueType, false>(
+                        mat, x_in, y_inout, alpha, beta));
 }
 
-template <>
-void reallyApplyBuiltInImpl<float>(const Epetra_CrsMatrix& mat,
-                                   const TranspositionMode trans,
-                                   const arma::Col<float>& x_in,
-                                   arma::Col<float>& y_inout,
-                                   const float alpha,
-                                   const float beta)
+template <typename ValueType>
+std::auto_ptr<CsrMatrix<ValueType> > transposeCsrMatrix(
+        const CsrMatrix<ValueType>& mat)
 {
-    // Copy the float vectors to double vectors
-    arma::Col<double> x_in_double(x_in.n_rows);
-    std::copy(x_in.begin(), x_in.end(), x_in_double.begin());
-    arma::Col<double> y_inout_double(y_inout.n_rows);
-    if (beta != 0.f)
-        std::copy(y_inout.begin(), y_inout.end(), y_inout_double.begin());
-
-    // Do the operation on the double vectors
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_in_double, y_inout_double, alpha, beta);
-
-    // Copy the result back to the float vector
-    std::copy(y_inout_double.begin(), y_inout_double.end(), y_inout.begin());
+    std::auto_ptr<CsrMatrix<ValueType> > result(
+            new CsrMatrix<ValueType>(mat.columnCount, mat.rowCount));
+    const size_t nonzeroCount = mat.nonzeroCount();
+    std::vector<size_t>& offsets = result->rowOffsets;
+    for (size_t k = 0; k < nonzeroCount; ++k)
+        ++offsets[mat.columnIndices[k] + 1];
+    for (size_t col = 0; col < mat.columnCount; ++col)
+        offsets[col + 1] += offsets[col];
+    result->columnIndices.resize(nonzeroCount);
+    result->values.resize(nonzeroCount);
+    // Rows of the original matrix are traversed in ascending order, so the
+    // column indices of the transposed matrix come out sorted
+    std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+    for (size_t row = 0; row < mat.rowCount; ++row)
+        for (size_t k = mat.rowOffsets[row]; k < mat.rowOffsets[row + 1]; ++k) {
+            const size_t position = positions[mat.columnIndices[k]]++;
+            result->columnIndices[position] = row;
+            result->values[position] = mat.values[k];
+        }
+    return result;
 }
 
-template <>
-void reallyApplyBuiltInImpl<std::complex<float> >(
-        const Epetra_CrsMatrix& mat,
-        const TranspositionMode trans,
-        const arma::Col<std::complex<float> >& x_in,
-        arma::Col<std::complex<float> >& y_inout,
-        const std::complex<float> alpha,
-        const std::complex<float> beta)
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+shared_ptr<const CsrMatrix<ValueType> > csrMatrixFromEpetraMatrix(
+        const Epetra_CrsMatrix& mat)
 {
-    // Do the y_inout *= beta part
-    const std::complex<float> zero(0.f, 0.f);
-    if (beta == zero)
-        y_inout.fill(zero);
-    else
-        y_inout *= beta;
-
-    // Separate the real and imaginary components and store them in
-    // double-precision vectors
-    arma::Col<double> x_real(x_in.n_rows);
-    for (size_t i = 0; i < x_in.n_rows; ++i)
-        x_real(i) = x_in(i).real();
-    arma::Col<double> x_imag(x_in.n_rows);
-    for (size_t i = 0; i < x_in.n_rows; ++i)
-        x_imag(i) = x_in(i).imag();
-    arma::Col<double> y_real(y_inout.n_rows);
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_real(i) = y_inout(i).real();
-    arma::Col<double> y_imag(y_inout.n_rows);
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_imag(i) = y_inout(i).imag();
-
-    // Do the "+= alpha A x" part (in steps)
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_real, alpha.real(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_real, -alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_imag, alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_imag, alpha.real(), 1.);
-
-    // Copy the result back to the complex vector
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_inout(i) = std::complex<float>(y_real(i), y_imag(i));
+    if (!mat.Filled())
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): "
+                "FillComplete() has not been called on the Epetra matrix");
+    if (mat.Comm().NumProc() != 1)
+        throw std::runtime_error(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): "
+                "distributed matrices are not supported");
+
+    shared_ptr<CsrMatrix<ValueType> > result =
+            boost::make_shared<CsrMatrix<ValueType> >(
+                mat.NumGlobalRows(), mat.NumGlobalCols());
+    const Epetra_Map& rowMap = mat.RowMap();
+    const Epetra_Map& colMap = mat.ColMap();
+    const int localRowCount = mat.NumMyRows();
+
+    std::vector<size_t>& offsets = result->rowOffsets;
+    for (int localRow = 0; localRow < localRowCount; ++localRow)
+        offsets[rowMap.GID(localRow) + 1] += mat.NumMyEntries(localRow);
+    for (size_t row = 0; row < result->rowCount; ++row)
+        offsets[row + 1] += offsets[row];
+    result->columnIndices.resize(offsets[result->rowCount]);
+    result->values.resize(offsets[result->rowCount]);
+
+    std::vector<std::pair<int, double> > entries;
+    for (int localRow = 0; localRow < localRowCount; ++localRow) {
+        int entryCount = 0;
+        double* values = 0;
+        int* indices = 0;
+        int errorCode = mat.ExtractMyRowView(localRow, entryCount,
+                                             values, indices);
+        if (errorCode != 0)
+            throw std::runtime_error(
+                    "DiscreteSparseBoundaryOperator::"
+                    "DiscreteSparseBoundaryOperator(): "
+                    "Epetra_CrsMatrix::ExtractMyRowView() failed");
+        entries.resize(entryCount);
+        for (int entry = 0; entry < entryCount; ++entry)
+            entries[entry] = std::make_pair(colMap.GID(indices[entry]),
+                                            values[entry]);
+        std::sort(entries.begin(), entries.end());
+        const size_t begin = offsets[rowMap.GID(localRow)];
+        for (int entry = 0; entry < entryCount; ++entry) {
+            result->columnIndices[begin + entry] = entries[entry].first;
+            result->values[begin + entry] =
+                    static_cast<ValueType>(entries[entry].second);
+        }
+    }
+    return result;
 }
 
-template <>
-void reallyApplyBuiltInImpl<std::complex<double> >(
-        const Epetra_CrsMatrix& mat,
-        const TranspositionMode trans,
-        const arma::Col<std::complex<double> >& x_in,
-        arma::Col<std::complex<double> >& y_inout,
-        const std::complex<double> alpha,
-        const std::complex<double> beta)
+template <typename ValueType>
+shared_ptr<const Epetra_CrsMatrix> epetraMatrixFromCsrMatrix(
+        const CsrMatrix<ValueType>& mat)
 {
-    // Do the y_inout *= beta part
-    const std::complex<double> zero(0., 0.);
-    if (beta == zero)
-        y_inout.fill(zero);
-    else
-        y_inout *= beta;
-
-    // Separate the real and imaginary components
-    arma::Col<double> x_real(arma::real(x_in));
-    arma::Col<double> x_imag(arma::imag(x_in));
-    arma::Col<double> y_real(arma::real(y_inout));
-    arma::Col<double> y_imag(arma::imag(y_inout));
-
-    // Do the "+= alpha A x" part (in steps)
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_real, alpha.real(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_real, -alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_imag, alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_imag, alpha.real(), 1.);
-
-    // Copy the result back to the complex vector
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_inout(i) = std::complex<double>(y_real(i), y_imag(i));
+    return createEpetraCrsMatrix(mat.rowCount, mat.columnCount,
+                                 mat.rowOffsets, mat.columnIndices,
+                                 mat.values);
 }
+#endif // WITH_TRILINOS
 
 } // namespace
 
+template <typename ValueType>
+DiscreteSparseBoundaryOperator<ValueType>::
+DiscreteSparseBoundaryOperator(
+        const shared_ptr<const CsrMatrix<ValueType> >& mat,
+        int symmetry, TranspositionMode trans,
+        const shared_ptr<AhmedBemBlcluster>& blockCluster,
+        const shared_ptr<IndexPermutation>& domainPermutation,
+        const shared_ptr<IndexPermutation>& rangePermutation,
+        const ParallelizationOptions& parallelizationOptions) :
+    m_csr(mat), m_symmetry(symmetry), m_trans(trans),
+    m_blockCluster(blockCluster),
+    m_domainPermutation(domainPermutation),
+    m_rangePermutation(rangePermutation),
+    m_parallelizationOptions(parallelizationOptions)
+{
+    if (!m_csr)
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): "
+                "mat must not be null");
+    if (m_csr->rowOffsets.size() != m_csr->rowCount + 1 ||
+            m_csr->rowOffsets.back() != m_csr->columnIndices.size() ||
+            m_csr->values.size() != m_csr->columnIndices.size())
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): "
+                "inconsistent array sizes in the CSR matrix");
+    m_transposedCsr.reset(new LazyCsrMatrix(
+                              TransposedCsrMatrixInitializer(m_csr)));
+    initializeVectorSpaces();
+}
 
+#ifdef WITH_TRILINOS
 template <typename ValueType>
 DiscreteSparseBoundaryOperator<ValueType>::
 DiscreteSparseBoundaryOperator(
@@ -208,70 +288,81 @@ DiscreteSparseBoundaryOperator(
         const shared_ptr<AhmedBemBlcluster>& blockCluster,
         const shared_ptr<IndexPermutation>& domainPermutation,
         const shared_ptr<IndexPermutation>& rangePermutation) :
-    m_mat(mat), m_symmetry(symmetry), m_trans(trans),
+    m_symmetry(symmetry), m_trans(trans),
     m_blockCluster(blockCluster),
     m_domainPermutation(domainPermutation),
-    m_rangePermutation(rangePermutation)
+    m_rangePermutation(rangePermutation),
+    m_mat(mat)
+{
+    if (!m_mat)
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): "
+                "mat must not be null");
+    m_csr = csrMatrixFromEpetraMatrix<ValueType>(*m_mat);
+    m_transposedCsr.reset(new LazyCsrMatrix(
+                              TransposedCsrMatrixInitializer(m_csr)));
+    initializeVectorSpaces();
+}
+#endif
+
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::initializeVectorSpaces()
 {
-    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
-                isTransposed() ? m_mat->NumGlobalRows() : m_mat->NumGlobalCols());
-    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
-                isTransposed() ? m_mat->NumGlobalCols() : m_mat->NumGlobalRows());
+#ifdef WITH_TRILINOS
+    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(columnCount());
+    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(rowCount());
+#endif
 }
 
 template <typename ValueType>
 void DiscreteSparseBoundaryOperator<ValueType>::dump() const
 {
     if (isTransposed())
-        std::cout << "Transpose of " << *m_mat << std::endl;
-    else
-        std::cout << *m_mat << std::endl;
+        std::cout << "Transpose of ";
+    std::cout << "sparse matrix of size " << m_csr->rowCount << " x "
+              << m_csr->columnCount << " with " << m_csr->nonzeroCount()
+              << " stored entries\n";
+    for (size_t row = 0; row < m_csr->rowCount; ++row)
+        for (size_t k = m_csr->rowOffsets[row];
+             k < m_csr->rowOffsets[row + 1]; ++k)
+            std::cout << row << " " << m_csr->columnIndices[k] << " "
+                      << m_csr->values[k] << "\n";
+    std::cout << std::flush;
 }
 
 template <typename ValueType>
 arma::Mat<ValueType>
 DiscreteSparseBoundaryOperator<ValueType>::asMatrix() const
 {
-    if (m_mat->Comm().NumProc() != 1)
-        throw std::runtime_error(
-                "DiscreteSparseBoundaryOperator::asMatrix(): "
-                "conversion of distributed matrices to local matrices is unsupported");
-
-    bool transposed = isTransposed();
-    const int untransposedRowCount = m_mat->NumGlobalRows();
+    const bool transposed = isTransposed();
+    const bool conjugated = (m_trans == CONJUGATE ||
+                             m_trans == CONJUGATE_TRANSPOSE);
     arma::Mat<ValueType> mat(rowCount(), columnCount());
     mat.fill(0.);
-    for (int row = 0; row < untransposedRowCount; ++row)
-    {
-        int entryCount = 0;
-        double* values = 0;
-        int* indices = 0;
-        int errorCode = m_mat->ExtractMyRowView(row, entryCount,
-                                                values, indices);
-        if (errorCode != 0)
-            throw std::runtime_error(
-                    "DiscreteSparseBoundaryOperator::asMatrix(): "
-                    "Epetra_CrsMatrix::ExtractMyRowView()) failed");
-        if (transposed)
-            for (int entry = 0; entry < entryCount; ++entry)
-                mat(indices[entry], row) = values[entry];
-        else
-            for (int entry = 0; entry < entryCount; ++entry)
-                mat(row, indices[entry]) = values[entry];
-    }
+    for (size_t row = 0; row < m_csr->rowCount; ++row)
+        for (size_t k = m_csr->rowOffsets[row];
+             k < m_csr->rowOffsets[row + 1]; ++k) {
+            const ValueType value = conjugated ?
+                        conj(m_csr->values[k]) : m_csr->values[k];
+            if (transposed)
+                mat(m_csr->columnIndices[k], row) = value;
+            else
+                mat(row, m_csr->columnIndices[k]) = value;
+        }
     return mat;
 }
 
 template <typename ValueType>
 unsigned int DiscreteSparseBoundaryOperator<ValueType>::rowCount() const
 {
-    return isTransposed() ? m_mat->NumGlobalCols() : m_mat->NumGlobalRows();
+    return isTransposed() ? m_csr->columnCount : m_csr->rowCount;
 }
 
 template <typename ValueType>
 unsigned int DiscreteSparseBoundaryOperator<ValueType>::columnCount() const
 {
-    return isTransposed() ? m_mat->NumGlobalRows() : m_mat->NumGlobalCols();
+    return isTransposed() ? m_csr->rowCount : m_csr->columnCount;
 }
 
 template <typename ValueType>
@@ -282,7 +373,9 @@ void DiscreteSparseBoundaryOperator<ValueType>::addBlock(
         arma::Mat<ValueType>& block) const
 {
     // indices of entries of the untransposed (stored) matrix
-    bool transposed = isTransposed();
+    const bool transposed = isTransposed();
+    const bool conjugated = (m_trans == CONJUGATE ||
+                             m_trans == CONJUGATE_TRANSPOSE);
     const std::vector<int>& untransposedRows = transposed ? cols : rows;
     const std::vector<int>& untransposedCols = transposed ? rows : cols;
 
@@ -290,38 +383,25 @@ void DiscreteSparseBoundaryOperator<ValueType>::addBlock(
         throw std::invalid_argument(
                 "DiscreteSparseBoundaryOperator::addBlock(): "
                 "incorrect block size");
-
-    int entryCount = 0;
-    double* values = 0;
-    int* indices = 0;
-
-    for (size_t row = 0; row < untransposedRows.size(); ++row)
-    {
-        // Provision for future MPI support.
-        if (m_mat->IndicesAreLocal())
-        {
-            int errorCode = m_mat->ExtractMyRowView(
-                        untransposedRows[row], entryCount, values, indices);
-            if (errorCode != 0)
-                throw std::runtime_error(
-                        "DiscreteSparseBoundaryOperator::addBlock(): "
-                        "Epetra_CrsMatrix::ExtractMyRowView()) failed");
-        }
-        else
-        {
-            int errorCode = m_mat->ExtractGlobalRowView(
-                        untransposedRows[row], entryCount, values, indices);
-            if (errorCode != 0)
-                throw std::runtime_error(
-                        "DiscreteSparseBoundaryOperator::addBlock(): "
-                        "Epetra_CrsMatrix::ExtractGlobalRowView()) failed");
+    if (m_csr->nonzeroCount() == 0)
+        return;
+
+    for (size_t row = 0; row < untransposedRows.size(); ++row) {
+        // Column indices within each row are sorted
+        const int* rowBegin = &m_csr->columnIndices[0] +
+                m_csr->rowOffsets[untransposedRows[row]];
+        const int* rowEnd = &m_csr->columnIndices[0] +
+                m_csr->rowOffsets[untransposedRows[row] + 1];
+        for (size_t col = 0; col < untransposedCols.size(); ++col) {
+            const int* entry = std::lower_bound(rowBegin, rowEnd,
+                                                untransposedCols[col]);
+            if (entry == rowEnd || *entry != untransposedCols[col])
+                continue;
+            const ValueType value =
+                    m_csr->values[entry - &m_csr->columnIndices[0]];
+            block(transposed ? col : row, transposed ? row : col) +=
+                    alpha * (conjugated ? conj(value) : value);
         }
-
-        for (size_t col = 0; col < untransposedCols.size(); ++col)
-            for (int entry = 0; entry < entryCount; ++entry)
-                if (indices[entry] == cols[col])
-                    block(transposed ? col : row, transposed ? row : col) +=
-                            alpha * static_cast<ValueType>(values[entry]);
     }
 }
 
@@ -346,10 +426,15 @@ DiscreteSparseBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
                                  "asDiscreteAcaBoundaryOperator(): "
                                  "transposed operators are not supported yet");
 
-    int* rowOffsets = 0;
-    int* colIndices = 0;
-    double* values = 0;
-    m_mat->ExtractCrsDataPointers(rowOffsets, colIndices, values);
+    // The converter expects integer row offsets and real double-precision
+    // values.
+    // WARNING: only the real part is taken into account!
+    std::vector<int> rowOffsets(m_csr->rowOffsets.begin(),
+                                m_csr->rowOffsets.end());
+    std::vector<int> colIndices(m_csr->columnIndices);
+    std::vector<double> values(m_csr->nonzeroCount());
+    for (size_t k = 0; k < values.size(); ++k)
+        values[k] = realPart(m_csr->values[k]);
 
     std::vector<unsigned int> domain_o2p =
             m_domainPermutation->permutedIndices();
@@ -363,7 +448,9 @@ DiscreteSparseBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
     boost::shared_array<AhmedMblock*> mblocks;
     int trueMaximumRank = 0;
     SparseToHMatrixConverter<ValueType>::constructHMatrix(
-        rowOffsets, colIndices, values,
+        &rowOffsets[0],
+        colIndices.empty() ? 0 : &colIndices[0],
+        values.empty() ? 0 : &values[0],
         domain_o2p, range_p2o, eps,
         m_blockCluster.get(),
         mblocks, trueMaximumRank);
@@ -396,12 +483,24 @@ DiscreteSparseBoundaryOperator<ValueType>::castToSparse(
 
 }
 
+template <typename ValueType>
+shared_ptr<const CsrMatrix<ValueType> >
+DiscreteSparseBoundaryOperator<ValueType>::csrMatrix() const
+{
+    return m_csr;
+}
+
+#ifdef WITH_TRILINOS
 template <typename ValueType>
 shared_ptr<const Epetra_CrsMatrix>
 DiscreteSparseBoundaryOperator<ValueType>::epetraMatrix() const
 {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    if (!m_mat)
+        m_mat = epetraMatrixFromCsrMatrix(*m_csr);
     return m_mat;
 }
+#endif
 
 template <typename ValueType>
 TranspositionMode
@@ -410,6 +509,7 @@ DiscreteSparseBoundaryOperator<ValueType>::transpositionMode() const
     return m_trans;
 }
 
+#ifdef WITH_TRILINOS
 template <typename ValueType>
 Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
 DiscreteSparseBoundaryOperator<ValueType>::domain() const
@@ -431,11 +531,27 @@ bool DiscreteSparseBoundaryOperator<ValueType>::opSupportedImpl(
     return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
             M_trans == Thyra::CONJ || M_trans == Thyra::CONJTRANS);
 }
+#endif
 
 template <typename ValueType>
 bool DiscreteSparseBoundaryOperator<ValueType>::isTransposed() const
 {
-    return m_trans & (TRANSPOSE | CONJUGATE_TRANSPOSE);
+    return m_trans == TRANSPOSE || m_trans == CONJUGATE_TRANSPOSE;
+}
+
+template <typename ValueType>
+const CsrMatrix<ValueType>&
+DiscreteSparseBoundaryOperator<ValueType>::transposedCsrMatrix() const
+{
+    return m_transposedCsr->get();
+}
+
+template <typename ValueType>
+std::auto_ptr<CsrMatrix<ValueType> >
+DiscreteSparseBoundaryOperator<ValueType>::TransposedCsrMatrixInitializer::
+operator()() const
+{
+    return transposeCsrMatrix(*m_mat);
 }
 
 template <typename ValueType>
@@ -446,22 +562,31 @@ void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
         const ValueType alpha,
         const ValueType beta) const
 {
-    TranspositionMode realTrans = trans;
-    bool transposed = isTransposed();
-    if (transposed)
-        switch (trans) {
-        case NO_TRANSPOSE: realTrans = TRANSPOSE; break;
-        case TRANSPOSE: realTrans = NO_TRANSPOSE; break;
-        case CONJUGATE: realTrans = CONJUGATE_TRANSPOSE; break;
-        case CONJUGATE_TRANSPOSE: realTrans = CONJUGATE; break;
-        // default: should not happen; anyway, don't change trans
-        }
+    // arma::Col is derived from arma::Mat
+    applyBuiltInMultiVectorImpl(trans, x_in, y_inout, alpha, beta);
+}
 
-    reallyApplyBuiltInImpl(*m_mat, realTrans, x_in, y_inout, alpha, beta);
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    // Combine the requested transformation with the one set in the
+    // constructor
+    const TranspositionMode realTrans = TranspositionMode(trans ^ m_trans);
+    const bool conjugate = (realTrans == CONJUGATE ||
+                            realTrans == CONJUGATE_TRANSPOSE);
+    if (realTrans == TRANSPOSE || realTrans == CONJUGATE_TRANSPOSE)
+        csrMatVec(transposedCsrMatrix(), conjugate, x_in, y_inout,
+                  alpha, beta, m_parallelizationOptions);
+    else
+        csrMatVec(*m_csr, conjugate, x_in, y_inout,
+                  alpha, beta, m_parallelizationOptions);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteSparseBoundaryOperator);
 
 } // namespace Bempp
-
-#endif // WITH_TRILINOS
@@ -28,13 +28,18 @@
 #include "discrete_boundary_operator.hpp"
 
 #include "ahmed_aux_fwd.hpp"
+#include "csr_matrix.hpp"
 #include "symmetry.hpp"
 #include "transposition_mode.hpp"
 
+#include "../common/lazy.hpp"
 #include "../common/shared_ptr.hpp"
 #include "../common/boost_shared_array_fwd.hpp"
+#include "../fiber/parallelization_options.hpp"
 #include "../fiber/scalar_traits.hpp"
 
+#include <tbb/mutex.h>
+
 #ifdef WITH_TRILINOS
 #include <Teuchos_RCP.hpp>
 #include <Thyra_SpmdVectorSpaceBase_decl.hpp>
@@ -49,8 +54,20 @@ namespace Bempp
 class IndexPermutation;
 /** \endcond */
 
+using Fiber::ParallelizationOptions;
+
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator stored as a sparse matrix.
+ *
+ *  The matrix is stored in the compressed sparse row format (see CsrMatrix).
+ *  Matrix-vector products are evaluated in parallel, each task processing a
+ *  contiguous range of rows; products with the transposed matrix use a
+ *  transposed copy of the matrix, created on first use.
+ *
+ *  This class does not depend on Trilinos. If BEM++ has been compiled with
+ *  Trilinos support, the operator can also be constructed from an
+ *  Epetra_CrsMatrix, and epetraMatrix() gives access to the matrix in
+ *  Epetra format.
  */
 template <typename ValueType>
 class DiscreteSparseBoundaryOperator :
@@ -58,11 +75,12 @@ class DiscreteSparseBoundaryOperator :
 {
     typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
     typedef AhmedDofWrapper<CoordinateType> AhmedDofType;
-    typedef bbxbemblcluster<AhmedDofType, AhmedDofType> AhmedBemBlcluster;
     typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
 
-#ifdef WITH_TRILINOS
 public:
+    /** \brief Type of the block cluster tree used by AHMED. */
+    typedef bbxbemblcluster<AhmedDofType, AhmedDofType> AhmedBemBlcluster;
+
     /** \brief Constructor.
      *
      *  \param[in] mat
@@ -73,6 +91,38 @@ public:
      *    in the Symmetry enumeration type.
      *  \param[in] trans
      *    If different from NO_TRANSPOSE, the discrete operator will represent
+     *    a transposed and/or complex-conjugated matrix \p mat.
+     *  \param[in] blockCluster, domainPermutation, rangePermutation
+     *    Data used by asDiscreteAcaBoundaryOperator(). May be null.
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used in matrix-vector
+     *    products. */
+    DiscreteSparseBoundaryOperator(
+            const shared_ptr<const CsrMatrix<ValueType> >& mat,
+            int symmetry = NO_SYMMETRY,
+            TranspositionMode trans = NO_TRANSPOSE,
+            const shared_ptr<AhmedBemBlcluster>& blockCluster =
+            shared_ptr<AhmedBemBlcluster>(),
+            const shared_ptr<IndexPermutation>& domainPermutation =
+            shared_ptr<IndexPermutation>(),
+            const shared_ptr<IndexPermutation>& rangePermutation =
+            shared_ptr<IndexPermutation>(),
+            const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+#ifdef WITH_TRILINOS
+    /** \brief Constructor.
+     *
+     *  \param[in] mat
+     *    Sparse matrix that will be represented by the newly
+     *    constructed operator. Must not be null and must be filled
+     *    (see Epetra_CrsMatrix::FillComplete()). Its entries are copied into
+     *    a CsrMatrix.
+     *  \param[in] symmetry
+     *    Symmetry of the matrix. May be any combination of flags defined
+     *    in the Symmetry enumeration type.
+     *  \param[in] trans
+     *    If different from NO_TRANSPOSE, the discrete operator will represent
      *    a transposed and/or complex-conjugated matrix \p mat. */
     DiscreteSparseBoundaryOperator(
             const shared_ptr<const Epetra_CrsMatrix>& mat,
@@ -84,11 +134,6 @@ public:
             shared_ptr<IndexPermutation>(),
             const shared_ptr<IndexPermutation>& rangePermutation =
             shared_ptr<IndexPermutation>());
-#else
-    // This class cannot be used without Trilinos
-private:
-    DiscreteSparseBoundaryOperator();
-public:
 #endif
 
     virtual void dump() const;
@@ -118,13 +163,27 @@ public:
             const shared_ptr<const DiscreteBoundaryOperator<ValueType> >&
             discreteOperator);
 
-#ifdef WITH_TRILINOS
     /** \brief Return a shared pointer to the sparse matrix stored within
      *  this operator.
      *
      *  \note The discrete operator represents the matrix returned by this
      *  function *and possibly transposed and/or complex-conjugated*, depending on
      *  the value returned by transpositionMode(). */
+    shared_ptr<const CsrMatrix<ValueType> > csrMatrix() const;
+
+#ifdef WITH_TRILINOS
+    /** \brief Return a shared pointer to the sparse matrix stored within
+     *  this operator, converted to an Epetra_CrsMatrix.
+     *
+     *  If the operator has been constructed from an Epetra_CrsMatrix, that
+     *  matrix is returned. Otherwise the conversion is done on the first call
+     *  and its result is stored for reuse. Epetra supports only real
+     *  double-precision matrices, so for complex \p ValueType only the real
+     *  parts of the matrix entries are exported.
+     *
+     *  \note The discrete operator represents the matrix returned by this
+     *  function *and possibly transposed and/or complex-conjugated*, depending on
+     *  the value returned by transpositionMode(). */
     shared_ptr<const Epetra_CrsMatrix> epetraMatrix() const;
 #endif
 
@@ -156,27 +215,49 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInMultiVectorImpl(const TranspositionMode trans,
+                                             const arma::Mat<ValueType>& x_in,
+                                             arma::Mat<ValueType>& y_inout,
+                                             const ValueType alpha,
+                                             const ValueType beta) const;
     bool isTransposed() const;
+    void initializeVectorSpaces();
+    const CsrMatrix<ValueType>& transposedCsrMatrix() const;
 
-    // void constructAhmedMatrix(
-    //         int* rowOffsets, int* colIndices, double* values,
-    //         std::vector<unsigned int>& domain_o2p,
-    //         std::vector<unsigned int>& range_p2o,
-    //         double eps,
-    //         AhmedBemBlcluster* blockCluster,
-    //         boost::shared_array<AhmedMblock*>& mblocks,
-    //         int& maximumRank) const;
+    // Functor constructing the transpose of a CSR matrix, for use with Lazy
+    class TransposedCsrMatrixInitializer
+    {
+    public:
+        explicit TransposedCsrMatrixInitializer(
+                const shared_ptr<const CsrMatrix<ValueType> >& mat) :
+            m_mat(mat) {
+        }
+
+        std::auto_ptr<CsrMatrix<ValueType> > operator()() const;
+
+    private:
+        shared_ptr<const CsrMatrix<ValueType> > m_mat;
+    };
+
+    typedef Lazy<CsrMatrix<ValueType>, TransposedCsrMatrixInitializer>
+    LazyCsrMatrix;
     /** \endcond */
 
 private:
     /** \cond PRIVATE */
-#ifdef WITH_TRILINOS
-    shared_ptr<const Epetra_CrsMatrix> m_mat;
+    shared_ptr<const CsrMatrix<ValueType> > m_csr;
     int m_symmetry;
     TranspositionMode m_trans;
     shared_ptr<AhmedBemBlcluster> m_blockCluster;
     // o2p
     shared_ptr<IndexPermutation> m_domainPermutation, m_rangePermutation;
+    ParallelizationOptions m_parallelizationOptions;
+    // Created on first use by a transposed or adjoint product
+    shared_ptr<LazyCsrMatrix> m_transposedCsr;
+    // Guards the creation of m_mat
+    mutable tbb::mutex m_mutex;
+#ifdef WITH_TRILINOS
+    mutable shared_ptr<const Epetra_CrsMatrix> m_mat;
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_rangeSpace;
 #endif
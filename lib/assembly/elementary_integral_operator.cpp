@@ -103,7 +103,7 @@ assembleWeakFormImpl(
 
     tbb::tick_count start = tbb::tick_count::now();
     std::auto_ptr<LocalAssembler> assembler =
-        this->makeAssembler(*context.quadStrategy(), context.assemblyOptions());
+        this->makeAssembler(context);
     shared_ptr<DiscreteBoundaryOperator<ResultType> > result =
         assembleWeakFormInternalImpl2(*assembler, context);
     tbb::tick_count end = tbb::tick_count::now();
@@ -118,6 +118,42 @@ ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::makeAssembler(
                              cacheSingularIntegrals);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::auto_ptr<typename ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::LocalAssembler>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::makeAssembler(
+        const Context<BasisFunctionType, ResultType>& context) const
+{
+    typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+    typedef std::vector<const Fiber::Shapeset<BasisFunctionType>*> ShapesetPtrVector;
+
+    const AssemblyOptions& options = context.assemblyOptions();
+    const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+    shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
+    shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
+    shared_ptr<Fiber::OpenClHandler> openClHandler;
+    shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
+    bool cacheSingularIntegrals;
+
+    if (verbose)
+        std::cout << "Collecting data for assembler construction..." << std::endl;
+    this->collectDataForAssemblerConstruction(context,
+                                              testRawGeometry, trialRawGeometry,
+                                              testGeometryFactory, trialGeometryFactory,
+                                              testShapesets, trialShapesets,
+                                              openClHandler, cacheSingularIntegrals);
+    if (verbose)
+        std::cout << "Data collection finished." << std::endl;
+
+    return makeAssemblerImpl(*context.quadStrategy(),
+                             testGeometryFactory, trialGeometryFactory,
+                             testRawGeometry, trialRawGeometry,
+                             testShapesets, trialShapesets, openClHandler,
+                             options.parallelizationOptions(),
+                             options.verbosityLevel(),
+                             cacheSingularIntegrals);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(ElementaryIntegralOperatorBase);
 
 } // namespace Bempp
@@ -110,6 +110,18 @@ public:
             const QuadratureStrategy& quadStrategy,
             const AssemblyOptions& options) const;
 
+    /** \brief Construct a local assembler suitable for this operator using
+     *  the quadrature strategy and assembly options of a specified context.
+     *
+     *  \param[in] context  Assembly context.
+     *
+     *  This is an overloaded function, provided for convenience. Grid and
+     *  space data needed by the assembler are taken from the cache owned by
+     *  \p context and hence shared with other operators assembled with the
+     *  same context. */
+    std::auto_ptr<LocalAssembler> makeAssembler(
+            const Context<BasisFunctionType, ResultType>& context) const;
+
     /** \brief Assemble the operator's weak form using a specified local assembler.
      *
      *  This function is intended for internal use of the library. End users
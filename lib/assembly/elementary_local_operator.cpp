@@ -19,7 +19,6 @@
 // THE SOFTWARE.
 
 #include "bempp/common/config_ahmed.hpp"
-#include "bempp/common/config_trilinos.hpp"
 
 #include "elementary_local_operator.hpp"
 
@@ -30,6 +29,8 @@
 #include "assembly_options.hpp"
 #include "boundary_operator.hpp"
 #include "cluster_construction_helper.hpp"
+#include "csr_assembly_helper.hpp"
+#include "csr_matrix.hpp"
 #include "discrete_dense_boundary_operator.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
 #include "context.hpp"
@@ -37,10 +38,12 @@
 #include "../common/types.hpp"
 #include "../common/complex_aux.hpp"
 #include "../fiber/basis.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 #include "../fiber/local_assembler_for_local_operators.hpp"
 #include "../fiber/opencl_handler.hpp"
+#include "../fiber/parallelization_options.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
 #include "../fiber/scalar_function_value_functor.hpp"
 #include "../fiber/default_collection_of_basis_transformations.hpp"
@@ -52,115 +55,61 @@
 #include "../space/space.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
-#include <boost/type_traits/is_complex.hpp>
 
+#include <tbb/blocked_range.h>
 #include <tbb/tick_count.h>
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
-#ifdef WITH_TRILINOS
-// This is a workaround of the problem of the abs() function being declared
-// both in Epetra and in AHMED. It relies of the implementation detail (!) that
-// in Epetra the declaration of abs is put between #ifndef __IBMCPP__ ...
-// #endif. So it may well break in future versions of Trilinos. The ideal
-// solution would be for AHMED to use namespaces.
-#ifndef __IBMCPP__
-#define __IBMCPP__
-#include <Epetra_FECrsMatrix.h>
-#include <Epetra_LocalMap.h>
-#include <Epetra_SerialComm.h>
-#undef __IBMCPP__
-#else
-#include <Epetra_FECrsMatrix.h>
-#include <Epetra_LocalMap.h>
-#include <Epetra_SerialComm.h>
-#endif
-#endif // WITH_TRILINOS
-
 namespace Bempp
 {
 
 namespace
 {
 
-#ifdef WITH_TRILINOS
-// Internal helper functions for Epetra
-template <typename ValueType>
-int epetraSumIntoGlobalValues(Epetra_FECrsMatrix& matrix,
-                              const std::vector<int>& rowIndices,
-                              const std::vector<int>& colIndices,
-                              const arma::Mat<ValueType>& values);
-
-// Specialisation for double -- no intermediate array is needed
-template <>
-inline int epetraSumIntoGlobalValues<double>(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<double>& values)
-{
-    assert(rowIndices.size() == values.n_rows);
-    assert(colIndices.size() == values.n_cols);
-    return matrix.SumIntoGlobalValues(rowIndices.size(), &rowIndices[0],
-                                      colIndices.size(), &colIndices[0],
-                                      values.memptr(),
-                                      Epetra_FECrsMatrix::COLUMN_MAJOR);
-}
+// Number of elements whose local weak forms are evaluated in a single task,
+// unless a grain size is set explicitly in ParallelizationOptions
+const size_t DEFAULT_LOCAL_WEAK_FORM_CHUNK_SIZE = 64;
 
-// Specialisation for float
-template <>
-inline int epetraSumIntoGlobalValues<float>(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<float>& values)
+/** Loop body evaluating the local weak forms of an operator on chunks of
+ *  consecutive elements. The weak forms are stored in a per-element array,
+ *  so that tasks never write to the same memory. */
+template <typename ResultType>
+class LocalWeakFormLoopBody
 {
-    // Convert data from float into double (expected by Epetra)
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    std::copy(values.begin(), values.end(), doubleValues.begin());
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
+public:
+    LocalWeakFormLoopBody(
+            Fiber::LocalAssemblerForLocalOperators<ResultType>& assembler,
+            size_t chunkSize, size_t elementCount,
+            std::vector<arma::Mat<ResultType> >& localResult) :
+        m_assembler(assembler), m_chunkSize(chunkSize),
+        m_elementCount(elementCount), m_localResult(localResult)
+    {
+    }
 
-// Specialisation for std::complex<float>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<float> >(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<std::complex<float> >& values)
-{
-    // Extract the real part of "values" into an array of type double
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    // Check whether arma::real returns a view or a copy (if the latter,
-    // this assert will fail)
-    for (size_t i = 0; i < values.n_elem; ++i)
-        doubleValues[i] = values[i].real();
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> elementIndices;
+        std::vector<arma::Mat<ResultType> > chunkResult;
+        for (size_t chunk = r.begin(); chunk != r.end(); ++chunk) {
+            const size_t begin = chunk * m_chunkSize;
+            const size_t end = std::min(begin + m_chunkSize, m_elementCount);
+            elementIndices.resize(end - begin);
+            for (size_t e = begin; e < end; ++e)
+                elementIndices[e - begin] = e;
+            m_assembler.evaluateLocalWeakForms(elementIndices, chunkResult);
+            for (size_t e = begin; e < end; ++e)
+                m_localResult[e] = chunkResult[e - begin];
+        }
+    }
 
-// Specialisation for std::complex<double>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<double> >(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<std::complex<double> >& values)
-{
-    // Extract the real part of "values" into an array of type double
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    for (size_t i = 0; i < values.n_elem; ++i)
-        doubleValues[i] = values[i].real();
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
-#endif
+private:
+    Fiber::LocalAssemblerForLocalOperators<ResultType>& m_assembler;
+    size_t m_chunkSize;
+    size_t m_elementCount;
+    std::vector<arma::Mat<ResultType> >& m_localResult;
+};
 
 /** Build a list of lists of global DOF indices corresponding to the local DOFs
  *  on each element of space.grid(). */
@@ -205,6 +154,52 @@ void gatherGlobalDofs(
     }
 }
 
+/** Evaluate the local weak forms of an operator on all elements in parallel
+ *  and assemble them into a sparse matrix in the CSR format. */
+template <typename BasisFunctionType, typename ResultType>
+void assembleCsrMatrix(
+    const Space<BasisFunctionType>& testSpace,
+    const Space<BasisFunctionType>& trialSpace,
+    Fiber::LocalAssemblerForLocalOperators<ResultType>& assembler,
+    const AssemblyOptions& options,
+    std::vector<size_t>& rowOffsets,
+    std::vector<int>& columnIndices,
+    std::vector<ResultType>& values)
+{
+    const GridView& view = testSpace.gridView();
+    const size_t elementCount = view.entityCount(0);
+
+    const ParallelizationOptions& parallelOptions =
+            options.parallelizationOptions();
+    const size_t chunkSize =
+            parallelOptions.grainSize() == ParallelizationOptions::AUTO ?
+                DEFAULT_LOCAL_WEAK_FORM_CHUNK_SIZE : parallelOptions.grainSize();
+    const size_t chunkCount = (elementCount + chunkSize - 1) / chunkSize;
+
+    // Fill local submatrices
+    std::vector<arma::Mat<ResultType> > localResult(elementCount);
+    Fiber::ExecutionContext::instance().parallelFor(
+                parallelOptions,
+                tbb::blocked_range<size_t>(0, chunkCount),
+                LocalWeakFormLoopBody<ResultType>(
+                    assembler, chunkSize, elementCount, localResult));
+
+    // Global DOF indices corresponding to local DOFs on elements
+    std::vector<std::vector<GlobalDofIndex> > testGdofs(elementCount);
+    std::vector<std::vector<GlobalDofIndex> > trialGdofs(elementCount);
+    std::vector<std::vector<BasisFunctionType> > testLdofWeights(elementCount);
+    std::vector<std::vector<BasisFunctionType> > trialLdofWeights(elementCount);
+    gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
+                     testLdofWeights, trialLdofWeights);
+
+    // Sum the local submatrices into a sparse matrix; its sparsity pattern
+    // follows from the element-DOF connectivity
+    CsrAssemblyHelper<BasisFunctionType, ResultType>::assembleFromLocalWeakForms(
+                testGdofs, trialGdofs, testLdofWeights, trialLdofWeights,
+                localResult, testSpace.globalDofCount(), parallelOptions,
+                rowOffsets, columnIndices, values);
+}
+
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -240,8 +235,7 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::assembleWeakFormImpl(
                   << this->label() << "'..." << std::endl;
 
     tbb::tick_count start = tbb::tick_count::now();
-    std::auto_ptr<LocalAssembler> assembler = this->makeAssembler(
-                *context.quadStrategy(), context.assemblyOptions());
+    std::auto_ptr<LocalAssembler> assembler = this->makeAssembler(context);
     shared_ptr<DiscreteBoundaryOperator<ResultType> > result =
             assembleWeakFormInternalImpl2(*assembler, context);
     tbb::tick_count end = tbb::tick_count::now();
@@ -258,12 +252,10 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::assembleWeakFormInternal
         LocalAssembler& assembler,
         const Context<BasisFunctionType, ResultType>& context) const
 {
-#ifdef WITH_TRILINOS
     if (context.assemblyOptions().isSparseStorageOfLocalOperatorsEnabled())
         return shared_ptr<DiscreteBoundaryOperator<ResultType> >(
             assembleWeakFormInSparseMode(assembler, context.assemblyOptions())
             .release());
-#endif
     return shared_ptr<DiscreteBoundaryOperator<ResultType> >(
         assembleWeakFormInDenseMode(assembler, context.assemblyOptions())
         .release());
@@ -278,47 +270,24 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::assembleWeakFormInDenseM
     const Space<BasisFunctionType>& testSpace = *this->dualToRange();
     const Space<BasisFunctionType>& trialSpace = *this->domain();
 
-    // Fill local submatrices
-    const GridView& view = testSpace.gridView();
-    const size_t elementCount = view.entityCount(0);
-    std::vector<int> elementIndices(elementCount);
-    for (size_t i = 0; i < elementCount; ++i)
-        elementIndices[i] = i;
-    std::vector<arma::Mat<ResultType> > localResult;
-    assembler.evaluateLocalWeakForms(elementIndices, localResult);
+    std::vector<size_t> rowOffsets;
+    std::vector<int> columnIndices;
+    std::vector<ResultType> values;
+    assembleCsrMatrix(testSpace, trialSpace, assembler, options,
+                      rowOffsets, columnIndices, values);
 
     // Create the operator's matrix
-    arma::Mat<ResultType> result(testSpace.globalDofCount(),
+    const size_t testGlobalDofCount = testSpace.globalDofCount();
+    arma::Mat<ResultType> result(testGlobalDofCount,
                                  trialSpace.globalDofCount());
     result.fill(0.);
-
-    // Retrieve global DOFs corresponding to local DOFs on all elements
-    std::vector<std::vector<GlobalDofIndex> > testGdofs(elementCount);
-    std::vector<std::vector<GlobalDofIndex> > trialGdofs(elementCount);
-    std::vector<std::vector<BasisFunctionType> > testLdofWeights(elementCount);
-    std::vector<std::vector<BasisFunctionType> > trialLdofWeights(elementCount);
-    gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
-                     testLdofWeights, trialLdofWeights);
-
-    // Distribute local matrices into the global matrix
-    for (size_t e = 0; e < elementCount; ++e)
-        for (size_t trialIndex = 0; trialIndex < trialGdofs[e].size(); ++trialIndex) {
-            int trialGdof = trialGdofs[e][trialIndex];
-            if (trialGdof < 0)
-                continue;
-            for (size_t testIndex = 0; testIndex < testGdofs[e].size(); ++testIndex) {
-                int testGdof = testGdofs[e][testIndex];
-                if (testGdof < 0)
-                    continue;
-                result(testGdof, trialGdof) +=
-                        conj(testLdofWeights[e][testIndex]) *
-                        trialLdofWeights[e][trialIndex] *
-                        localResult[e](testIndex, trialIndex);
-            }
-        }
+    for (size_t row = 0; row < testGlobalDofCount; ++row)
+        for (size_t i = rowOffsets[row]; i < rowOffsets[row + 1]; ++i)
+            result(row, columnIndices[i]) = values[i];
 
     return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
-                new DiscreteDenseBoundaryOperator<ResultType>(result));
+                new DiscreteDenseBoundaryOperator<ResultType>(
+                    result, options.parallelizationOptions()));
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -327,93 +296,15 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::assembleWeakFormInSparse
         LocalAssembler& assembler,
         const AssemblyOptions& options) const
 {
-#ifdef WITH_TRILINOS
-    if (boost::is_complex<BasisFunctionType>::value)
-        throw std::runtime_error(
-                "ElementaryLocalOperator::assembleWeakFormInSparseMode(): "
-                "sparse-mode assembly of identity operators for "
-                "complex-valued basis functions is not supported yet");
-
     const Space<BasisFunctionType>& testSpace = *this->dualToRange();
     const Space<BasisFunctionType>& trialSpace = *this->domain();
 
-    // Fill local submatrices
-    const GridView& view = testSpace.gridView();
-    const size_t elementCount = view.entityCount(0);
-    std::vector<int> elementIndices(elementCount);
-    for (size_t i = 0; i < elementCount; ++i)
-        elementIndices[i] = i;
-    std::vector<arma::Mat<ResultType> > localResult;
-    assembler.evaluateLocalWeakForms(elementIndices, localResult);
-
-    // Global DOF indices corresponding to local DOFs on elements
-    std::vector<std::vector<GlobalDofIndex> > testGdofs(elementCount);
-    std::vector<std::vector<GlobalDofIndex> > trialGdofs(elementCount);
-    std::vector<std::vector<BasisFunctionType> > testLdofWeights(elementCount);
-    std::vector<std::vector<BasisFunctionType> > trialLdofWeights(elementCount);
-    gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
-                     testLdofWeights, trialLdofWeights);
-
-    // Multiply matrix entries by DOF weights
-    for (size_t e = 0; e < elementCount; ++e)
-        for (size_t trialDof = 0; trialDof < trialGdofs[e].size(); ++trialDof)
-            for (size_t testDof = 0; testDof < testGdofs[e].size(); ++testDof)
-                localResult[e](testDof, trialDof) *=
-                    conj(testLdofWeights[e][testDof]) *
-                    trialLdofWeights[e][trialDof];
-
-    // Estimate number of entries in each row
-
-    //    This will be useful when we begin to use MPI
-    //    // Get global DOF indices for which this process is responsible
-    //    const int testGlobalDofCount = testSpace.globalDofCount();
-    //    Epetra_Map rowMap(testGlobalDofCount, 0 /* index-base */, comm);
-    //    std::vector<int> myTestGlobalDofs(rowMap.MyGlobalElements(),
-    //                                      rowMap.MyGlobalElements() +
-    //                                      rowMap.NumMyElements());
-    //    const int myTestGlobalDofCount = myTestGlobalDofs.size();
-
-    const int testGlobalDofCount = testSpace.globalDofCount();
-    const int trialGlobalDofCount = trialSpace.globalDofCount();
-    arma::Col<int> nonzeroEntryCountEstimates(testGlobalDofCount);
-    nonzeroEntryCountEstimates.fill(0);
-
-    // Upper estimate for the number of global trial DOFs coupled to a given
-    // global test DOF: sum of the local trial DOF counts for each element that
-    // contributes to the global test DOF in question
-    for (size_t e = 0; e < elementCount; ++e)
-        for (size_t testLdof = 0; testLdof < testGdofs[e].size(); ++testLdof) {
-            int testGdof = testGdofs[e][testLdof];
-            if (testGdof >= 0)
-                nonzeroEntryCountEstimates(testGdof) += trialGdofs[e].size();
-        }
-
-    Epetra_SerialComm comm; // To be replaced once we begin to use MPI
-    Epetra_LocalMap rowMap(testGlobalDofCount, 0 /* index_base */, comm);
-    Epetra_LocalMap colMap(trialGlobalDofCount, 0 /* index_base */, comm);
-    shared_ptr<Epetra_FECrsMatrix> result = boost::make_shared<Epetra_FECrsMatrix>(
-                Copy, rowMap, colMap,
-                nonzeroEntryCountEstimates.memptr());
-
-    // TODO: make each process responsible for a subset of elements
-    // Find maximum number of local dofs per element
-    size_t maxLdofCount = 0;
-    for (size_t e = 0; e < elementCount; ++e)
-        maxLdofCount = std::max(maxLdofCount,
-                                testGdofs[e].size() * trialGdofs[e].size());
-
-    // Initialise sparse matrix with zeros at required positions
-    arma::Col<double> zeros(maxLdofCount);
-    zeros.fill(0.);
-    for (size_t e = 0; e < elementCount; ++e)
-        result->InsertGlobalValues(testGdofs[e].size(), &testGdofs[e][0],
-                                   trialGdofs[e].size(), &trialGdofs[e][0],
-                                   zeros.memptr());
-    // Add contributions from individual elements
-    for (size_t e = 0; e < elementCount; ++e)
-        epetraSumIntoGlobalValues(
-            *result, testGdofs[e], trialGdofs[e], localResult[e]);
-    result->GlobalAssemble();
+    shared_ptr<CsrMatrix<ResultType> > result =
+            boost::make_shared<CsrMatrix<ResultType> >(
+                testSpace.globalDofCount(), trialSpace.globalDofCount());
+    assembleCsrMatrix(testSpace, trialSpace, assembler, options,
+                      result->rowOffsets, result->columnIndices,
+                      result->values);
 
     // If assembly mode is equal to ACA and we have AHMED,
     // construct the block cluster tree. Otherwise leave it uninitialized.
@@ -457,23 +348,19 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::assembleWeakFormInSparse
     return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
         new DiscreteSparseBoundaryOperator<ResultType>(
                     result, this->symmetry(), NO_TRANSPOSE,
-                    blockCluster, trial_o2pPermutation, test_o2pPermutation));
-#else // WITH_TRILINOS
-    throw std::runtime_error("ElementaryLocalOperator::assembleWeakFormInSparseMode(): "
-                             "To enable assembly in sparse mode, recompile BEM++ "
-                             "with the symbol WITH_TRILINOS defined.");
-#endif
+                    blockCluster, trial_o2pPermutation, test_o2pPermutation,
+                    options.parallelizationOptions()));
 }
 
 template <typename BasisFunctionType, typename ResultType>
 std::auto_ptr<typename ElementaryLocalOperator<BasisFunctionType, ResultType>::LocalAssembler>
 ElementaryLocalOperator<BasisFunctionType, ResultType>::makeAssembler(
-        const QuadratureStrategy& quadStrategy,
-        const AssemblyOptions& options) const
+        const Context<BasisFunctionType, ResultType>& context) const
 {
     typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
     typedef std::vector<const Fiber::Shapeset<BasisFunctionType>*> ShapesetPtrVector;
 
+    const AssemblyOptions& options = context.assemblyOptions();
     const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
 
     shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
@@ -484,7 +371,7 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::makeAssembler(
 
     if (verbose)
         std::cout << "Collecting data for assembler construction..." << std::endl;
-       this->collectDataForAssemblerConstruction(options,
+       this->collectDataForAssemblerConstruction(context,
                                         testRawGeometry, trialRawGeometry,
                                         testGeometryFactory, trialGeometryFactory,
                                         testShapesets, trialShapesets,
@@ -494,7 +381,7 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::makeAssembler(
     assert(testRawGeometry == trialRawGeometry);
     assert(testGeometryFactory == trialGeometryFactory);
 
-    return quadStrategy.makeAssemblerForLocalOperators(
+    return context.quadStrategy()->makeAssemblerForLocalOperators(
                 testGeometryFactory, testRawGeometry,
                 testShapesets, trialShapesets,
                 make_shared_from_ref(testTransformations()),
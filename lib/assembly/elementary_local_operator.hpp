@@ -135,8 +135,7 @@ private:
             const AssemblyOptions& options) const;
 
     std::auto_ptr<LocalAssembler> makeAssembler(
-            const QuadratureStrategy& quadStrategy,
-            const AssemblyOptions& options) const;
+            const Context<BasisFunctionType, ResultType>& context) const;
 
 private:
     shared_ptr<const AbstractBoundaryOperatorId> m_id;
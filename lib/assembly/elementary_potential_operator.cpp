@@ -131,10 +131,12 @@ evaluateAtPoints(
         std::auto_ptr<Evaluator> evaluator =
                 makeEvaluator(argument, quadStrategy, options);
 
-        // right now we don't bother about far and near field
-        // (this might depend on evaluation options)
         arma::Mat<ResultType> result;
         evaluator->evaluate(Evaluator::FAR_FIELD, evaluationPoints, result);
+        if (options.isNearFieldQuadratureEnabled())
+            evaluator->applyNearFieldCorrections(
+                        evaluationPoints, options.nearFieldEvaluationOptions(),
+                        result);
         return result;
     } else if (options.evaluationMode() == EvaluationOptions::ACA) {
         AssembledPotentialOperator<BasisFunctionType, ResultType> assembledOp =
@@ -142,6 +144,19 @@ evaluateAtPoints(
                          make_shared_from_ref(evaluationPoints),
                          quadStrategy, options);
         return assembledOp.apply(argument);
+    } else if (options.evaluationMode() == EvaluationOptions::HIERARCHICAL) {
+        std::auto_ptr<Evaluator> evaluator =
+                makeEvaluator(argument, quadStrategy, options);
+
+        arma::Mat<ResultType> result;
+        evaluator->evaluateHierarchically(
+                    evaluationPoints, options.hierarchicalEvaluationOptions(),
+                    result);
+        if (options.isNearFieldQuadratureEnabled())
+            evaluator->applyNearFieldCorrections(
+                        evaluationPoints, options.nearFieldEvaluationOptions(),
+                        result);
+        return result;
     } else
         throw std::invalid_argument(
                 "ElementaryPotentialOperator::evaluateAtPoints(): "
@@ -171,6 +186,11 @@ assemble(
                 "the number of coordinates of each evaluation point must be "
                 "equal to the dimension of the space containing the surface "
                 "on which the function space 'space' is defined");
+    if (options.evaluationMode() == EvaluationOptions::HIERARCHICAL)
+        throw std::invalid_argument(
+                "ElementaryPotentialOperator::assemble(): "
+                "potential operators cannot be assembled in the hierarchical "
+                "evaluation mode; use the ACA mode instead");
 
     std::auto_ptr<LocalAssembler> assembler =
             makeAssembler(*space, *evaluationPoints, quadStrategy, options);
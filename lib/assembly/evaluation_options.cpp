@@ -25,6 +25,7 @@ namespace Bempp
 
 EvaluationOptions::EvaluationOptions() :
     m_evaluationMode(DENSE),
+    m_nearFieldQuadratureEnabled(false),
     m_verbosityLevel(VerbosityLevel::DEFAULT)
 {
 }
@@ -40,6 +41,13 @@ void EvaluationOptions::switchToAcaMode(const AcaOptions& acaOptions)
     m_acaOptions = acaOptions;
 }
 
+void EvaluationOptions::switchToHierarchicalMode(
+        const HierarchicalEvaluationOptions& hierarchicalOptions)
+{
+    m_evaluationMode = HIERARCHICAL;
+    m_hierarchicalOptions = hierarchicalOptions;
+}
+
 EvaluationOptions::Mode EvaluationOptions::evaluationMode() const {
     return m_evaluationMode;
 }
@@ -48,6 +56,33 @@ const AcaOptions& EvaluationOptions::acaOptions() const {
     return m_acaOptions;
 }
 
+const HierarchicalEvaluationOptions&
+EvaluationOptions::hierarchicalEvaluationOptions() const {
+    return m_hierarchicalOptions;
+}
+
+void EvaluationOptions::enableNearFieldQuadrature(
+        const NearFieldEvaluationOptions& nearFieldOptions)
+{
+    m_nearFieldQuadratureEnabled = true;
+    m_nearFieldOptions = nearFieldOptions;
+}
+
+void EvaluationOptions::disableNearFieldQuadrature()
+{
+    m_nearFieldQuadratureEnabled = false;
+}
+
+bool EvaluationOptions::isNearFieldQuadratureEnabled() const
+{
+    return m_nearFieldQuadratureEnabled;
+}
+
+const NearFieldEvaluationOptions&
+EvaluationOptions::nearFieldEvaluationOptions() const {
+    return m_nearFieldOptions;
+}
+
 //void EvaluationOptions::switchToOpenCl(const OpenClOptions& openClOptions)
 //{
 //    m_parallelizationOptions.switchToOpenCl(openClOptions);
@@ -27,6 +27,8 @@
 #include "aca_options.hpp"
 
 #include "../common/deprecated.hpp"
+#include "../fiber/hierarchical_evaluation_options.hpp"
+#include "../fiber/near_field_evaluation_options.hpp"
 #include "../fiber/opencl_options.hpp"
 #include "../fiber/parallelization_options.hpp"
 #include "../fiber/verbosity_level.hpp"
@@ -34,6 +36,8 @@
 namespace Bempp
 {
 
+using Fiber::HierarchicalEvaluationOptions;
+using Fiber::NearFieldEvaluationOptions;
 using Fiber::OpenClOptions;
 using Fiber::ParallelizationOptions;
 using Fiber::VerbosityLevel;
@@ -57,7 +61,10 @@ public:
         /** \brief Assemble dense matrices. */
         DENSE,
         /** \brief Assemble hierarchical matrices using adaptive cross approximation (ACA). */
-        ACA
+        ACA,
+        /** \brief Evaluate potentials directly on cluster trees, interpolating
+         *  far-field interactions. */
+        HIERARCHICAL
     };
 
     /** \brief Use dense-matrix representations of elementary potential operators.
@@ -116,10 +123,35 @@ public:
      */
     void switchToAcaMode(const AcaOptions& acaOptions);
 
+    /** \brief Evaluate potentials hierarchically, without assembling any
+     *  matrices.
+     *
+     *  \param[in] hierarchicalOptions Parameters controlling the accuracy
+     *    of the approximation.
+     *
+     *  In this mode, PotentialOperator::evaluateAtPoints() and
+     *  evaluateOnGrid() organise the evaluation points and the quadrature
+     *  points used in the DENSE mode in cluster trees. The potential
+     *  generated by each cluster of quadrature points is summed directly
+     *  only at the evaluation points lying close to it; in boxes of
+     *  evaluation points lying far from it, it is evaluated at a small
+     *  number of Chebyshev nodes and interpolated. This reduces the cost of
+     *  evaluating the potential of a single charge distribution at many
+     *  points from O(MN) to roughly O((M + N) log(M + N)), where M is the
+     *  number of evaluation points and N that of quadrature points. The
+     *  method only requires values of the kernels and so works for all
+     *  potential operators.
+     *
+     *  This mode does not provide a matrix representation of the potential
+     *  operator, so PotentialOperator::assemble() cannot be used with it. */
+    void switchToHierarchicalMode(
+            const HierarchicalEvaluationOptions& hierarchicalOptions =
+            HierarchicalEvaluationOptions());
+
     /** \brief Return current evaluation mode.
      *
-     *  The evaluation mode can be changed by calling switchToDenseMode() or
-     *  switchToAcaMode(). */
+     *  The evaluation mode can be changed by calling switchToDenseMode(),
+     *  switchToAcaMode() or switchToHierarchicalMode(). */
     Mode evaluationMode() const;
 
     /** \brief Return the current adaptive cross approximation (ACA) settings.
@@ -128,6 +160,55 @@ public:
      *  evaluationMode() returns ACA. */
     const AcaOptions& acaOptions() const;
 
+    /** \brief Return the current parameters of the hierarchical evaluation.
+     *
+     *  \note These settings are only used in the HIERARCHICAL evaluation
+     *  mode. */
+    const HierarchicalEvaluationOptions& hierarchicalEvaluationOptions() const;
+
+    /** @}
+      @name Near-field quadrature
+      @{ */
+
+    /** \brief Improve the accuracy of potentials evaluated close to the
+     *  surface.
+     *
+     *  \param[in] nearFieldOptions Parameters determining which elements
+     *    are considered to lie close to an evaluation point and how finely
+     *    they can be subdivided.
+     *
+     *  By default, the contribution of each element to the potential is
+     *  calculated with the same quadrature rule at all evaluation points.
+     *  This rule becomes inaccurate at points lying at distances comparable
+     *  to the element size. When near-field quadrature is enabled, the
+     *  elements lying close to each evaluation point are found with a
+     *  spatial index and their contributions are recalculated by splitting
+     *  them recursively into subelements lying far enough from the point.
+     *  The contributions of all other elements are still calculated with
+     *  the ordinary rule, so the cost of evaluation at points lying far from
+     *  the surface is unaffected.
+     *
+     *  Near-field quadrature is used in the DENSE and HIERARCHICAL
+     *  evaluation modes. */
+    void enableNearFieldQuadrature(
+            const NearFieldEvaluationOptions& nearFieldOptions =
+            NearFieldEvaluationOptions());
+
+    /** \brief Integrate all elements with the ordinary quadrature rule,
+     *  regardless of their distance from the evaluation points.
+     *
+     *  This is the default. */
+    void disableNearFieldQuadrature();
+
+    /** \brief Return true if near-field quadrature is enabled. */
+    bool isNearFieldQuadratureEnabled() const;
+
+    /** \brief Return the current parameters of the near-field quadrature.
+     *
+     *  \note These settings are only used if
+     *  isNearFieldQuadratureEnabled() returns true. */
+    const NearFieldEvaluationOptions& nearFieldEvaluationOptions() const;
+
     /** @}
       @name Parallelization
       @{ */
@@ -169,6 +250,9 @@ private:
     /** \cond */
     Mode m_evaluationMode;
     AcaOptions m_acaOptions;
+    HierarchicalEvaluationOptions m_hierarchicalOptions;
+    bool m_nearFieldQuadratureEnabled;
+    NearFieldEvaluationOptions m_nearFieldOptions;
     ParallelizationOptions m_parallelizationOptions;
     VerbosityLevel::Level m_verbosityLevel;
     /** \endcond */
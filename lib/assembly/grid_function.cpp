@@ -26,6 +26,7 @@
 #include "context.hpp"
 #include "discrete_boundary_operator.hpp"
 #include "identity_operator.hpp"
+#include "local_assembler_construction_data_cache.hpp"
 #include "local_assembler_construction_helper.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -34,12 +35,14 @@
 #include "../fiber/basis.hpp"
 #include "../fiber/basis_data.hpp"
 #include "../fiber/collection_of_basis_transformations.hpp"
+#include "../fiber/execution_context.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/function.hpp"
 #include "../fiber/local_assembler_for_grid_functions.hpp"
 #include "../fiber/opencl_handler.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/stacked_function.hpp"
 #include "../grid/geometry_factory.hpp"
 #include "../grid/grid.hpp"
 #include "../grid/grid_view.hpp"
@@ -51,10 +54,14 @@
 #include "identity_operator.hpp"
 #include "../io/gmsh.hpp"
 
+#include <algorithm>
 #include <boost/array.hpp>
 #include <fstream>
 #include <set>
 #include <sstream>
+#include <utility>
+
+#include <tbb/blocked_range.h>
 
 namespace Bempp
 {
@@ -64,17 +71,108 @@ namespace Bempp
 namespace
 {
 
+// Number of elements whose local weak forms are evaluated in a single task,
+// unless a grain size is set explicitly in ParallelizationOptions
+const size_t DEFAULT_PROJECTION_CHUNK_SIZE = 64;
+
+/** Loop body evaluating the local weak forms of a grid function on chunks
+ *  of consecutive elements. The weak forms are stored in a per-element
+ *  array, so that tasks never write to the same memory. */
+template <typename ResultType>
+class LocalProjectionLoopBody
+{
+public:
+    LocalProjectionLoopBody(
+            Fiber::LocalAssemblerForGridFunctions<ResultType>& assembler,
+            size_t chunkSize, size_t elementCount,
+            std::vector<arma::Col<ResultType> >& localResults) :
+        m_assembler(assembler), m_chunkSize(chunkSize),
+        m_elementCount(elementCount), m_localResults(localResults)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> elementIndices;
+        std::vector<arma::Col<ResultType> > chunkResults;
+        for (size_t chunk = r.begin(); chunk != r.end(); ++chunk) {
+            const size_t begin = chunk * m_chunkSize;
+            const size_t end = std::min(begin + m_chunkSize, m_elementCount);
+            elementIndices.resize(end - begin);
+            for (size_t e = begin; e < end; ++e)
+                elementIndices[e - begin] = e;
+            m_assembler.evaluateLocalWeakForms(elementIndices, chunkResults);
+            for (size_t e = begin; e < end; ++e)
+                m_localResults[e] = chunkResults[e - begin];
+        }
+    }
+
+private:
+    Fiber::LocalAssemblerForGridFunctions<ResultType>& m_assembler;
+    size_t m_chunkSize;
+    size_t m_elementCount;
+    std::vector<arma::Col<ResultType> >& m_localResults;
+};
+
+/** Loop body summing the local weak forms into the global projection
+ *  vectors. Each global DOF gathers the contributions of the local DOFs
+ *  mapped to it, so no two tasks write to the same entry and the result
+ *  does not depend on the number of threads. */
 template <typename BasisFunctionType, typename ResultType>
-shared_ptr<arma::Col<ResultType> > reallyCalculateProjections(
+class ProjectionGatherLoopBody
+{
+public:
+    ProjectionGatherLoopBody(
+            const std::vector<size_t>& dofOffsets,
+            const std::vector<std::pair<int, int> >& dofContributions,
+            const std::vector<std::vector<BasisFunctionType> >& localDofWeights,
+            const std::vector<arma::Col<ResultType> >& localResults,
+            arma::Mat<ResultType>& result) :
+        m_dofOffsets(dofOffsets), m_dofContributions(dofContributions),
+        m_localDofWeights(localDofWeights), m_localResults(localResults),
+        m_result(result)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const size_t functionCount = m_result.n_cols;
+        for (size_t dof = r.begin(); dof != r.end(); ++dof)
+            for (size_t i = m_dofOffsets[dof]; i < m_dofOffsets[dof + 1]; ++i) {
+                const int element = m_dofContributions[i].first;
+                const int localDof = m_dofContributions[i].second;
+                const BasisFunctionType weight =
+                        conj(m_localDofWeights[element][localDof]);
+                const size_t localDofCount =
+                        m_localDofWeights[element].size();
+                for (size_t f = 0; f < functionCount; ++f)
+                    m_result(dof, f) += weight * m_localResults[element](
+                                f * localDofCount + localDof);
+            }
+    }
+
+private:
+    const std::vector<size_t>& m_dofOffsets;
+    const std::vector<std::pair<int, int> >& m_dofContributions;
+    const std::vector<std::vector<BasisFunctionType> >& m_localDofWeights;
+    const std::vector<arma::Col<ResultType> >& m_localResults;
+    arma::Mat<ResultType>& m_result;
+};
+
+/** \brief Calculate the projections of functionCount functions, integrated
+  by \p assembler, on the basis functions of \p dualSpace.
+
+  Column \p f of the returned matrix contains the projections of the
+  <em>f</em>th function. */
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> reallyCalculateProjections(
         const Space<BasisFunctionType>& dualSpace,
         Fiber::LocalAssemblerForGridFunctions<ResultType>& assembler,
+        size_t functionCount,
         const AssemblyOptions& options)
 {
-    // TODO: parallelise using TBB (the parameter options will then start be used)
-
     // Get the grid's leaf view so that we can iterate over elements
     const GridView& view = dualSpace.gridView();
     const size_t elementCount = view.entityCount(0);
+    const size_t globalDofCount = dualSpace.globalDofCount();
 
     // Global DOF indices corresponding to local DOFs on elements
     std::vector<std::vector<GlobalDofIndex> > testGlobalDofs(elementCount);
@@ -91,42 +189,67 @@ shared_ptr<arma::Col<ResultType> > reallyCalculateProjections(
         it->next();
     }
 
-    // Make a vector of all element indices
-    std::vector<int> testIndices(elementCount);
-    for (size_t i = 0; i < elementCount; ++i)
-        testIndices[i] = i;
+    // List the (element, local DOF) pairs contributing to each global DOF.
+    // Negative global DOF indices denote constrained (unused) local DOFs.
+    std::vector<size_t> dofOffsets(globalDofCount + 1, 0);
+    for (size_t e = 0; e < elementCount; ++e)
+        for (size_t i = 0; i < testGlobalDofs[e].size(); ++i)
+            if (testGlobalDofs[e][i] >= 0)
+                ++dofOffsets[testGlobalDofs[e][i] + 1];
+    for (size_t dof = 0; dof < globalDofCount; ++dof)
+        dofOffsets[dof + 1] += dofOffsets[dof];
+    std::vector<std::pair<int, int> > dofContributions(
+                dofOffsets[globalDofCount]);
+    {
+        std::vector<size_t> positions(dofOffsets.begin(), dofOffsets.end() - 1);
+        for (size_t e = 0; e < elementCount; ++e)
+            for (size_t i = 0; i < testGlobalDofs[e].size(); ++i)
+                if (testGlobalDofs[e][i] >= 0)
+                    dofContributions[positions[testGlobalDofs[e][i]]++] =
+                            std::make_pair(int(e), int(i));
+    }
 
-    // Create the weak form's column vector
-    shared_ptr<arma::Col<ResultType> > result(
-                new arma::Col<ResultType>(dualSpace.globalDofCount()));
-    result->fill(0.);
+    const ParallelizationOptions& parallelOptions =
+            options.parallelizationOptions();
+    const size_t chunkSize =
+            parallelOptions.grainSize() == ParallelizationOptions::AUTO ?
+                DEFAULT_PROJECTION_CHUNK_SIZE : parallelOptions.grainSize();
+    const size_t chunkCount = (elementCount + chunkSize - 1) / chunkSize;
 
-    std::vector<arma::Col<ResultType> > localResult;
     // Evaluate local weak forms
-    assembler.evaluateLocalWeakForms(testIndices, localResult);
-
-    // Loop over test indices
-    for (size_t testIndex = 0; testIndex < elementCount; ++testIndex)
-        // Add the integrals to appropriate entries in the global weak form
-        for (size_t testDof = 0; testDof < testGlobalDofs[testIndex].size(); ++testDof) {
-            int testGlobalDof = testGlobalDofs[testIndex][testDof];
-            if (testGlobalDof >= 0) // if it's negative, it means that this
-                                    // local dof is constrained (not used)
-                (*result)(testGlobalDof) +=
-                    conj(testLocalDofWeights[testIndex][testDof]) *
-                    localResult[testIndex](testDof);
-        }
-
-    // Return the vector of projections <phi_i, f>
+    std::vector<arma::Col<ResultType> > localResults(elementCount);
+    Fiber::ExecutionContext::instance().parallelFor(
+                parallelOptions,
+                tbb::blocked_range<size_t>(0, chunkCount),
+                LocalProjectionLoopBody<ResultType>(
+                    assembler, chunkSize, elementCount, localResults));
+
+    // Add the integrals to appropriate entries in the global weak forms
+    arma::Mat<ResultType> result(globalDofCount, functionCount);
+    result.fill(0.);
+    Fiber::ExecutionContext::instance().parallelFor(
+                parallelOptions,
+                tbb::blocked_range<size_t>(
+                    0, globalDofCount,
+                    Fiber::ExecutionContext::grainSize(parallelOptions)),
+                ProjectionGatherLoopBody<BasisFunctionType, ResultType>(
+                    dofOffsets, dofContributions, testLocalDofWeights,
+                    localResults, result));
+
+    // Return the vectors of projections <phi_i, f>
     return result;
 }
 
-/** \brief Calculate projections of the function on the basis functions of
-  the given dual space. */
+/** \brief Calculate projections of the functions on the basis functions of
+  the given dual space.
+
+  Column \p f of the returned matrix contains the projections of
+  <tt>functions[f]</tt>. The geometrical data and test function values are
+  evaluated only once for all the functions. */
 template <typename BasisFunctionType, typename ResultType>
-shared_ptr<arma::Col<ResultType> > calculateProjections(
+arma::Mat<ResultType> calculateProjections(
         const Context<BasisFunctionType, ResultType>& context,
-        const Function<ResultType>& globalFunction,
+        const std::vector<const Function<ResultType>*>& globalFunctions,
         const Space<BasisFunctionType>& dualSpace)
 {
     const AssemblyOptions& options = context.assemblyOptions();
@@ -142,8 +265,9 @@ shared_ptr<arma::Col<ResultType> > calculateProjections(
     shared_ptr<Fiber::OpenClHandler> openClHandler;
     shared_ptr<ShapesetPtrVector> testShapesets;
 
-    Helper::collectGridData(dualSpace,
-                            rawGeometry, geometryFactory);
+    // Grid data are shared with operators assembled with the same context
+    context.localAssemblerConstructionDataCache()->getGridData(
+                dualSpace, options, rawGeometry, geometryFactory);
     Helper::makeOpenClHandler(options.parallelizationOptions().openClOptions(),
                               rawGeometry, openClHandler);
     Helper::collectShapesets(dualSpace, testShapesets);
@@ -152,16 +276,36 @@ shared_ptr<arma::Col<ResultType> > calculateProjections(
     const Fiber::CollectionOfShapesetTransformations<CoordinateType>&
             testTransformations = dualSpace.basisFunctionValue();
 
+    // Integrate all the functions in one go
+    Fiber::StackedFunction<ResultType> stackedFunction(globalFunctions);
+
     typedef Fiber::LocalAssemblerForGridFunctions<ResultType> LocalAssembler;
     std::auto_ptr<LocalAssembler> assembler =
             context.quadStrategy()->makeAssemblerForGridFunctions(
                 geometryFactory, rawGeometry,
                 testShapesets,
                 make_shared_from_ref(testTransformations),
-                make_shared_from_ref(globalFunction),
+                make_shared_from_ref<const Function<ResultType> >(
+                    stackedFunction),
                 openClHandler);
 
-    return reallyCalculateProjections(dualSpace, *assembler, options);
+    return reallyCalculateProjections(dualSpace, *assembler,
+                                      globalFunctions.size(), options);
+}
+
+/** \brief Calculate projections of the function on the basis functions of
+  the given dual space. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<arma::Col<ResultType> > calculateProjections(
+        const Context<BasisFunctionType, ResultType>& context,
+        const Function<ResultType>& globalFunction,
+        const Space<BasisFunctionType>& dualSpace)
+{
+    std::vector<const Function<ResultType>*> globalFunctions(
+                1, &globalFunction);
+    arma::Mat<ResultType> projections =
+            calculateProjections(context, globalFunctions, dualSpace);
+    return boost::make_shared<arma::Col<ResultType> >(projections.col(0));
 }
 
 /** \brief Evaluate the function at the interpolation points of the chosen space. */
@@ -1066,6 +1210,66 @@ GridFunction<BasisFunctionType, ResultType> operator/(
 }
 
 
+template <typename BasisFunctionType, typename ResultType>
+std::vector<GridFunction<BasisFunctionType, ResultType> >
+gridFunctionsFromFunctions(
+        const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const Space<BasisFunctionType> >& dualSpace,
+        const std::vector<const Function<ResultType>*>& functions)
+{
+    if (!context)
+        throw std::invalid_argument(
+                "gridFunctionsFromFunctions(): context must not be null");
+    if (!space)
+        throw std::invalid_argument(
+                "gridFunctionsFromFunctions(): space must not be null");
+    if (!dualSpace)
+        throw std::invalid_argument(
+                "gridFunctionsFromFunctions(): dualSpace must not be null");
+
+    if (space->codomainDimension() != dualSpace->codomainDimension())
+        throw std::invalid_argument(
+                "gridFunctionsFromFunctions(): "
+                "functions from 'space' and 'dualSpace' have a different "
+                "number of components");
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (!functions[i])
+            throw std::invalid_argument(
+                    "gridFunctionsFromFunctions(): "
+                    "functions must not be null");
+        if (functions[i]->codomainDimension() != space->codomainDimension())
+            throw std::invalid_argument(
+                    "gridFunctionsFromFunctions(): "
+                    "functions from 'space' have a different number of "
+                    "components than some of 'functions'");
+    }
+
+    std::vector<GridFunction<BasisFunctionType, ResultType> > result;
+    if (functions.empty())
+        return result;
+
+    shared_ptr<const Space<BasisFunctionType> > newSpace = space;
+    shared_ptr<const Space<BasisFunctionType> > newDualSpace = dualSpace;
+    if (space->isBarycentric() || dualSpace->isBarycentric()) {
+        newSpace = space->barycentricSpace(space);
+        newDualSpace = dualSpace->barycentricSpace(dualSpace);
+    }
+    if (newSpace->grid() != newDualSpace->grid())
+            throw std::invalid_argument(
+                    "gridFunctionsFromFunctions(): "
+                    "space and dualSpace must be defined on the same grid");
+
+    const arma::Mat<ResultType> projections =
+            calculateProjections(*context, functions, *newDualSpace);
+    result.reserve(functions.size());
+    for (size_t i = 0; i < functions.size(); ++i)
+        result.push_back(GridFunction<BasisFunctionType, ResultType>(
+                             context, newSpace, newDualSpace,
+                             arma::Col<ResultType>(projections.col(i))));
+    return result;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 void exportToVtk(
         const GridFunction<BasisFunctionType, ResultType>& gridFunction,
@@ -1192,7 +1396,13 @@ FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(GridFunction);
     VtkWriter::DataType dataType, \
     const char* dataLabel, \
     const char* fileNamesBase, const char* filesPath, \
-    VtkWriter::OutputType outputType)
+    VtkWriter::OutputType outputType); \
+    template std::vector<GridFunction<BASIS, RESULT> > \
+    gridFunctionsFromFunctions( \
+    const shared_ptr<const Context<BASIS, RESULT> >& context, \
+    const shared_ptr<const Space<BASIS> >& space, \
+    const shared_ptr<const Space<BASIS> >& dualSpace, \
+    const std::vector<const Function<RESULT>*>& functions)
 #define INSTANTIATE_FREE_FUNCTIONS_WITH_SCALAR(BASIS, RESULT, SCALAR) \
     template GridFunction<BASIS, RESULT> operator*( \
     const GridFunction<BASIS, RESULT>& op, const SCALAR& scalar); \
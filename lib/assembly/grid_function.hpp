@@ -36,6 +36,7 @@
 #include <boost/mpl/has_key.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <memory>
+#include <vector>
 
 namespace Fiber
 {
@@ -574,6 +575,30 @@ template <typename BasisFunctionType, typename ResultType, typename ScalarType>
 GridFunction<BasisFunctionType, ResultType> operator/(
         const GridFunction<BasisFunctionType, ResultType>& g1, const ScalarType& scalar);
 
+// Construction of multiple grid functions
+
+/** \relates GridFunction
+ *  \brief Approximate several functions in the same space.
+ *
+ *  Element <em>i</em> of the returned vector is equivalent to
+ *  <tt>GridFunction(context, space, dualSpace, *functions[i])</tt>, i.e. it
+ *  is determined from the projections of <tt>*functions[i]</tt> on the basis
+ *  functions of \p dualSpace. However, the projections of all functions are
+ *  calculated in a single pass over the grid, so that the geometrical data
+ *  and the values of the basis functions of \p dualSpace are evaluated only
+ *  once. This is useful when many right-hand sides need to be constructed,
+ *  e.g. for a sequence of time steps or frequencies.
+ *
+ *  All the functions must have the same number of components as the
+ *  functions from \p space. */
+template <typename BasisFunctionType, typename ResultType>
+std::vector<GridFunction<BasisFunctionType, ResultType> >
+gridFunctionsFromFunctions(
+        const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const Space<BasisFunctionType> >& dualSpace,
+        const std::vector<const Function<ResultType>*>& functions);
+
 // Export
 
 /** \relates GridFunction
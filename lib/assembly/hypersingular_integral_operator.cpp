@@ -69,12 +69,12 @@ shared_ptr<typename HypersingularIntegralOperator<
 BasisFunctionType, KernelType, ResultType>::LocalAssembler>
 >
 HypersingularIntegralOperator<BasisFunctionType, KernelType, ResultType>::makeAssemblers(
-        const QuadratureStrategy& quadStrategy,
-        const AssemblyOptions& options) const
+        const Context<BasisFunctionType, ResultType>& context) const
 {
     typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
     typedef std::vector<const Fiber::Shapeset<BasisFunctionType>*> ShapesetPtrVector;
 
+    const AssemblyOptions& options = context.assemblyOptions();
     const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
 
     shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
@@ -85,7 +85,7 @@ HypersingularIntegralOperator<BasisFunctionType, KernelType, ResultType>::makeAs
 
     if (verbose)
         std::cout << "Collecting data for assembler construction..." << std::endl;
-       this->collectDataForAssemblerConstruction(options,
+       this->collectDataForAssemblerConstruction(context,
                                         testRawGeometry, trialRawGeometry,
                                         testGeometryFactory, trialGeometryFactory,
                                         testShapesets, trialShapesets,
@@ -97,7 +97,7 @@ HypersingularIntegralOperator<BasisFunctionType, KernelType, ResultType>::makeAs
         options.assemblyMode() == AssemblyOptions::ACA &&
         options.acaOptions().mode == AcaOptions::HYBRID_ASSEMBLY;
 
-    return reallyMakeAssemblers(quadStrategy,
+    return reallyMakeAssemblers(*context.quadStrategy(),
                                 testGeometryFactory, trialGeometryFactory,
                                 testRawGeometry, trialRawGeometry,
                                 testShapesets, trialShapesets, openClHandler,
@@ -173,7 +173,7 @@ assembleWeakFormImpl(
 
     tbb::tick_count start = tbb::tick_count::now();
     std::pair<shared_ptr<LocalAssembler>, shared_ptr<LocalAssembler> > assemblers =
-        makeAssemblers(*context.quadStrategy(), context.assemblyOptions());
+        makeAssemblers(context);
     shared_ptr<DiscreteBoundaryOperator<ResultType> > result =
         assembleWeakFormInternal(*assemblers.first, *assemblers.second, context);
     tbb::tick_count end = tbb::tick_count::now();
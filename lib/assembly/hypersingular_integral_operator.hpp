@@ -223,8 +223,7 @@ private:
 
     std::pair<shared_ptr<LocalAssembler>, shared_ptr<LocalAssembler> >
     makeAssemblers(
-            const QuadratureStrategy& quadStrategy,
-            const AssemblyOptions& options) const;
+            const Context<BasisFunctionType, ResultType>& context) const;
 
     std::pair<shared_ptr<LocalAssembler>, shared_ptr<LocalAssembler> >
     reallyMakeAssemblers(
@@ -89,6 +89,30 @@ public:
             original(i) = permuted(m_permutedIndices[i]);
     }
 
+    /** \brief Convert the rows of a matrix from original to permuted ordering. */
+    template <typename ValueType>
+    void permuteMatrixRows(const arma::Mat<ValueType>& original,
+                           arma::Mat<ValueType>& permuted) const
+    {
+        const int dim = original.n_rows;
+        permuted.set_size(dim, original.n_cols);
+        for (size_t c = 0; c < original.n_cols; ++c)
+            for (int i = 0; i < dim; ++i)
+                permuted(m_permutedIndices[i], c) = original(i, c);
+    }
+
+    /** \brief Convert the rows of a matrix from permuted to original ordering. */
+    template <typename ValueType>
+    void unpermuteMatrixRows(const arma::Mat<ValueType>& permuted,
+                             arma::Mat<ValueType>& original) const
+    {
+        const int dim = permuted.n_rows;
+        original.set_size(dim, permuted.n_cols);
+        for (size_t c = 0; c < permuted.n_cols; ++c)
+            for (int i = 0; i < dim; ++i)
+                original(i, c) = permuted(m_permutedIndices[i], c);
+    }
+
     /** \brief Permute index. */
     unsigned int permuted(unsigned int index) const {
         return m_permutedIndices[index];
@@ -0,0 +1,101 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "local_assembler_construction_data_cache.hpp"
+
+#include "assembly_options.hpp"
+#include "local_assembler_construction_helper.hpp"
+
+#include "../fiber/default_local_assembler_for_operators_on_surfaces_utilities.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType>
+LocalAssemblerConstructionDataCache<BasisFunctionType>::
+LocalAssemblerConstructionDataCache()
+{
+}
+
+template <typename BasisFunctionType>
+LocalAssemblerConstructionDataCache<BasisFunctionType>::
+~LocalAssemblerConstructionDataCache()
+{
+}
+
+template <typename BasisFunctionType>
+void LocalAssemblerConstructionDataCache<BasisFunctionType>::getGridData(
+        const Space<BasisFunctionType>& space,
+        const AssemblyOptions& options,
+        shared_ptr<RawGridGeometry>& rawGeometry,
+        shared_ptr<GeometryFactory>& geometryFactory)
+{
+    typedef LocalAssemblerConstructionHelper Helper;
+    typedef Fiber::DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
+            BasisFunctionType> Utilities;
+
+    tbb::mutex::scoped_lock lock(m_mutex);
+    shared_ptr<const Grid> grid = space.grid();
+    typename GridDataMap::iterator it = m_gridData.find(grid.get());
+    if (it == m_gridData.end()) {
+        GridData data;
+        data.grid = grid;
+        Helper::collectGridData(space, data.rawGeometry, data.geometryFactory);
+        data.rawGeometry->setElementSizesAndCenters(
+                    Utilities::elementSizesAndCenters(*data.rawGeometry));
+        it = m_gridData.insert(std::make_pair(grid.get(), data)).first;
+    }
+    if (options.isSingularIntegralCachingEnabled())
+        Helper::attachElementAdjacency(space, it->second.rawGeometry,
+                                       options.parallelizationOptions());
+    rawGeometry = it->second.rawGeometry;
+    geometryFactory = it->second.geometryFactory;
+}
+
+template <typename BasisFunctionType>
+void LocalAssemblerConstructionDataCache<BasisFunctionType>::getShapesets(
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        shared_ptr<ShapesetPtrVector>& shapesets)
+{
+    typedef LocalAssemblerConstructionHelper Helper;
+
+    tbb::mutex::scoped_lock lock(m_mutex);
+    typename SpaceDataMap::iterator it = m_spaceData.find(space.get());
+    if (it == m_spaceData.end()) {
+        SpaceData data;
+        data.space = space;
+        Helper::collectShapesets(*space, data.shapesets);
+        it = m_spaceData.insert(std::make_pair(space.get(), data)).first;
+    }
+    shapesets = it->second.shapesets;
+}
+
+template <typename BasisFunctionType>
+void LocalAssemblerConstructionDataCache<BasisFunctionType>::clear()
+{
+    tbb::mutex::scoped_lock lock(m_mutex);
+    m_gridData.clear();
+    m_spaceData.clear();
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(LocalAssemblerConstructionDataCache);
+
+} // namespace Bempp
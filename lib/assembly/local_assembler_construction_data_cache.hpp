@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_local_assembler_construction_data_cache_hpp
+#define bempp_local_assembler_construction_data_cache_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <map>
+#include <tbb/mutex.h>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \cond FORWARD_DECL */
+template <typename CoordinateType> class RawGridGeometry;
+template <typename BasisFunctionType> class Shapeset;
+/** \endcond */
+
+} // namespace Fiber
+
+namespace Bempp
+{
+
+/** \cond FORWARD_DECL */
+class AssemblyOptions;
+class GeometryFactory;
+class Grid;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of grid and space data used to construct local assemblers.
+ *
+ *  Each Context owns an instance of this class. When several operators are
+ *  assembled with the same context on the same grid (for example, the
+ *  components of a Calderon projector), the raw grid geometry, the sizes and
+ *  centres of elements, the lists of adjacent elements and the shapesets of
+ *  each space are calculated only once and then reused by all the operators.
+ *
+ *  The cache holds references to the grids and spaces whose data it
+ *  stores, so these objects are kept alive as long as the cache (i.e. its
+ *  context) exists or until clear() is called.
+ *
+ *  All member functions are thread-safe. */
+template <typename BasisFunctionType>
+class LocalAssemblerConstructionDataCache
+{
+public:
+    typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+    typedef std::vector<const Fiber::Shapeset<BasisFunctionType>*>
+    ShapesetPtrVector;
+
+    /** \brief Constructor. */
+    LocalAssemblerConstructionDataCache();
+
+    /** \brief Destructor. */
+    ~LocalAssemblerConstructionDataCache();
+
+    /** \brief Get the raw geometry and geometry factory of the grid on which
+     *  \p space is defined.
+     *
+     *  The sizes and centres of elements are attached to the returned raw
+     *  geometry. If singular-integral caching is enabled in \p options, so
+     *  are the lists of adjacent elements. */
+    void getGridData(
+            const Space<BasisFunctionType>& space,
+            const AssemblyOptions& options,
+            shared_ptr<RawGridGeometry>& rawGeometry,
+            shared_ptr<GeometryFactory>& geometryFactory);
+
+    /** \brief Get the shapesets of all elements of the grid on which
+     *  \p space is defined. */
+    void getShapesets(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            shared_ptr<ShapesetPtrVector>& shapesets);
+
+    /** \brief Remove all data from the cache. */
+    void clear();
+
+private:
+    /** \cond PRIVATE */
+    struct GridData
+    {
+        shared_ptr<const Grid> grid;
+        shared_ptr<RawGridGeometry> rawGeometry;
+        shared_ptr<GeometryFactory> geometryFactory;
+    };
+
+    struct SpaceData
+    {
+        shared_ptr<const Space<BasisFunctionType> > space;
+        shared_ptr<ShapesetPtrVector> shapesets;
+    };
+
+    typedef std::map<const Grid*, GridData> GridDataMap;
+    typedef std::map<const Space<BasisFunctionType>*, SpaceData> SpaceDataMap;
+
+    GridDataMap m_gridData;
+    SpaceDataMap m_spaceData;
+    tbb::mutex m_mutex;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
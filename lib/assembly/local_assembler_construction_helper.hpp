@@ -26,6 +26,7 @@
 #include "assembly_options.hpp"
 #include "../common/not_implemented_error.hpp"
 #include "../common/shared_ptr.hpp"
+#include "../fiber/element_adjacency.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
 #include "../fiber/opencl_handler.hpp"
 #include "../grid/geometry_factory.hpp"
@@ -59,6 +60,27 @@ struct LocalAssemblerConstructionHelper
         geometryFactory = space.elementGeometryFactory();
     }
 
+    /** \brief Attach to \p rawGeometry the element adjacency lists cached
+     *  by the grid of \p space, building them if necessary.
+     *
+     *  \p rawGeometry must have been filled by collectGridData() called with
+     *  the same space. The cached lists describe the leaf view of the grid,
+     *  on which spaces are defined; if the view of \p space has a different
+     *  number of elements, nothing is attached and the local assemblers
+     *  build their own lists. */
+    template <typename CoordinateType, typename BasisFunctionType>
+    static void attachElementAdjacency(
+            const Space<BasisFunctionType>& space,
+            const shared_ptr<Fiber::RawGridGeometry<CoordinateType> >& rawGeometry,
+            const Fiber::ParallelizationOptions& parallelizationOptions) {
+        if (rawGeometry->elementAdjacency())
+            return;
+        shared_ptr<const Fiber::ElementAdjacency> adjacency =
+                space.grid()->elementAdjacency(parallelizationOptions);
+        if (adjacency->elementCount() == rawGeometry->elementCount())
+            rawGeometry->setElementAdjacency(adjacency);
+    }
+
     template <typename BasisFunctionType>
     static void collectShapesets(
             const Space<BasisFunctionType>& space,
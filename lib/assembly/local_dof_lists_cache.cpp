@@ -35,8 +35,12 @@ LocalDofListsCache<BasisFunctionType>::LocalDofListsCache(
         const Space<BasisFunctionType>& space,
         const std::vector<unsigned int>& p2o,
         bool indexWithGlobalDofs) :
-    m_space(space), m_p2o(p2o), m_indexWithGlobalDofs(indexWithGlobalDofs)
+    m_space(space), m_p2o(p2o), m_indexWithGlobalDofs(indexWithGlobalDofs),
+    m_singleIndexLists(p2o.size())
 {
+    for (size_t i = 0; i < m_singleIndexLists.size(); ++i)
+        m_singleIndexLists[i] = 0;
+    m_builtListCount = 0;
 }
 
 template <typename BasisFunctionType>
@@ -46,6 +50,8 @@ LocalDofListsCache<BasisFunctionType>::~LocalDofListsCache()
          it != m_map.end(); ++it)
         delete it->second;
     m_map.clear();
+    for (size_t i = 0; i < m_singleIndexLists.size(); ++i)
+        delete m_singleIndexLists[i];
 }
 
 template <typename BasisFunctionType>
@@ -53,12 +59,26 @@ shared_ptr<const LocalDofLists<BasisFunctionType> >
 LocalDofListsCache<BasisFunctionType>::get(int start, int indexCount)
 {
     if (indexCount == 1) {
-        shared_ptr<LocalDofLists<BasisFunctionType> > result(
-            new LocalDofLists<BasisFunctionType>);
-        findLocalDofs(start, result->originalIndices, result->elementIndices,
-                      result->localDofIndices, result->localDofWeights,
-                      result->arrayIndices);
-        return result;
+        assert(start >= 0 && start < int(m_singleIndexLists.size()));
+        const LocalDofLists<BasisFunctionType>* lists = m_singleIndexLists[start];
+        if (lists)
+            return make_shared_from_ref(*lists);
+
+        LocalDofLists<BasisFunctionType>* newLists =
+                new LocalDofLists<BasisFunctionType>;
+        ++m_builtListCount;
+        findLocalDofs(start, newLists->originalIndices, newLists->elementIndices,
+                      newLists->localDofIndices, newLists->localDofWeights,
+                      newLists->arrayIndices);
+        // Publish the new list unless another thread was faster, in which
+        // case use the list it created.
+        const LocalDofLists<BasisFunctionType>* previous =
+                m_singleIndexLists[start].compare_and_swap(newLists, 0);
+        if (previous) {
+            delete newLists;
+            return make_shared_from_ref(*previous);
+        }
+        return make_shared_from_ref(*newLists);
     }
 
     std::pair<int, int> key(start, indexCount);
@@ -69,6 +89,7 @@ LocalDofListsCache<BasisFunctionType>::get(int start, int indexCount)
 
     // The relevant local DOF list doesn't exist yet and must be created.
     LocalDofLists<BasisFunctionType>* newLists = new LocalDofLists<BasisFunctionType>;
+    ++m_builtListCount;
     findLocalDofs(start, indexCount,
                   newLists->originalIndices, newLists->elementIndices,
                   newLists->localDofIndices, newLists->localDofWeights,
@@ -90,6 +111,12 @@ LocalDofListsCache<BasisFunctionType>::get(int start, int indexCount)
     return make_shared_from_ref(*result.first->second);
 }
 
+template <typename BasisFunctionType>
+size_t LocalDofListsCache<BasisFunctionType>::builtListCount() const
+{
+    return m_builtListCount;
+}
+
 template <typename BasisFunctionType>
 void LocalDofListsCache<BasisFunctionType>::
 findLocalDofs(
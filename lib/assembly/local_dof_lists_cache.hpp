@@ -25,6 +25,7 @@
 #include "../common/shared_ptr.hpp"
 #include "../common/types.hpp"
 
+#include <tbb/atomic.h>
 #include <tbb/concurrent_unordered_map.h>
 #include <vector>
 #include <iostream>
@@ -68,10 +69,23 @@ public:
     ~LocalDofListsCache();
 
     /** \brief Return the LocalDofLists object describing the DOFs corresponding to
-     *  AHMED matrix indices [start, start + indexCount). */
+     *  AHMED matrix indices [start, start + indexCount).
+     *
+     *  Lists corresponding to single indices, requested by ACA for each pivot
+     *  row and column, are stored in a table indexed directly by \p start,
+     *  so that repeated requests for the same pivot do not need to query
+     *  the space again. */
     shared_ptr<const LocalDofLists<BasisFunctionType> > get(
         int start, int indexCount);
 
+    /** \brief Return the number of LocalDofLists objects constructed so far.
+     *
+     *  Each call to get() that cannot be served from the cache builds a new
+     *  object by querying the space, so comparing this number with the number
+     *  of calls to get() shows how effective the cache is. Objects built
+     *  concurrently for the same key by several threads are all counted. */
+    size_t builtListCount() const;
+
 private:
     void findLocalDofs(
         int start,
@@ -99,6 +113,9 @@ private:
     typedef tbb::concurrent_unordered_map<std::pair<int, int>,
         const LocalDofLists<BasisFunctionType>*> LocalDofListsMap;
     LocalDofListsMap m_map;
+    std::vector<tbb::atomic<const LocalDofLists<BasisFunctionType>*> >
+    m_singleIndexLists;
+    tbb::atomic<size_t> m_builtListCount;
     /** \endcond */
 };
 
@@ -0,0 +1,141 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "mixed_precision_mblock_array.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_aux.hpp"
+
+#include "../common/not_implemented_error.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace Bempp
+{
+
+template <typename ValueType>
+MixedPrecisionMblockArray<ValueType>::BlockRecord::BlockRecord() :
+    converted(false), lowRank(false), n1(0), n2(0), rank(0)
+{
+}
+
+template <typename ValueType>
+MixedPrecisionMblockArray<ValueType>::MixedPrecisionMblockArray(
+        const AhmedMblockArray& blocks, size_t blockCount,
+        bool convertDenseBlocks) :
+    m_records(blockCount), m_blocks(blocks)
+{
+    for (size_t i = 0; i < blockCount; ++i) {
+        AhmedMblock* block = m_blocks[i];
+        if (!block->isLrM() && (block->isHeM() || block->isSyM() ||
+                                block->isLtM() || block->isUtM()))
+            throw NotImplementedError(
+                    "MixedPrecisionMblockArray::MixedPrecisionMblockArray(): "
+                    "only low-rank and general dense mblocks are supported");
+        BlockRecord& record = m_records[i];
+        record.lowRank = block->isLrM();
+        record.n1 = block->getn1();
+        record.n2 = block->getn2();
+        record.rank = record.lowRank ? block->rank() : 0;
+        record.converted = record.lowRank || convertDenseBlocks;
+        if (!record.converted)
+            continue;
+
+        const size_t valueCount = record.lowRank ?
+                    size_t(record.n1 + record.n2) * record.rank :
+                    size_t(record.n1) * record.n2;
+        const ValueType* data =
+                reinterpret_cast<const ValueType*>(block->getdata());
+        record.data.resize(valueCount);
+        for (size_t j = 0; j < valueCount; ++j)
+            record.data[j] = SingleValueType(data[j]);
+        delete block;
+        m_blocks[i] = 0;
+    }
+}
+
+template <typename ValueType>
+const typename MixedPrecisionMblockArray<ValueType>::SingleValueType*
+MixedPrecisionMblockArray<ValueType>::singlePrecisionData(size_t index) const
+{
+    const BlockRecord& record = m_records[index];
+    if (!record.converted || record.data.empty())
+        return 0;
+    return &record.data[0];
+}
+
+template <typename ValueType>
+const ValueType*
+MixedPrecisionMblockArray<ValueType>::fullPrecisionData(size_t index) const
+{
+    if (m_records[index].converted)
+        return 0;
+    return reinterpret_cast<const ValueType*>(m_blocks[index]->getdata());
+}
+
+template <typename ValueType>
+typename MixedPrecisionMblockArray<ValueType>::AhmedMblock*
+MixedPrecisionMblockArray<ValueType>::loadMblock(size_t index) const
+{
+    const BlockRecord& record = m_records[index];
+    std::auto_ptr<AhmedMblock> block(new AhmedMblock(record.n1, record.n2));
+    if (record.lowRank)
+        block->setrank(record.rank);
+    else
+        block->setGeM();
+    ValueType* data = reinterpret_cast<ValueType*>(block->getdata());
+    if (record.converted)
+        for (size_t j = 0; j < record.data.size(); ++j)
+            data[j] = ValueType(record.data[j]);
+    else
+        std::copy(fullPrecisionData(index),
+                  fullPrecisionData(index) + m_blocks[index]->nvals(), data);
+    return block.release();
+}
+
+template <typename ValueType>
+size_t MixedPrecisionMblockArray<ValueType>::memoryUsage() const
+{
+    size_t result = 0;
+    for (size_t i = 0; i < m_records.size(); ++i)
+        if (m_records[i].converted)
+            result += m_records[i].data.size() * sizeof(SingleValueType);
+        else
+            result += m_blocks[i]->nvals() * sizeof(ValueType);
+    return result;
+}
+
+template <typename ValueType>
+unsigned int MixedPrecisionMblockArray<ValueType>::maximumRank() const
+{
+    unsigned int result = 0;
+    for (size_t i = 0; i < m_records.size(); ++i)
+        result = std::max(result, m_records[i].rank);
+    return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(MixedPrecisionMblockArray);
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
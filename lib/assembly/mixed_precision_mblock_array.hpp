@@ -0,0 +1,156 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_mixed_precision_mblock_array_hpp
+#define bempp_mixed_precision_mblock_array_hpp
+
+#include "../common/common.hpp"
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_aux_fwd.hpp"
+
+#include <complex>
+#include <vector>
+#include "../common/boost_shared_array_fwd.hpp"
+
+namespace Bempp
+{
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Single-precision type with the same "realness" as \p ValueType. */
+template <typename ValueType>
+struct SinglePrecisionTraits
+{
+    typedef ValueType Type;
+};
+
+template <>
+struct SinglePrecisionTraits<double>
+{
+    typedef float Type;
+};
+
+template <>
+struct SinglePrecisionTraits<std::complex<double> >
+{
+    typedef std::complex<float> Type;
+};
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Mblocks of an H-matrix, some of which are stored in single
+ *  precision.
+ *
+ *  The values of converted mblocks are stored in the single-precision type
+ *  SingleValueType, which halves their memory footprint. Matrix-vector
+ *  products convert them back to \p ValueType on the fly, so that all
+ *  arithmetic is done (and all sums are accumulated) in the precision of \p
+ *  ValueType. The remaining mblocks are kept as ordinary AHMED mblocks.
+ *
+ *  Only low-rank and general dense mblocks are supported. */
+template <typename ValueType>
+class MixedPrecisionMblockArray
+{
+public:
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+    typedef boost::shared_array<AhmedMblock*> AhmedMblockArray;
+    typedef typename SinglePrecisionTraits<ValueType>::Type SingleValueType;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] blocks
+     *    Array of \p blockCount mblocks. Low-rank mblocks, and also general
+     *    dense ones if \p convertDenseBlocks is true, are converted to
+     *    single precision; the original mblocks are then deleted and their
+     *    entries in \p blocks set to null. The array must not be used by
+     *    other objects afterwards.
+     *  \param[in] blockCount
+     *    Number of mblocks.
+     *  \param[in] convertDenseBlocks
+     *    Whether to convert general dense mblocks in addition to low-rank
+     *    ones. */
+    MixedPrecisionMblockArray(const AhmedMblockArray& blocks,
+                              size_t blockCount, bool convertDenseBlocks);
+
+    /** \brief Return the number of mblocks. */
+    size_t blockCount() const { return m_records.size(); }
+
+    /** \brief Return true if mblock no. \p index is stored in single
+     *  precision. */
+    bool isConverted(size_t index) const { return m_records[index].converted; }
+
+    /** \brief Return true if mblock no. \p index is stored in the low-rank
+     *  format. */
+    bool isLowRank(size_t index) const { return m_records[index].lowRank; }
+
+    /** \brief Return the rank of mblock no. \p index if it is stored in the
+     *  low-rank format, otherwise 0. */
+    unsigned int rank(size_t index) const { return m_records[index].rank; }
+
+    /** \brief Return the values of mblock no. \p index if it is stored in
+     *  single precision, otherwise a null pointer.
+     *
+     *  The values of a low-rank mblock U V^H are the column-major entries
+     *  of U followed by those of V; the values of a dense mblock are its
+     *  column-major entries. */
+    const SingleValueType* singlePrecisionData(size_t index) const;
+
+    /** \brief Return the values of mblock no. \p index if it is stored in
+     *  full precision, otherwise a null pointer.
+     *
+     *  The values are laid out as in singlePrecisionData(). */
+    const ValueType* fullPrecisionData(size_t index) const;
+
+    /** \brief Return a newly allocated full-precision copy of mblock no. \p
+     *  index. */
+    AhmedMblock* loadMblock(size_t index) const;
+
+    /** \brief Return the number of bytes occupied by the values of all
+     *  mblocks. */
+    size_t memoryUsage() const;
+
+    /** \brief Return the maximum rank of the low-rank mblocks. */
+    unsigned int maximumRank() const;
+
+private:
+    /** \cond PRIVATE */
+    struct BlockRecord
+    {
+        BlockRecord();
+
+        bool converted;
+        bool lowRank;
+        unsigned int n1, n2, rank;
+        std::vector<SingleValueType> data;
+    };
+
+    std::vector<BlockRecord> m_records;
+    // Mblocks kept in full precision; entries of converted mblocks are null
+    AhmedMblockArray m_blocks;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
+
+#endif
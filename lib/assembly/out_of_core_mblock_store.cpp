@@ -0,0 +1,300 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "out_of_core_mblock_store.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_aux.hpp"
+
+#include "../common/not_implemented_error.hpp"
+#include "../common/to_string.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <tbb/atomic.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+tbb::atomic<unsigned int> scratchFileCounter;
+
+// Return the name of a file in the given directory that does not exist yet
+std::string makeScratchFileName(const std::string& directory)
+{
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/')
+        prefix += '/';
+    prefix += "bempp-mblocks-" + toString(std::time(0)) + "-";
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        std::string name = prefix + toString(scratchFileCounter++) + ".tmp";
+        std::ifstream test(name.c_str());
+        if (!test)
+            return name;
+    }
+    throw std::runtime_error("OutOfCoreMblockStore::OutOfCoreMblockStore(): "
+                             "cannot find an unused scratch file name in "
+                             "directory '" + directory + "'");
+}
+
+} // namespace
+
+template <typename ValueType>
+OutOfCoreMblockStore<ValueType>::BlockRecord::BlockRecord() :
+    stored(false), lowRank(false), n1(0), n2(0), rank(0)
+{
+    offset[0] = offset[1] = 0;
+    valueCount[0] = valueCount[1] = 0;
+}
+
+template <typename ValueType>
+OutOfCoreMblockStore<ValueType>::Segment::Segment() :
+    pinCount(0), resident(false)
+{
+}
+
+template <typename ValueType>
+OutOfCoreMblockStore<ValueType>::OutOfCoreMblockStore(
+        const std::string& directory, size_t blockCount,
+        size_t memoryBudget) :
+    m_fileName(makeScratchFileName(directory)),
+    m_fileSize(0),
+    m_blocks(blockCount),
+    m_memoryBudget(memoryBudget),
+    m_segments(2 * blockCount),
+    m_residentBytes(0)
+{
+    m_file.open(m_fileName.c_str(), std::ios::in | std::ios::out |
+                std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        throw std::runtime_error(
+                "OutOfCoreMblockStore::OutOfCoreMblockStore(): "
+                "cannot create scratch file '" + m_fileName + "'");
+}
+
+template <typename ValueType>
+OutOfCoreMblockStore<ValueType>::~OutOfCoreMblockStore()
+{
+    m_file.close();
+    std::remove(m_fileName.c_str());
+}
+
+template <typename ValueType>
+void OutOfCoreMblockStore<ValueType>::storeMblock(size_t index,
+                                                  AhmedMblock& block)
+{
+    if (index >= m_blocks.size())
+        throw std::invalid_argument("OutOfCoreMblockStore::storeMblock(): "
+                                    "invalid mblock index");
+    if (!block.isLrM() && (block.isHeM() || block.isSyM() ||
+                           block.isLtM() || block.isUtM()))
+        throw NotImplementedError(
+                "OutOfCoreMblockStore::storeMblock(): only low-rank and "
+                "general dense mblocks can be stored out of core");
+    BlockRecord& record = m_blocks[index];
+    if (record.stored)
+        throw std::invalid_argument("OutOfCoreMblockStore::storeMblock(): "
+                                    "mblock " + toString(index) +
+                                    " has already been stored");
+
+    record.lowRank = block.isLrM();
+    record.n1 = block.getn1();
+    record.n2 = block.getn2();
+    if (record.lowRank) {
+        record.rank = block.rank();
+        record.valueCount[FIRST_FACTOR] = size_t(record.n1) * record.rank;
+        record.valueCount[SECOND_FACTOR] = size_t(record.n2) * record.rank;
+    } else {
+        record.rank = 0;
+        record.valueCount[FIRST_FACTOR] = size_t(record.n1) * record.n2;
+        record.valueCount[SECOND_FACTOR] = 0;
+    }
+    const ValueType* data =
+            reinterpret_cast<const ValueType*>(block.getdata());
+    writeValues(data, record.valueCount[FIRST_FACTOR],
+                record.offset[FIRST_FACTOR]);
+    writeValues(data + record.valueCount[FIRST_FACTOR],
+                record.valueCount[SECOND_FACTOR],
+                record.offset[SECOND_FACTOR]);
+    record.stored = true;
+}
+
+template <typename ValueType>
+typename OutOfCoreMblockStore<ValueType>::AhmedMblock*
+OutOfCoreMblockStore<ValueType>::loadMblock(size_t index) const
+{
+    if (index >= m_blocks.size() || !m_blocks[index].stored)
+        throw std::invalid_argument("OutOfCoreMblockStore::loadMblock(): "
+                                    "mblock " + toString(index) +
+                                    " has not been stored");
+    const BlockRecord& record = m_blocks[index];
+    std::auto_ptr<AhmedMblock> block(new AhmedMblock(record.n1, record.n2));
+    if (record.lowRank)
+        block->setrank(record.rank);
+    else
+        block->setGeM();
+    ValueType* data = reinterpret_cast<ValueType*>(block->getdata());
+    readValues(record.offset[FIRST_FACTOR], record.valueCount[FIRST_FACTOR],
+               data);
+    readValues(record.offset[SECOND_FACTOR], record.valueCount[SECOND_FACTOR],
+               data + record.valueCount[FIRST_FACTOR]);
+    return block.release();
+}
+
+template <typename ValueType>
+const ValueType* OutOfCoreMblockStore<ValueType>::acquire(
+        size_t index, Part part) const
+{
+    const BlockRecord& record = m_blocks[index];
+    if (!record.stored)
+        throw std::invalid_argument("OutOfCoreMblockStore::acquire(): "
+                                    "mblock " + toString(index) +
+                                    " has not been stored");
+    const size_t count = record.valueCount[part];
+    if (count == 0)
+        return 0;
+    const size_t segmentIndex = 2 * index + part;
+    {
+        tbb::mutex::scoped_lock lock(m_cacheMutex);
+        Segment& segment = m_segments[segmentIndex];
+        if (segment.resident) {
+            if (segment.pinCount == 0)
+                m_unpinnedSegments.erase(segment.lruPosition);
+            ++segment.pinCount;
+            return &segment.data[0];
+        }
+    }
+
+    // Read the segment without holding the cache lock, so that other threads
+    // can meanwhile use resident segments
+    std::vector<ValueType> data(count);
+    readValues(record.offset[part], count, &data[0]);
+
+    tbb::mutex::scoped_lock lock(m_cacheMutex);
+    Segment& segment = m_segments[segmentIndex];
+    if (!segment.resident) {
+        segment.data.swap(data);
+        segment.resident = true;
+        m_residentBytes += count * sizeof(ValueType);
+    } else if (segment.pinCount == 0) // loaded by another thread meanwhile
+        m_unpinnedSegments.erase(segment.lruPosition);
+    ++segment.pinCount;
+    evictSegments();
+    return &segment.data[0];
+}
+
+template <typename ValueType>
+void OutOfCoreMblockStore<ValueType>::release(size_t index, Part part) const
+{
+    if (m_blocks[index].valueCount[part] == 0)
+        return;
+    const size_t segmentIndex = 2 * index + part;
+    tbb::mutex::scoped_lock lock(m_cacheMutex);
+    Segment& segment = m_segments[segmentIndex];
+    assert(segment.resident && segment.pinCount > 0);
+    if (--segment.pinCount == 0) {
+        m_unpinnedSegments.push_front(segmentIndex);
+        segment.lruPosition = m_unpinnedSegments.begin();
+        evictSegments();
+    }
+}
+
+template <typename ValueType>
+size_t OutOfCoreMblockStore<ValueType>::storedBytes() const
+{
+    tbb::mutex::scoped_lock lock(m_fileMutex);
+    return static_cast<size_t>(m_fileSize);
+}
+
+template <typename ValueType>
+size_t OutOfCoreMblockStore<ValueType>::residentBytes() const
+{
+    tbb::mutex::scoped_lock lock(m_cacheMutex);
+    return m_residentBytes;
+}
+
+template <typename ValueType>
+unsigned int OutOfCoreMblockStore<ValueType>::maximumRank() const
+{
+    unsigned int result = 0;
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+        result = std::max(result, m_blocks[i].rank);
+    return result;
+}
+
+template <typename ValueType>
+void OutOfCoreMblockStore<ValueType>::writeValues(
+        const ValueType* values, size_t count, std::streamoff& offset)
+{
+    tbb::mutex::scoped_lock lock(m_fileMutex);
+    offset = m_fileSize;
+    if (count == 0)
+        return;
+    m_file.seekp(offset);
+    m_file.write(reinterpret_cast<const char*>(values),
+                 count * sizeof(ValueType));
+    if (!m_file)
+        throw std::runtime_error("OutOfCoreMblockStore::writeValues(): "
+                                 "error while writing scratch file '" +
+                                 m_fileName + "'");
+    m_fileSize += count * sizeof(ValueType);
+}
+
+template <typename ValueType>
+void OutOfCoreMblockStore<ValueType>::readValues(
+        std::streamoff offset, size_t count, ValueType* values) const
+{
+    if (count == 0)
+        return;
+    tbb::mutex::scoped_lock lock(m_fileMutex);
+    m_file.seekg(offset);
+    m_file.read(reinterpret_cast<char*>(values), count * sizeof(ValueType));
+    if (!m_file)
+        throw std::runtime_error("OutOfCoreMblockStore::readValues(): "
+                                 "error while reading scratch file '" +
+                                 m_fileName + "'");
+}
+
+// To be called with m_cacheMutex locked
+template <typename ValueType>
+void OutOfCoreMblockStore<ValueType>::evictSegments() const
+{
+    while (m_residentBytes > m_memoryBudget && !m_unpinnedSegments.empty()) {
+        Segment& segment = m_segments[m_unpinnedSegments.back()];
+        m_unpinnedSegments.pop_back();
+        m_residentBytes -= segment.data.size() * sizeof(ValueType);
+        std::vector<ValueType>().swap(segment.data);
+        segment.resident = false;
+    }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(OutOfCoreMblockStore);
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
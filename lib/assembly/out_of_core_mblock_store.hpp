@@ -0,0 +1,203 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_out_of_core_mblock_store_hpp
+#define bempp_out_of_core_mblock_store_hpp
+
+#include "../common/common.hpp"
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "ahmed_aux_fwd.hpp"
+
+#include <fstream>
+#include <list>
+#include <string>
+#include <vector>
+#include <tbb/mutex.h>
+
+namespace Bempp
+{
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Storage of the mblocks of an H-matrix in a scratch file.
+ *
+ *  This class makes it possible to work with H-matrices whose mblocks do not
+ *  fit in memory. The mblocks are written to a scratch file as soon
+ *  as they have been assembled and read back on demand. The data of a
+ *  low-rank mblock U V^H are stored as two separate segments, U and V, since
+ *  matrix-vector products need them in different phases; the data of a
+ *  dense mblock form a single segment.
+ *
+ *  Segments that have been read from the file are kept in memory as long as
+ *  the total size of the resident segments does not exceed a given budget;
+ *  when it does, the least recently used segments are evicted. A segment is
+ *  pinned (i.e. cannot be evicted) between the calls to acquire() and
+ *  release(). Pinned segments may make the resident set temporarily exceed
+ *  the budget.
+ *
+ *  Only low-rank and general dense mblocks are supported.
+ *
+ *  All member functions are thread-safe. */
+template <typename ValueType>
+class OutOfCoreMblockStore
+{
+public:
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+
+    /** \brief Part of an mblock stored as a separate segment. */
+    enum Part {
+        /** \brief The factor U of a low-rank mblock U V^H or the data of a
+         *  dense mblock. */
+        FIRST_FACTOR = 0,
+        /** \brief The factor V of a low-rank mblock U V^H. */
+        SECOND_FACTOR = 1
+    };
+
+    /** \brief Constructor.
+     *
+     *  \param[in] directory
+     *    Directory in which the scratch file will be created. If empty, the
+     *    current working directory is used.
+     *  \param[in] blockCount
+     *    Number of mblocks (leaves of the block cluster tree) to be stored.
+     *  \param[in] memoryBudget
+     *    Maximum number of bytes occupied by segments kept in memory
+     *    after they have been released.
+     *
+     *  The scratch file is deleted when the object is destroyed. */
+    OutOfCoreMblockStore(const std::string& directory, size_t blockCount,
+                         size_t memoryBudget);
+
+    ~OutOfCoreMblockStore();
+
+    /** \brief Write the data of mblock no. \p index to the scratch file.
+     *
+     *  \p block must be a low-rank or general dense mblock. Each mblock may
+     *  be stored only once. */
+    void storeMblock(size_t index, AhmedMblock& block);
+
+    /** \brief Return a newly allocated copy of mblock no. \p index. */
+    AhmedMblock* loadMblock(size_t index) const;
+
+    /** \brief Return the number of mblocks. */
+    size_t blockCount() const { return m_blocks.size(); }
+
+    /** \brief Return true if mblock no. \p index has been stored. */
+    bool isStored(size_t index) const { return m_blocks[index].stored; }
+
+    /** \brief Return true if mblock no. \p index is stored in the low-rank
+     *  format. */
+    bool isLowRank(size_t index) const { return m_blocks[index].lowRank; }
+
+    /** \brief Return the rank of mblock no. \p index if it is stored in the
+     *  low-rank format, otherwise 0. */
+    unsigned int rank(size_t index) const { return m_blocks[index].rank; }
+
+    /** \brief Return the number of values in a part of mblock no. \p
+     *  index. */
+    size_t valueCount(size_t index, Part part) const {
+        return m_blocks[index].valueCount[part];
+    }
+
+    /** \brief Load (if necessary) and pin a part of mblock no. \p index.
+     *
+     *  Returns a pointer to the values of the requested part, stored in
+     *  column-major order, or a null pointer if this part is empty. The
+     *  pointer stays valid until the matching call to release(). */
+    const ValueType* acquire(size_t index, Part part) const;
+
+    /** \brief Unpin a part of mblock no. \p index pinned by acquire(). */
+    void release(size_t index, Part part) const;
+
+    /** \brief Return the number of bytes occupied by the mblocks in the
+     *  scratch file. */
+    size_t storedBytes() const;
+
+    /** \brief Return the number of bytes currently occupied by segments
+     *  kept in memory. */
+    size_t residentBytes() const;
+
+    /** \brief Return the memory budget. */
+    size_t memoryBudget() const { return m_memoryBudget; }
+
+    /** \brief Return the maximum rank of the low-rank mblocks. */
+    unsigned int maximumRank() const;
+
+    /** \brief Return the name of the scratch file. */
+    const std::string& fileName() const { return m_fileName; }
+
+private:
+    /** \cond PRIVATE */
+    OutOfCoreMblockStore(const OutOfCoreMblockStore&);
+    OutOfCoreMblockStore& operator=(const OutOfCoreMblockStore&);
+
+    struct BlockRecord
+    {
+        BlockRecord();
+
+        bool stored;
+        bool lowRank;
+        unsigned int n1, n2, rank;
+        std::streamoff offset[2];
+        size_t valueCount[2];
+    };
+
+    struct Segment
+    {
+        Segment();
+
+        std::vector<ValueType> data;
+        int pinCount;
+        bool resident;
+        // Position in m_unpinnedSegments; valid if resident and not pinned
+        std::list<size_t>::iterator lruPosition;
+    };
+
+    void writeValues(const ValueType* values, size_t count,
+                     std::streamoff& offset);
+    void readValues(std::streamoff offset, size_t count,
+                    ValueType* values) const;
+    void evictSegments() const;
+
+    std::string m_fileName;
+    mutable std::fstream m_file;
+    std::streamoff m_fileSize;
+    mutable tbb::mutex m_fileMutex;
+
+    std::vector<BlockRecord> m_blocks;
+    size_t m_memoryBudget;
+
+    // Segment 2 * i + p holds part p of mblock i
+    mutable std::vector<Segment> m_segments;
+    // Indices of resident unpinned segments, most recently used first
+    mutable std::list<size_t> m_unpinnedSegments;
+    mutable size_t m_residentBytes;
+    mutable tbb::mutex m_cacheMutex;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif // WITH_AHMED
+
+#endif
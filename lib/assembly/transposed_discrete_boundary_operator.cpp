@@ -108,6 +108,18 @@ void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
                       alpha, beta);
 }
 
+template <typename ValueType>
+void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInMultiVectorImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    m_operator->apply(TranspositionMode(trans ^ m_trans), x_in, y_inout,
+                      alpha, beta);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(TransposedDiscreteBoundaryOperator);
 
 } // namespace Bempp
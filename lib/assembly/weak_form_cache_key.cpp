@@ -0,0 +1,153 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "weak_form_cache_key.hpp"
+
+#include "aca_options.hpp"
+#include "assembly_options.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/types.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../grid/grid_view.hpp"
+#include "../space/space.hpp"
+
+#include <typeinfo>
+
+namespace Bempp
+{
+
+namespace
+{
+
+const boost::uint64_t FNV_OFFSET_BASIS = UINT64_C(14695981039346656037);
+const boost::uint64_t FNV_PRIME = UINT64_C(1099511628211);
+
+} // namespace
+
+WeakFormCacheKey::WeakFormCacheKey() :
+    m_hash(FNV_OFFSET_BASIS)
+{
+}
+
+void WeakFormCacheKey::addBytes(const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    boost::uint64_t hash = m_hash;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    m_hash = hash;
+    m_contents.append(reinterpret_cast<const char*>(data), size);
+}
+
+void WeakFormCacheKey::add(const std::string& value)
+{
+    add(value.size());
+    addBytes(value.data(), value.size());
+}
+
+void WeakFormCacheKey::addAcaOptions(const AcaOptions& acaOptions)
+{
+    add(acaOptions.eps);
+    add(acaOptions.eta);
+    add(acaOptions.minimumBlockSize);
+    add(acaOptions.maximumBlockSize);
+    add(acaOptions.maximumRank);
+    add(static_cast<int>(acaOptions.mode));
+    add(static_cast<int>(acaOptions.reactionToUnsupportedMode));
+    add(acaOptions.recompress);
+    add(acaOptions.outputPostscript);
+    add(acaOptions.outputFname);
+    add(acaOptions.scaling);
+    add(acaOptions.useAhmedAca);
+    add(acaOptions.firstClusterIndex);
+    add(acaOptions.outOfCore);
+    add(acaOptions.outOfCoreDirectory);
+    add(acaOptions.outOfCoreMemoryBudget);
+    add(static_cast<int>(acaOptions.storagePrecision));
+    add(acaOptions.globalAssemblyBeforeCompression);
+}
+
+void WeakFormCacheKey::addAssemblyOptions(const AssemblyOptions& options)
+{
+    add(static_cast<int>(options.isBlasEnabledInQuadrature()));
+    add(options.isQuadratureOrderUniformInEachCluster());
+}
+
+template <typename BasisFunctionType>
+void WeakFormCacheKey::addSpace(const Space<BasisFunctionType>& space)
+{
+    typedef typename Space<BasisFunctionType>::CoordinateType CoordinateType;
+
+    // The name of the dynamic type distinguishes e.g. piecewise constant
+    // and piecewise linear spaces defined on the same grid
+    add(std::string(typeid(space).name()));
+    add(space.globalDofCount());
+    add(space.flatLocalDofCount());
+
+    std::vector<Point3D<CoordinateType> > positions;
+    space.getGlobalDofPositions(positions);
+    add(positions);
+
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    std::vector<int> domainIndices;
+    space.gridView().getRawElementData(vertices, elementCorners, auxData,
+                                       domainIndices);
+    add(vertices);
+    add(elementCorners);
+    add(domainIndices);
+}
+
+std::string WeakFormCacheKey::toString() const
+{
+    const char digits[] = "0123456789abcdef";
+    std::string result(16, '0');
+    boost::uint64_t hash = m_hash;
+    for (int i = 15; i >= 0; --i) {
+        result[i] = digits[hash & 0xf];
+        hash >>= 4;
+    }
+    return result;
+}
+
+const std::string& WeakFormCacheKey::contents() const
+{
+    return m_contents;
+}
+
+std::string WeakFormCacheKey::fileName(const std::string& directory,
+                                       const std::string& extension) const
+{
+    std::string result = directory;
+    if (!result.empty() && result[result.size() - 1] != '/')
+        result += '/';
+    return result + toString() + "." + extension;
+}
+
+#define INSTANTIATE_ADD_SPACE(BASIS) \
+    template void WeakFormCacheKey::addSpace<BASIS>( \
+        const Space<BASIS>& space)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_ADD_SPACE);
+
+} // namespace Bempp
@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_weak_form_cache_key_hpp
+#define bempp_weak_form_cache_key_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace Bempp
+{
+
+/** \cond FORWARD_DECL */
+struct AcaOptions;
+class AssemblyOptions;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Content hash identifying a discrete weak form in the on-disk cache.
+ *
+ *  The key is built incrementally from the raw bytes of all data that the
+ *  weak form depends on. The assemblers add the type of matrix entries, the
+ *  test and trial spaces (their type, DOF counts and DOF positions, and the
+ *  geometry of their grids), the assembly and ACA parameters, the
+ *  signatures of the local assemblers (which identify the kernels, shapeset
+ *  transformations and integral of the operator and the quadrature accuracy
+ *  options) and a small sample of matrix entries evaluated with the local
+ *  assemblers. The sample accounts for the values of kernel parameters
+ *  (e.g. the wavenumber), which cannot be inspected directly.
+ *
+ *  The file name of a cache entry is derived from a 64-bit FNV-1a checksum
+ *  of these data, so it does not depend on the process or on the platform's
+ *  std::hash implementation. The data themselves, returned by contents(),
+ *  are stored in the cache file and compared with those of the key being
+ *  looked up, so that a hash collision cannot make the assemblers load the
+ *  wrong weak form.
+ *
+ *  \see AssemblyOptions::setWeakFormCacheDirectory(). */
+class WeakFormCacheKey
+{
+public:
+    /** \brief Construct an empty key. */
+    WeakFormCacheKey();
+
+    /** \brief Add \p size bytes starting at \p data to the key. */
+    void addBytes(const void* data, size_t size);
+
+    /** \brief Add the binary representation of \p value to the key. */
+    template <typename T>
+    void add(const T& value) {
+        addBytes(&value, sizeof(T));
+    }
+
+    /** \brief Add the length and contents of \p values to the key. */
+    template <typename T>
+    void add(const std::vector<T>& values) {
+        add(values.size());
+        if (!values.empty())
+            addBytes(&values[0], values.size() * sizeof(T));
+    }
+
+    /** \brief Add the dimensions and elements of \p values to the key. */
+    template <typename T>
+    void add(const arma::Mat<T>& values) {
+        add(values.n_rows);
+        add(values.n_cols);
+        addBytes(values.memptr(), values.n_elem * sizeof(T));
+    }
+
+    /** \brief Add the length and characters of \p value to the key. */
+    void add(const std::string& value);
+
+    /** \brief Add the name of the type \p T to the key. */
+    template <typename T>
+    void addType() {
+        add(std::string(typeid(T).name()));
+    }
+
+    /** \brief Add the parameters of ACA to the key.
+     *
+     *  All the fields of \p acaOptions are taken into account, including
+     *  those that only control diagnostic output, so that no field
+     *  influencing the assembled H-matrix can be overlooked. */
+    void addAcaOptions(const AcaOptions& acaOptions);
+
+    /** \brief Add the assembly options influencing the values of matrix
+     *  entries to the key.
+     *
+     *  ACA parameters are not included; add them with addAcaOptions(). */
+    void addAssemblyOptions(const AssemblyOptions& options);
+
+    /** \brief Add the type, DOF counts and DOF positions of \p space and the
+     *  vertices and elements of its grid to the key. */
+    template <typename BasisFunctionType>
+    void addSpace(const Space<BasisFunctionType>& space);
+
+    /** \brief Return the checksum of the key as a string of 16 hexadecimal
+     *  digits. */
+    std::string toString() const;
+
+    /** \brief Return all the data added to the key, concatenated. */
+    const std::string& contents() const;
+
+    /** \brief Return the path of the cache file with the extension
+     *  \p extension corresponding to this key in the directory \p
+     *  directory. */
+    std::string fileName(const std::string& directory,
+                         const std::string& extension) const;
+
+private:
+    /** \cond PRIVATE */
+    boost::uint64_t m_hash;
+    std::string m_contents;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -23,6 +23,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 namespace Fiber
 {
@@ -30,6 +31,24 @@ namespace Fiber
 namespace
 {
 
+// Write the quadrature options in a form that distinguishes relative and
+// absolute orders: only relative orders depend on the default order
+void writeQuadratureOptions(std::ostream& out, const QuadratureOptions& opts)
+{
+    out << opts.quadratureOrder(0) << "/" << opts.quadratureOrder(1);
+}
+
+void writeQuadratureOptions(
+        std::ostream& out,
+        const std::vector<std::pair<double, QuadratureOptions> >& opts)
+{
+    for (size_t i = 0; i < opts.size(); ++i) {
+        out << opts[i].first << ":";
+        writeQuadratureOptions(out, opts[i].second);
+        out << ";";
+    }
+}
+
 struct LessOrEqual
 {
     bool operator()(const std::pair<double, QuadratureOptions>& first,
@@ -340,4 +359,17 @@ void AccuracyOptionsEx::setDoubleSingular(
         m_doubleSingular.setAbsoluteQuadratureOrder(accuracyOrder);
 }
 
+std::string AccuracyOptionsEx::toString() const
+{
+    std::ostringstream out;
+    out.precision(17);
+    out << "singleRegular=";
+    writeQuadratureOptions(out, m_singleRegular);
+    out << " doubleRegular=";
+    writeQuadratureOptions(out, m_doubleRegular);
+    out << " doubleSingular=";
+    writeQuadratureOptions(out, m_doubleSingular);
+    return out.str();
+}
+
 } // namespace Fiber
@@ -26,6 +26,7 @@
 #include "quadrature_options.hpp"
 
 #include <limits>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -347,6 +348,12 @@ public:
      *  above the default level. */
     void setDoubleSingular(int accuracyOrder, bool relativeToDefault = true);
 
+    /** \brief Return a textual representation of all the options.
+     *
+     *  Two objects with the same representation request the same quadrature
+     *  orders for all pairs of elements. */
+    std::string toString() const;
+
 private:
     /** \cond PRIVATE */
     std::vector<std::pair<double, QuadratureOptions> > m_singleRegular;
@@ -0,0 +1,216 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_chebyshev_box_interpolator_hpp
+#define fiber_chebyshev_box_interpolator_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Tensor-product Chebyshev interpolation in an axis-aligned box.
+ *
+ *  The interpolation nodes are the Chebyshev points of the first kind,
+ *  \p order of them along each side of the box. Sides of zero length (up to
+ *  rounding) get a single node, so that functions sampled on flat sets of
+ *  points are interpolated with the smallest possible number of nodes.
+ *
+ *  Nodes are numbered with the first coordinate varying fastest. */
+template <typename CoordinateType>
+class ChebyshevBoxInterpolator
+{
+public:
+    /** \brief Constructor.
+     *
+     *  \param[in] order Number of nodes along each nondegenerate side.
+     *  \param[in] dimension Number of coordinates (at most 3).
+     *  \param[in] lower Lower corner of the box.
+     *  \param[in] upper Upper corner of the box. */
+    ChebyshevBoxInterpolator(int order, int dimension,
+                             const CoordinateType* lower,
+                             const CoordinateType* upper);
+
+    /** \brief Number of interpolation nodes that would be used in the
+     *  box with corners \p lower and \p upper. */
+    static int nodeCount(int order, int dimension,
+                         const CoordinateType* lower,
+                         const CoordinateType* upper);
+
+    /** \brief Number of interpolation nodes. */
+    int nodeCount() const {
+        return m_nodes.n_cols;
+    }
+
+    /** \brief Coordinates of the interpolation nodes; the jth column
+     *  contains the coordinates of the jth node. */
+    const arma::Mat<CoordinateType>& nodes() const {
+        return m_nodes;
+    }
+
+    /** \brief Calculate the interpolation weights at \p points.
+     *
+     *  On output, \p result is a 2D array of dimensions (nodeCount(),
+     *  points.n_cols) such that the interpolant of a function f evaluated at
+     *  the jth point is the sum over i of result(i, j) f(node i). */
+    template <typename ValueType>
+    void weights(const arma::Mat<CoordinateType>& points,
+                 arma::Mat<ValueType>& result) const;
+
+private:
+    /** \cond PRIVATE */
+    static bool isDegenerate(int dimension, const CoordinateType* lower,
+                             const CoordinateType* upper, int d);
+
+    int m_dimension;
+    int m_counts[3];
+    CoordinateType m_lower[3];
+    CoordinateType m_upper[3];
+    // Chebyshev points on [-1, 1] (m_counts[d] first entries used)
+    std::vector<CoordinateType> m_referenceNodes;
+    arma::Mat<CoordinateType> m_nodes;
+    /** \endcond */
+};
+
+template <typename CoordinateType>
+bool ChebyshevBoxInterpolator<CoordinateType>::isDegenerate(
+        int dimension, const CoordinateType* lower,
+        const CoordinateType* upper, int d)
+{
+    CoordinateType diameter = 0.;
+    for (int i = 0; i < dimension; ++i)
+        diameter = std::max(diameter, upper[i] - lower[i]);
+    return upper[d] - lower[d] <= CoordinateType(1e-8) * diameter;
+}
+
+template <typename CoordinateType>
+int ChebyshevBoxInterpolator<CoordinateType>::nodeCount(
+        int order, int dimension,
+        const CoordinateType* lower, const CoordinateType* upper)
+{
+    int result = 1;
+    for (int d = 0; d < dimension; ++d)
+        if (!isDegenerate(dimension, lower, upper, d))
+            result *= order;
+    return result;
+}
+
+template <typename CoordinateType>
+ChebyshevBoxInterpolator<CoordinateType>::ChebyshevBoxInterpolator(
+        int order, int dimension,
+        const CoordinateType* lower, const CoordinateType* upper) :
+    m_dimension(dimension)
+{
+    if (order < 1)
+        throw std::invalid_argument(
+                "ChebyshevBoxInterpolator::ChebyshevBoxInterpolator(): "
+                "order must be positive");
+    if (dimension < 1 || dimension > 3)
+        throw std::invalid_argument(
+                "ChebyshevBoxInterpolator::ChebyshevBoxInterpolator(): "
+                "dimension must be between 1 and 3");
+
+    m_referenceNodes.resize(order);
+    for (int j = 0; j < order; ++j)
+        m_referenceNodes[j] = std::cos(M_PI * (2 * j + 1) / (2 * order));
+
+    int count = 1;
+    for (int d = 0; d < 3; ++d) {
+        m_counts[d] = 1;
+        m_lower[d] = m_upper[d] = 0.;
+    }
+    for (int d = 0; d < dimension; ++d) {
+        m_lower[d] = lower[d];
+        m_upper[d] = upper[d];
+        if (!isDegenerate(dimension, lower, upper, d))
+            m_counts[d] = order;
+        count *= m_counts[d];
+    }
+
+    m_nodes.set_size(dimension, count);
+    for (int n = 0; n < count; ++n) {
+        int rest = n;
+        for (int d = 0; d < dimension; ++d) {
+            const int j = rest % m_counts[d];
+            rest /= m_counts[d];
+            const CoordinateType center = 0.5 * (m_lower[d] + m_upper[d]);
+            m_nodes(d, n) = m_counts[d] == 1 ?
+                        center :
+                        center + 0.5 * (m_upper[d] - m_lower[d]) *
+                        m_referenceNodes[j];
+        }
+    }
+}
+
+template <typename CoordinateType>
+template <typename ValueType>
+void ChebyshevBoxInterpolator<CoordinateType>::weights(
+        const arma::Mat<CoordinateType>& points,
+        arma::Mat<ValueType>& result) const
+{
+    const int pointCount = points.n_cols;
+    const int count = m_nodes.n_cols;
+    result.set_size(count, pointCount);
+
+    // Values of the one-dimensional Lagrange polynomials at the coordinates
+    // of the current point
+    std::vector<CoordinateType> basis[3];
+    for (int d = 0; d < m_dimension; ++d)
+        basis[d].resize(m_counts[d]);
+
+    for (int p = 0; p < pointCount; ++p) {
+        for (int d = 0; d < m_dimension; ++d) {
+            if (m_counts[d] == 1) {
+                basis[d][0] = 1.;
+                continue;
+            }
+            const CoordinateType t =
+                    (2. * points(d, p) - (m_lower[d] + m_upper[d])) /
+                    (m_upper[d] - m_lower[d]);
+            for (int j = 0; j < m_counts[d]; ++j) {
+                CoordinateType value = 1.;
+                for (int m = 0; m < m_counts[d]; ++m)
+                    if (m != j)
+                        value *= (t - m_referenceNodes[m]) /
+                                (m_referenceNodes[j] - m_referenceNodes[m]);
+                basis[d][j] = value;
+            }
+        }
+        for (int n = 0; n < count; ++n) {
+            int rest = n;
+            CoordinateType value = 1.;
+            for (int d = 0; d < m_dimension; ++d) {
+                value *= basis[d][rest % m_counts[d]];
+                rest /= m_counts[d];
+            }
+            result(n, p) = value;
+        }
+    }
+}
+
+} // namespace Fiber
+
+#endif
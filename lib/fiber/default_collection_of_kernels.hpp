@@ -77,6 +77,20 @@ namespace Fiber
         // defined, the kernel behaves as if its estimated magnitude was 1
         // everywhere.
         CoordinateType estimateRelativeScale(CoordinateType distance) const;
+
+        // (Optional)
+        // Evaluate the kernels at all pairs made of a point from the block
+        // testGeomData and the single point trialGeomData. The (j, k)th
+        // element of the tensor being the value of i'th kernel at the p'th
+        // point of the block should be written to
+        // result[i][j + kernelRowCount(i) * (k + kernelColCount(i) * p)].
+        // If this function is defined, evaluateOnGrid() uses it in preference
+        // to evaluate(), which allows the implementation to vectorise the
+        // computations over test points.
+        void evaluateBatch(
+                const GeometricalDataBlock<CoordinateType>& testGeomData,
+                const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+                ValueType* const* result) const;
     };
     \endcode
 
@@ -26,7 +26,9 @@
 #include "collection_of_3d_arrays.hpp"
 #include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 
+#include <algorithm>
 #include <boost/utility/enable_if.hpp>
 #include <stdexcept>
 
@@ -45,6 +47,22 @@ namespace Fiber
 {
 
 FIBER_HAS_MEM_FUNC(estimateRelativeScale, hasEstimateRelativeScale);
+FIBER_HAS_MEM_FUNC(evaluateBatch, hasEvaluateBatch);
+
+/** \brief Maximum number of kernels in a collection for which the batched
+ *  evaluation path of DefaultCollectionOfKernels is used. */
+const int MAX_BATCHED_KERNEL_COUNT = 4;
+
+template <typename Functor>
+struct EvaluateBatchSignature
+{
+    typedef typename Functor::CoordinateType CoordinateType;
+    typedef typename Functor::ValueType ValueType;
+    typedef void (Functor::*type)(
+            const GeometricalDataBlock<CoordinateType>&,
+            const ConstGeometricalDataSlice<CoordinateType>&,
+            ValueType* const*) const;
+};
 
 //template <class Type>
 //class TypeHasEstimateRelativeScale
@@ -111,6 +129,79 @@ estimateRelativeScaleInternal(const Functor& functor,
 //   return 1.;
 //}
 
+template <typename Functor>
+void evaluateOnGridPointwise(
+        const Functor& functor,
+        const GeometricalData<typename Functor::CoordinateType>& testGeomData,
+        const GeometricalData<typename Functor::CoordinateType>& trialGeomData,
+        CollectionOf4dArrays<typename Functor::ValueType>& result)
+{
+    const size_t testPointCount = testGeomData.pointCount();
+    const size_t trialPointCount = trialGeomData.pointCount();
+#ifdef  __INTEL_COMPILER
+#pragma ivdep
+#endif
+    for (size_t trialIndex = 0; trialIndex < trialPointCount; ++trialIndex)
+        for (size_t testIndex = 0; testIndex < testPointCount; ++testIndex)
+            functor.evaluate(testGeomData.const_slice(testIndex),
+                             trialGeomData.const_slice(trialIndex),
+                             result.slice(testIndex, trialIndex).self());
+}
+
+template <typename Functor>
+typename boost::disable_if<hasEvaluateBatch<Functor,
+                           typename EvaluateBatchSignature<Functor>::type> >::type
+evaluateOnGridInternal(
+        const Functor& functor,
+        const GeometricalData<typename Functor::CoordinateType>& testGeomData,
+        const GeometricalData<typename Functor::CoordinateType>& trialGeomData,
+        CollectionOf4dArrays<typename Functor::ValueType>& result)
+{
+    evaluateOnGridPointwise(functor, testGeomData, trialGeomData, result);
+}
+
+// Test points are copied block by block into structure-of-arrays storage;
+// each block is then passed to Functor::evaluateBatch() together with each
+// trial point in turn. For a fixed trial point, the values of each kernel at
+// consecutive test points are stored contiguously in result.
+template <typename Functor>
+typename boost::enable_if<hasEvaluateBatch<Functor,
+                          typename EvaluateBatchSignature<Functor>::type> >::type
+evaluateOnGridInternal(
+        const Functor& functor,
+        const GeometricalData<typename Functor::CoordinateType>& testGeomData,
+        const GeometricalData<typename Functor::CoordinateType>& trialGeomData,
+        CollectionOf4dArrays<typename Functor::ValueType>& result)
+{
+    typedef typename Functor::CoordinateType CoordinateType;
+    typedef typename Functor::ValueType ValueType;
+
+    const int kernelCount = functor.kernelCount();
+    if (testGeomData.dimWorld() != 3 || trialGeomData.dimWorld() != 3 ||
+            kernelCount > MAX_BATCHED_KERNEL_COUNT) {
+        evaluateOnGridPointwise(functor, testGeomData, trialGeomData, result);
+        return;
+    }
+
+    const int testPointCount = testGeomData.pointCount();
+    const int trialPointCount = trialGeomData.pointCount();
+    GeometricalDataBlock<CoordinateType> testBlock;
+    ValueType* blockResult[MAX_BATCHED_KERNEL_COUNT];
+    for (int start = 0; start < testPointCount;
+         start += GEOMETRICAL_DATA_BLOCK_SIZE) {
+        const int count = std::min(GEOMETRICAL_DATA_BLOCK_SIZE,
+                                   testPointCount - start);
+        testBlock.load(testGeomData, start, count);
+        for (int trialIndex = 0; trialIndex < trialPointCount; ++trialIndex) {
+            for (int k = 0; k < kernelCount; ++k)
+                blockResult[k] = &result[k](0, 0, start, trialIndex);
+            functor.evaluateBatch(testBlock,
+                                  trialGeomData.const_slice(trialIndex),
+                                  blockResult);
+        }
+    }
+}
+
 template <typename Functor>
 void DefaultCollectionOfKernels<Functor>::addGeometricalDependencies(
         size_t& testGeomDeps, size_t& trialGeomDeps) const
@@ -155,14 +246,7 @@ void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
                            m_functor.kernelColCount(k),
                            testPointCount,
                            trialPointCount);
-#ifdef  __INTEL_COMPILER
-#pragma ivdep
-#endif
-    for (size_t trialIndex = 0; trialIndex < trialPointCount; ++trialIndex)
-        for (size_t testIndex = 0; testIndex < testPointCount; ++testIndex)
-            m_functor.evaluate(testGeomData.const_slice(testIndex),
-                               trialGeomData.const_slice(trialIndex),
-                               result.slice(testIndex, trialIndex).self());
+    evaluateOnGridInternal(m_functor, testGeomData, trialGeomData, result);
 }
 
 template <typename Functor>
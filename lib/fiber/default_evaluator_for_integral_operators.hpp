@@ -78,14 +78,42 @@ public:
                           const arma::Mat<CoordinateType>& points,
                           arma::Mat<ResultType>& result) const;
 
+    virtual void evaluateHierarchically(
+            const arma::Mat<CoordinateType>& points,
+            const HierarchicalEvaluationOptions& options,
+            arma::Mat<ResultType>& result) const;
+
+    virtual void applyNearFieldCorrections(
+            const arma::Mat<CoordinateType>& points,
+            const NearFieldEvaluationOptions& options,
+            arma::Mat<ResultType>& result) const;
+
 private:
+    /** \cond PRIVATE */
+    typedef typename GeometryFactory::Geometry Geometry;
+    class NearFieldCorrectionLoopBody;
+
     void cacheTrialData();
     void calcTrialData(
             Region region,
             int kernelTrialGeomDeps,
             GeometricalData<CoordinateType>& trialGeomData,
             CollectionOf2dArrays<ResultType>& trialExprValues,
+            std::vector<CoordinateType>& weights,
+            std::vector<int>& elementOffsets) const;
+    void calcElementTrialData(
+            int elementIndex,
+            const arma::Mat<CoordinateType>& localQuadPoints,
+            const std::vector<CoordinateType>& quadWeights,
+            Geometry& geometry,
+            GeometricalData<CoordinateType>& trialGeomData,
+            CollectionOf2dArrays<ResultType>& trialTransfValues,
             std::vector<CoordinateType>& weights) const;
+    void calcFarFieldQuadratureRule(
+            int elementIndex,
+            arma::Mat<CoordinateType>& localQuadPoints,
+            std::vector<CoordinateType>& quadWeights) const;
+    /** \endcond */
 
 private:
     const shared_ptr<const GeometryFactory> m_geometryFactory;
@@ -101,12 +129,14 @@ private:
                          BasisFunctionType> > m_quadDescSelector;
     const shared_ptr<const SingleQuadratureRuleFamily<CoordinateType> > m_quadRuleFamily;
 
-    Fiber::GeometricalData<CoordinateType> m_nearFieldTrialGeomData;
+    int m_kernelTrialGeomDeps;
     Fiber::GeometricalData<CoordinateType> m_farFieldTrialGeomData;
-    CollectionOf2dArrays<ResultType> m_nearFieldTrialTransfValues;
     CollectionOf2dArrays<ResultType> m_farFieldTrialTransfValues;
-    std::vector<CoordinateType> m_nearFieldWeights;
     std::vector<CoordinateType> m_farFieldWeights;
+    // Quadrature points of element e occupy columns
+    // [m_farFieldElementOffsets[e], m_farFieldElementOffsets[e + 1])
+    // of the far-field arrays
+    std::vector<int> m_farFieldElementOffsets;
 };
 
 } // namespace Fiber
@@ -23,21 +23,31 @@
 #include "../common/common.hpp"
 
 #include "basis_data.hpp"
+#include "chebyshev_box_interpolator.hpp"
 #include "collection_of_basis_transformations.hpp"
 #include "geometrical_data.hpp"
+#include "hierarchical_evaluation_options.hpp"
 #include "collection_of_kernels.hpp"
 #include "collection_of_2d_arrays.hpp"
 #include "collection_of_3d_arrays.hpp"
 #include "collection_of_4d_arrays.hpp"
+#include "default_local_assembler_for_operators_on_surfaces_utilities.hpp"
+#include "element_sizes_and_centers.hpp"
+#include "execution_context.hpp"
 #include "kernel_trial_integral.hpp"
+#include "near_field_evaluation_options.hpp"
 #include "numerical_quadrature.hpp"
 #include "opencl_handler.hpp"
+#include "point_cluster_tree.hpp"
 #include "raw_grid_geometry.hpp"
 #include "serial_blas_region.hpp"
 #include "shapeset.hpp"
 
-#include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <tbb/blocked_range.h>
 
 namespace Fiber
 {
@@ -101,6 +111,420 @@ private:
     size_t m_outputComponentCount;
 };
 
+// Calculate the values and/or derivatives of the function with expansion
+// coefficients localCoefficients in the basis whose data are stored in
+// basisData
+template <typename BasisFunctionType, typename ResultType>
+void evaluateArgument(size_t basisDeps,
+                      const BasisData<BasisFunctionType>& basisData,
+                      const std::vector<ResultType>& localCoefficients,
+                      BasisData<ResultType>& argumentData)
+{
+    if (basisDeps & VALUES)
+    {
+        argumentData.values.set_size(basisData.values.extent(0),
+                                     1, // just one function
+                                     basisData.values.extent(2));
+        std::fill(argumentData.values.begin(),
+                  argumentData.values.end(), 0.);
+        assert(localCoefficients.size() == basisData.values.extent(1));
+        for (size_t point = 0; point < basisData.values.extent(2); ++point)
+            for (size_t dim = 0; dim < basisData.values.extent(0); ++dim)
+                for (size_t fun = 0; fun < basisData.values.extent(1); ++fun)
+                    argumentData.values(dim, 0, point) +=
+                            basisData.values(dim, fun, point) *
+                            localCoefficients[fun];
+    }
+    if (basisDeps & DERIVATIVES)
+    {
+        argumentData.derivatives.set_size(basisData.derivatives.extent(0),
+                                          basisData.derivatives.extent(1),
+                                          1, // just one function
+                                          basisData.derivatives.extent(3));
+        std::fill(argumentData.derivatives.begin(),
+                  argumentData.derivatives.end(), 0.);
+        assert(localCoefficients.size() == basisData.derivatives.extent(2));
+        for (size_t point = 0; point < basisData.derivatives.extent(3); ++point)
+            for (size_t dim = 0; dim < basisData.derivatives.extent(1); ++dim)
+                for (size_t comp = 0; comp < basisData.derivatives.extent(0); ++comp)
+                    for (size_t fun = 0; fun < basisData.derivatives.extent(2); ++fun)
+                        argumentData.derivatives(comp, dim, 0, point) +=
+                            basisData.derivatives(comp, dim, fun, point) *
+                            localCoefficients[fun];
+    }
+}
+
+// Copy the trial data of the quadrature points indices[0], ...,
+// indices[count - 1] into the "gathered" arrays
+template <typename CoordinateType, typename ResultType>
+void gatherTrialData(
+        const GeometricalData<CoordinateType>& geomData,
+        const CollectionOf2dArrays<ResultType>& transfValues,
+        const std::vector<CoordinateType>& weights,
+        const int* indices, int count,
+        GeometricalData<CoordinateType>& gatheredGeomData,
+        CollectionOf2dArrays<ResultType>& gatheredTransfValues,
+        std::vector<CoordinateType>& gatheredWeights)
+{
+    if (!geomData.globals.is_empty()) {
+        gatheredGeomData.globals.set_size(geomData.globals.n_rows, count);
+        for (int i = 0; i < count; ++i)
+            for (size_t d = 0; d < geomData.globals.n_rows; ++d)
+                gatheredGeomData.globals(d, i) = geomData.globals(d, indices[i]);
+    }
+    if (!geomData.integrationElements.is_empty()) {
+        gatheredGeomData.integrationElements.set_size(count);
+        for (int i = 0; i < count; ++i)
+            gatheredGeomData.integrationElements(i) =
+                    geomData.integrationElements(indices[i]);
+    }
+    if (!geomData.normals.is_empty()) {
+        gatheredGeomData.normals.set_size(geomData.normals.n_rows, count);
+        for (int i = 0; i < count; ++i)
+            for (size_t d = 0; d < geomData.normals.n_rows; ++d)
+                gatheredGeomData.normals(d, i) = geomData.normals(d, indices[i]);
+    }
+    if (!geomData.jacobiansTransposed.is_empty()) {
+        const _3dArray<CoordinateType>& src = geomData.jacobiansTransposed;
+        _3dArray<CoordinateType>& dest = gatheredGeomData.jacobiansTransposed;
+        dest.set_size(src.extent(0), src.extent(1), count);
+        for (int i = 0; i < count; ++i)
+            for (size_t c = 0; c < src.extent(1); ++c)
+                for (size_t r = 0; r < src.extent(0); ++r)
+                    dest(r, c, i) = src(r, c, indices[i]);
+    }
+    if (!geomData.jacobianInversesTransposed.is_empty()) {
+        const _3dArray<CoordinateType>& src = geomData.jacobianInversesTransposed;
+        _3dArray<CoordinateType>& dest = gatheredGeomData.jacobianInversesTransposed;
+        dest.set_size(src.extent(0), src.extent(1), count);
+        for (int i = 0; i < count; ++i)
+            for (size_t c = 0; c < src.extent(1); ++c)
+                for (size_t r = 0; r < src.extent(0); ++r)
+                    dest(r, c, i) = src(r, c, indices[i]);
+    }
+    gatheredGeomData.domainIndex = geomData.domainIndex;
+
+    gatheredTransfValues.set_size(transfValues.size());
+    for (size_t transf = 0; transf < transfValues.size(); ++transf) {
+        const size_t dimCount = transfValues[transf].extent(0);
+        gatheredTransfValues[transf].set_size(dimCount, count);
+        for (int i = 0; i < count; ++i)
+            for (size_t dim = 0; dim < dimCount; ++dim)
+                gatheredTransfValues[transf](dim, i) =
+                        transfValues[transf](dim, indices[i]);
+    }
+
+    gatheredWeights.resize(count);
+    for (int i = 0; i < count; ++i)
+        gatheredWeights[i] = weights[indices[i]];
+}
+
+// Calculates the potential generated by clusters of trial quadrature points
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class ClusterPotentialCalculator
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    ClusterPotentialCalculator(
+            const GeometricalData<CoordinateType>& trialGeomData,
+            const CollectionOf2dArrays<ResultType>& trialTransfValues,
+            const std::vector<CoordinateType>& weights,
+            const PointClusterTree<CoordinateType>& sourceTree,
+            const CollectionOfKernels<KernelType>& kernels,
+            const KernelTrialIntegral<BasisFunctionType, KernelType, ResultType>& integral) :
+        m_trialGeomData(trialGeomData), m_trialTransfValues(trialTransfValues),
+        m_weights(weights), m_sourceTree(sourceTree),
+        m_kernels(kernels), m_integral(integral)
+    {
+    }
+
+    // Add to 'result' the potential generated at the points stored in
+    // evalPointGeomData.globals by the quadrature points belonging to
+    // the source cluster 'sourceNode'
+    void addPotential(const GeometricalData<CoordinateType>& evalPointGeomData,
+                      int sourceNode, arma::Mat<ResultType>& result) const {
+        const int pointCount = evalPointGeomData.globals.n_cols;
+        const int componentCount = result.n_rows;
+        const int begin = m_sourceTree.node(sourceNode).begin;
+        const int end = m_sourceTree.node(sourceNode).end;
+        const std::vector<int>& permutation = m_sourceTree.permutation();
+
+        // Process the sources in chunks, as in evaluate(), to avoid
+        // creating too large arrays of kernel values
+        const int chunkSize = std::max<size_t>(
+                    1, 10 * 1024 * 1024 / (pointCount * sizeof(KernelType)));
+        GeometricalData<CoordinateType> sourceGeomData;
+        CollectionOf2dArrays<ResultType> sourceTransfValues;
+        std::vector<CoordinateType> sourceWeights;
+        CollectionOf4dArrays<KernelType> kernelValues;
+        arma::Mat<ResultType> chunkResult(componentCount, pointCount);
+        for (int start = begin; start < end; start += chunkSize) {
+            const int count = std::min(chunkSize, end - start);
+            gatherTrialData(m_trialGeomData, m_trialTransfValues, m_weights,
+                            &permutation[start], count,
+                            sourceGeomData, sourceTransfValues, sourceWeights);
+            m_kernels.evaluateOnGrid(evalPointGeomData, sourceGeomData,
+                                     kernelValues);
+            _2dArray<ResultType> chunkResultView(componentCount, pointCount,
+                                                 chunkResult.memptr());
+            m_integral.evaluate(sourceGeomData, kernelValues,
+                                sourceTransfValues, sourceWeights,
+                                chunkResultView);
+            result += chunkResult;
+        }
+    }
+
+private:
+    const GeometricalData<CoordinateType>& m_trialGeomData;
+    const CollectionOf2dArrays<ResultType>& m_trialTransfValues;
+    const std::vector<CoordinateType>& m_weights;
+    const PointClusterTree<CoordinateType>& m_sourceTree;
+    const CollectionOfKernels<KernelType>& m_kernels;
+    const KernelTrialIntegral<BasisFunctionType, KernelType, ResultType>& m_integral;
+};
+
+template <typename CoordinateType>
+void addSourceToLeaves(const PointClusterTree<CoordinateType>& targetTree,
+                       int targetNode, int sourceNode,
+                       std::vector<std::vector<int> >& nearSources)
+{
+    const typename PointClusterTree<CoordinateType>::Node& node =
+            targetTree.node(targetNode);
+    if (node.isLeaf())
+        nearSources[targetNode].push_back(sourceNode);
+    else {
+        addSourceToLeaves(targetTree, node.firstChild, sourceNode, nearSources);
+        addSourceToLeaves(targetTree, node.secondChild, sourceNode, nearSources);
+    }
+}
+
+// Traverse the target and source trees simultaneously. On exit,
+// farSources[t] lists the source clusters whose potential is interpolated
+// in the target cluster t, and nearSources[t] (for leaves t only) the
+// source clusters whose potential is summed directly at the points of t.
+template <typename CoordinateType>
+void collectInteractions(const PointClusterTree<CoordinateType>& targetTree,
+                         int targetNode,
+                         const PointClusterTree<CoordinateType>& sourceTree,
+                         int sourceNode,
+                         const HierarchicalEvaluationOptions& options,
+                         std::vector<std::vector<int> >& farSources,
+                         std::vector<std::vector<int> >& nearSources)
+{
+    typedef typename PointClusterTree<CoordinateType>::Node Node;
+    const Node& target = targetTree.node(targetNode);
+    const Node& source = sourceTree.node(sourceNode);
+    const CoordinateType targetDiameter = targetTree.diameter(targetNode);
+
+    if (targetDiameter <= options.eta *
+            targetTree.distance(targetNode, sourceTree, sourceNode)) {
+        // Interpolation only pays off if the target cluster contains more
+        // points than interpolation nodes
+        if (target.size() > ChebyshevBoxInterpolator<CoordinateType>::nodeCount(
+                    options.interpolationOrder, targetTree.dimension(),
+                    target.lower, target.upper))
+            farSources[targetNode].push_back(sourceNode);
+        else
+            addSourceToLeaves(targetTree, targetNode, sourceNode, nearSources);
+        return;
+    }
+
+    if (target.isLeaf() && source.isLeaf())
+        nearSources[targetNode].push_back(sourceNode);
+    else if (target.isLeaf() ||
+             (!source.isLeaf() &&
+              sourceTree.diameter(sourceNode) > targetDiameter)) {
+        collectInteractions(targetTree, targetNode, sourceTree, source.firstChild,
+                            options, farSources, nearSources);
+        collectInteractions(targetTree, targetNode, sourceTree, source.secondChild,
+                            options, farSources, nearSources);
+    } else {
+        collectInteractions(targetTree, target.firstChild, sourceTree, sourceNode,
+                            options, farSources, nearSources);
+        collectInteractions(targetTree, target.secondChild, sourceTree, sourceNode,
+                            options, farSources, nearSources);
+    }
+}
+
+// Evaluates the potential at the interpolation nodes of target clusters
+// due to their far source clusters
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class FarFieldLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef ClusterPotentialCalculator<BasisFunctionType, KernelType, ResultType>
+    Calculator;
+
+    FarFieldLoopBody(const Calculator& calculator,
+                     const PointClusterTree<CoordinateType>& targetTree,
+                     const std::vector<int>& targetNodes,
+                     const std::vector<std::vector<int> >& farSources,
+                     int interpolationOrder, int componentCount,
+                     std::vector<arma::Mat<ResultType> >& nodeValues) :
+        m_calculator(calculator), m_targetTree(targetTree),
+        m_targetNodes(targetNodes), m_farSources(farSources),
+        m_interpolationOrder(interpolationOrder),
+        m_componentCount(componentCount), m_nodeValues(nodeValues)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        GeometricalData<CoordinateType> nodeGeomData;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int t = m_targetNodes[i];
+            const typename PointClusterTree<CoordinateType>::Node& target =
+                    m_targetTree.node(t);
+            ChebyshevBoxInterpolator<CoordinateType> interpolator(
+                        m_interpolationOrder, m_targetTree.dimension(),
+                        target.lower, target.upper);
+            nodeGeomData.globals = interpolator.nodes();
+            arma::Mat<ResultType>& values = m_nodeValues[t];
+            values.zeros(m_componentCount, interpolator.nodeCount());
+            for (size_t s = 0; s < m_farSources[t].size(); ++s)
+                m_calculator.addPotential(nodeGeomData, m_farSources[t][s],
+                                          values);
+        }
+    }
+
+private:
+    const Calculator& m_calculator;
+    const PointClusterTree<CoordinateType>& m_targetTree;
+    const std::vector<int>& m_targetNodes;
+    const std::vector<std::vector<int> >& m_farSources;
+    int m_interpolationOrder;
+    int m_componentCount;
+    std::vector<arma::Mat<ResultType> >& m_nodeValues;
+};
+
+// Adds the interpolant of the potential known at the nodes of each parent
+// cluster to the values at the nodes of its child
+template <typename ResultType>
+class DownwardPassLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    DownwardPassLoopBody(const PointClusterTree<CoordinateType>& targetTree,
+                         const std::vector<int>& childNodes,
+                         int interpolationOrder,
+                         std::vector<arma::Mat<ResultType> >& nodeValues) :
+        m_targetTree(targetTree), m_childNodes(childNodes),
+        m_interpolationOrder(interpolationOrder), m_nodeValues(nodeValues)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        typedef typename PointClusterTree<CoordinateType>::Node Node;
+        arma::Mat<ResultType> weights;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int c = m_childNodes[i];
+            const Node& child = m_targetTree.node(c);
+            const Node& parent = m_targetTree.node(child.parent);
+            const int dim = m_targetTree.dimension();
+            ChebyshevBoxInterpolator<CoordinateType> parentInterpolator(
+                        m_interpolationOrder, dim, parent.lower, parent.upper);
+            ChebyshevBoxInterpolator<CoordinateType> childInterpolator(
+                        m_interpolationOrder, dim, child.lower, child.upper);
+            parentInterpolator.weights(childInterpolator.nodes(), weights);
+            const arma::Mat<ResultType>& parentValues =
+                    m_nodeValues[child.parent];
+            arma::Mat<ResultType>& childValues = m_nodeValues[c];
+            if (childValues.is_empty())
+                childValues = parentValues * weights;
+            else
+                childValues += parentValues * weights;
+        }
+    }
+
+private:
+    const PointClusterTree<CoordinateType>& m_targetTree;
+    const std::vector<int>& m_childNodes;
+    int m_interpolationOrder;
+    std::vector<arma::Mat<ResultType> >& m_nodeValues;
+};
+
+// Evaluates the potential at the points of the leaves of the target tree
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class LeafEvaluationLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef ClusterPotentialCalculator<BasisFunctionType, KernelType, ResultType>
+    Calculator;
+
+    LeafEvaluationLoopBody(const Calculator& calculator,
+                           const arma::Mat<CoordinateType>& points,
+                           const PointClusterTree<CoordinateType>& targetTree,
+                           const std::vector<int>& leaves,
+                           const std::vector<std::vector<int> >& nearSources,
+                           const std::vector<arma::Mat<ResultType> >& nodeValues,
+                           int interpolationOrder,
+                           arma::Mat<ResultType>& result) :
+        m_calculator(calculator), m_points(points), m_targetTree(targetTree),
+        m_leaves(leaves), m_nearSources(nearSources), m_nodeValues(nodeValues),
+        m_interpolationOrder(interpolationOrder), m_result(result)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const std::vector<int>& permutation = m_targetTree.permutation();
+        const int dim = m_targetTree.dimension();
+        GeometricalData<CoordinateType> leafGeomData;
+        arma::Mat<ResultType> leafResult, weights;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int t = m_leaves[i];
+            const typename PointClusterTree<CoordinateType>::Node& leaf =
+                    m_targetTree.node(t);
+            const int pointCount = leaf.size();
+            arma::Mat<CoordinateType>& leafPoints = leafGeomData.globals;
+            leafPoints.set_size(dim, pointCount);
+            for (int p = 0; p < pointCount; ++p)
+                for (int d = 0; d < dim; ++d)
+                    leafPoints(d, p) = m_points(d, permutation[leaf.begin + p]);
+
+            leafResult.zeros(m_result.n_rows, pointCount);
+            for (size_t s = 0; s < m_nearSources[t].size(); ++s)
+                m_calculator.addPotential(leafGeomData, m_nearSources[t][s],
+                                          leafResult);
+            if (!m_nodeValues[t].is_empty()) {
+                ChebyshevBoxInterpolator<CoordinateType> interpolator(
+                            m_interpolationOrder, dim, leaf.lower, leaf.upper);
+                interpolator.weights(leafPoints, weights);
+                leafResult += m_nodeValues[t] * weights;
+            }
+
+            // Each point belongs to exactly one leaf
+            for (int p = 0; p < pointCount; ++p)
+                m_result.col(permutation[leaf.begin + p]) = leafResult.col(p);
+        }
+    }
+
+private:
+    const Calculator& m_calculator;
+    const arma::Mat<CoordinateType>& m_points;
+    const PointClusterTree<CoordinateType>& m_targetTree;
+    const std::vector<int>& m_leaves;
+    const std::vector<std::vector<int> >& m_nearSources;
+    const std::vector<arma::Mat<ResultType> >& m_nodeValues;
+    int m_interpolationOrder;
+    arma::Mat<ResultType>& m_result;
+};
+
+// Part of a reference element: the image of the reference element of the
+// same type (the unit triangle, square or segment) under the affine map
+// x -> origin + x[0] * edge0 + x[1] * edge1
+template <typename CoordinateType>
+struct SubElement
+{
+    CoordinateType origin[2];
+    CoordinateType edge0[2];
+    CoordinateType edge1[2];
+    // Ratio of the measure of the subelement to that of the reference element
+    CoordinateType measure;
+};
+
 } // namespace
 
 template <typename BasisFunctionType, typename KernelType,
@@ -163,17 +587,10 @@ ResultType, GeometryFactory>::evaluate(
     result.fill(0.);
 
     const GeometricalData<CoordinateType>& trialGeomData =
-            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
-                m_nearFieldTrialGeomData :
-                m_farFieldTrialGeomData;
+            m_farFieldTrialGeomData;
     const CollectionOf2dArrays<ResultType>& trialTransfValues =
-            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
-                m_nearFieldTrialTransfValues :
-                m_farFieldTrialTransfValues;
-    const std::vector<CoordinateType>& weights =
-            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
-                m_nearFieldWeights :
-                m_farFieldWeights;
+            m_farFieldTrialTransfValues;
+    const std::vector<CoordinateType>& weights = m_farFieldWeights;
 
     // Do things in chunks -- in order to avoid creating
     // too large arrays of kernel values
@@ -186,25 +603,21 @@ ResultType, GeometryFactory>::evaluate(
         std::max(1ul, 10 * 1024 * 1024 / kernelValuesSizePerEvalPoint);
     const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
 
-    int maxThreadCount = 1;
-    if (!m_parallelizationOptions.isOpenClEnabled()) {
-        if (m_parallelizationOptions.maxThreadCount() ==
-                ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = m_parallelizationOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
     typedef EvaluationLoopBody<
             BasisFunctionType, KernelType, ResultType> Body;
     {
         Fiber::SerialBlasRegion region;
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
-                          Body(chunkSize,
-                               points, trialGeomData, trialTransfValues, weights,
-                               *m_kernels, *m_integral, result));
+        ExecutionContext::instance().parallelFor(
+                    m_parallelizationOptions,
+                    tbb::blocked_range<size_t>(0, chunkCount),
+                    Body(chunkSize,
+                         points, trialGeomData, trialTransfValues, weights,
+                         *m_kernels, *m_integral, result));
     }
 
+    if (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD)
+        applyNearFieldCorrections(points, NearFieldEvaluationOptions(), result);
+
 //    // Old serial version
 //    CollectionOf4dArrays<KernelType> kernelValues;
 //    GeometricalData<CoordinateType> evalPointGeomData;
@@ -223,6 +636,116 @@ ResultType, GeometryFactory>::evaluate(
 //    }
 }
 
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::evaluateHierarchically(
+        const arma::Mat<CoordinateType>& points,
+        const HierarchicalEvaluationOptions& options,
+        arma::Mat<ResultType>& result) const
+{
+    if (options.interpolationOrder < 1)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::evaluateHierarchically(): "
+                "interpolationOrder must be positive");
+    if (options.eta <= 0.)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::evaluateHierarchically(): "
+                "eta must be positive");
+    if (options.maximumLeafSize < 1)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::evaluateHierarchically(): "
+                "maximumLeafSize must be positive");
+
+    const size_t pointCount = points.n_cols;
+    const int outputComponentCount = m_integral->resultDimension();
+
+    result.set_size(outputComponentCount, pointCount);
+    result.fill(0.);
+
+    const GeometricalData<CoordinateType>& trialGeomData =
+            m_farFieldTrialGeomData;
+    if (pointCount == 0 || m_farFieldWeights.empty())
+        return;
+    if (trialGeomData.globals.n_cols != m_farFieldWeights.size())
+        throw std::runtime_error(
+                "DefaultEvaluatorForIntegralOperators::evaluateHierarchically(): "
+                "hierarchical evaluation requires kernels depending on the "
+                "global coordinates of trial points");
+
+    // Organise the evaluation points and the trial quadrature points in
+    // cluster trees and find the interactions between their clusters
+    typedef PointClusterTree<CoordinateType> Tree;
+    const Tree targetTree(points, options.maximumLeafSize);
+    const Tree sourceTree(trialGeomData.globals, options.maximumLeafSize);
+    const int targetNodeCount = targetTree.nodeCount();
+    std::vector<std::vector<int> > farSources(targetNodeCount);
+    std::vector<std::vector<int> > nearSources(targetNodeCount);
+    collectInteractions(targetTree, 0, sourceTree, 0, options,
+                        farSources, nearSources);
+
+    std::vector<int> farTargetNodes, leaves;
+    int maxLevel = 0;
+    for (int t = 0; t < targetNodeCount; ++t) {
+        if (!farSources[t].empty())
+            farTargetNodes.push_back(t);
+        if (targetTree.node(t).isLeaf())
+            leaves.push_back(t);
+        maxLevel = std::max(maxLevel, targetTree.node(t).level);
+    }
+
+    typedef ClusterPotentialCalculator<BasisFunctionType, KernelType, ResultType>
+            Calculator;
+    const Calculator calculator(trialGeomData, m_farFieldTrialTransfValues,
+                                m_farFieldWeights, sourceTree,
+                                *m_kernels, *m_integral);
+    // Potential at the interpolation nodes of each target cluster (empty
+    // for clusters without far interactions, including those of ancestors)
+    std::vector<arma::Mat<ResultType> > nodeValues(targetNodeCount);
+
+    ExecutionContext& executionContext = ExecutionContext::instance();
+    Fiber::SerialBlasRegion region;
+
+    typedef FarFieldLoopBody<BasisFunctionType, KernelType, ResultType>
+            FarFieldBody;
+    executionContext.parallelFor(
+                m_parallelizationOptions,
+                tbb::blocked_range<size_t>(0, farTargetNodes.size()),
+                FarFieldBody(calculator, targetTree, farTargetNodes, farSources,
+                             options.interpolationOrder, outputComponentCount,
+                             nodeValues));
+
+    // Pass the interpolated potential down the target tree, one level at
+    // a time. Nodes are stored in depth-first order, so whether a parent
+    // has values is known before its children are visited.
+    std::vector<std::vector<int> > childNodesByLevel(maxLevel + 1);
+    std::vector<bool> hasValues(targetNodeCount, false);
+    for (int t = 0; t < targetNodeCount; ++t) {
+        const int parent = targetTree.node(t).parent;
+        hasValues[t] = !farSources[t].empty();
+        if (parent >= 0 && hasValues[parent]) {
+            hasValues[t] = true;
+            childNodesByLevel[targetTree.node(t).level].push_back(t);
+        }
+    }
+    typedef DownwardPassLoopBody<ResultType> DownwardPassBody;
+    for (int level = 1; level <= maxLevel; ++level)
+        executionContext.parallelFor(
+                    m_parallelizationOptions,
+                    tbb::blocked_range<size_t>(
+                        0, childNodesByLevel[level].size()),
+                    DownwardPassBody(targetTree, childNodesByLevel[level],
+                                     options.interpolationOrder, nodeValues));
+
+    typedef LeafEvaluationLoopBody<BasisFunctionType, KernelType, ResultType>
+            LeafBody;
+    executionContext.parallelFor(
+                m_parallelizationOptions,
+                tbb::blocked_range<size_t>(0, leaves.size()),
+                LeafBody(calculator, points, targetTree, leaves, nearSources,
+                         nodeValues, options.interpolationOrder, result));
+}
+
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
@@ -236,13 +759,13 @@ ResultType, GeometryFactory>::cacheTrialData()
                 "potentials cannot contain kernels that depend on other test data "
                 "than global coordinates");
 
+    m_kernelTrialGeomDeps = trialGeomDeps;
+    // The near field is handled by applyNearFieldCorrections(), which
+    // integrates the contributions of individual elements on the fly
     calcTrialData(EvaluatorForIntegralOperators<ResultType>::FAR_FIELD,
                   trialGeomDeps, m_farFieldTrialGeomData,
-                  m_farFieldTrialTransfValues, m_farFieldWeights);
-    // near field is currently not treated in any special way
-    calcTrialData(EvaluatorForIntegralOperators<ResultType>::FAR_FIELD,
-                  trialGeomDeps, m_nearFieldTrialGeomData,
-                  m_nearFieldTrialTransfValues, m_nearFieldWeights);
+                  m_farFieldTrialTransfValues, m_farFieldWeights,
+                  m_farFieldElementOffsets);
 }
 
 template <typename BasisFunctionType, typename KernelType,
@@ -253,7 +776,8 @@ ResultType, GeometryFactory>::calcTrialData(
         int kernelTrialGeomDeps,
         GeometricalData<CoordinateType>& trialGeomData,
         CollectionOf2dArrays<ResultType>& trialTransfValues,
-        std::vector<CoordinateType>& weights) const
+        std::vector<CoordinateType>& weights,
+        std::vector<int>& elementOffsets) const
 {
     if (region != EvaluatorForIntegralOperators<ResultType>::FAR_FIELD)
         throw std::invalid_argument(
@@ -328,15 +852,6 @@ ResultType, GeometryFactory>::calcTrialData(
         activeShapeset.evaluate(basisDeps, localQuadPoints, ALL_DOFS, basisData);
 
         BasisData<ResultType> argumentData;
-        if (basisDeps & VALUES)
-            argumentData.values.set_size(basisData.values.extent(0),
-                                         1, // just one function
-                                         basisData.values.extent(2));
-        if (basisDeps & DERIVATIVES)
-            argumentData.derivatives.set_size(basisData.derivatives.extent(0),
-                                              basisData.derivatives.extent(1),
-                                              1, // just one function
-                                              basisData.derivatives.extent(3));
 
         // Loop over elements and process those that use the active shapeset
         CollectionOf3dArrays<ResultType> trialValues;
@@ -351,31 +866,8 @@ ResultType, GeometryFactory>::calcTrialData(
 
             // Calculate the argument function's values and/or derivatives
             // at quadrature points in the current element
-            if (basisDeps & VALUES)
-            {
-                std::fill(argumentData.values.begin(),
-                          argumentData.values.end(), 0.);
-                assert(localCoefficients.size() == basisData.values.extent(1));
-                for (size_t point = 0; point < basisData.values.extent(2); ++point)
-                    for (size_t dim = 0; dim < basisData.values.extent(0); ++dim)
-                        for (size_t fun = 0; fun < basisData.values.extent(1); ++fun)
-                            argumentData.values(dim, 0, point) +=
-                                    basisData.values(dim, fun, point) *
-                                    localCoefficients[fun];
-            }
-            if (basisDeps & DERIVATIVES)
-            {
-                std::fill(argumentData.derivatives.begin(),
-                          argumentData.derivatives.end(), 0.);
-                assert(localCoefficients.size() == basisData.derivatives.extent(2));
-                for (size_t point = 0; point < basisData.derivatives.extent(3); ++point)
-                    for (size_t dim = 0; dim < basisData.derivatives.extent(1); ++dim)
-                        for (size_t comp = 0; comp < basisData.derivatives.extent(0); ++comp)
-                            for (size_t fun = 0; fun < basisData.derivatives.extent(2); ++fun)
-                                argumentData.derivatives(comp, dim, 0, point) +=
-                                    basisData.derivatives(comp, dim, fun, point) *
-                                    localCoefficients[fun];
-            }
+            evaluateArgument(basisDeps, basisData, localCoefficients,
+                             argumentData);
 
             // Get geometrical data
             m_rawGeometry->setupGeometry(e, *geometry);
@@ -452,11 +944,14 @@ ResultType, GeometryFactory>::calcTrialData(
         trialTransfValues[transf].set_size(
                     m_trialTransformations->resultDimension(transf), quadPointCount);
     weights.resize(quadPointCount);
+    elementOffsets.resize(elementCount + 1);
+    elementOffsets[elementCount] = quadPointCount;
 
     for (int e = 0, startCol = 0;
          e < elementCount;
          startCol += trialTransfValuesPerElement[e][0].extent(1), ++e)
     {
+        elementOffsets[e] = startCol;
         int endCol = startCol + trialTransfValuesPerElement[e][0].extent(1) - 1;
         if (kernelTrialGeomDeps & GLOBALS)
             trialGeomData.globals.cols(startCol, endCol) =
@@ -498,4 +993,421 @@ ResultType, GeometryFactory>::calcTrialData(
     }
 }
 
+// Recalculates the contributions of the elements lying close to each
+// evaluation point
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+class DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::NearFieldCorrectionLoopBody
+{
+public:
+    NearFieldCorrectionLoopBody(
+            const DefaultEvaluatorForIntegralOperators& evaluator,
+            const arma::Mat<CoordinateType>& points,
+            const NearFieldEvaluationOptions& options,
+            const PointClusterTree<CoordinateType>& elementTree,
+            const std::vector<CoordinateType>& nodeRadii,
+            const arma::Mat<CoordinateType>& elementCenters,
+            const std::vector<CoordinateType>& elementRadii,
+            arma::Mat<ResultType>& result) :
+        m_evaluator(evaluator), m_points(points), m_options(options),
+        m_elementTree(elementTree), m_nodeRadii(nodeRadii),
+        m_elementCenters(elementCenters), m_elementRadii(elementRadii),
+        m_result(result)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::auto_ptr<Geometry> geometry(
+                    m_evaluator.m_geometryFactory->make());
+        std::vector<int> nearElements;
+        GeometricalData<CoordinateType> pointGeomData;
+        GeometricalData<CoordinateType> trialGeomData;
+        CollectionOf2dArrays<ResultType> trialTransfValues;
+        std::vector<CoordinateType> weights;
+        arma::Mat<CoordinateType> localQuadPoints;
+        std::vector<CoordinateType> quadWeights;
+        arma::Mat<ResultType> contribution(m_result.n_rows, 1);
+        std::vector<int> indices;
+
+        for (size_t p = r.begin(); p < r.end(); ++p) {
+            findNearElements(p, nearElements);
+            if (nearElements.empty())
+                continue;
+            pointGeomData.globals = m_points.col(p);
+            for (size_t i = 0; i < nearElements.size(); ++i) {
+                const int e = nearElements[i];
+
+                // Remove the contribution calculated with the far-field rule
+                const int begin = m_evaluator.m_farFieldElementOffsets[e];
+                const int end = m_evaluator.m_farFieldElementOffsets[e + 1];
+                indices.resize(end - begin);
+                for (int j = begin; j < end; ++j)
+                    indices[j - begin] = j;
+                if (!indices.empty()) {
+                    gatherTrialData(m_evaluator.m_farFieldTrialGeomData,
+                                    m_evaluator.m_farFieldTrialTransfValues,
+                                    m_evaluator.m_farFieldWeights,
+                                    &indices[0], indices.size(),
+                                    trialGeomData, trialTransfValues, weights);
+                    integrate(pointGeomData, trialGeomData, trialTransfValues,
+                              weights, contribution);
+                    m_result.col(p) -= contribution;
+                }
+
+                // Add the contribution calculated on subdivided elements
+                subdivide(e, m_points.colptr(p), *geometry,
+                          localQuadPoints, quadWeights);
+                m_evaluator.calcElementTrialData(
+                            e, localQuadPoints, quadWeights, *geometry,
+                            trialGeomData, trialTransfValues, weights);
+                integrate(pointGeomData, trialGeomData, trialTransfValues,
+                          weights, contribution);
+                m_result.col(p) += contribution;
+            }
+        }
+    }
+
+private:
+    void findNearElements(size_t p, std::vector<int>& nearElements) const {
+        typedef typename PointClusterTree<CoordinateType>::Node Node;
+        const CoordinateType* point = m_points.colptr(p);
+        const int dim = m_points.n_rows;
+        const std::vector<int>& permutation = m_elementTree.permutation();
+        nearElements.clear();
+        std::vector<int> stack(1, 0);
+        while (!stack.empty()) {
+            const int n = stack.back();
+            stack.pop_back();
+            if (m_elementTree.distance(n, point) >= m_nodeRadii[n])
+                continue;
+            const Node& node = m_elementTree.node(n);
+            if (!node.isLeaf()) {
+                stack.push_back(node.firstChild);
+                stack.push_back(node.secondChild);
+                continue;
+            }
+            for (int i = node.begin; i < node.end; ++i) {
+                const int e = permutation[i];
+                CoordinateType distanceSquared = 0.;
+                for (int d = 0; d < dim; ++d) {
+                    const CoordinateType diff = point[d] - m_elementCenters(d, e);
+                    distanceSquared += diff * diff;
+                }
+                if (distanceSquared < m_elementRadii[e] * m_elementRadii[e])
+                    nearElements.push_back(e);
+            }
+        }
+    }
+
+    // Split element e recursively until each subelement lies far enough
+    // from 'point' and return the far-field quadrature rule of the element
+    // mapped to all the resulting subelements
+    void subdivide(int e, const CoordinateType* point, Geometry& geometry,
+                   arma::Mat<CoordinateType>& localQuadPoints,
+                   std::vector<CoordinateType>& quadWeights) const {
+        const RawGridGeometry<CoordinateType>& rawGeometry =
+                *m_evaluator.m_rawGeometry;
+        const int gridDim = rawGeometry.gridDimension();
+        const int worldDim = rawGeometry.worldDimension();
+        const bool triangle = gridDim == 2 &&
+                rawGeometry.elementCornerCount(e) == 3;
+
+        arma::Mat<CoordinateType> ruleQuadPoints;
+        std::vector<CoordinateType> ruleWeights;
+        m_evaluator.calcFarFieldQuadratureRule(e, ruleQuadPoints, ruleWeights);
+        const int rulePointCount = ruleWeights.size();
+        rawGeometry.setupGeometry(e, geometry);
+
+        // Columns: corners of the subelement followed by its centre
+        const int cornerCount = gridDim == 1 ? 2 : (triangle ? 3 : 4);
+        arma::Mat<CoordinateType> localCorners(gridDim, cornerCount + 1);
+        arma::Mat<CoordinateType> globalCorners;
+
+        std::vector<SubElement<CoordinateType> > accepted;
+        std::vector<std::pair<SubElement<CoordinateType>, int> > stack;
+        SubElement<CoordinateType> root;
+        root.origin[0] = root.origin[1] = 0.;
+        root.edge0[0] = 1.; root.edge0[1] = 0.;
+        root.edge1[0] = 0.; root.edge1[1] = 1.;
+        root.measure = 1.;
+        stack.push_back(std::make_pair(root, 0));
+        while (!stack.empty()) {
+            const SubElement<CoordinateType> sub = stack.back().first;
+            const int level = stack.back().second;
+            stack.pop_back();
+
+            for (int d = 0; d < gridDim; ++d) {
+                localCorners(d, 0) = sub.origin[d];
+                localCorners(d, 1) = sub.origin[d] + sub.edge0[d];
+                if (gridDim == 1)
+                    localCorners(d, 2) = sub.origin[d] + 0.5 * sub.edge0[d];
+                else {
+                    localCorners(d, 2) = sub.origin[d] + sub.edge1[d];
+                    if (triangle)
+                        localCorners(d, 3) = sub.origin[d] +
+                                (sub.edge0[d] + sub.edge1[d]) / 3.;
+                    else {
+                        localCorners(d, 3) = sub.origin[d] +
+                                sub.edge0[d] + sub.edge1[d];
+                        localCorners(d, 4) = sub.origin[d] +
+                                0.5 * (sub.edge0[d] + sub.edge1[d]);
+                    }
+                }
+            }
+            geometry.local2global(localCorners, globalCorners);
+
+            // As in ElementSizesAndCenters, the size is the length of the
+            // longest edge of a triangle or diagonal of a quadrilateral
+            CoordinateType sizeSquared = 0.;
+            if (gridDim == 1)
+                sizeSquared = distanceSquared(globalCorners, 0, 1);
+            else if (triangle)
+                sizeSquared = std::max(distanceSquared(globalCorners, 0, 1),
+                        std::max(distanceSquared(globalCorners, 1, 2),
+                                 distanceSquared(globalCorners, 2, 0)));
+            else
+                sizeSquared = std::max(distanceSquared(globalCorners, 0, 3),
+                                       distanceSquared(globalCorners, 1, 2));
+            CoordinateType pointDistanceSquared = 0.;
+            for (int d = 0; d < worldDim; ++d) {
+                const CoordinateType diff =
+                        point[d] - globalCorners(d, cornerCount);
+                pointDistanceSquared += diff * diff;
+            }
+            const CoordinateType relativeDistance = m_options.relativeDistance;
+            if (level >= m_options.maximumSubdivisionLevel ||
+                    pointDistanceSquared >=
+                    relativeDistance * relativeDistance * sizeSquared) {
+                accepted.push_back(sub);
+                continue;
+            }
+
+            SubElement<CoordinateType> child = sub;
+            if (gridDim == 1) {
+                child.edge0[0] = 0.5 * sub.edge0[0];
+                child.measure = 0.5 * sub.measure;
+                for (int i = 0; i < 2; ++i) {
+                    child.origin[0] = sub.origin[0] + i * child.edge0[0];
+                    stack.push_back(std::make_pair(child, level + 1));
+                }
+                continue;
+            }
+            for (int d = 0; d < 2; ++d) {
+                child.edge0[d] = 0.5 * sub.edge0[d];
+                child.edge1[d] = 0.5 * sub.edge1[d];
+            }
+            child.measure = 0.25 * sub.measure;
+            for (int i = 0; i < 2; ++i)
+                for (int j = 0; j < 2; ++j) {
+                    if (triangle && i == 1 && j == 1)
+                        continue;
+                    for (int d = 0; d < 2; ++d)
+                        child.origin[d] = sub.origin[d] +
+                                i * child.edge0[d] + j * child.edge1[d];
+                    stack.push_back(std::make_pair(child, level + 1));
+                }
+            if (triangle) {
+                // The middle triangle, spanned by the edge midpoints
+                for (int d = 0; d < 2; ++d) {
+                    child.origin[d] = sub.origin[d] +
+                            child.edge0[d] + child.edge1[d];
+                    child.edge0[d] = -0.5 * sub.edge0[d];
+                    child.edge1[d] = -0.5 * sub.edge1[d];
+                }
+                stack.push_back(std::make_pair(child, level + 1));
+            }
+        }
+
+        localQuadPoints.set_size(gridDim, accepted.size() * rulePointCount);
+        quadWeights.resize(accepted.size() * rulePointCount);
+        for (size_t i = 0; i < accepted.size(); ++i) {
+            const SubElement<CoordinateType>& sub = accepted[i];
+            for (int q = 0; q < rulePointCount; ++q) {
+                const size_t col = i * rulePointCount + q;
+                for (int d = 0; d < gridDim; ++d) {
+                    localQuadPoints(d, col) = sub.origin[d] +
+                            ruleQuadPoints(0, q) * sub.edge0[d];
+                    if (gridDim > 1)
+                        localQuadPoints(d, col) +=
+                                ruleQuadPoints(1, q) * sub.edge1[d];
+                }
+                quadWeights[col] = ruleWeights[q] * sub.measure;
+            }
+        }
+    }
+
+    static CoordinateType distanceSquared(const arma::Mat<CoordinateType>& points,
+                                          int a, int b) {
+        CoordinateType result = 0.;
+        for (size_t d = 0; d < points.n_rows; ++d)
+            result += (points(d, a) - points(d, b)) * (points(d, a) - points(d, b));
+        return result;
+    }
+
+    void integrate(const GeometricalData<CoordinateType>& pointGeomData,
+                   const GeometricalData<CoordinateType>& trialGeomData,
+                   const CollectionOf2dArrays<ResultType>& trialTransfValues,
+                   const std::vector<CoordinateType>& weights,
+                   arma::Mat<ResultType>& contribution) const {
+        CollectionOf4dArrays<KernelType> kernelValues;
+        m_evaluator.m_kernels->evaluateOnGrid(pointGeomData, trialGeomData,
+                                              kernelValues);
+        _2dArray<ResultType> contributionView(contribution.n_rows, 1,
+                                              contribution.memptr());
+        m_evaluator.m_integral->evaluate(trialGeomData, kernelValues,
+                                         trialTransfValues, weights,
+                                         contributionView);
+    }
+
+    const DefaultEvaluatorForIntegralOperators& m_evaluator;
+    const arma::Mat<CoordinateType>& m_points;
+    const NearFieldEvaluationOptions& m_options;
+    const PointClusterTree<CoordinateType>& m_elementTree;
+    const std::vector<CoordinateType>& m_nodeRadii;
+    const arma::Mat<CoordinateType>& m_elementCenters;
+    const std::vector<CoordinateType>& m_elementRadii;
+    arma::Mat<ResultType>& m_result;
+};
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::applyNearFieldCorrections(
+        const arma::Mat<CoordinateType>& points,
+        const NearFieldEvaluationOptions& options,
+        arma::Mat<ResultType>& result) const
+{
+    if (options.relativeDistance <= 0.)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::"
+                "applyNearFieldCorrections(): "
+                "relativeDistance must be positive");
+    if (options.maximumSubdivisionLevel < 0)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::"
+                "applyNearFieldCorrections(): "
+                "maximumSubdivisionLevel must not be negative");
+    if (points.n_rows != m_rawGeometry->worldDimension())
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::"
+                "applyNearFieldCorrections(): "
+                "the number of coordinates of each evaluation point must be "
+                "equal to the dimension of the world");
+    if (result.n_rows != m_integral->resultDimension() ||
+            result.n_cols != points.n_cols)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::"
+                "applyNearFieldCorrections(): "
+                "the dimensions of 'result' do not match the number of "
+                "evaluation points");
+
+    const int elementCount = m_rawGeometry->elementCount();
+    if (points.n_cols == 0 || elementCount == 0)
+        return;
+
+    // Index the elements by their centres. Each node of the tree stores the
+    // largest distance from its bounding box at which a point can still lie
+    // close to one of its elements.
+    typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
+            BasisFunctionType> Utilities;
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> > sizesAndCenters =
+            Utilities::elementSizesAndCenters(*m_rawGeometry);
+    std::vector<CoordinateType> elementRadii(elementCount);
+    for (int e = 0; e < elementCount; ++e)
+        elementRadii[e] = options.relativeDistance *
+                std::sqrt(sizesAndCenters->sizesSquared[e]);
+    typedef PointClusterTree<CoordinateType> Tree;
+    const Tree elementTree(sizesAndCenters->centers, 16 /* maximumLeafSize */);
+    std::vector<CoordinateType> nodeRadii(elementTree.nodeCount(), 0.);
+    // Children follow their parents
+    for (int n = elementTree.nodeCount() - 1; n >= 0; --n) {
+        const typename Tree::Node& node = elementTree.node(n);
+        if (node.isLeaf())
+            for (int i = node.begin; i < node.end; ++i)
+                nodeRadii[n] = std::max(
+                            nodeRadii[n],
+                            elementRadii[elementTree.permutation()[i]]);
+        else
+            nodeRadii[n] = std::max(nodeRadii[node.firstChild],
+                                    nodeRadii[node.secondChild]);
+    }
+
+    Fiber::SerialBlasRegion region;
+    ExecutionContext::instance().parallelFor(
+                m_parallelizationOptions,
+                tbb::blocked_range<size_t>(0, points.n_cols),
+                NearFieldCorrectionLoopBody(
+                    *this, points, options, elementTree, nodeRadii,
+                    sizesAndCenters->centers, elementRadii, result));
+}
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::calcFarFieldQuadratureRule(
+        int elementIndex,
+        arma::Mat<CoordinateType>& localQuadPoints,
+        std::vector<CoordinateType>& quadWeights) const
+{
+    SingleQuadratureDescriptor desc =
+        m_quadDescSelector->farFieldQuadratureDescriptor(
+            *(*m_trialShapesets)[elementIndex],
+            m_rawGeometry->elementCornerCount(elementIndex));
+    m_quadRuleFamily->fillQuadraturePointsAndWeights(
+                desc, localQuadPoints, quadWeights);
+}
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::calcElementTrialData(
+        int elementIndex,
+        const arma::Mat<CoordinateType>& localQuadPoints,
+        const std::vector<CoordinateType>& quadWeights,
+        Geometry& geometry,
+        GeometricalData<CoordinateType>& trialGeomData,
+        CollectionOf2dArrays<ResultType>& trialTransfValues,
+        std::vector<CoordinateType>& weights) const
+{
+    size_t basisDeps = 0;
+    size_t trialGeomDeps = m_kernelTrialGeomDeps;
+    m_trialTransformations->addDependencies(basisDeps, trialGeomDeps);
+    trialGeomDeps |= INTEGRATION_ELEMENTS;
+
+    BasisData<BasisFunctionType> basisData;
+    (*m_trialShapesets)[elementIndex]->evaluate(
+                basisDeps, localQuadPoints, ALL_DOFS, basisData);
+    BasisData<ResultType> argumentData;
+    evaluateArgument(basisDeps, basisData,
+                     (*m_argumentLocalCoefficients)[elementIndex],
+                     argumentData);
+
+    m_rawGeometry->setupGeometry(elementIndex, geometry);
+    geometry.getData(trialGeomDeps, localQuadPoints, trialGeomData);
+    if (trialGeomDeps & Fiber::DOMAIN_INDEX)
+        trialGeomData.domainIndex = m_rawGeometry->domainIndex(elementIndex);
+
+    CollectionOf3dArrays<ResultType> trialValues;
+    m_trialTransformations->evaluate(argumentData, trialGeomData, trialValues);
+
+    const int transformationCount = m_trialTransformations->transformationCount();
+    const size_t pointCount = quadWeights.size();
+    trialTransfValues.set_size(transformationCount);
+    for (int transf = 0; transf < transformationCount; ++transf)
+    {
+        const size_t dimCount = trialValues[transf].extent(0);
+        trialTransfValues[transf].set_size(dimCount, pointCount);
+        for (size_t point = 0; point < pointCount; ++point)
+            for (size_t dim = 0; dim < dimCount; ++dim)
+                trialTransfValues[transf](dim, point) =
+                        trialValues[transf](dim, 0, point);
+    }
+
+    weights.resize(pointCount);
+    for (size_t point = 0; point < pointCount; ++point)
+        weights[point] = quadWeights[point] *
+                trialGeomData.integrationElements(point);
+}
+
 } // namespace Fiber
@@ -28,7 +28,10 @@
 #include "_2d_array.hpp"
 #include "accuracy_options.hpp"
 #include "default_local_assembler_for_operators_on_surfaces_utilities.hpp"
+#include "double_quadrature_integrator_table.hpp"
+#include "element_adjacency.hpp"
 #include "element_pair_topology.hpp"
+#include "local_weak_form_cache.hpp"
 #include "numerical_quadrature.hpp"
 #include "parallelization_options.hpp"
 #include "shared_ptr.hpp"
@@ -37,7 +40,6 @@
 
 #include <boost/static_assert.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
-#include <tbb/concurrent_unordered_map.h>
 #include <tbb/mutex.h>
 #include <cstring>
 #include <climits>
@@ -106,6 +108,8 @@ public:
 
     virtual CoordinateType estimateRelativeScale(CoordinateType minDist) const;
 
+    virtual std::string signature() const;
+
 private:
     /** \cond PRIVATE */
     typedef TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> Integrator;
@@ -113,42 +117,11 @@ private:
     typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
     BasisFunctionType> Utilities;
 
-    /** \brief Alternative comparison functor for pairs.
-     *
-     *  This functor can be used to sort pairs according to the second member
-     *  and then, in case of equality, according to the first member. */
-    template <typename T1, typename T2>
-    struct alternative_less {
-        bool operator() (const std::pair<T1, T2>& a, const std::pair<T1, T2>& b) const {
-            return a.second < b.second
-                || (!(b.second < a.second) && a.first < b.first);
-        }
-    };
-
-    /** \brief Comparison functor for element-index pairs.
-     *
-     *  This functor sorts element index pairs first after the trial element
-     *  index (second member) and then, in case of equality, after the test
-     *  element index (first member) */
-    typedef alternative_less<
-        typename ElementIndexPair::first_type,
-        typename ElementIndexPair::second_type> ElementIndexPairCompare;
-
-    /** \brief Set of element index pairs.
-     *
-     *  The alternative sorting (first after the trial element index) is used
-     *  because profiling has shown that evaluateLocalWeakForms is called more
-     *  often in the TEST_TRIAL mode (with a single trial element index) than
-     *  in the TRIAL_TEST mode. Therefore the singular integral cache is
-     *  indexed with trial element index, and this sorting mode makes it easier
-     *  to construct such cache. */
-    typedef std::set<ElementIndexPair, ElementIndexPairCompare> ElementIndexPairSet;
-
     bool testAndTrialGridsAreIdentical() const;
 
     void cacheSingularLocalWeakForms();
-    void findPairsOfAdjacentElements(ElementIndexPairSet& pairs) const;
-    void cacheLocalWeakForms(const ElementIndexPairSet& elementIndexPairs);
+    void cacheLocalWeakForms(const std::vector<int>& trialElementOffsets,
+                             const std::vector<int>& testElementIndices);
 
     const Integrator& selectIntegrator(
             int testElementIndex, int trialElementIndex,
@@ -173,24 +146,14 @@ private:
     shared_ptr<const QuadratureDescriptorSelectorForIntegralOperators<CoordinateType> > m_quadDescSelector;
     shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType> > m_quadRuleFamily;
 
-    typedef tbb::concurrent_unordered_map<DoubleQuadratureDescriptor,
-    Integrator*> IntegratorMap;
-    IntegratorMap m_testKernelTrialIntegrators;
+    DoubleQuadratureIntegratorTable<Integrator> m_testKernelTrialIntegrators;
     mutable tbb::mutex m_integratorCreationMutex;
 
-    enum { INVALID_INDEX = INT_MAX };
-    typedef _2dArray<std::pair<int, arma::Mat<ResultType> > > Cache;
     /** \brief Singular integral cache.
      *
      *  This cache stores the preevaluated local weak forms expressed by
-     *  singular integrals. A particular item it stored in r'th row and c'th
-     *  column stores, in its second member, the local weak form calculated for
-     *  the test element with index it.first and the trial element with index
-     *  c. In each column, the items are sorted after increasing test element
-     *  index. At the end of each column there can be unused items with test
-     *  element index set to INVALID_INDEX (= INT_MAX, so that the sorting is
-     *  preserved). */
-    Cache m_cache;
+     *  singular integrals, i.e. those of pairs of adjacent elements. */
+    LocalWeakFormCache<ResultType> m_cache;
     /** \endcond */
 };
 
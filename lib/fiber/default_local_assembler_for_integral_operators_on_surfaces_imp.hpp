@@ -24,13 +24,19 @@
 #include "default_local_assembler_for_integral_operators_on_surfaces.hpp"
 
 #include "double_quadrature_rule_family.hpp"
+#include "execution_context.hpp"
 #include "nonseparable_numerical_test_kernel_trial_integrator.hpp"
 #include "quadrature_descriptor_selector_for_integral_operators.hpp"
+#include "raw_grid_geometry.hpp"
 #include "separable_numerical_test_kernel_trial_integrator.hpp"
 #include "serial_blas_region.hpp"
 
-#include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
+#include "../common/boost_make_shared_fwd.hpp"
+
+#include <tbb/blocked_range.h>
+#include <map>
+#include <string>
+#include <typeinfo>
 
 #include "../common/auto_timer.hpp"
 
@@ -52,12 +58,14 @@ public:
             const std::vector<ElementIndexPair>& activeElementPairs,
             const Shapeset<BasisFunctionType>& activeTestShapeset,
             const Shapeset<BasisFunctionType>& activeTrialShapeset,
-            const std::vector<arma::Mat<ResultType>*>& localResult) :
+            const std::vector<int>& activeCacheEntries,
+            LocalWeakFormCache<ResultType>& cache) :
         m_activeIntegrator(activeIntegrator),
         m_activeElementPairs(activeElementPairs),
         m_activeTestBasis(activeTestShapeset),
         m_activeTrialBasis(activeTrialShapeset),
-        m_localResult(localResult) {
+        m_activeCacheEntries(activeCacheEntries),
+        m_cache(cache) {
     }
 
     void operator() (const tbb::blocked_range<size_t>& r) const {
@@ -66,11 +74,21 @@ public:
         std::vector<ElementIndexPair> localActiveElementPairs(
                     &m_activeElementPairs[r.begin()],
                     &m_activeElementPairs[r.end()]);
-        std::vector<arma::Mat<ResultType>*> localLocalResult(
-                    &m_localResult[r.begin()],
-                    &m_localResult[r.end()]);
+        std::vector<arma::Mat<ResultType> > localResult(r.size());
+        std::vector<arma::Mat<ResultType>*> localResultPtrs(r.size());
+        for (size_t i = 0; i < r.size(); ++i)
+            localResultPtrs[i] = &localResult[i];
         m_activeIntegrator.integrate(localActiveElementPairs, m_activeTestBasis,
-                                     m_activeTrialBasis, localLocalResult);
+                                     m_activeTrialBasis, localResultPtrs);
+
+        // Move the results to their (disjoint) slots in the cache
+        for (size_t i = 0; i < r.size(); ++i) {
+            const int entry = m_activeCacheEntries[r.begin() + i];
+            assert(int(localResult[i].n_rows) == m_cache.rowCount(entry));
+            assert(int(localResult[i].n_cols) == m_cache.colCount(entry));
+            std::copy(localResult[i].begin(), localResult[i].end(),
+                      m_cache.data(entry));
+        }
     }
 
 private:
@@ -78,7 +96,8 @@ private:
     const std::vector<ElementIndexPair>& m_activeElementPairs;
     const Shapeset<BasisFunctionType>& m_activeTestBasis;
     const Shapeset<BasisFunctionType>& m_activeTrialBasis;
-    const std::vector<arma::Mat<ResultType>*>& m_localResult;
+    const std::vector<int>& m_activeCacheEntries;
+    LocalWeakFormCache<ResultType>& m_cache;
 };
 
 } // namespace
@@ -134,12 +153,8 @@ KernelType, ResultType, GeometryFactory>::
 ~DefaultLocalAssemblerForIntegralOperatorsOnSurfaces()
 {
     // Note: obviously the destructor is assumed to be called only after
-    // all threads have ceased using the assembler!
-
-    for (typename IntegratorMap::const_iterator it = m_testKernelTrialIntegrators.begin();
-         it != m_testKernelTrialIntegrators.end(); ++it)
-        delete it->second;
-    m_testKernelTrialIntegrators.clear();
+    // all threads have ceased using the assembler! The integrators are
+    // deleted by m_testKernelTrialIntegrators.
 }
 
 template <typename BasisFunctionType, typename KernelType,
@@ -185,37 +200,36 @@ evaluateLocalWeakForms(
     typedef std::pair<const Integrator*, const Shapeset*> QuadVariant;
     const QuadVariant CACHED(0, 0);
     std::vector<QuadVariant> quadVariants(elementACount);
+    // Only adjacent elements have their local weak forms cached, and elements
+    // lying at a positive distance from each other are never adjacent
+    const bool useCache = !m_cache.isEmpty() && nominalDistance <= 0.;
     for (int i = 0; i < elementACount; ++i) {
         // Try to find matrix in cache
-        const arma::Mat<ResultType>* cachedLocalWeakForm = 0;
-        if (callVariant == TEST_TRIAL) {
-            const int testElementIndex = elementIndicesA[i];
-            const int trialElementIndex = elementIndexB;
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, trialElementIndex).first == testElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-                    break;
-                }
-        }
-        else {
-            const int testElementIndex = elementIndexB;
-            const int trialElementIndex = elementIndicesA[i];
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, trialElementIndex).first == testElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-                    break;
-                }
-        }
+        int cacheEntry = -1;
+        if (useCache)
+            cacheEntry = callVariant == TEST_TRIAL ?
+                        m_cache.find(elementIndicesA[i], elementIndexB) :
+                        m_cache.find(elementIndexB, elementIndicesA[i]);
 
-        if (cachedLocalWeakForm) { // Matrix found in cache
+        if (cacheEntry >= 0) { // Matrix found in cache
             quadVariants[i] = CACHED;
+            const ResultType* cachedLocalWeakForm = m_cache.data(cacheEntry);
+            const int rowCount = m_cache.rowCount(cacheEntry);
+            const int colCount = m_cache.colCount(cacheEntry);
             if (localDofIndexB == ALL_DOFS)
-                result[i] = *cachedLocalWeakForm;
+                result[i] = arma::Mat<ResultType>(cachedLocalWeakForm,
+                                                  rowCount, colCount);
             else {
                 if (callVariant == TEST_TRIAL)
-                    result[i] = cachedLocalWeakForm->col(localDofIndexB);
-                else
-                    result[i] = cachedLocalWeakForm->row(localDofIndexB);
+                    result[i] = arma::Mat<ResultType>(
+                                cachedLocalWeakForm + localDofIndexB * rowCount,
+                                rowCount, 1);
+                else {
+                    result[i].set_size(1, colCount);
+                    for (int col = 0; col < colCount; ++col)
+                        result[i](0, col) =
+                                cachedLocalWeakForm[localDofIndexB + col * rowCount];
+                }
             }
         } else {
             const Integrator* integrator =
@@ -297,22 +311,24 @@ evaluateLocalWeakForms(
             QuadVariant;
     const QuadVariant CACHED(0, 0, 0);
     Fiber::_2dArray<QuadVariant> quadVariants(testElementCount, trialElementCount);
+    // See the comment in the other overload of this function
+    const bool useCache = !m_cache.isEmpty() && nominalDistance <= 0.;
 
     for (int trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
         for (int testIndex = 0; testIndex < testElementCount; ++testIndex) {
             const int activeTestElementIndex = testElementIndices[testIndex];
             const int activeTrialElementIndex = trialElementIndices[trialIndex];
             // Try to find matrix in cache
-            const arma::Mat<ResultType>* cachedLocalWeakForm = 0;
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, activeTrialElementIndex).first == activeTestElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, activeTrialElementIndex).second;
-                    break;
-                }
+            const int cacheEntry = useCache ?
+                        m_cache.find(activeTestElementIndex,
+                                     activeTrialElementIndex) : -1;
 
-            if (cachedLocalWeakForm) { // Matrix found in cache
+            if (cacheEntry >= 0) { // Matrix found in cache
                 quadVariants(testIndex, trialIndex) = CACHED;
-                result(testIndex, trialIndex) = *cachedLocalWeakForm;
+                result(testIndex, trialIndex) = arma::Mat<ResultType>(
+                            m_cache.data(cacheEntry),
+                            m_cache.rowCount(cacheEntry),
+                            m_cache.colCount(cacheEntry));
             } else {
                 const Integrator* integrator =
                         &selectIntegrator(activeTestElementIndex,
@@ -386,203 +402,176 @@ estimateRelativeScale(CoordinateType minDist) const
 
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
-void
+std::string
 DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<BasisFunctionType,
-KernelType, ResultType, GeometryFactory>::
-cacheSingularLocalWeakForms()
+    KernelType, ResultType, GeometryFactory>::
+signature() const
 {
-    ElementIndexPairSet elementIndexPairs;
-    findPairsOfAdjacentElements(elementIndexPairs);
-    cacheLocalWeakForms(elementIndexPairs);
+    // The dynamic types of the kernels, transformations and integral
+    // identify the operator; the quadrature rule family and descriptor
+    // selector determine the accuracy of the local weak forms
+    std::string result = typeid(*this).name();
+    result += std::string(" ") + typeid(*m_kernels).name();
+    result += std::string(" ") + typeid(*m_testTransformations).name();
+    result += std::string(" ") + typeid(*m_trialTransformations).name();
+    result += std::string(" ") + typeid(*m_integral).name();
+    result += std::string(" ") + typeid(*m_quadRuleFamily).name();
+    result += std::string(" ") + m_quadDescSelector->signature();
+    return result;
 }
 
-/** \brief Fill \p pairs with the list of pairs of indices of elements
-        sharing at least one vertex. */
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 void
 DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<BasisFunctionType,
 KernelType, ResultType, GeometryFactory>::
-findPairsOfAdjacentElements(ElementIndexPairSet& pairs) const
+cacheSingularLocalWeakForms()
 {
-    pairs.clear();
-
     if (!testAndTrialGridsAreIdentical())
         return; // we assume that nonidentical grids are always disjoint
 
-    const RawGridGeometry<CoordinateType>& rawGeometry = *m_testRawGeometry;
-
-    const arma::Mat<CoordinateType>& vertices = rawGeometry.vertices();
-    const arma::Mat<int>& elementCornerIndices =
-            rawGeometry.elementCornerIndices();
-
-    const int vertexCount = vertices.n_cols;
-    const int elementCount = elementCornerIndices.n_cols;
-    const int maxCornerCount = elementCornerIndices.n_rows;
-
-    typedef std::vector<int> ElementIndexVector;
-    // ith entry: set of elements sharing vertex number i
-    std::vector<ElementIndexVector> elementsAdjacentToVertex(vertexCount);
-
-    for (int e = 0; e < elementCount; ++e)
-        for (int v = 0; v < maxCornerCount; ++v) {
-            const int index = elementCornerIndices(v, e);
-            if (index >= 0)
-                elementsAdjacentToVertex[index].push_back(e);
-        }
-
-    // Loop over vertex indices
-    for (int v = 0; v < vertexCount; ++v) {
-        const ElementIndexVector& adjacentElements = elementsAdjacentToVertex[v];
-        // Add to pairs each pair of elements adjacent to vertex v
-        const int adjacentElementCount = adjacentElements.size();
-        for (int e1 = 0; e1 < adjacentElementCount; ++e1)
-            for (int e2 = 0; e2 < adjacentElementCount; ++e2)
-                pairs.insert(ElementIndexPair(adjacentElements[e1],
-                                              adjacentElements[e2]));
-    }
+    // Reuse the adjacency lists attached to the grid geometry, if any;
+    // otherwise build them now
+    shared_ptr<const ElementAdjacency> adjacency =
+            m_testRawGeometry->elementAdjacency();
+    if (!adjacency)
+        adjacency = boost::make_shared<ElementAdjacency>(
+                    m_testRawGeometry->elementCornerIndices(),
+                    m_testRawGeometry->vertices().n_cols,
+                    m_parallelizationOptions);
+    // The adjacency relation is symmetric, so the neighbour list of element
+    // e is also the list of test elements adjacent to trial element e
+    cacheLocalWeakForms(adjacency->offsets(), adjacency->neighbours());
 }
 
+/** \brief Calculate and cache the local weak forms of the element pairs
+ *  given in compressed-sparse-row format: the test elements paired with trial
+ *  element \p e are testElementIndices[trialElementOffsets[e]], ...,
+ *  testElementIndices[trialElementOffsets[e + 1] - 1]. */
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 void
 DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<BasisFunctionType,
 KernelType, ResultType, GeometryFactory>::
-cacheLocalWeakForms(const ElementIndexPairSet& elementIndexPairs)
+cacheLocalWeakForms(const std::vector<int>& trialElementOffsets,
+                    const std::vector<int>& testElementIndices)
 {
     tbb::tick_count start = tbb::tick_count::now();
 
-    if (elementIndexPairs.empty())
+    if (testElementIndices.empty())
         return;
 
     if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
         std::cout << "Precalculating singular integrals..." << std::endl;
 
-    // Get the maximum number of neighbours a trial element can have.
-    // This will be used to allocate a cache of correct size.
-    // This loops assumes that elementIndexPairs are sorted after the trial
-    // element index first.
-    size_t maxNeighbourCount = 0;
-    for (typename ElementIndexPairSet::const_iterator it = elementIndexPairs.begin();
-         it != elementIndexPairs.end(); /* nothing */) {
-        int curTrialElementIndex = it->second;
-        size_t neighbourCount = 1;
-        for (++it;
-             it != elementIndexPairs.end() && it->second == curTrialElementIndex;
-             ++it) {
-            ++neighbourCount;
-        }
-        maxNeighbourCount = std::max(maxNeighbourCount, neighbourCount);
-    }
-
-    // Allocate cache and initialize all test element indices to INVALID_INDEX
-    size_t trialElementCount = m_trialRawGeometry->elementCount();
-    m_cache.set_size(maxNeighbourCount, trialElementCount);
-    for (size_t trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
-        for (size_t nborIndex = 0; nborIndex < maxNeighbourCount; ++nborIndex)
-            m_cache(nborIndex, trialIndex).first = INVALID_INDEX;
-
-    // Find cached matrices; select integrators to calculate non-cached ones
+    // Select integrators and find the dimensions of the local weak forms.
+    // Rather than storing the quadrature variant (integrator, test shapeset
+    // and trial shapeset) of each pair, number the distinct variants and
+    // store only the number.
     typedef Fiber::Shapeset<BasisFunctionType> Shapeset;
     typedef boost::tuples::tuple<const Integrator*, const Shapeset*, const Shapeset*>
             QuadVariant;
-    const int elementPairCount = elementIndexPairs.size();
-    std::vector<QuadVariant> quadVariants(elementPairCount);
-
-    typedef typename ElementIndexPairSet::const_iterator
-            ElementIndexPairIterator;
-    typedef typename std::vector<QuadVariant>::iterator QuadVariantIterator;
-    {
-        ElementIndexPairIterator pairIt = elementIndexPairs.begin();
-        QuadVariantIterator qvIt = quadVariants.begin();
-        for (; pairIt != elementIndexPairs.end(); ++pairIt, ++qvIt) {
-            const int testElementIndex = pairIt->first;
-            const int trialElementIndex = pairIt->second;
+    typedef std::map<QuadVariant, int> QuadVariantMap;
+    const int trialElementCount = int(trialElementOffsets.size()) - 1;
+    const int elementPairCount = testElementIndices.size();
+    QuadVariantMap uniqueQuadVariants;
+    std::vector<QuadVariant> quadVariantList;
+    std::vector<int> quadVariantIds(elementPairCount);
+    std::vector<int> rowCounts(elementPairCount), colCounts(elementPairCount);
+    for (int trialElementIndex = 0; trialElementIndex < trialElementCount;
+         ++trialElementIndex)
+        for (int i = trialElementOffsets[trialElementIndex];
+             i < trialElementOffsets[trialElementIndex + 1]; ++i) {
+            const int testElementIndex = testElementIndices[i];
             const Integrator* integrator =
                     &selectIntegrator(testElementIndex, trialElementIndex);
-            *qvIt = QuadVariant(integrator,
-                                (*m_testShapesets)[testElementIndex],
-                                (*m_trialShapesets)[trialElementIndex]);
+            const Shapeset* testShapeset = (*m_testShapesets)[testElementIndex];
+            const Shapeset* trialShapeset = (*m_trialShapesets)[trialElementIndex];
+            const QuadVariant quadVariant(integrator, testShapeset, trialShapeset);
+            typename QuadVariantMap::iterator it =
+                    uniqueQuadVariants.find(quadVariant);
+            if (it == uniqueQuadVariants.end()) {
+                it = uniqueQuadVariants.insert(std::make_pair(
+                        quadVariant, int(quadVariantList.size()))).first;
+                quadVariantList.push_back(quadVariant);
+            }
+            quadVariantIds[i] = it->second;
+            rowCounts[i] = testShapeset->size();
+            colCounts[i] = trialShapeset->size();
         }
-    }
 
-    // Integration will proceed in batches of element pairs having the same
-    // "quadrature variant", i.e. integrator, test shapeset and trial shapeset
+    // Allocate contiguous storage for all the cached matrices. The ith pair
+    // is stored in the ith cache entry.
+    m_cache.reset(trialElementOffsets, testElementIndices,
+                  rowCounts, colCounts);
 
-    // Find all the unique quadrature variants present
-    typedef std::set<QuadVariant> QuadVariantSet;
-    // Set of unique quadrature variants
-    QuadVariantSet uniqueQuadVariants(quadVariants.begin(), quadVariants.end());
+    // Integration will proceed in batches of element pairs having the same
+    // "quadrature variant", i.e. integrator, test shapeset and trial shapeset.
+    // Group the pairs by quadrature variant (counting sort).
+    const int quadVariantCount = quadVariantList.size();
+    std::vector<int> variantStarts(quadVariantCount + 1, 0);
+    for (int i = 0; i < elementPairCount; ++i)
+        ++variantStarts[quadVariantIds[i] + 1];
+    for (int v = 0; v < quadVariantCount; ++v)
+        variantStarts[v + 1] += variantStarts[v];
+    std::vector<ElementIndexPair> sortedElementPairs(elementPairCount);
+    std::vector<int> sortedCacheEntries(elementPairCount);
+    {
+        std::vector<int> nextSlot(variantStarts.begin(), variantStarts.end() - 1);
+        for (int trialElementIndex = 0; trialElementIndex < trialElementCount;
+             ++trialElementIndex)
+            for (int i = trialElementOffsets[trialElementIndex];
+                 i < trialElementOffsets[trialElementIndex + 1]; ++i) {
+                const int slot = nextSlot[quadVariantIds[i]]++;
+                sortedElementPairs[slot] =
+                        ElementIndexPair(testElementIndices[i], trialElementIndex);
+                sortedCacheEntries[slot] = i;
+            }
+    }
+    std::vector<int>().swap(quadVariantIds);
 
     std::vector<ElementIndexPair> activeElementPairs;
-    std::vector<arma::Mat<ResultType>*> activeLocalResults;
-    activeElementPairs.reserve(elementPairCount);
-    activeLocalResults.reserve(elementPairCount);
-    // m_cache.rehash(int(elementIndexPairs.size() / m_cache.max_load_factor() + 1));
-
-    int maxThreadCount = 1;
-    if (!m_parallelizationOptions.isOpenClEnabled()) {
-        if (m_parallelizationOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = m_parallelizationOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    std::vector<int> activeCacheEntries;
 
-    // Now loop over unique quadrature variants
-    for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
-         it != uniqueQuadVariants.end(); ++it) {
-        const QuadVariant activeQuadVariant = *it;
-        const Integrator& activeIntegrator = *it->template get<0>();
-        const Shapeset& activeTestShapeset  = *it->template get<1>();
-        const Shapeset& activeTrialShapeset = *it->template get<2>();
+    ExecutionContext& executionContext = ExecutionContext::instance();
+    const size_t grainSize =
+            ExecutionContext::grainSize(m_parallelizationOptions);
 
-        // Find all the element pairs for which quadrature should proceed
-        // according to the current quadrature variant
-        activeElementPairs.clear();
-        activeLocalResults.clear();
-        {
-            ElementIndexPairIterator pairIt = elementIndexPairs.begin();
-            QuadVariantIterator qvIt = quadVariants.begin();
-            size_t neighbourIndex = 0; // Cache row index
-            size_t curTrialElementIndex = pairIt->second; // Cache column index
-            for (; pairIt != elementIndexPairs.end(); ++pairIt, ++qvIt) {
-                if (pairIt->second != curTrialElementIndex) {
-                    // Go to the next column of cache
-                    curTrialElementIndex = pairIt->second;
-                    neighbourIndex = 0;
-                }
-                if (*qvIt == activeQuadVariant) {
-                    activeElementPairs.push_back(*pairIt);
-                    m_cache(neighbourIndex, curTrialElementIndex).first = pairIt->first;
-                    activeLocalResults.push_back(
-                        &m_cache(neighbourIndex, curTrialElementIndex).second);
-                }
-                // Increment cache row index
-                ++neighbourIndex;
-            }
-        }
+    // Now loop over unique quadrature variants
+    for (int v = 0; v < quadVariantCount; ++v) {
+        const Integrator& activeIntegrator = *quadVariantList[v].template get<0>();
+        const Shapeset& activeTestShapeset  = *quadVariantList[v].template get<1>();
+        const Shapeset& activeTrialShapeset = *quadVariantList[v].template get<2>();
+
+        // Element pairs for which quadrature should proceed according to the
+        // current quadrature variant
+        activeElementPairs.assign(sortedElementPairs.begin() + variantStarts[v],
+                                  sortedElementPairs.begin() + variantStarts[v + 1]);
+        activeCacheEntries.assign(sortedCacheEntries.begin() + variantStarts[v],
+                                  sortedCacheEntries.begin() + variantStarts[v + 1]);
 
         // Integrate!
-        // Old serial version
-        // activeIntegrator.integrate(activeElementPairs, activeTestShapeset,
-        //                            activeTrialShapeset, localResult);
-
         typedef SingularIntegralCalculatorLoopBody<
                 BasisFunctionType, KernelType, ResultType> Body;
         {
             Fiber::SerialBlasRegion region;
-            tbb::parallel_for(tbb::blocked_range<size_t>(0, activeElementPairs.size()),
-                              Body(activeIntegrator,
-                                   activeElementPairs, activeTestShapeset, activeTrialShapeset,
-                                   activeLocalResults));
+            executionContext.parallelFor(
+                        m_parallelizationOptions,
+                        tbb::blocked_range<size_t>(
+                            0, activeElementPairs.size(), grainSize),
+                        Body(activeIntegrator,
+                             activeElementPairs, activeTestShapeset, activeTrialShapeset,
+                             activeCacheEntries, m_cache));
         }
     }
     tbb::tick_count end = tbb::tick_count::now();
     if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
         std::cout << "Precalculation of singular integrals took "
                   << (end - start).seconds() << " s" << std::endl;
+    if (m_verbosityLevel >= VerbosityLevel::HIGH)
+        std::cout << "Singular integral cache: " << m_cache.entryCount()
+                  << " local weak forms, " << m_cache.memoryUsage()
+                  << " bytes" << std::endl;
 }
 
 template <typename BasisFunctionType, typename KernelType,
@@ -605,67 +594,48 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<BasisFunctionType,
 KernelType, ResultType, GeometryFactory>::
 getIntegrator(const DoubleQuadratureDescriptor& desc)
 {
-    typename IntegratorMap::iterator it = m_testKernelTrialIntegrators.find(desc);
-    // Note: as far as I understand TBB's docs, .end() keeps pointing to the
-    // same element even if another thread inserts a new element into the map
-    if (it == m_testKernelTrialIntegrators.end()) {
-        tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
-        it = m_testKernelTrialIntegrators.find(desc);
-        if (it == m_testKernelTrialIntegrators.end()) {
-            // std::cout << "getIntegrator(" << desc
-            //           << "): creating an integrator" << std::endl;
-            // Integrator doesn't exist yet and must be created.
-            arma::Mat<CoordinateType> testPoints, trialPoints;
-            std::vector<CoordinateType> testWeights, trialWeights;
-            bool isTensor;
-            m_quadRuleFamily->fillQuadraturePointsAndWeights(
-                desc, testPoints, trialPoints,
-                testWeights, trialWeights, isTensor);
-            Integrator* integrator = 0;
-            if (isTensor) {
-                typedef SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType,
-                        KernelType, ResultType, GeometryFactory> ConcreteIntegrator;
-                integrator = new ConcreteIntegrator(
-                            testPoints, trialPoints, testWeights, trialWeights,
-                            *m_testGeometryFactory, *m_trialGeometryFactory,
-                            *m_testRawGeometry, *m_trialRawGeometry,
-                            *m_testTransformations, *m_kernels, *m_trialTransformations,
-                            *m_integral,
-                            *m_openClHandler);
-            } else {
-                typedef NonseparableNumericalTestKernelTrialIntegrator<BasisFunctionType,
-                        KernelType, ResultType, GeometryFactory> ConcreteIntegrator;
-                integrator = new ConcreteIntegrator(
-                            testPoints, trialPoints, testWeights,
-                            *m_testGeometryFactory, *m_trialGeometryFactory,
-                            *m_testRawGeometry, *m_trialRawGeometry,
-                            *m_testTransformations, *m_kernels, *m_trialTransformations,
-                            *m_integral,
-                            *m_openClHandler);
-            }
-
-            // Attempt to insert the newly created integrator into the map
-            std::pair<typename IntegratorMap::iterator, bool> result =
-                    m_testKernelTrialIntegrators.insert(std::make_pair(desc, integrator));
-            if (result.second)
-                // Insertion succeeded. The newly created integrator will be deleted in
-                // our own destructor
-                ;
-            else
-                // Insertion failed -- another thread was faster. Delete the newly
-                // created integrator.
-                delete integrator;
-
-            //    if (result.second)
-            //        std::cout << "getIntegrator(: " << desc << "): insertion succeeded" << std::endl;
-            //    else
-            //        std::cout << "getIntegrator(: " << desc << "): insertion failed" << std::endl;
-
-            // Return pointer to the integrator that ended up in the map.
-            it = result.first;
-        }
+    // Fast path: lock-free lookup of an existing integrator
+    if (const Integrator* integrator = m_testKernelTrialIntegrators.find(desc))
+        return *integrator;
+
+    tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
+    // Another thread may have created the integrator in the meantime
+    if (const Integrator* integrator = m_testKernelTrialIntegrators.find(desc))
+        return *integrator;
+
+    // Integrator doesn't exist yet and must be created.
+    arma::Mat<CoordinateType> testPoints, trialPoints;
+    std::vector<CoordinateType> testWeights, trialWeights;
+    bool isTensor;
+    m_quadRuleFamily->fillQuadraturePointsAndWeights(
+        desc, testPoints, trialPoints,
+        testWeights, trialWeights, isTensor);
+    std::auto_ptr<Integrator> integrator;
+    if (isTensor) {
+        typedef SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType,
+                KernelType, ResultType, GeometryFactory> ConcreteIntegrator;
+        integrator.reset(new ConcreteIntegrator(
+                    testPoints, trialPoints, testWeights, trialWeights,
+                    *m_testGeometryFactory, *m_trialGeometryFactory,
+                    *m_testRawGeometry, *m_trialRawGeometry,
+                    *m_testTransformations, *m_kernels, *m_trialTransformations,
+                    *m_integral,
+                    *m_openClHandler));
+    } else {
+        typedef NonseparableNumericalTestKernelTrialIntegrator<BasisFunctionType,
+                KernelType, ResultType, GeometryFactory> ConcreteIntegrator;
+        integrator.reset(new ConcreteIntegrator(
+                    testPoints, trialPoints, testWeights,
+                    *m_testGeometryFactory, *m_trialGeometryFactory,
+                    *m_testRawGeometry, *m_trialRawGeometry,
+                    *m_testTransformations, *m_kernels, *m_trialTransformations,
+                    *m_integral,
+                    *m_openClHandler));
     }
-    return *it->second;
+
+    // Insertion is serialised by m_integratorCreationMutex; concurrent
+    // lookups see the new integrator as soon as it has been published
+    return m_testKernelTrialIntegrators.insert(desc, integrator);
 }
 
 } // namespace Fiber
@@ -30,7 +30,7 @@
 #include "shared_ptr.hpp"
 
 #include "../common/armadillo_fwd.hpp"
-#include "../common/boost_ptr_map_fwd.hpp"
+#include <tbb/concurrent_unordered_map.h>
 #include <cstring>
 #include <iostream>
 #include <map>
@@ -67,7 +67,11 @@ public:
         const shared_ptr<const OpenClHandler>& openClHandler,
         const shared_ptr<const QuadratureDescriptorSelectorForLocalOperators<CoordinateType> >& quadDescSelector,
         const shared_ptr<const SingleQuadratureRuleFamily<CoordinateType> >& quadRuleFamily);
+    virtual ~DefaultLocalAssemblerForLocalOperatorsOnSurfaces();
 
+    /** \brief Assemble local weak forms.
+
+      This function may be called concurrently from several threads. */
     virtual void evaluateLocalWeakForms(
         const std::vector<int>& elementIndices,
         std::vector<arma::Mat<ResultType> >& result);
@@ -81,8 +85,8 @@ private:
         const SingleQuadratureDescriptor& desc);
 
 private:
-    typedef boost::ptr_map<SingleQuadratureDescriptor,
-            TestTrialIntegrator<BasisFunctionType, ResultType> > IntegratorMap;
+    typedef tbb::concurrent_unordered_map<SingleQuadratureDescriptor,
+            TestTrialIntegrator<BasisFunctionType, ResultType>*> IntegratorMap;
     typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
             BasisFunctionType> Utilities;
 
@@ -59,6 +59,19 @@ DefaultLocalAssemblerForLocalOperatorsOnSurfaces(
 {
 }
 
+template <typename BasisFunctionType, typename ResultType, typename GeometryFactory>
+DefaultLocalAssemblerForLocalOperatorsOnSurfaces<BasisFunctionType, ResultType, GeometryFactory>::
+~DefaultLocalAssemblerForLocalOperatorsOnSurfaces()
+{
+    // Note: obviously the destructor is assumed to be called only after
+    // all threads have ceased using the assembler!
+
+    for (typename IntegratorMap::const_iterator it = m_testTrialIntegrators.begin();
+         it != m_testTrialIntegrators.end(); ++it)
+        delete it->second;
+    m_testTrialIntegrators.clear();
+}
+
 template <typename BasisFunctionType, typename ResultType, typename GeometryFactory>
 void
 DefaultLocalAssemblerForLocalOperatorsOnSurfaces<BasisFunctionType, ResultType, GeometryFactory>::
@@ -152,14 +165,23 @@ getIntegrator(const SingleQuadratureDescriptor& desc)
 
     typedef NumericalTestTrialIntegrator<BasisFunctionType, ResultType,
             GeometryFactory> Integrator;
-    std::auto_ptr<TestTrialIntegrator<BasisFunctionType, ResultType> > integrator(
+    TestTrialIntegrator<BasisFunctionType, ResultType>* integrator(
         new Integrator(points, weights,
                        *m_geometryFactory, *m_rawGeometry,
                        *m_testTransformations, *m_trialTransformations,
                        *m_integral,
                        *m_openClHandler));
 
-    return *m_testTrialIntegrators.insert(desc, integrator).first->second;
+    // Attempt to insert the newly created integrator into the map
+    std::pair<typename IntegratorMap::iterator, bool> result =
+            m_testTrialIntegrators.insert(std::make_pair(desc, integrator));
+    if (!result.second)
+        // Insertion failed -- another thread was faster. Delete the newly
+        // created integrator.
+        delete integrator;
+
+    // Return reference to the integrator that ended up in the map.
+    return *result.first->second;
 }
 
 } // namespace Fiber
@@ -1,9 +1,12 @@
 #include "default_local_assembler_for_operators_on_surfaces_utilities.hpp"
 
 #include "shapeset.hpp"
+#include "element_sizes_and_centers.hpp"
 #include "explicit_instantiation.hpp"
 #include "raw_grid_geometry.hpp"
 
+#include "../common/boost_make_shared_fwd.hpp"
+
 namespace Fiber
 {
 
@@ -67,6 +70,25 @@ precalculateElementSizesAndCentersForSingleGrid(
         elementCenters.col(e) = elementCenter(e, rawGeometry);
 }
 
+template <typename BasisFunctionType>
+shared_ptr<const ElementSizesAndCenters<
+typename DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
+BasisFunctionType>::CoordinateType> >
+DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<BasisFunctionType>::
+elementSizesAndCenters(const RawGridGeometry<CoordinateType>& rawGeometry)
+{
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> > result =
+            rawGeometry.elementSizesAndCenters();
+    if (result)
+        return result;
+    shared_ptr<ElementSizesAndCenters<CoordinateType> > newResult =
+            boost::make_shared<ElementSizesAndCenters<CoordinateType> >();
+    precalculateElementSizesAndCentersForSingleGrid(
+                rawGeometry, newResult->sizesSquared, newResult->centers,
+                newResult->averageSize);
+    return newResult;
+}
+
 template <typename BasisFunctionType>
 inline
 typename DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
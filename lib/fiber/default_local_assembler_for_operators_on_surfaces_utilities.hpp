@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 
 #include "scalar_traits.hpp"
+#include "shared_ptr.hpp"
 #include "../common/armadillo_fwd.hpp"
 
 #include <vector>
@@ -33,6 +34,7 @@ namespace Fiber
 
 template <typename BasisFunctionType> class Shapeset;
 template <typename CoordinateType> class RawGridGeometry;
+template <typename CoordinateType> struct ElementSizesAndCenters;
 
 // These are internal routines used by the
 // DefaultLocalAssemblerFor*OperatorsOnSurfaces classes. They are not part of
@@ -54,6 +56,14 @@ public:
             arma::Mat<CoordinateType>& elementCenters,
             CoordinateType& averageElementSize);
 
+    /** \brief Return the sizes and centres of the elements of
+     *  \p rawGeometry.
+     *
+     *  If these data have been attached to \p rawGeometry, they are
+     *  returned directly; otherwise they are calculated. */
+    static shared_ptr<const ElementSizesAndCenters<CoordinateType> >
+    elementSizesAndCenters(const RawGridGeometry<CoordinateType>& rawGeometry);
+
 private:
     static CoordinateType elementSizeSquared(
             int elementIndex,
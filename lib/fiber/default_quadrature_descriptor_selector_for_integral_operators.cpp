@@ -21,6 +21,7 @@
 #include "default_quadrature_descriptor_selector_for_integral_operators.hpp"
 
 #include "default_local_assembler_for_operators_on_surfaces_utilities.hpp"
+#include "element_sizes_and_centers.hpp"
 #include "explicit_instantiation.hpp"
 #include "quadrature_options.hpp"
 #include "raw_grid_geometry.hpp"
@@ -65,26 +66,30 @@ void
 DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
 precalculateElementSizesAndCenters()
 {
-    CoordinateType averageTestElementSize;
-    Utilities::precalculateElementSizesAndCentersForSingleGrid(
-                *m_testRawGeometry,
-                m_testElementSizesSquared, m_testElementCenters,
-                averageTestElementSize);
+    // These data are reused if they have been attached to the raw geometry
+    m_testElementSizesAndCenters =
+            Utilities::elementSizesAndCenters(*m_testRawGeometry);
     if (testAndTrialGridsAreIdentical()) {
-        m_trialElementSizesSquared = m_testElementSizesSquared;
-        m_trialElementCenters = m_testElementCenters;
-        m_averageElementSize = averageTestElementSize;
+        m_trialElementSizesAndCenters = m_testElementSizesAndCenters;
+        m_averageElementSize = m_testElementSizesAndCenters->averageSize;
     } else {
-        CoordinateType averageTrialElementSize;
-        Utilities::precalculateElementSizesAndCentersForSingleGrid(
-                    *m_trialRawGeometry,
-                    m_trialElementSizesSquared, m_trialElementCenters,
-                    averageTrialElementSize);
+        m_trialElementSizesAndCenters =
+                Utilities::elementSizesAndCenters(*m_trialRawGeometry);
         m_averageElementSize =
-                (averageTestElementSize + averageTrialElementSize) / 2.;
+                (m_testElementSizesAndCenters->averageSize +
+                 m_trialElementSizesAndCenters->averageSize) / 2.;
     }
 }
 
+template <typename BasisFunctionType>
+std::string
+DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
+signature() const
+{
+    return typeid(*this).name() + std::string(" ") +
+            m_accuracyOptions.toString();
+}
+
 template <typename BasisFunctionType>
 DoubleQuadratureDescriptor
 DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
@@ -141,9 +146,9 @@ getRegularOrders(int testElementIndex, int trialElementIndex,
     CoordinateType normalisedDistance;
     if (nominalDistance < 0.) {
         CoordinateType testElementSizeSquared =
-                m_testElementSizesSquared[testElementIndex];
+                m_testElementSizesAndCenters->sizesSquared[testElementIndex];
         CoordinateType trialElementSizeSquared =
-                m_trialElementSizesSquared[trialElementIndex];
+                m_trialElementSizesAndCenters->sizesSquared[trialElementIndex];
         CoordinateType distanceSquared =
                 elementDistanceSquared(testElementIndex, trialElementIndex);
         CoordinateType normalisedDistanceSquared =
@@ -186,11 +191,15 @@ DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
 elementDistanceSquared(
         int testElementIndex, int trialElementIndex) const
 {
+    const arma::Mat<CoordinateType>& testElementCenters =
+            m_testElementSizesAndCenters->centers;
+    const arma::Mat<CoordinateType>& trialElementCenters =
+            m_trialElementSizesAndCenters->centers;
     CoordinateType result = 0.;
     const int dimWorld = 3;
     for (int d = 0; d < dimWorld; ++d) {
-        CoordinateType diff = m_trialElementCenters(d, trialElementIndex) -
-                m_testElementCenters(d, testElementIndex);
+        CoordinateType diff = trialElementCenters(d, trialElementIndex) -
+                testElementCenters(d, testElementIndex);
         result += diff * diff;
     }
     return result;
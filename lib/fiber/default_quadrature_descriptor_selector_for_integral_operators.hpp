@@ -32,6 +32,7 @@ namespace Fiber
 
 template <typename BasisFunctionType> class Shapeset;
 template <typename CoordinateType> class RawGridGeometry;
+template <typename CoordinateType> struct ElementSizesAndCenters;
 template <typename BasisFunctionType>
 class DefaultLocalAssemblerForOperatorsOnSurfacesUtilities;
 
@@ -61,6 +62,8 @@ public:
         int testElementIndex, int trialElementIndex,
         CoordinateType nominalDistance) const;
 
+    virtual std::string signature() const;
+
 private:
     /** \cond PRIVATE */
     typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
@@ -87,10 +90,10 @@ private:
                    const Shapeset<BasisFunctionType>*> > m_trialShapesets;
     AccuracyOptionsEx m_accuracyOptions;
 
-    std::vector<CoordinateType> m_testElementSizesSquared;
-    std::vector<CoordinateType> m_trialElementSizesSquared;
-    arma::Mat<CoordinateType> m_testElementCenters;
-    arma::Mat<CoordinateType> m_trialElementCenters;
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> >
+    m_testElementSizesAndCenters;
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> >
+    m_trialElementSizesAndCenters;
     CoordinateType m_averageElementSize;
     /** \endcond */
 };
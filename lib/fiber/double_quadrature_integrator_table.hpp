@@ -0,0 +1,215 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_double_quadrature_integrator_table_hpp
+#define fiber_double_quadrature_integrator_table_hpp
+
+#include "../common/common.hpp"
+
+#include "double_quadrature_descriptor.hpp"
+
+#include <map>
+#include <memory>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Table of integrators indexed by double quadrature descriptors.
+ *
+ *  The integrators are stored in a dense two-level array. The first level
+ *  is indexed by a compact code of the element pair topology (the shape of
+ *  the pair and the numbers of vertices of both elements), the second by
+ *  the test and trial quadrature orders. Second-level arrays are allocated
+ *  only for topologies that actually occur.
+ *
+ *  Looking up an integrator with find() takes no locks: it costs the
+ *  computation of the topology code and two atomic loads. Descriptors
+ *  that do not fit into the dense array (quadrature orders larger than
+ *  MAX_DENSE_ORDER or unsupported topologies) are stored in a map protected
+ *  by a mutex.
+ *
+ *  find() can be called concurrently with other calls to find() and with
+ *  insert(). Calls to insert() must be serialised by the caller, which
+ *  normally needs a lock anyway to avoid creating the same integrator
+ *  twice.
+ *
+ *  \tparam Integrator
+ *    Type of the stored integrators. The table takes ownership of the
+ *    inserted objects. */
+template <typename Integrator>
+class DoubleQuadratureIntegratorTable
+{
+public:
+    /** \brief Largest quadrature order stored in the dense array. */
+    enum { MAX_DENSE_ORDER = 31 };
+
+    /** \brief Constructor. */
+    DoubleQuadratureIntegratorTable() :
+        m_orderTables(TOPOLOGY_CODE_COUNT) {
+        for (size_t i = 0; i < m_orderTables.size(); ++i)
+            m_orderTables[i] = 0;
+    }
+
+    /** \brief Destructor.
+     *
+     *  Deletes all the stored integrators. */
+    ~DoubleQuadratureIntegratorTable() {
+        for (size_t i = 0; i < m_orderTables.size(); ++i)
+            delete static_cast<OrderTable*>(m_orderTables[i]);
+        for (size_t i = 0; i < m_integrators.size(); ++i)
+            delete m_integrators[i];
+    }
+
+    /** \brief Return the integrator stored for the descriptor \p desc, or a
+     *  null pointer if there is none. */
+    const Integrator* find(const DoubleQuadratureDescriptor& desc) const {
+        const int code = topologyCode(desc.topology);
+        if (code >= 0 && fitsIntoDenseArray(desc)) {
+            const OrderTable* orderTable = m_orderTables[code];
+            if (!orderTable)
+                return 0;
+            return orderTable->slots[slotIndex(desc)];
+        } else {
+            tbb::mutex::scoped_lock lock(m_overflowMutex);
+            typename OverflowMap::const_iterator it = m_overflow.find(desc);
+            return it == m_overflow.end() ? 0 : it->second;
+        }
+    }
+
+    /** \brief Store an integrator for the descriptor \p desc.
+     *
+     *  If an integrator has already been stored for \p desc, \p integrator
+     *  is deleted and the existing integrator is returned. Otherwise the
+     *  table takes ownership of \p integrator and returns a reference to
+     *  it. */
+    const Integrator& insert(const DoubleQuadratureDescriptor& desc,
+                             std::auto_ptr<Integrator> integrator) {
+        if (const Integrator* existing = find(desc))
+            return *existing;
+
+        // Take ownership before publishing the integrator, so that a
+        // failing push_back() cannot leave a dangling pointer in the table
+        m_integrators.push_back(integrator.get());
+        const Integrator* result = integrator.release();
+        const int code = topologyCode(desc.topology);
+        if (code >= 0 && fitsIntoDenseArray(desc)) {
+            OrderTable* orderTable = m_orderTables[code];
+            if (!orderTable) {
+                orderTable = new OrderTable;
+                for (int i = 0; i < ORDER_SLOT_COUNT; ++i)
+                    orderTable->slots[i] = 0;
+                // Publish the table only once it is fully initialised
+                m_orderTables[code] = orderTable;
+            }
+            orderTable->slots[slotIndex(desc)] = result;
+        } else {
+            tbb::mutex::scoped_lock lock(m_overflowMutex);
+            m_overflow[desc] = result;
+        }
+        return *result;
+    }
+
+    /** \brief Number of stored integrators. */
+    size_t size() const {
+        return m_integrators.size();
+    }
+
+private:
+    /** \cond PRIVATE */
+    enum {
+        // Shapes: disjoint (1), shared vertex (4 x 4), shared edge
+        // (16 x 16), coincident (1); each combined with 2 x 2 possible
+        // numbers of vertices
+        SHAPE_COUNT = 1 + 16 + 256 + 1,
+        TOPOLOGY_CODE_COUNT = 4 * SHAPE_COUNT,
+        ORDER_SLOT_COUNT = (MAX_DENSE_ORDER + 1) * (MAX_DENSE_ORDER + 1)
+    };
+
+    struct OrderTable
+    {
+        tbb::atomic<const Integrator*> slots[ORDER_SLOT_COUNT];
+    };
+
+    typedef std::map<DoubleQuadratureDescriptor, const Integrator*>
+    OverflowMap;
+
+    // Forbid copying
+    DoubleQuadratureIntegratorTable(const DoubleQuadratureIntegratorTable&);
+    DoubleQuadratureIntegratorTable& operator=(
+            const DoubleQuadratureIntegratorTable&);
+
+    /** \brief Return the compact code of \p topology or -1 if it is not
+     *  representable. */
+    static int topologyCode(const ElementPairTopology& topology) {
+        const unsigned testVertexCountCode = topology.testVertexCount - 3u;
+        const unsigned trialVertexCountCode = topology.trialVertexCount - 3u;
+        if (testVertexCountCode > 1u || trialVertexCountCode > 1u)
+            return -1;
+        const unsigned testV0 = topology.testSharedVertex0;
+        const unsigned testV1 = topology.testSharedVertex1;
+        const unsigned trialV0 = topology.trialSharedVertex0;
+        const unsigned trialV1 = topology.trialSharedVertex1;
+        int shape;
+        switch (topology.type) {
+        case ElementPairTopology::Disjoint:
+            shape = 0;
+            break;
+        case ElementPairTopology::SharedVertex:
+            if (testV0 > 3u || trialV0 > 3u)
+                return -1;
+            shape = 1 + 4 * testV0 + trialV0;
+            break;
+        case ElementPairTopology::SharedEdge:
+            if (testV0 > 3u || testV1 > 3u || trialV0 > 3u || trialV1 > 3u)
+                return -1;
+            shape = 17 + 16 * (4 * testV0 + testV1) + (4 * trialV0 + trialV1);
+            break;
+        case ElementPairTopology::Coincident:
+            shape = SHAPE_COUNT - 1;
+            break;
+        default:
+            return -1;
+        }
+        return 4 * shape + testVertexCountCode + 2 * trialVertexCountCode;
+    }
+
+    static bool fitsIntoDenseArray(const DoubleQuadratureDescriptor& desc) {
+        return unsigned(desc.testOrder) <= unsigned(MAX_DENSE_ORDER) &&
+                unsigned(desc.trialOrder) <= unsigned(MAX_DENSE_ORDER);
+    }
+
+    static int slotIndex(const DoubleQuadratureDescriptor& desc) {
+        return desc.testOrder + (MAX_DENSE_ORDER + 1) * desc.trialOrder;
+    }
+
+private:
+    std::vector<tbb::atomic<OrderTable*> > m_orderTables;
+    OverflowMap m_overflow;
+    mutable tbb::mutex m_overflowMutex;
+    std::vector<Integrator*> m_integrators;
+    /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
@@ -0,0 +1,174 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "element_adjacency.hpp"
+
+#include "execution_context.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+
+namespace Fiber
+{
+
+namespace
+{
+
+// Collects, sorted and without duplicates, the indices of the elements
+// sharing at least one vertex with element e
+class NeighbourCollector
+{
+public:
+    NeighbourCollector(const arma::Mat<int>& elementCornerIndices,
+                       const std::vector<int>& vertexOffsets,
+                       const std::vector<int>& vertexElements) :
+        m_elementCornerIndices(elementCornerIndices),
+        m_vertexOffsets(vertexOffsets),
+        m_vertexElements(vertexElements) {
+    }
+
+    void collect(int e, std::vector<int>& neighbours) const {
+        neighbours.clear();
+        const int maxCornerCount = m_elementCornerIndices.n_rows;
+        for (int c = 0; c < maxCornerCount; ++c) {
+            const int v = m_elementCornerIndices(c, e);
+            if (v < 0)
+                continue;
+            neighbours.insert(neighbours.end(),
+                              m_vertexElements.begin() + m_vertexOffsets[v],
+                              m_vertexElements.begin() + m_vertexOffsets[v + 1]);
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                         neighbours.end());
+    }
+
+private:
+    const arma::Mat<int>& m_elementCornerIndices;
+    const std::vector<int>& m_vertexOffsets;
+    const std::vector<int>& m_vertexElements;
+};
+
+class NeighbourCountLoopBody
+{
+public:
+    NeighbourCountLoopBody(const NeighbourCollector& collector,
+                           std::vector<int>& offsets) :
+        m_collector(collector), m_offsets(offsets) {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        std::vector<int> neighbours;
+        for (int e = r.begin(); e != r.end(); ++e) {
+            m_collector.collect(e, neighbours);
+            m_offsets[e + 1] = neighbours.size();
+        }
+    }
+
+private:
+    const NeighbourCollector& m_collector;
+    std::vector<int>& m_offsets;
+};
+
+class NeighbourFillLoopBody
+{
+public:
+    NeighbourFillLoopBody(const NeighbourCollector& collector,
+                          const std::vector<int>& offsets,
+                          std::vector<int>& allNeighbours) :
+        m_collector(collector), m_offsets(offsets),
+        m_allNeighbours(allNeighbours) {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        std::vector<int> neighbours;
+        for (int e = r.begin(); e != r.end(); ++e) {
+            m_collector.collect(e, neighbours);
+            std::copy(neighbours.begin(), neighbours.end(),
+                      m_allNeighbours.begin() + m_offsets[e]);
+        }
+    }
+
+private:
+    const NeighbourCollector& m_collector;
+    const std::vector<int>& m_offsets;
+    std::vector<int>& m_allNeighbours;
+};
+
+} // namespace
+
+ElementAdjacency::ElementAdjacency(
+        const arma::Mat<int>& elementCornerIndices,
+        int vertexCount,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    const int elementCount = elementCornerIndices.n_cols;
+    const int maxCornerCount = elementCornerIndices.n_rows;
+
+    // Build the lists of elements adjacent to each vertex (counting sort)
+    std::vector<int> vertexOffsets(vertexCount + 1, 0);
+    for (int e = 0; e < elementCount; ++e)
+        for (int c = 0; c < maxCornerCount; ++c) {
+            const int v = elementCornerIndices(c, e);
+            if (v >= vertexCount)
+                throw std::invalid_argument(
+                        "ElementAdjacency::ElementAdjacency(): "
+                        "invalid vertex index");
+            if (v >= 0)
+                ++vertexOffsets[v + 1];
+        }
+    for (int v = 0; v < vertexCount; ++v)
+        vertexOffsets[v + 1] += vertexOffsets[v];
+    std::vector<int> vertexElements(vertexOffsets[vertexCount]);
+    {
+        std::vector<int> nextSlot(vertexOffsets.begin(), vertexOffsets.end() - 1);
+        for (int e = 0; e < elementCount; ++e)
+            for (int c = 0; c < maxCornerCount; ++c) {
+                const int v = elementCornerIndices(c, e);
+                if (v >= 0)
+                    vertexElements[nextSlot[v]++] = e;
+            }
+    }
+
+    // Count the neighbours of each element, allocate storage for the lists
+    // and finally fill them in
+    NeighbourCollector collector(elementCornerIndices,
+                                 vertexOffsets, vertexElements);
+    ExecutionContext& executionContext = ExecutionContext::instance();
+    const int grainSize = std::max<size_t>(
+                ExecutionContext::grainSize(parallelizationOptions), 256);
+
+    m_offsets.assign(elementCount + 1, 0);
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<int>(0, elementCount, grainSize),
+                NeighbourCountLoopBody(collector, m_offsets));
+    for (int e = 0; e < elementCount; ++e)
+        m_offsets[e + 1] += m_offsets[e];
+
+    m_neighbours.resize(m_offsets[elementCount]);
+    executionContext.parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<int>(0, elementCount, grainSize),
+                NeighbourFillLoopBody(collector, m_offsets, m_neighbours));
+}
+
+} // namespace Fiber
@@ -0,0 +1,101 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_adjacency_hpp
+#define fiber_element_adjacency_hpp
+
+#include "../common/common.hpp"
+
+#include "parallelization_options.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Lists of elements sharing at least one vertex with each element
+ *  of a grid.
+ *
+ *  The lists are stored in compressed-sparse-row format: the neighbours of
+ *  element \p e are
+ *  <tt>neighbours()[offsets()[e]]</tt>, ...,
+ *  <tt>neighbours()[offsets()[e + 1] - 1]</tt>,
+ *  sorted in ascending order. Each element is regarded as a neighbour of
+ *  itself. Since the relation is symmetric, the list of element \p e can be
+ *  used both as the list of test elements adjacent to the trial element \p e
+ *  and vice versa.
+ *
+ *  The lists are built in parallel, without any intermediate storage other
+ *  than the vertex-to-element incidence lists. */
+class ElementAdjacency
+{
+public:
+    /** \brief Constructor.
+     *
+     *  \param[in] elementCornerIndices
+     *    Matrix whose (i, j)th element contains the index of the ith corner
+     *    of the jth element, or a negative number if the jth element has
+     *    fewer than i + 1 corners (see RawGridGeometry::elementCornerIndices()).
+     *  \param[in] vertexCount
+     *    Number of vertices in the grid.
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used to build the lists. */
+    ElementAdjacency(const arma::Mat<int>& elementCornerIndices,
+                     int vertexCount,
+                     const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+    /** \brief Number of elements. */
+    int elementCount() const {
+        return int(m_offsets.size()) - 1;
+    }
+
+    /** \brief Total number of (ordered) pairs of adjacent elements. */
+    size_t pairCount() const {
+        return m_neighbours.size();
+    }
+
+    /** \brief Offsets of the neighbour lists of consecutive elements in the
+     *  array returned by neighbours(). Has elementCount() + 1 entries. */
+    const std::vector<int>& offsets() const {
+        return m_offsets;
+    }
+
+    /** \brief Concatenated neighbour lists of all elements. */
+    const std::vector<int>& neighbours() const {
+        return m_neighbours;
+    }
+
+    /** \brief Approximate number of bytes occupied by the lists. */
+    size_t memoryUsage() const {
+        return (m_offsets.size() + m_neighbours.size()) * sizeof(int);
+    }
+
+private:
+    /** \cond PRIVATE */
+    std::vector<int> m_offsets;
+    std::vector<int> m_neighbours;
+    /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
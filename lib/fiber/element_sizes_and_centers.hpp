@@ -0,0 +1,53 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_sizes_and_centers_hpp
+#define fiber_element_sizes_and_centers_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Sizes and centres of all elements of a grid.
+ *
+ *  These data are used by quadrature descriptor selectors to estimate the
+ *  distance between elements relative to their sizes. */
+template <typename CoordinateType>
+struct ElementSizesAndCenters
+{
+    /** \brief Squared sizes of elements.
+     *
+     *  The size of an element is the length of its longest edge (for
+     *  triangles) or diagonal (for quadrilaterals). */
+    std::vector<CoordinateType> sizesSquared;
+    /** \brief Element centres; the jth column contains the coordinates of
+     *  the centre of the jth element. */
+    arma::Mat<CoordinateType> centers;
+    /** \brief Average element size. */
+    CoordinateType averageSize;
+};
+
+} // namespace Fiber
+
+#endif
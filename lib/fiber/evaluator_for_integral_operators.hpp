@@ -29,12 +29,25 @@
 namespace Fiber
 {
 
+/** \cond FORWARD_DECL */
+struct HierarchicalEvaluationOptions;
+struct NearFieldEvaluationOptions;
+/** \endcond */
+
 template <typename ResultType>
 class EvaluatorForIntegralOperators
 {
 public:
     typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
 
+    /** \brief Regions of space where a potential can be evaluated.
+     *
+     *  In the FAR_FIELD region, the contribution of each element is
+     *  integrated with the same, fixed quadrature rule. In the NEAR_FIELD
+     *  region, the contributions of elements lying close to the evaluation
+     *  point are in addition corrected as described in
+     *  applyNearFieldCorrections(), with the default
+     *  NearFieldEvaluationOptions. */
     enum Region {
         NEAR_FIELD, FAR_FIELD
     };
@@ -44,6 +57,32 @@ public:
     virtual void evaluate(Region region,
                           const arma::Mat<CoordinateType>& points,
                           arma::Mat<ResultType>& result) const = 0;
+
+    /** \brief Evaluate the potential at \p points using cluster trees of
+     *  the evaluation points and the trial quadrature points.
+     *
+     *  The potential generated by well-separated clusters of quadrature
+     *  points is interpolated from its values at the Chebyshev nodes of the
+     *  boxes containing the evaluation points; see
+     *  HierarchicalEvaluationOptions for the parameters controlling the
+     *  accuracy. The same quadrature rule as in the FAR_FIELD region is
+     *  used. */
+    virtual void evaluateHierarchically(
+            const arma::Mat<CoordinateType>& points,
+            const HierarchicalEvaluationOptions& options,
+            arma::Mat<ResultType>& result) const = 0;
+
+    /** \brief Correct the values \p result of the potential at \p points,
+     *  calculated in the FAR_FIELD region, for the contributions of
+     *  elements lying close to these points.
+     *
+     *  The contribution of each element lying closer to an evaluation point
+     *  than \p options.relativeDistance times its size is recalculated with
+     *  an adaptively subdivided quadrature rule. */
+    virtual void applyNearFieldCorrections(
+            const arma::Mat<CoordinateType>& points,
+            const NearFieldEvaluationOptions& options,
+            arma::Mat<ResultType>& result) const = 0;
 };
 
 } // namespace Fiber
@@ -0,0 +1,200 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "execution_context.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <tbb/atomic.h>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/task_scheduler_observer.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Fiber
+{
+
+namespace
+{
+
+// Parse a list of CPU indices in the format used by Linux's sysfs,
+// e.g. "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        std::istringstream rangeStream(range);
+        int first = -1, last = -1;
+        char dash = 0;
+        if (!(rangeStream >> first))
+            continue;
+        if (rangeStream >> dash >> last && dash == '-')
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        else
+            cpus.push_back(first);
+    }
+    return cpus;
+}
+
+// Return the list of CPUs ordered so that consecutive entries belong to
+// different NUMA nodes (whenever possible)
+std::vector<int> cpusInterleavedOverNumaNodes()
+{
+    std::vector<std::vector<int> > nodeCpus;
+    for (int node = 0; ; ++node) {
+        std::ostringstream path;
+        path << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream file(path.str().c_str());
+        if (!file)
+            break;
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus = parseCpuList(list);
+        if (!cpus.empty())
+            nodeCpus.push_back(cpus);
+    }
+
+    std::vector<int> result;
+    if (nodeCpus.empty()) {
+        const int cpuCount = tbb::task_scheduler_init::default_num_threads();
+        for (int cpu = 0; cpu < cpuCount; ++cpu)
+            result.push_back(cpu);
+        return result;
+    }
+    size_t maxNodeSize = 0;
+    for (size_t node = 0; node < nodeCpus.size(); ++node)
+        maxNodeSize = std::max(maxNodeSize, nodeCpus[node].size());
+    for (size_t i = 0; i < maxNodeSize; ++i)
+        for (size_t node = 0; node < nodeCpus.size(); ++node)
+            if (i < nodeCpus[node].size())
+                result.push_back(nodeCpus[node][i]);
+    return result;
+}
+
+} // namespace
+
+/** \cond PRIVATE */
+// Pins each worker thread entering the TBB scheduler to a separate CPU
+class ThreadPinningObserver : public tbb::task_scheduler_observer
+{
+public:
+    ThreadPinningObserver() : m_cpus(cpusInterleavedOverNumaNodes()) {
+        m_nextSlot = 0;
+        observe(true);
+    }
+
+    virtual void on_scheduler_entry(bool isWorker) {
+        if (!isWorker || m_cpus.empty())
+            return;
+#ifdef __linux__
+        const size_t slot = m_nextSlot++;
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(m_cpus[slot % m_cpus.size()], &cpuSet);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#endif
+    }
+
+private:
+    std::vector<int> m_cpus;
+    tbb::atomic<size_t> m_nextSlot;
+};
+/** \endcond */
+
+ExecutionContext& ExecutionContext::instance()
+{
+    static ExecutionContext context;
+    return context;
+}
+
+ExecutionContext::ExecutionContext() :
+    m_pinningObserver(0), m_depth(0)
+{
+}
+
+ExecutionContext::~ExecutionContext()
+{
+    for (ArenaMap::iterator it = m_arenas.begin(); it != m_arenas.end(); ++it)
+        delete it->second;
+    if (m_pinningObserver) {
+        m_pinningObserver->observe(false);
+        delete m_pinningObserver;
+    }
+}
+
+tbb::task_arena* ExecutionContext::arena(
+        const ParallelizationOptions& options)
+{
+    if (m_depth.local() > 0)
+        return 0; // nested call
+
+    int maxThreadCount = 1;
+    if (!options.isOpenClEnabled()) {
+        if (options.maxThreadCount() == ParallelizationOptions::AUTO)
+            maxThreadCount = tbb::task_arena::automatic;
+        else
+            maxThreadCount = options.maxThreadCount();
+    }
+
+    tbb::mutex::scoped_lock lock(m_arenaMutex);
+    if (options.isThreadPinningEnabled() && !m_pinningObserver)
+        m_pinningObserver = new ThreadPinningObserver;
+    ArenaMap::iterator it = m_arenas.find(maxThreadCount);
+    if (it == m_arenas.end())
+        it = m_arenas.insert(std::make_pair(
+                                 maxThreadCount,
+                                 new tbb::task_arena(maxThreadCount))).first;
+    return it->second;
+}
+
+bool ExecutionContext::isThreadPinningActive() const
+{
+    tbb::mutex::scoped_lock lock(m_arenaMutex);
+    return m_pinningObserver != 0;
+}
+
+void ExecutionContext::disableThreadPinning()
+{
+    tbb::mutex::scoped_lock lock(m_arenaMutex);
+    if (m_pinningObserver) {
+        m_pinningObserver->observe(false);
+        delete m_pinningObserver;
+        m_pinningObserver = 0;
+    }
+}
+
+size_t ExecutionContext::grainSize(const ParallelizationOptions& options)
+{
+    if (options.grainSize() == ParallelizationOptions::AUTO)
+        return 1;
+    else
+        return options.grainSize();
+}
+
+} // namespace Fiber
@@ -0,0 +1,215 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_execution_context_hpp
+#define fiber_execution_context_hpp
+
+#include "../common/common.hpp"
+
+#include "parallelization_options.hpp"
+
+#include <map>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/mutex.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/task_arena.h>
+
+namespace Fiber
+{
+
+/** \cond FORWARD_DECL */
+class ThreadPinningObserver;
+/** \endcond */
+
+/** \brief Process-wide pool of threads shared by all parallel loops.
+ *
+ *  Creating a tbb::task_scheduler_init in each parallel function makes Intel
+ *  TBB start and stop its worker threads on every call, which is costly for
+ *  short, frequently repeated operations such as matrix-vector products in
+ *  iterative solvers. Instead, parallel loops should be run through the
+ *  single instance of this class. Its worker threads are started on first
+ *  use and live until the end of the program.
+ *
+ *  The number of threads taking part in a loop is limited by
+ *  ParallelizationOptions::maxThreadCount() by running the loop in a
+ *  tbb::task_arena of appropriate concurrency; these arenas are created on
+ *  first use and reused afterwards.
+ *
+ *  Nested loops are detected only per thread: a loop started by the thread
+ *  that entered an arena (i.e. the caller of execute()) while that arena's
+ *  function is still running is run directly, in the enclosing arena. Loops
+ *  started from tasks of an enclosing loop that TBB happens to run on worker
+ *  threads are not detected as nested; they enter the arena corresponding to
+ *  their own options, as TBB permits.
+ *
+ *  Thread pinning, once requested by the options of any loop, applies to all
+ *  worker threads entering the scheduler afterwards, until it is switched off
+ *  with disableThreadPinning(). */
+class ExecutionContext
+{
+public:
+    /** \brief Return the process-wide execution context. */
+    static ExecutionContext& instance();
+
+    ~ExecutionContext();
+
+    /** \brief Execute <tt>f()</tt> with the thread limit and thread pinning
+     *  mode specified in \p options. */
+    template <typename Functor>
+    void execute(const ParallelizationOptions& options, Functor& f);
+
+    /** \brief Equivalent to <tt>tbb::parallel_for(range, body)</tt>, but
+     *  run with the thread limit and thread pinning mode specified in \p
+     *  options. */
+    template <typename Range, typename Body>
+    void parallelFor(const ParallelizationOptions& options,
+                     const Range& range, const Body& body);
+
+    /** \brief Equivalent to <tt>tbb::parallel_reduce(range, body)</tt>, but
+     *  run with the thread limit and thread pinning mode specified in \p
+     *  options. */
+    template <typename Range, typename Body>
+    void parallelReduce(const ParallelizationOptions& options,
+                        const Range& range, Body& body);
+
+    /** \brief Return the grain size to be used in ranges of parallel loops.
+     *
+     *  This is ParallelizationOptions::grainSize(), or 1 if the latter is
+     *  equal to ParallelizationOptions::AUTO. */
+    static size_t grainSize(const ParallelizationOptions& options);
+
+    /** \brief Return true if worker threads entering the scheduler are
+     *  currently being pinned to CPUs. */
+    bool isThreadPinningActive() const;
+
+    /** \brief Stop pinning worker threads entering the scheduler to CPUs.
+     *
+     *  Threads that have already been pinned keep their affinity. Pinning
+     *  is switched on again by the next loop whose options request it. */
+    void disableThreadPinning();
+
+private:
+    /** \cond PRIVATE */
+    ExecutionContext();
+    ExecutionContext(const ExecutionContext&);
+    ExecutionContext& operator=(const ExecutionContext&);
+
+    // Return the arena in which a loop with given options should be run or
+    // 0 if it should be run directly by the calling thread. Only nesting
+    // within the calling thread is detected (see m_depth).
+    tbb::task_arena* arena(const ParallelizationOptions& options);
+
+    struct DepthGuard
+    {
+        explicit DepthGuard(int& depth) : m_depth(depth) { ++m_depth; }
+        ~DepthGuard() { --m_depth; }
+        int& m_depth;
+    };
+
+    template <typename Functor>
+    class ExecuteWrapper
+    {
+    public:
+        ExecuteWrapper(tbb::enumerable_thread_specific<int>& depth,
+                       Functor& f) :
+            m_depth(depth), m_f(f) {
+        }
+
+        void operator()() const {
+            DepthGuard guard(m_depth.local());
+            m_f();
+        }
+
+    private:
+        tbb::enumerable_thread_specific<int>& m_depth;
+        Functor& m_f;
+    };
+
+    template <typename Range, typename Body>
+    struct ParallelForFunctor
+    {
+        ParallelForFunctor(const Range& range, const Body& body) :
+            m_range(range), m_body(body) {
+        }
+        void operator()() const {
+            tbb::parallel_for(m_range, m_body);
+        }
+        const Range& m_range;
+        const Body& m_body;
+    };
+
+    template <typename Range, typename Body>
+    struct ParallelReduceFunctor
+    {
+        ParallelReduceFunctor(const Range& range, Body& body) :
+            m_range(range), m_body(body) {
+        }
+        void operator()() const {
+            tbb::parallel_reduce(m_range, m_body);
+        }
+        const Range& m_range;
+        Body& m_body;
+    };
+
+    typedef std::map<int, tbb::task_arena*> ArenaMap;
+    ArenaMap m_arenas;
+    mutable tbb::mutex m_arenaMutex;
+    ThreadPinningObserver* m_pinningObserver;
+    // Number of functions being executed in the context by each thread;
+    // incremented only by the thread calling execute(), not by the workers
+    // running tasks on its behalf
+    tbb::enumerable_thread_specific<int> m_depth;
+    /** \endcond */
+};
+
+template <typename Functor>
+inline void ExecutionContext::execute(const ParallelizationOptions& options,
+                                      Functor& f)
+{
+    tbb::task_arena* a = arena(options);
+    if (a) {
+        ExecuteWrapper<Functor> wrapper(m_depth, f);
+        a->execute(wrapper);
+    } else
+        f();
+}
+
+template <typename Range, typename Body>
+inline void ExecutionContext::parallelFor(
+        const ParallelizationOptions& options,
+        const Range& range, const Body& body)
+{
+    ParallelForFunctor<Range, Body> f(range, body);
+    execute(options, f);
+}
+
+template <typename Range, typename Body>
+inline void ExecutionContext::parallelReduce(
+        const ParallelizationOptions& options,
+        const Range& range, Body& body)
+{
+    ParallelReduceFunctor<Range, Body> f(range, body);
+    execute(options, f);
+}
+
+} // namespace Fiber
+
+#endif
@@ -0,0 +1,273 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_geometrical_data_block_hpp
+#define fiber_geometrical_data_block_hpp
+
+#include "../common/common.hpp"
+
+#include "geometrical_data.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Fiber
+{
+
+/** \brief Maximum number of points stored in a GeometricalDataBlock. */
+const int GEOMETRICAL_DATA_BLOCK_SIZE = 64;
+
+/** \brief Structure-of-arrays copy of the geometrical data of a block of
+ *  points.
+ *
+ *  GeometricalData stores the coordinates of each point contiguously, which
+ *  is convenient for per-point access but prevents the vectorisation of
+ *  loops running over points. This class holds the global coordinates and
+ *  normals of up to GEOMETRICAL_DATA_BLOCK_SIZE points in separate arrays
+ *  (one per component), so that kernel functors providing the optional
+ *  \c evaluateBatch() member function (see DefaultCollectionOfKernels) can
+ *  process whole blocks of points with SIMD instructions.
+ *
+ *  Only three-dimensional data are supported. */
+template <typename CoordinateType>
+struct GeometricalDataBlock
+{
+    /** \brief Number of points in the block. */
+    int pointCount;
+    /** \brief Global coordinates; <tt>globals[d][p]</tt> is the \p d'th
+     *  coordinate of the \p p'th point. */
+    CoordinateType globals[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+    /** \brief Unit normals, stored like \p globals. Filled only if the
+     *  source GeometricalData object contains normals. */
+    CoordinateType normals[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+
+    /** \brief Copy the data of points <tt>start</tt>, ...,
+     *  <tt>start + count - 1</tt> from \p geomData. */
+    void load(const GeometricalData<CoordinateType>& geomData,
+              int start, int count) {
+        assert(count > 0 && count <= GEOMETRICAL_DATA_BLOCK_SIZE);
+        pointCount = count;
+        if (!geomData.globals.is_empty()) {
+            assert(geomData.globals.n_rows == 3);
+            const CoordinateType* source = geomData.globals.colptr(start);
+            for (int p = 0; p < count; ++p)
+                for (int d = 0; d < 3; ++d)
+                    globals[d][p] = source[3 * p + d];
+        }
+        if (!geomData.normals.is_empty()) {
+            assert(geomData.normals.n_rows == 3);
+            const CoordinateType* source = geomData.normals.colptr(start);
+            for (int p = 0; p < count; ++p)
+                for (int d = 0; d < 3; ++d)
+                    normals[d][p] = source[3 * p + d];
+        }
+    }
+};
+
+/** \cond PRIVATE */
+namespace GeometricalDataBlockDetail
+{
+
+template <typename CoordinateType>
+inline void computeDistancesPortable(
+        const GeometricalDataBlock<CoordinateType>& block,
+        const CoordinateType* point, int start,
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE],
+        CoordinateType* distanceSq,
+        CoordinateType* distance)
+{
+    const int n = block.pointCount;
+    for (int p = start; p < n; ++p) {
+        diff[0][p] = block.globals[0][p] - point[0];
+        diff[1][p] = block.globals[1][p] - point[1];
+        diff[2][p] = block.globals[2][p] - point[2];
+        distanceSq[p] = diff[0][p] * diff[0][p] + diff[1][p] * diff[1][p] +
+                diff[2][p] * diff[2][p];
+    }
+    for (int p = start; p < n; ++p)
+        distance[p] = std::sqrt(distanceSq[p]);
+}
+
+// Returns the index of the first point not processed.
+inline int computeDistancesSimd(
+        const GeometricalDataBlock<double>& block, const double* point,
+        double diff[3][GEOMETRICAL_DATA_BLOCK_SIZE],
+        double* distanceSq, double* distance)
+{
+    int p = 0;
+#if defined(__AVX512F__)
+    const __m512d px = _mm512_set1_pd(point[0]);
+    const __m512d py = _mm512_set1_pd(point[1]);
+    const __m512d pz = _mm512_set1_pd(point[2]);
+    for (; p + 8 <= block.pointCount; p += 8) {
+        const __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(&block.globals[0][p]), px);
+        const __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(&block.globals[1][p]), py);
+        const __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(&block.globals[2][p]), pz);
+        const __m512d r2 = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(
+                dy, dy, _mm512_mul_pd(dx, dx)));
+        _mm512_storeu_pd(&diff[0][p], dx);
+        _mm512_storeu_pd(&diff[1][p], dy);
+        _mm512_storeu_pd(&diff[2][p], dz);
+        _mm512_storeu_pd(&distanceSq[p], r2);
+        _mm512_storeu_pd(&distance[p], _mm512_sqrt_pd(r2));
+    }
+#elif defined(__AVX2__)
+    const __m256d px = _mm256_set1_pd(point[0]);
+    const __m256d py = _mm256_set1_pd(point[1]);
+    const __m256d pz = _mm256_set1_pd(point[2]);
+    for (; p + 4 <= block.pointCount; p += 4) {
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&block.globals[0][p]), px);
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&block.globals[1][p]), py);
+        const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&block.globals[2][p]), pz);
+        const __m256d r2 = _mm256_add_pd(
+                _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+                _mm256_mul_pd(dz, dz));
+        _mm256_storeu_pd(&diff[0][p], dx);
+        _mm256_storeu_pd(&diff[1][p], dy);
+        _mm256_storeu_pd(&diff[2][p], dz);
+        _mm256_storeu_pd(&distanceSq[p], r2);
+        _mm256_storeu_pd(&distance[p], _mm256_sqrt_pd(r2));
+    }
+#endif
+    return p;
+}
+
+inline int computeDistancesSimd(
+        const GeometricalDataBlock<float>& block, const float* point,
+        float diff[3][GEOMETRICAL_DATA_BLOCK_SIZE],
+        float* distanceSq, float* distance)
+{
+    int p = 0;
+#if defined(__AVX512F__)
+    const __m512 px = _mm512_set1_ps(point[0]);
+    const __m512 py = _mm512_set1_ps(point[1]);
+    const __m512 pz = _mm512_set1_ps(point[2]);
+    for (; p + 16 <= block.pointCount; p += 16) {
+        const __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(&block.globals[0][p]), px);
+        const __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(&block.globals[1][p]), py);
+        const __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(&block.globals[2][p]), pz);
+        const __m512 r2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(
+                dy, dy, _mm512_mul_ps(dx, dx)));
+        _mm512_storeu_ps(&diff[0][p], dx);
+        _mm512_storeu_ps(&diff[1][p], dy);
+        _mm512_storeu_ps(&diff[2][p], dz);
+        _mm512_storeu_ps(&distanceSq[p], r2);
+        _mm512_storeu_ps(&distance[p], _mm512_sqrt_ps(r2));
+    }
+#elif defined(__AVX2__)
+    const __m256 px = _mm256_set1_ps(point[0]);
+    const __m256 py = _mm256_set1_ps(point[1]);
+    const __m256 pz = _mm256_set1_ps(point[2]);
+    for (; p + 8 <= block.pointCount; p += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&block.globals[0][p]), px);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&block.globals[1][p]), py);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&block.globals[2][p]), pz);
+        const __m256 r2 = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                _mm256_mul_ps(dz, dz));
+        _mm256_storeu_ps(&diff[0][p], dx);
+        _mm256_storeu_ps(&diff[1][p], dy);
+        _mm256_storeu_ps(&diff[2][p], dz);
+        _mm256_storeu_ps(&distanceSq[p], r2);
+        _mm256_storeu_ps(&distance[p], _mm256_sqrt_ps(r2));
+    }
+#endif
+    return p;
+}
+
+} // namespace GeometricalDataBlockDetail
+/** \endcond */
+
+/** \brief Compute the differences between the points of a block and a single
+ *  point, together with the corresponding squared and plain distances.
+ *
+ *  On output, <tt>diff[d][p] = block.globals[d][p] - point.global(d)</tt>,
+ *  <tt>distanceSq[p] = |diff[.][p]|^2</tt> and
+ *  <tt>distance[p] = sqrt(distanceSq[p])</tt>.
+ *
+ *  AVX-512 or AVX2 instructions are used for single- and double-precision
+ *  data if the code is compiled with support for these instruction sets;
+ *  otherwise a portable loop is used. */
+template <typename CoordinateType>
+inline void computeBlockDistances(
+        const GeometricalDataBlock<CoordinateType>& block,
+        const ConstGeometricalDataSlice<CoordinateType>& point,
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE],
+        CoordinateType* distanceSq,
+        CoordinateType* distance)
+{
+    assert(point.dimWorld() == 3);
+    const CoordinateType pointCoords[3] = {
+        point.global(0), point.global(1), point.global(2)
+    };
+    const int start = GeometricalDataBlockDetail::computeDistancesSimd(
+                block, pointCoords, diff, distanceSq, distance);
+    GeometricalDataBlockDetail::computeDistancesPortable(
+                block, pointCoords, start, diff, distanceSq, distance);
+}
+
+/** \brief Compute <tt>result[p] = exp(-waveNumber * distance[p])</tt> for
+ *  \p p = 0, 1, ..., <tt>count - 1</tt>.
+ *
+ *  The real exponential, cosine and sine are evaluated in separate loops so
+ *  that compilers providing vectorised versions of these functions can use
+ *  them. */
+template <typename CoordinateType>
+inline void computeBlockExponentials(
+        CoordinateType waveNumber, const CoordinateType* distance,
+        int count, CoordinateType* result)
+{
+    for (int p = 0; p < count; ++p)
+        result[p] = -waveNumber * distance[p];
+    for (int p = 0; p < count; ++p)
+        result[p] = std::exp(result[p]);
+}
+
+template <typename CoordinateType>
+inline void computeBlockExponentials(
+        std::complex<CoordinateType> waveNumber, const CoordinateType* distance,
+        int count, std::complex<CoordinateType>* result)
+{
+    const CoordinateType re = waveNumber.real(), im = waveNumber.imag();
+    CoordinateType modulus[GEOMETRICAL_DATA_BLOCK_SIZE];
+    CoordinateType cosine[GEOMETRICAL_DATA_BLOCK_SIZE];
+    CoordinateType sine[GEOMETRICAL_DATA_BLOCK_SIZE];
+    assert(count <= GEOMETRICAL_DATA_BLOCK_SIZE);
+    for (int p = 0; p < count; ++p)
+        modulus[p] = std::exp(-re * distance[p]);
+    for (int p = 0; p < count; ++p)
+        cosine[p] = std::cos(im * distance[p]);
+    for (int p = 0; p < count; ++p)
+        sine[p] = std::sin(im * distance[p]);
+    // exp(-(re + i im) r) = exp(-re r) (cos(im r) - i sin(im r))
+    for (int p = 0; p < count; ++p)
+        result[p] = std::complex<CoordinateType>(modulus[p] * cosine[p],
+                                                 -modulus[p] * sine[p]);
+}
+
+} // namespace Fiber
+
+#endif
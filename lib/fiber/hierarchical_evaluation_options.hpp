@@ -0,0 +1,72 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_hierarchical_evaluation_options_hpp
+#define fiber_hierarchical_evaluation_options_hpp
+
+#include "../common/common.hpp"
+
+namespace Fiber
+{
+
+/** \brief Parameters of the hierarchical evaluation of potentials.
+ *
+ *  In the hierarchical mode, the evaluation points and the quadrature points
+ *  on the surface are organised in cluster trees. The potential generated
+ *  by a cluster of quadrature points in a box of evaluation points lying
+ *  sufficiently far from it is evaluated only at the Chebyshev nodes of the
+ *  box and interpolated to the evaluation points. All other interactions
+ *  are summed directly.
+ *
+ *  The accuracy is controlled by \p interpolationOrder and \p eta: the
+ *  interpolation error decreases geometrically with the order, at a rate
+ *  that improves as \p eta decreases. */
+struct HierarchicalEvaluationOptions
+{
+    /** \brief Initialize the parameters to default values. */
+    HierarchicalEvaluationOptions();
+
+    /** \brief Number of Chebyshev nodes per coordinate direction used to
+     *  interpolate the potential in a box of evaluation points.
+     *
+     *  Boxes that are flat in some direction (such as those made of points
+     *  lying in a plane) use a single node in that direction.
+     *
+     *  Default value: 5. */
+    int interpolationOrder;
+
+    /** \brief Admissibility parameter.
+     *
+     *  A box of evaluation points and a cluster of quadrature points interact
+     *  through interpolation if the diameter of the box does not exceed
+     *  \p eta times the distance between the box and the cluster.
+     *
+     *  Default value: 1. */
+    double eta;
+
+    /** \brief Maximum number of points in a leaf of the cluster trees.
+     *
+     *  Default value: 64. */
+    int maximumLeafSize;
+};
+
+} // namespace Fiber
+
+#endif
@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 #include "scalar_traits.hpp"
 
 namespace Fiber
@@ -77,6 +78,25 @@ public:
         result[0](0, 0) = -numeratorSum /
             (static_cast<CoordinateType>(4. * M_PI) * distanceSq * distance);
     }
+
+    void evaluateBatch(
+            const GeometricalDataBlock<CoordinateType>& testGeomData,
+            const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+            ValueType* const* result) const {
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distanceSq[GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distance[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockDistances(testGeomData, trialGeomData,
+                              diff, distanceSq, distance);
+        const CoordinateType factor =
+                static_cast<CoordinateType>(-1. / (4. * M_PI));
+        for (int p = 0; p < testGeomData.pointCount; ++p)
+            result[0][p] = factor *
+                    (diff[0][p] * testGeomData.normals[0][p] +
+                     diff[1][p] * testGeomData.normals[1][p] +
+                     diff[2][p] * testGeomData.normals[2][p]) /
+                    (distance[p] * distanceSq[p]);
+    }
 };
 
 } // namespace Fiber
@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 #include "scalar_traits.hpp"
 
 namespace Fiber
@@ -74,6 +75,21 @@ public:
         result[0](0, 0) = static_cast<CoordinateType>(1. / (4. * M_PI)) /
                 sqrt(sum);
     }
+
+    void evaluateBatch(
+            const GeometricalDataBlock<CoordinateType>& testGeomData,
+            const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+            ValueType* const* result) const {
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distanceSq[GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distance[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockDistances(testGeomData, trialGeomData,
+                              diff, distanceSq, distance);
+        const CoordinateType factor =
+                static_cast<CoordinateType>(1. / (4. * M_PI));
+        for (int p = 0; p < testGeomData.pointCount; ++p)
+            result[0][p] = factor / distance[p];
+    }
 };
 
 } // namespace Fiber
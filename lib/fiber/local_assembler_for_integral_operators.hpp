@@ -27,6 +27,8 @@
 #include "scalar_traits.hpp"
 #include "types.hpp"
 
+#include <string>
+#include <typeinfo>
 #include <vector>
 
 namespace Fiber
@@ -113,6 +115,19 @@ public:
      *  which the operator becomes very small and so can be safely approximated
      *  with 0. */
     virtual CoordinateType estimateRelativeScale(CoordinateType minDist) const = 0;
+
+    /** \brief Return a string identifying the integral evaluated by this
+     *  assembler and the quadrature rules used to evaluate it.
+     *
+     *  Assemblers returning the same string should produce the same local
+     *  weak forms, except for differences caused by the values of kernel
+     *  parameters (e.g. the wave number), which the string need not reflect.
+     *  It is used to tell operators apart in the on-disk cache of weak
+     *  forms. The default implementation returns the name of the dynamic type
+     *  of the assembler. */
+    virtual std::string signature() const {
+        return typeid(*this).name();
+    }
 };
 
 } // namespace Fiber
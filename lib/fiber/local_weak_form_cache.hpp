@@ -0,0 +1,252 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_local_weak_form_cache_hpp
+#define fiber_local_weak_form_cache_hpp
+
+#include "../common/common.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Compact cache of local weak forms indexed by pairs of elements.
+ *
+ *  All cached matrices are stored contiguously (each in column-major order)
+ *  in a single array. The cache is indexed in compressed-sparse-row fashion
+ *  by the trial element index: the entries belonging to each trial element
+ *  occupy a contiguous range and are sorted after increasing test element
+ *  index. Looking up an element pair therefore costs a bound check against
+ *  the smallest and largest test element index stored for the given trial
+ *  element, followed (only if that check passes) by a binary search over
+ *  the few neighbours of that element.
+ *
+ *  The cache is filled in two stages: one of the reset() overloads sets up
+ *  the index and allocates storage for all matrices, then the matrices are
+ *  written through data(). Distinct entries occupy disjoint memory, so they can be
+ *  filled concurrently. */
+template <typename ResultType>
+class LocalWeakFormCache
+{
+public:
+    /** \brief Pair of element indices (test element, trial element). */
+    typedef std::pair<int, int> ElementIndexPair;
+
+    LocalWeakFormCache() : m_trialElementCount(0) {}
+
+    /** \brief Set up the cache for local weak forms of the given element
+     *  pairs.
+     *
+     *  \param[in] trialElementCount
+     *    Number of trial elements; all trial element indices stored in
+     *    \p elementIndexPairs must be smaller than this number.
+     *  \param[in] elementIndexPairs
+     *    Pairs (test element index, trial element index) to be cached. Each
+     *    pair may occur only once.
+     *  \param[in] rowCounts, colCounts
+     *    Dimensions of the local weak forms of the corresponding pairs.
+     *
+     *  Any previous contents of the cache are discarded. The newly allocated
+     *  matrices are zero-initialised. */
+    void reset(int trialElementCount,
+               const std::vector<ElementIndexPair>& elementIndexPairs,
+               const std::vector<int>& rowCounts,
+               const std::vector<int>& colCounts) {
+        const size_t pairCount = elementIndexPairs.size();
+        if (rowCounts.size() != pairCount || colCounts.size() != pairCount)
+            throw std::invalid_argument("LocalWeakFormCache::reset(): "
+                                        "incompatible argument lengths");
+
+        // Count the entries of each trial element...
+        std::vector<int> rowStarts(trialElementCount + 1, 0);
+        for (size_t i = 0; i < pairCount; ++i) {
+            const int trialElementIndex = elementIndexPairs[i].second;
+            if (trialElementIndex < 0 || trialElementIndex >= trialElementCount)
+                throw std::invalid_argument("LocalWeakFormCache::reset(): "
+                                            "invalid trial element index");
+            ++rowStarts[trialElementIndex + 1];
+        }
+        for (int e = 0; e < trialElementCount; ++e)
+            rowStarts[e + 1] += rowStarts[e];
+
+        // ... distribute them into the rows...
+        std::vector<std::pair<int, int> > entries(pairCount); // (test, pair)
+        {
+            std::vector<int> nextSlot(rowStarts.begin(), rowStarts.end() - 1);
+            for (size_t i = 0; i < pairCount; ++i)
+                entries[nextSlot[elementIndexPairs[i].second]++] =
+                        std::make_pair(elementIndexPairs[i].first, int(i));
+        }
+        // ... and sort each row after the test element index
+        for (int e = 0; e < trialElementCount; ++e)
+            std::sort(entries.begin() + rowStarts[e],
+                      entries.begin() + rowStarts[e + 1]);
+
+        std::vector<int> testElementIndices(pairCount);
+        std::vector<int> sortedRowCounts(pairCount), sortedColCounts(pairCount);
+        for (size_t n = 0; n < pairCount; ++n) {
+            testElementIndices[n] = entries[n].first;
+            sortedRowCounts[n] = rowCounts[entries[n].second];
+            sortedColCounts[n] = colCounts[entries[n].second];
+        }
+        reset(rowStarts, testElementIndices, sortedRowCounts, sortedColCounts);
+    }
+
+    /** \brief Set up the cache for local weak forms of element pairs given
+     *  in compressed-sparse-row format.
+     *
+     *  \param[in] rowStarts
+     *    Vector of length (number of trial elements + 1); the test elements
+     *    paired with trial element \p e are given by
+     *    <tt>testElementIndices[rowStarts[e]]</tt>, ...,
+     *    <tt>testElementIndices[rowStarts[e + 1] - 1]</tt>.
+     *  \param[in] testElementIndices
+     *    Test element indices, strictly increasing within each row.
+     *  \param[in] rowCounts, colCounts
+     *    Dimensions of the local weak forms of the corresponding pairs.
+     *
+     *  The pair stored at position \p n of \p testElementIndices is assigned
+     *  the entry index \p n. Any previous contents of the cache are
+     *  discarded. The newly allocated matrices are zero-initialised. */
+    void reset(const std::vector<int>& rowStarts,
+               const std::vector<int>& testElementIndices,
+               const std::vector<int>& rowCounts,
+               const std::vector<int>& colCounts) {
+        const size_t pairCount = testElementIndices.size();
+        if (rowStarts.empty() || size_t(rowStarts.back()) != pairCount ||
+                rowCounts.size() != pairCount || colCounts.size() != pairCount)
+            throw std::invalid_argument("LocalWeakFormCache::reset(): "
+                                        "incompatible argument lengths");
+        for (size_t e = 0; e + 1 < rowStarts.size(); ++e)
+            for (int n = rowStarts[e] + 1; n < rowStarts[e + 1]; ++n)
+                if (testElementIndices[n - 1] >= testElementIndices[n])
+                    throw std::invalid_argument(
+                            "LocalWeakFormCache::reset(): test element "
+                            "indices must be strictly increasing within rows");
+
+        m_trialElementCount = int(rowStarts.size()) - 1;
+        m_rowStarts = rowStarts;
+        m_testElementIndices = testElementIndices;
+        m_rowCounts = rowCounts;
+        m_colCounts = colCounts;
+        m_valueOffsets.resize(pairCount + 1);
+        m_valueOffsets[0] = 0;
+        for (size_t n = 0; n < pairCount; ++n)
+            m_valueOffsets[n + 1] =
+                    m_valueOffsets[n] + size_t(rowCounts[n]) * colCounts[n];
+        std::vector<ResultType>(m_valueOffsets.back()).swap(m_values);
+    }
+
+    /** \brief Remove all entries from the cache and release its memory. */
+    void clear() {
+        m_trialElementCount = 0;
+        std::vector<int>().swap(m_rowStarts);
+        std::vector<int>().swap(m_testElementIndices);
+        std::vector<int>().swap(m_rowCounts);
+        std::vector<int>().swap(m_colCounts);
+        std::vector<size_t>().swap(m_valueOffsets);
+        std::vector<ResultType>().swap(m_values);
+    }
+
+    /** \brief Return true if the cache contains no entries. */
+    bool isEmpty() const {
+        return m_testElementIndices.empty();
+    }
+
+    /** \brief Number of cached local weak forms. */
+    size_t entryCount() const {
+        return m_testElementIndices.size();
+    }
+
+    /** \brief Return the index of the entry storing the local weak form of
+     *  the given pair of elements, or -1 if this pair is not cached. */
+    int find(int testElementIndex, int trialElementIndex) const {
+        if (unsigned(trialElementIndex) >= unsigned(m_trialElementCount))
+            return -1;
+        const int begin = m_rowStarts[trialElementIndex];
+        const int end = m_rowStarts[trialElementIndex + 1];
+        if (begin == end ||
+                testElementIndex < m_testElementIndices[begin] ||
+                testElementIndex > m_testElementIndices[end - 1])
+            return -1;
+        const int* first = &m_testElementIndices[0] + begin;
+        const int* last = &m_testElementIndices[0] + end;
+        const int* it = std::lower_bound(first, last, testElementIndex);
+        return (it != last && *it == testElementIndex) ?
+                    int(it - &m_testElementIndices[0]) : -1;
+    }
+
+    /** \brief Number of rows of the local weak form stored in a given entry. */
+    int rowCount(int entry) const {
+        assert(unsigned(entry) < m_rowCounts.size());
+        return m_rowCounts[entry];
+    }
+
+    /** \brief Number of columns of the local weak form stored in a given
+     *  entry. */
+    int colCount(int entry) const {
+        assert(unsigned(entry) < m_colCounts.size());
+        return m_colCounts[entry];
+    }
+
+    /** \brief Pointer to the (column-major) local weak form stored in a given
+     *  entry. */
+    ResultType* data(int entry) {
+        assert(unsigned(entry) < m_rowCounts.size());
+        return &m_values[0] + m_valueOffsets[entry];
+    }
+
+    /** \brief Pointer to the (column-major) local weak form stored in a given
+     *  entry. */
+    const ResultType* data(int entry) const {
+        assert(unsigned(entry) < m_rowCounts.size());
+        return &m_values[0] + m_valueOffsets[entry];
+    }
+
+    /** \brief Approximate number of bytes occupied by the cache. */
+    size_t memoryUsage() const {
+        return m_values.size() * sizeof(ResultType) +
+                m_valueOffsets.size() * sizeof(size_t) +
+                (m_rowStarts.size() + m_testElementIndices.size() +
+                 m_rowCounts.size() + m_colCounts.size()) * sizeof(int);
+    }
+
+private:
+    /** \cond PRIVATE */
+    int m_trialElementCount;
+    // Entries of trial element e are stored at positions
+    // m_rowStarts[e], ..., m_rowStarts[e + 1] - 1
+    std::vector<int> m_rowStarts;
+    std::vector<int> m_testElementIndices;
+    std::vector<int> m_rowCounts;
+    std::vector<int> m_colCounts;
+    std::vector<size_t> m_valueOffsets;
+    std::vector<ResultType> m_values;
+    /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
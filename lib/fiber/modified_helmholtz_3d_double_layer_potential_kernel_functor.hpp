@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -89,6 +90,34 @@ public:
                 exp(-m_waveNumber * distance);
     }
 
+    void evaluateBatch(
+            const GeometricalDataBlock<CoordinateType>& testGeomData,
+            const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+            ValueType* const* result) const {
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distanceSq[GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distance[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockDistances(testGeomData, trialGeomData,
+                              diff, distanceSq, distance);
+        ValueType exponential[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockExponentials(m_waveNumber, distance,
+                                 testGeomData.pointCount, exponential);
+        const CoordinateType trialNormal[3] = {
+            trialGeomData.normal(0), trialGeomData.normal(1),
+            trialGeomData.normal(2)
+        };
+        const CoordinateType factor =
+                static_cast<CoordinateType>(1. / (4. * M_PI));
+        const CoordinateType one = 1.;
+        // diff is oriented from the trial to the test point, hence the sign
+        for (int p = 0; p < testGeomData.pointCount; ++p)
+            result[0][p] = factor *
+                    (diff[0][p] * trialNormal[0] +
+                     diff[1][p] * trialNormal[1] +
+                     diff[2][p] * trialNormal[2]) / distanceSq[p] *
+                    (m_waveNumber + one / distance[p]) * exponential[p];
+    }
+
     CoordinateType estimateRelativeScale(CoordinateType distance) const {
         return exp(-realPart(m_waveNumber) * distance);
     }
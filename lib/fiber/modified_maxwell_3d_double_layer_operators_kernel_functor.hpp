@@ -25,6 +25,7 @@
 #include "../common/complex_aux.hpp"
 
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 #include "scalar_traits.hpp"
 
 #include "modified_helmholtz_3d_single_layer_potential_kernel_functor.hpp"
@@ -96,6 +97,31 @@ public:
                  trialGeomData.global(coordIndex));
     }
 
+    void evaluateBatch(
+            const GeometricalDataBlock<CoordinateType>& testGeomData,
+            const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+            ValueType* const* result) const {
+        CoordinateType diff[3][GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distanceSq[GEOMETRICAL_DATA_BLOCK_SIZE];
+        CoordinateType distance[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockDistances(testGeomData, trialGeomData,
+                              diff, distanceSq, distance);
+        ValueType exponential[GEOMETRICAL_DATA_BLOCK_SIZE];
+        computeBlockExponentials(m_waveNumber, distance,
+                                 testGeomData.pointCount, exponential);
+        const CoordinateType factor =
+                static_cast<CoordinateType>(-1. / (4. * M_PI));
+        const CoordinateType one = 1.;
+        for (int p = 0; p < testGeomData.pointCount; ++p) {
+            const ValueType commonFactor = factor *
+                    (one + m_waveNumber * distance[p]) /
+                    (distance[p] * distanceSq[p]) * exponential[p];
+            for (int coordIndex = 0; coordIndex < 3; ++coordIndex)
+                result[0][3 * p + coordIndex] =
+                        commonFactor * diff[coordIndex][p];
+        }
+    }
+
     CoordinateType estimateRelativeScale(CoordinateType distance) const {
         return exp(-realPart(m_waveNumber) * distance);
     }
@@ -25,6 +25,7 @@
 #include "../common/complex_aux.hpp"
 
 #include "geometrical_data.hpp"
+#include "geometrical_data_block.hpp"
 #include "scalar_traits.hpp"
 
 #include "modified_helmholtz_3d_single_layer_potential_kernel_functor.hpp"
@@ -81,6 +82,19 @@ public:
         result[0](0, 0) *= m_slpKernel.waveNumber();
     }
 
+    void evaluateBatch(
+            const GeometricalDataBlock<CoordinateType>& testGeomData,
+            const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
+            ValueType* const* result) const {
+        // This will put the values of the SLP kernel in result[0]
+        m_slpKernel.evaluateBatch(testGeomData, trialGeomData, result);
+        const ValueType waveNumber = m_slpKernel.waveNumber();
+        for (int p = 0; p < testGeomData.pointCount; ++p) {
+            result[1][p] = result[0][p] / waveNumber;
+            result[0][p] *= waveNumber;
+        }
+    }
+
     CoordinateType estimateRelativeScale(CoordinateType distance) const {
         return m_slpKernel.estimateRelativeScale(distance);
     }
@@ -0,0 +1,68 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_near_field_evaluation_options_hpp
+#define fiber_near_field_evaluation_options_hpp
+
+#include "../common/common.hpp"
+
+namespace Fiber
+{
+
+/** \brief Parameters of the near-field quadrature used in the evaluation
+ *  of potentials close to the surface.
+ *
+ *  The quadrature rule used to evaluate potentials away from the surface
+ *  loses accuracy at points lying close to an element. The contributions of
+ *  such elements are recalculated by splitting them recursively into four
+ *  subelements until each subelement lies far enough from the evaluation
+ *  point, and applying the original rule on each subelement. The
+ *  contributions of all other elements are not affected. */
+struct NearFieldEvaluationOptions
+{
+    /** \brief Initialize the parameters to default values. */
+    NearFieldEvaluationOptions();
+
+    /** \brief Distance, relative to the element size, below which an
+     *  evaluation point is considered to lie close to an element.
+     *
+     *  An element (or subelement) is treated with the ordinary quadrature
+     *  rule if the distance between the evaluation point and its center is
+     *  at least \p relativeDistance times its size (the length of its
+     *  longest edge).
+     *
+     *  Default value: 2. */
+    double relativeDistance;
+
+    /** \brief Maximum number of times an element can be subdivided.
+     *
+     *  Each subdivision halves the size of the subelements. Subelements
+     *  reaching this level are integrated with the ordinary quadrature rule
+     *  even if they lie close to the evaluation point, which limits the
+     *  cost (and the accuracy) of the evaluation at points lying almost on
+     *  the surface.
+     *
+     *  Default value: 6. */
+    int maximumSubdivisionLevel;
+};
+
+} // namespace Fiber
+
+#endif
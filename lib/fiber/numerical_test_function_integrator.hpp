@@ -35,7 +35,14 @@ template <typename ValueType> class Function;
 template <typename CoordinateType> class RawGridGeometry;
 /** \endcond */
 
-/** \brief Integration over pairs of elements on tensor-product point grids. */
+/** \brief Integration over pairs of elements on tensor-product point grids.
+ *
+ *  If the number of components of the function is \f$k\f$ times larger
+ *  than that of the test functions, the function is treated as \f$k\f$
+ *  functions stacked on top of each other (see StackedFunction). The
+ *  integrals of the <em>f</em>th of them are then stored in rows
+ *  <tt>f * testDofCount</tt> to <tt>(f + 1) * testDofCount - 1</tt> of the
+ *  result of integrate(). */
 template <typename BasisFunctionType, typename UserFunctionType,
           typename ResultType, typename GeometryFactory>
 class NumericalTestFunctionIntegrator :
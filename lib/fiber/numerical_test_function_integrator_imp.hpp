@@ -92,10 +92,15 @@ integrate(
     const int componentCount = m_testTransformations.resultDimension(0);
     const int testDofCount = testShapeset.size();
 
-    if (m_function.codomainDimension() != componentCount)
+    // The function may consist of several functions stacked on top of each
+    // other (see StackedFunction); each of them is integrated separately
+    if (componentCount == 0 ||
+            m_function.codomainDimension() % componentCount != 0)
         throw std::runtime_error("NumericalTestFunctionIntegrator::integrate(): "
-                                 "test functions and the \"arbitrary\" function "
-                                 "must have the same number of components");
+                                 "the number of components of the \"arbitrary\" "
+                                 "function must be a multiple of that of "
+                                 "the test functions");
+    const int functionCount = m_function.codomainDimension() / componentCount;
 
     BasisData<BasisFunctionType> testBasisData;
     GeometricalData<CoordinateType> geomData;
@@ -112,7 +117,7 @@ integrate(
     Fiber::CollectionOf3dArrays<BasisFunctionType> testValues;
     arma::Mat<UserFunctionType> functionValues;
 
-    result.set_size(testDofCount, elementCount);
+    result.set_size(testDofCount * functionCount, elementCount);
 
     testShapeset.evaluate(testBasisDeps, m_localQuadPoints, ALL_DOFS, testBasisData);
 
@@ -127,17 +132,18 @@ integrate(
         m_testTransformations.evaluate(testBasisData, geomData, testValues);
         m_function.evaluate(geomData, functionValues);
 
-        for (int testDof = 0; testDof < testDofCount; ++testDof)
-        {
-            ResultType sum = 0.;
-            for (size_t point = 0; point < pointCount; ++point)
-                for (int dim = 0; dim < componentCount; ++dim)
-                    sum +=  m_quadWeights[point] *
-                            geomData.integrationElements(point) *
-                            conjugate(testValues[0](dim, testDof, point)) *
-                            functionValues(dim, point);
-            result(testDof, e) = sum;
-        }
+        for (int f = 0; f < functionCount; ++f)
+            for (int testDof = 0; testDof < testDofCount; ++testDof)
+            {
+                ResultType sum = 0.;
+                for (size_t point = 0; point < pointCount; ++point)
+                    for (int dim = 0; dim < componentCount; ++dim)
+                        sum +=  m_quadWeights[point] *
+                                geomData.integrationElements(point) *
+                                conjugate(testValues[0](dim, testDof, point)) *
+                                functionValues(f * componentCount + dim, point);
+                result(f * testDofCount + testDof, e) = sum;
+            }
     }
 }
 
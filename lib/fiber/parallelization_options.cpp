@@ -26,7 +26,8 @@ namespace Fiber
 {
 
 ParallelizationOptions::ParallelizationOptions() :
-    m_openClEnabled(false), m_maxThreadCount(AUTO)
+    m_openClEnabled(false), m_maxThreadCount(AUTO), m_grainSize(AUTO),
+    m_threadPinningEnabled(false)
 {
     m_openClOptions.useOpenCl = false;
 }
@@ -65,4 +66,31 @@ int ParallelizationOptions::maxThreadCount() const {
     return m_maxThreadCount;
 }
 
+void ParallelizationOptions::setGrainSize(int grainSize)
+{
+    if (grainSize <= 0 && grainSize != AUTO)
+        throw std::runtime_error("ParallelizationOptions::setGrainSize(): "
+                                 "grainSize must be positive or equal to AUTO");
+    m_grainSize = grainSize;
+}
+
+int ParallelizationOptions::grainSize() const {
+    return m_grainSize;
+}
+
+void ParallelizationOptions::enableThreadPinning()
+{
+    m_threadPinningEnabled = true;
+}
+
+void ParallelizationOptions::disableThreadPinning()
+{
+    m_threadPinningEnabled = false;
+}
+
+bool ParallelizationOptions::isThreadPinningEnabled() const
+{
+    return m_threadPinningEnabled;
+}
+
 } // namespace Fiber
@@ -60,10 +60,39 @@ public:
      *  Intel Threading Building Blocks. */
     int maxThreadCount() const;
 
+    /** \brief Set the grain size of parallel loops.
+     *
+     *  The grain size is the minimum number of loop iterations (e.g. elements
+     *  or element pairs) processed by a single task. \p grainSize must be a
+     *  positive number or \p AUTO. In the latter case a grain size of 1 is
+     *  used and load balancing is left to Intel Threading Building
+     *  Blocks. */
+    void setGrainSize(int grainSize = AUTO);
+
+    /** \brief Return the grain size of parallel loops.
+     *
+     *  The returned value can be a positive number or \p AUTO. */
+    int grainSize() const;
+
+    /** \brief Pin worker threads to individual processor cores.
+     *
+     *  Consecutive worker threads are distributed in a round-robin fashion
+     *  over the NUMA nodes of the machine. Pinning is currently implemented
+     *  only on Linux; on other systems this setting is ignored. Once a
+     *  parallel loop has been run with pinning enabled, the worker threads
+     *  stay pinned for the rest of the program. */
+    void enableThreadPinning();
+    /** \brief Do not pin worker threads to individual processor cores. */
+    void disableThreadPinning();
+    /** \brief Return whether worker threads are pinned to processor cores. */
+    bool isThreadPinningEnabled() const;
+
 private:
     bool m_openClEnabled;
     OpenClOptions m_openClOptions;
     int m_maxThreadCount;
+    int m_grainSize;
+    bool m_threadPinningEnabled;
 };
 
 } // namespace Fiber
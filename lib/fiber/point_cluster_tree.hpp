@@ -0,0 +1,262 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_point_cluster_tree_hpp
+#define fiber_point_cluster_tree_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Binary cluster tree of a set of points.
+ *
+ *  The tree is built by recursive median splits along the longest side of
+ *  the bounding box of the points in each cluster. The points of each
+ *  cluster occupy a contiguous range of the array returned by
+ *  permutation(). Nodes are stored in depth-first order, so that each
+ *  parent precedes its children.
+ *
+ *  Objects of this class are immutable and can be queried concurrently. */
+template <typename CoordinateType>
+class PointClusterTree
+{
+public:
+    /** \brief Node of the tree. */
+    struct Node
+    {
+        /** \brief Lower corner of the bounding box of the cluster. */
+        CoordinateType lower[3];
+        /** \brief Upper corner of the bounding box of the cluster. */
+        CoordinateType upper[3];
+        /** \brief Range [begin, end) of permutation() occupied by the
+         *  points of the cluster. */
+        int begin, end;
+        /** \brief Indices of the children; -1 for leaves. */
+        int firstChild, secondChild;
+        /** \brief Index of the parent; -1 for the root. */
+        int parent;
+        /** \brief Distance from the root. */
+        int level;
+
+        bool isLeaf() const {
+            return firstChild < 0;
+        }
+        int size() const {
+            return end - begin;
+        }
+    };
+
+    /** \brief Constructor.
+     *
+     *  \param[in] points
+     *    2D array whose (i, j)th element contains the ith coordinate of the
+     *    jth point. Must have at most 3 rows and at least one column.
+     *  \param[in] maximumLeafSize
+     *    Clusters containing at most this number of points are not split. */
+    PointClusterTree(const arma::Mat<CoordinateType>& points,
+                     int maximumLeafSize);
+
+    /** \brief Number of coordinates of each point. */
+    int dimension() const {
+        return m_dimension;
+    }
+
+    /** \brief Number of nodes. The root has index 0. */
+    int nodeCount() const {
+        return m_nodes.size();
+    }
+
+    /** \brief Return the node with index \p index. */
+    const Node& node(int index) const {
+        return m_nodes[index];
+    }
+
+    /** \brief Indices of the points in the order of the clusters. */
+    const std::vector<int>& permutation() const {
+        return m_permutation;
+    }
+
+    /** \brief Length of the diagonal of the bounding box of node \p index. */
+    CoordinateType diameter(int index) const;
+
+    /** \brief Distance between the bounding box of node \p index of this
+     *  tree and that of node \p otherIndex of \p other. */
+    CoordinateType distance(int index, const PointClusterTree& other,
+                            int otherIndex) const;
+
+    /** \brief Distance between the bounding box of node \p index and the
+     *  point whose dimension() coordinates are stored in \p point. */
+    CoordinateType distance(int index, const CoordinateType* point) const;
+
+private:
+    /** \cond PRIVATE */
+    class CoordinateLess;
+
+    int buildNode(const arma::Mat<CoordinateType>& points,
+                  int begin, int end, int parent, int level,
+                  int maximumLeafSize);
+
+    int m_dimension;
+    std::vector<Node> m_nodes;
+    std::vector<int> m_permutation;
+    /** \endcond */
+};
+
+/** \cond PRIVATE */
+template <typename CoordinateType>
+class PointClusterTree<CoordinateType>::CoordinateLess
+{
+public:
+    CoordinateLess(const arma::Mat<CoordinateType>& points, int dim) :
+        m_points(points), m_dim(dim) {
+    }
+
+    bool operator()(int a, int b) const {
+        return m_points(m_dim, a) < m_points(m_dim, b);
+    }
+
+private:
+    const arma::Mat<CoordinateType>& m_points;
+    int m_dim;
+};
+/** \endcond */
+
+template <typename CoordinateType>
+PointClusterTree<CoordinateType>::PointClusterTree(
+        const arma::Mat<CoordinateType>& points, int maximumLeafSize) :
+    m_dimension(points.n_rows)
+{
+    if (m_dimension < 1 || m_dimension > 3)
+        throw std::invalid_argument(
+                "PointClusterTree::PointClusterTree(): "
+                "points must have between 1 and 3 coordinates");
+    if (points.n_cols == 0)
+        throw std::invalid_argument(
+                "PointClusterTree::PointClusterTree(): "
+                "the set of points must not be empty");
+    if (maximumLeafSize < 1)
+        throw std::invalid_argument(
+                "PointClusterTree::PointClusterTree(): "
+                "maximumLeafSize must be positive");
+
+    const int pointCount = points.n_cols;
+    m_permutation.resize(pointCount);
+    for (int i = 0; i < pointCount; ++i)
+        m_permutation[i] = i;
+    m_nodes.reserve(2 * (pointCount / maximumLeafSize + 1));
+    buildNode(points, 0, pointCount, -1, 0, maximumLeafSize);
+}
+
+template <typename CoordinateType>
+int PointClusterTree<CoordinateType>::buildNode(
+        const arma::Mat<CoordinateType>& points,
+        int begin, int end, int parent, int level, int maximumLeafSize)
+{
+    const int index = m_nodes.size();
+    m_nodes.push_back(Node());
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    node.firstChild = node.secondChild = -1;
+    node.parent = parent;
+    node.level = level;
+    for (int d = 0; d < 3; ++d)
+        node.lower[d] = node.upper[d] = 0.;
+    for (int d = 0; d < m_dimension; ++d)
+        node.lower[d] = node.upper[d] = points(d, m_permutation[begin]);
+    for (int i = begin + 1; i < end; ++i)
+        for (int d = 0; d < m_dimension; ++d) {
+            const CoordinateType x = points(d, m_permutation[i]);
+            node.lower[d] = std::min(node.lower[d], x);
+            node.upper[d] = std::max(node.upper[d], x);
+        }
+
+    int splitDim = 0;
+    for (int d = 1; d < m_dimension; ++d)
+        if (node.upper[d] - node.lower[d] >
+                node.upper[splitDim] - node.lower[splitDim])
+            splitDim = d;
+    // Coincident points cannot be separated
+    if (end - begin > maximumLeafSize &&
+            node.upper[splitDim] > node.lower[splitDim]) {
+        const int middle = begin + (end - begin) / 2;
+        std::nth_element(m_permutation.begin() + begin,
+                         m_permutation.begin() + middle,
+                         m_permutation.begin() + end,
+                         CoordinateLess(points, splitDim));
+        node.firstChild = buildNode(points, begin, middle, index, level + 1,
+                                    maximumLeafSize);
+        node.secondChild = buildNode(points, middle, end, index, level + 1,
+                                     maximumLeafSize);
+    }
+    m_nodes[index] = node;
+    return index;
+}
+
+template <typename CoordinateType>
+CoordinateType PointClusterTree<CoordinateType>::diameter(int index) const
+{
+    const Node& node = m_nodes[index];
+    CoordinateType sum = 0.;
+    for (int d = 0; d < m_dimension; ++d)
+        sum += (node.upper[d] - node.lower[d]) * (node.upper[d] - node.lower[d]);
+    return std::sqrt(sum);
+}
+
+template <typename CoordinateType>
+CoordinateType PointClusterTree<CoordinateType>::distance(
+        int index, const PointClusterTree& other, int otherIndex) const
+{
+    const Node& a = m_nodes[index];
+    const Node& b = other.m_nodes[otherIndex];
+    CoordinateType sum = 0.;
+    for (int d = 0; d < m_dimension; ++d) {
+        const CoordinateType gap = std::max(CoordinateType(0.), std::max(
+            a.lower[d] - b.upper[d], b.lower[d] - a.upper[d]));
+        sum += gap * gap;
+    }
+    return std::sqrt(sum);
+}
+
+template <typename CoordinateType>
+CoordinateType PointClusterTree<CoordinateType>::distance(
+        int index, const CoordinateType* point) const
+{
+    const Node& node = m_nodes[index];
+    CoordinateType sum = 0.;
+    for (int d = 0; d < m_dimension; ++d) {
+        const CoordinateType gap = std::max(CoordinateType(0.), std::max(
+            node.lower[d] - point[d], point[d] - node.upper[d]));
+        sum += gap * gap;
+    }
+    return std::sqrt(sum);
+}
+
+} // namespace Fiber
+
+#endif
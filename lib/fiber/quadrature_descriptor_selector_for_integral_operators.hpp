@@ -25,6 +25,9 @@
 
 #include "double_quadrature_descriptor.hpp"
 
+#include <string>
+#include <typeinfo>
+
 namespace Fiber
 {
 
@@ -55,6 +58,17 @@ public:
     virtual DoubleQuadratureDescriptor quadratureDescriptor(
         int testElementIndex, int trialElementIndex,
         CoordinateType nominalDistance) const = 0;
+
+    /** \brief Return a string identifying the rules followed by this
+     *  selector.
+     *
+     *  Selectors returning the same string must choose the same quadrature
+     *  descriptors for the same pairs of elements. The default implementation
+     *  returns the name of the dynamic type of the selector; subclasses
+     *  whose behaviour depends on parameters should append them. */
+    virtual std::string signature() const {
+        return typeid(*this).name();
+    }
 };
 
 } // namespace Fiber
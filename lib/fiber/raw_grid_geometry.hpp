@@ -23,11 +23,18 @@
 
 #include "../common/common.hpp"
 
+#include "shared_ptr.hpp"
+
 #include "../common/armadillo_fwd.hpp"
 
 namespace Fiber
 {
 
+/** \cond FORWARD_DECL */
+class ElementAdjacency;
+template <typename CoordinateType> struct ElementSizesAndCenters;
+/** \endcond */
+
 template <typename CoordinateType>
 class RawGridGeometry
 {
@@ -89,6 +96,23 @@ public:
         return m_domainIndices[elementIndex];
     }
 
+    /** \brief Lists of elements adjacent to each element.
+     *
+     *  Returns a null pointer unless these lists have been attached with
+     *  setElementAdjacency(). */
+    shared_ptr<const ElementAdjacency> elementAdjacency() const {
+        return m_elementAdjacency;
+    }
+
+    /** \brief Sizes and centres of all elements.
+     *
+     *  Returns a null pointer unless these data have been attached with
+     *  setElementSizesAndCenters(). */
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> >
+    elementSizesAndCenters() const {
+        return m_elementSizesAndCenters;
+    }
+
     // Non-const accessors (currently needed for construction)
 
     arma::Mat<CoordinateType>& vertices() {
@@ -107,6 +131,23 @@ public:
         return m_domainIndices;
     }
 
+    /** \brief Attach the lists of elements adjacent to each element.
+     *
+     *  This allows the lists, which are expensive to build on large grids, to
+     *  be shared by all objects using grid data with the same
+     *  element-corner connectivity. */
+    void setElementAdjacency(
+            const shared_ptr<const ElementAdjacency>& elementAdjacency) {
+        m_elementAdjacency = elementAdjacency;
+    }
+
+    /** \brief Attach precalculated sizes and centres of all elements. */
+    void setElementSizesAndCenters(
+            const shared_ptr<const ElementSizesAndCenters<CoordinateType> >&
+            elementSizesAndCenters) {
+        m_elementSizesAndCenters = elementSizesAndCenters;
+    }
+
     // Auxiliary functions
 
     template <typename Geometry>
@@ -131,6 +172,9 @@ private:
     arma::Mat<int> m_elementCornerIndices;
     arma::Mat<char> m_auxData;
     std::vector<int> m_domainIndices;
+    shared_ptr<const ElementAdjacency> m_elementAdjacency;
+    shared_ptr<const ElementSizesAndCenters<CoordinateType> >
+    m_elementSizesAndCenters;
 };
 
 } // namespace Fiber
@@ -0,0 +1,117 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_stacked_function_hpp
+#define fiber_stacked_function_hpp
+
+#include "../common/common.hpp"
+
+#include "function.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief %Function whose values are formed by stacking the values of several
+  other functions.
+
+  The components of the first function come first, followed by those of the
+  second function and so on. All the functions must have the same world and
+  codomain dimensions.
+
+  This makes it possible to evaluate a number of functions on the same
+  geometrical data; for example, NumericalTestFunctionIntegrator integrates
+  all of them in a single pass when given a StackedFunction.
+
+  The functions are stored by reference and must outlive this object.
+  */
+template <typename ValueType_>
+class StackedFunction : public Function<ValueType_>
+{
+public:
+    typedef Function<ValueType_> Base;
+    typedef typename Base::ValueType ValueType;
+    typedef typename Base::CoordinateType CoordinateType;
+
+    explicit StackedFunction(
+            const std::vector<const Function<ValueType>*>& functions) :
+        m_functions(functions) {
+        if (functions.empty())
+            throw std::invalid_argument(
+                    "StackedFunction::StackedFunction(): "
+                    "at least one function must be given");
+        for (size_t i = 0; i < functions.size(); ++i) {
+            if (!functions[i])
+                throw std::invalid_argument(
+                        "StackedFunction::StackedFunction(): "
+                        "functions must not be null");
+            if (functions[i]->worldDimension() !=
+                    functions[0]->worldDimension() ||
+                    functions[i]->codomainDimension() !=
+                    functions[0]->codomainDimension())
+                throw std::invalid_argument(
+                        "StackedFunction::StackedFunction(): "
+                        "all functions must have the same world and "
+                        "codomain dimensions");
+        }
+    }
+
+    /** \brief Number of stacked functions. */
+    int functionCount() const {
+        return m_functions.size();
+    }
+
+    virtual int worldDimension() const {
+        return m_functions[0]->worldDimension();
+    }
+
+    virtual int codomainDimension() const {
+        return m_functions.size() * m_functions[0]->codomainDimension();
+    }
+
+    virtual void addGeometricalDependencies(size_t& geomDeps) const {
+        for (size_t i = 0; i < m_functions.size(); ++i)
+            m_functions[i]->addGeometricalDependencies(geomDeps);
+    }
+
+    virtual void evaluate(const GeometricalData<CoordinateType>& geomData,
+                          arma::Mat<ValueType>& result) const {
+        const int componentCount = m_functions[0]->codomainDimension();
+        arma::Mat<ValueType> values;
+        for (size_t i = 0; i < m_functions.size(); ++i) {
+            m_functions[i]->evaluate(geomData, values);
+            if (i == 0)
+                result.set_size(codomainDimension(), values.n_cols);
+            result.rows(i * componentCount, (i + 1) * componentCount - 1) =
+                    values;
+        }
+    }
+
+private:
+    std::vector<const Function<ValueType>*> m_functions;
+};
+
+} // namespace Fiber
+
+#endif
@@ -33,6 +33,14 @@
 #include <vector>
 #include <tbb/mutex.h>
 
+/** \cond FORWARD_DECL */
+namespace Fiber
+{
+class ElementAdjacency;
+class ParallelizationOptions;
+} // namespace Fiber
+/** \endcond */
+
 
 namespace Bempp
 {
@@ -42,6 +50,7 @@ template<int codim> class Entity;
 class GeometryFactory;
 class GridView;
 class IdSet;
+class TriangleBvh;
 /** \endcond */
 
 /** \ingroup grid
@@ -117,10 +126,35 @@ public:
     void getBoundingBox(arma::Col<double>& lowerBound,
                         arma::Col<double>& upperBound) const;
 
+    /** \brief Get the lists of elements adjacent to each element of the
+     *  leaf view of this grid.
+     *
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used to build the lists.
+     *
+     *  The elements are numbered as in the arrays returned by
+     *  GridView::getRawElementData(). The lists are built on first request
+     *  and cached, so that all the operators defined on this grid can share
+     *  them. */
+    shared_ptr<const Fiber::ElementAdjacency> elementAdjacency(
+            const Fiber::ParallelizationOptions& parallelizationOptions) const;
+
+    /** \brief Get the bounding volume hierarchy of the elements of the leaf
+     *  view of this grid.
+     *
+     *  Quadrilateral elements are split into two triangles. The hierarchy is
+     *  built on first request and cached.
+     *
+     *  \note Implemented only for 2D grids embedded in 3D spaces. */
+    shared_ptr<const TriangleBvh> triangleBvh() const;
 
 private:
     /** \cond PRIVATE */
     mutable arma::Col<double> m_lowerBound, m_upperBound;
+    mutable shared_ptr<const Fiber::ElementAdjacency> m_elementAdjacency;
+    mutable tbb::mutex m_elementAdjacencyMutex;
+    mutable shared_ptr<const TriangleBvh> m_triangleBvh;
+    mutable tbb::mutex m_triangleBvhMutex;
     /** \endcond */
 };
 
@@ -140,6 +174,10 @@ private:
  *
  *  \note This function has only been tested for triangular grids.
  *
+ *  \note The queries are run in parallel against the bounding volume
+ *    hierarchy returned by Grid::triangleBvh(), which is built on the first
+ *    call and reused by subsequent ones.
+ *
  *  \note The implementation assumes that no grid vertices are separated by less
  *    than 1e-9.
  */
@@ -0,0 +1,334 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "triangle_bvh.hpp"
+
+#include "ray_triangle_intersection.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/execution_context.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <tbb/blocked_range.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Maximum number of triangles stored in a leaf
+const int MAX_LEAF_SIZE = 4;
+// Number of rays traced together through the hierarchy
+const int PACKET_SIZE = 8;
+// Enough for any hierarchy built by median splits
+const int MAX_STACK_SIZE = 64;
+
+class CentroidComparator
+{
+public:
+    CentroidComparator(const std::vector<double>& centroids, int axis) :
+        m_centroids(centroids), m_axis(axis) {
+    }
+
+    bool operator()(int t1, int t2) const {
+        return m_centroids[3 * t1 + m_axis] < m_centroids[3 * t2 + m_axis];
+    }
+
+private:
+    const std::vector<double>& m_centroids;
+    int m_axis;
+};
+
+// Interleave the lower 16 bits of x and y
+unsigned int mortonCode(unsigned int x, unsigned int y)
+{
+    unsigned int result = 0;
+    for (int bit = 0; bit < 16; ++bit)
+        result |= ((x >> bit) & 1u) << (2 * bit) |
+                ((y >> bit) & 1u) << (2 * bit + 1);
+    return result;
+}
+
+unsigned int quantize(double x, double lower, double upper)
+{
+    const double MAX_VALUE = 65535.;
+    if (upper <= lower)
+        return 0;
+    return static_cast<unsigned int>(
+                std::min(MAX_VALUE,
+                         std::max(0., (x - lower) / (upper - lower) * MAX_VALUE)));
+}
+
+bool isNew(const double* intersection, const std::vector<double>& intersections)
+{
+    const double EPSILON = 1e-10;
+    for (size_t i = 0; i < intersections.size(); i += 3)
+        if (std::fabs(intersections[i] - intersection[0]) < EPSILON &&
+                std::fabs(intersections[i + 1] - intersection[1]) < EPSILON &&
+                std::fabs(intersections[i + 2] - intersection[2]) < EPSILON)
+            return false;
+    return true;
+}
+
+} // namespace
+
+/** \cond PRIVATE */
+class TriangleBvh::InsideTestLoopBody
+{
+public:
+    InsideTestLoopBody(const TriangleBvh& bvh,
+                       const arma::Mat<double>& points,
+                       const std::vector<int>& sortedPointIndices,
+                       std::vector<char>& result) :
+        m_bvh(bvh), m_points(points),
+        m_sortedPointIndices(sortedPointIndices), m_result(result) {
+    }
+
+    void operator()(const tbb::blocked_range<size_t>& r) const {
+        std::vector<double> intersections[PACKET_SIZE];
+        for (size_t packet = r.begin(); packet != r.end(); ++packet) {
+            const size_t begin = packet * PACKET_SIZE;
+            const size_t end = std::min(begin + PACKET_SIZE,
+                                        m_sortedPointIndices.size());
+            const int rayCount = end - begin;
+            for (int ray = 0; ray < rayCount; ++ray)
+                intersections[ray].clear();
+            tracePacket(&m_sortedPointIndices[begin], rayCount, intersections);
+            for (int ray = 0; ray < rayCount; ++ray)
+                m_result[m_sortedPointIndices[begin + ray]] =
+                        (intersections[ray].size() / 3) % 2;
+        }
+    }
+
+private:
+    // Collect the distinct intersections of the surface with the rays cast
+    // in the +z direction from points pointIndices[0], ...,
+    // pointIndices[rayCount - 1]
+    void tracePacket(const int* pointIndices, int rayCount,
+                     std::vector<double>* intersections) const {
+        double x[PACKET_SIZE], y[PACKET_SIZE], z[PACKET_SIZE];
+        const double* origins[PACKET_SIZE];
+        for (int ray = 0; ray < rayCount; ++ray) {
+            origins[ray] = m_points.colptr(pointIndices[ray]);
+            x[ray] = origins[ray][0];
+            y[ray] = origins[ray][1];
+            z[ray] = origins[ray][2];
+        }
+        const std::vector<Node>& nodes = m_bvh.m_nodes;
+        const std::vector<double>& triangles = m_bvh.m_triangles;
+
+        bool active[PACKET_SIZE];
+        double intersection[3];
+        int stack[MAX_STACK_SIZE];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            bool anyActive = false;
+            for (int ray = 0; ray < rayCount; ++ray) {
+                active[ray] =
+                        x[ray] >= node.lower[0] && x[ray] <= node.upper[0] &&
+                        y[ray] >= node.lower[1] && y[ray] <= node.upper[1] &&
+                        z[ray] <= node.upper[2];
+                anyActive |= active[ray];
+            }
+            if (!anyActive)
+                continue;
+            if (node.count == 0) {
+                stack[stackSize++] = node.secondChild;
+                stack[stackSize++] = &node - &nodes[0] + 1;
+                continue;
+            }
+            for (int t = node.first; t < node.first + node.count; ++t) {
+                const double* v0 = &triangles[9 * t];
+                const double* v1 = v0 + 3;
+                const double* v2 = v0 + 6;
+                const double xMin = std::min(v0[0], std::min(v1[0], v2[0]));
+                const double xMax = std::max(v0[0], std::max(v1[0], v2[0]));
+                const double yMin = std::min(v0[1], std::min(v1[1], v2[1]));
+                const double yMax = std::max(v0[1], std::max(v1[1], v2[1]));
+                for (int ray = 0; ray < rayCount; ++ray)
+                    if (active[ray] &&
+                            x[ray] >= xMin && x[ray] <= xMax &&
+                            y[ray] >= yMin && y[ray] <= yMax &&
+                            zRayIntersectsTriangle(origins[ray], v0, v1, v2,
+                                                   intersection) > 0. &&
+                            isNew(intersection, intersections[ray]))
+                        intersections[ray].insert(intersections[ray].end(),
+                                                  intersection, intersection + 3);
+            }
+        }
+    }
+
+    const TriangleBvh& m_bvh;
+    const arma::Mat<double>& m_points;
+    const std::vector<int>& m_sortedPointIndices;
+    std::vector<char>& m_result;
+};
+/** \endcond */
+
+TriangleBvh::TriangleBvh(const arma::Mat<double>& vertices,
+                         const arma::Mat<int>& triangleCorners)
+{
+    if (vertices.n_rows != 3 || triangleCorners.n_rows != 3)
+        throw std::invalid_argument(
+                "TriangleBvh::TriangleBvh(): vertices and triangleCorners "
+                "must have 3 rows");
+    const int vertexCount = vertices.n_cols;
+    const int triangleCount = triangleCorners.n_cols;
+
+    std::vector<double> triangles(9 * triangleCount);
+    std::vector<double> centroids(3 * triangleCount, 0.);
+    for (int t = 0; t < triangleCount; ++t)
+        for (int c = 0; c < 3; ++c) {
+            const int v = triangleCorners(c, t);
+            if (v < 0 || v >= vertexCount)
+                throw std::invalid_argument(
+                        "TriangleBvh::TriangleBvh(): invalid vertex index");
+            for (int d = 0; d < 3; ++d) {
+                triangles[9 * t + 3 * c + d] = vertices(d, v);
+                centroids[3 * t + d] += vertices(d, v) / 3.;
+            }
+        }
+
+    if (triangleCount == 0)
+        return;
+    std::vector<int> order(triangleCount);
+    for (int t = 0; t < triangleCount; ++t)
+        order[t] = t;
+    m_nodes.reserve(2 * (triangleCount / MAX_LEAF_SIZE + 1));
+    buildNode(order, 0, triangleCount, centroids, triangles);
+
+    m_triangles.resize(triangles.size());
+    for (int t = 0; t < triangleCount; ++t)
+        std::copy(&triangles[9 * order[t]], &triangles[9 * order[t]] + 9,
+                  &m_triangles[9 * t]);
+}
+
+int TriangleBvh::buildNode(std::vector<int>& order, int begin, int end,
+                           const std::vector<double>& centroids,
+                           const std::vector<double>& triangles)
+{
+    const int index = m_nodes.size();
+    m_nodes.push_back(Node());
+
+    Node node;
+    double centroidLower[3], centroidUpper[3];
+    for (int d = 0; d < 3; ++d) {
+        node.lower[d] = centroidLower[d] = std::numeric_limits<double>::max();
+        node.upper[d] = centroidUpper[d] = -std::numeric_limits<double>::max();
+    }
+    for (int i = begin; i < end; ++i) {
+        const int t = order[i];
+        for (int d = 0; d < 3; ++d) {
+            for (int c = 0; c < 3; ++c) {
+                node.lower[d] = std::min(node.lower[d], triangles[9 * t + 3 * c + d]);
+                node.upper[d] = std::max(node.upper[d], triangles[9 * t + 3 * c + d]);
+            }
+            centroidLower[d] = std::min(centroidLower[d], centroids[3 * t + d]);
+            centroidUpper[d] = std::max(centroidUpper[d], centroids[3 * t + d]);
+        }
+    }
+
+    if (end - begin <= MAX_LEAF_SIZE) {
+        node.first = begin;
+        node.count = end - begin;
+        node.secondChild = -1;
+        m_nodes[index] = node;
+        return index;
+    }
+
+    int axis = 0;
+    for (int d = 1; d < 3; ++d)
+        if (centroidUpper[d] - centroidLower[d] >
+                centroidUpper[axis] - centroidLower[axis])
+            axis = d;
+    const int middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle,
+                     order.begin() + end, CentroidComparator(centroids, axis));
+
+    node.first = -1;
+    node.count = 0;
+    m_nodes[index] = node;
+    buildNode(order, begin, middle, centroids, triangles);
+    const int secondChild = buildNode(order, middle, end, centroids, triangles);
+    m_nodes[index].secondChild = secondChild;
+    return index;
+}
+
+std::vector<bool> TriangleBvh::areInside(
+        const arma::Mat<double>& points,
+        const ParallelizationOptions& parallelizationOptions) const
+{
+    if (points.n_rows != 3)
+        throw std::invalid_argument("TriangleBvh::areInside(): "
+                                    "points must have 3 rows");
+    const size_t pointCount = points.n_cols;
+    std::vector<bool> result(pointCount, false);
+    if (m_nodes.empty())
+        return result;
+
+    // Discard the points lying outside the bounding box of the surface and
+    // sort the others along a Z-order curve in the xy plane, so that
+    // neighbouring rays end up in the same packet
+    const Node& root = m_nodes[0];
+    std::vector<std::pair<unsigned int, int> > keys;
+    keys.reserve(pointCount);
+    for (size_t pt = 0; pt < pointCount; ++pt) {
+        bool outside = false;
+        for (int d = 0; d < 3; ++d)
+            outside |= points(d, pt) < root.lower[d] ||
+                    points(d, pt) > root.upper[d];
+        if (outside)
+            continue;
+        keys.push_back(std::make_pair(
+                           mortonCode(quantize(points(0, pt),
+                                               root.lower[0], root.upper[0]),
+                                      quantize(points(1, pt),
+                                               root.lower[1], root.upper[1])),
+                           int(pt)));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<int> sortedPointIndices(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        sortedPointIndices[i] = keys[i].second;
+
+    // std::vector<bool> cannot be written to concurrently
+    std::vector<char> inside(pointCount, 0);
+    const size_t packetCount =
+            (sortedPointIndices.size() + PACKET_SIZE - 1) / PACKET_SIZE;
+    Fiber::ExecutionContext::instance().parallelFor(
+                parallelizationOptions,
+                tbb::blocked_range<size_t>(
+                    0, packetCount,
+                    Fiber::ExecutionContext::grainSize(parallelizationOptions)),
+                InsideTestLoopBody(*this, points, sortedPointIndices, inside));
+
+    for (size_t pt = 0; pt < pointCount; ++pt)
+        result[pt] = inside[pt];
+    return result;
+}
+
+} // namespace Bempp
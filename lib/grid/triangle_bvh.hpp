@@ -0,0 +1,121 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_triangle_bvh_hpp
+#define bempp_triangle_bvh_hpp
+
+#include "../common/common.hpp"
+
+#include "../fiber/parallelization_options.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <vector>
+
+namespace Bempp
+{
+
+using Fiber::ParallelizationOptions;
+
+/** \ingroup grid
+ *  \brief Bounding volume hierarchy of a set of triangles in 3D space.
+ *
+ *  The hierarchy is a binary tree of axis-aligned bounding boxes built by
+ *  recursive median splits along the longest axis of the box enclosing the
+ *  triangle centroids, so its depth is logarithmic in the number of
+ *  triangles. It is used to test whether points lie inside a closed surface
+ *  by counting the intersections of the surface with rays cast from these
+ *  points in the +z direction.
+ *
+ *  Objects of this class are immutable and can be queried concurrently. */
+class TriangleBvh
+{
+public:
+    /** \brief Constructor.
+     *
+     *  \param[in] vertices
+     *    2D array whose (i, j)th element contains the ith coordinate of the
+     *    jth vertex. Must have 3 rows.
+     *  \param[in] triangleCorners
+     *    2D array whose (i, j)th element contains the index of the ith corner
+     *    of the jth triangle. Must have 3 rows. */
+    TriangleBvh(const arma::Mat<double>& vertices,
+                const arma::Mat<int>& triangleCorners);
+
+    /** \brief Number of triangles stored in the hierarchy. */
+    size_t triangleCount() const {
+        return m_triangles.size() / 9;
+    }
+
+    /** \brief Check whether points are inside the surface formed by the
+     *  triangles.
+     *
+     *  \param[in] points
+     *    2D array of dimensions (3, \c n) whose (\c i, \c j)th element is the
+     *    \c i'th coordinate of \c j'th point.
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used in the queries.
+     *
+     *  \returns A vector of length \c n whose \c j'th element is \c true if
+     *    the \c j'th point lies inside the surface, \c false otherwise.
+     *
+     *  A point is regarded as inside if a ray cast from it in the +z direction
+     *  crosses the surface an odd number of times (intersection points lying
+     *  closer than 1e-10 to each other, such as those with edges shared by
+     *  two triangles, are counted once). The results are undefined if the
+     *  triangles do not form a closed surface.
+     *
+     *  The points are sorted along a space-filling curve and traced in
+     *  packets of neighbouring rays, which share a single traversal of the
+     *  hierarchy. */
+    std::vector<bool> areInside(
+            const arma::Mat<double>& points,
+            const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions()) const;
+
+private:
+    /** \cond PRIVATE */
+    struct Node
+    {
+        double lower[3];
+        double upper[3];
+        // Leaves: index of the first triangle and number of triangles.
+        // Internal nodes: count == 0; the first child immediately follows
+        // its parent and the second child is stored at index secondChild.
+        int first;
+        int count;
+        int secondChild;
+    };
+
+    class InsideTestLoopBody;
+
+    int buildNode(std::vector<int>& order, int begin, int end,
+                  const std::vector<double>& centroids,
+                  const std::vector<double>& triangles);
+
+    std::vector<Node> m_nodes;
+    // Corners of the triangles, in the order of the leaves referring to them
+    // (9 coordinates per triangle)
+    std::vector<double> m_triangles;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
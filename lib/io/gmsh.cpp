@@ -23,8 +23,9 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
-#include "boost/tokenizer.hpp"
-#include "boost/lexical_cast.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
 #include "../fiber/explicit_instantiation.hpp"
 #include "../space/space.hpp"
 #include "../space/piecewise_constant_scalar_space.hpp"
@@ -52,8 +53,6 @@
 
 namespace {
 
-typedef std::vector<std::string> StringVector;
-
 std::istream& safeGetline(std::istream& is, std::string& t)
 {
     t.clear();
@@ -89,15 +88,159 @@ std::istream& safeGetline(std::istream& is, std::string& t)
     }
 }
 
-StringVector stringTokens(std::string input) {
+// Reads whitespace-separated numbers directly from the stream buffer,
+// without allocating a string for each line or token
+class AsciiTokenizer
+{
+public:
+    explicit AsciiTokenizer(std::istream& input) : m_buf(input.rdbuf()) {
+    }
+
+    // Skip spaces and tabs, but not line ends
+    void skipBlanks() {
+        int c = m_buf->sgetc();
+        while (c == ' ' || c == '\t' || c == '\r')
+            c = m_buf->snextc();
+    }
+
+    void skipWhitespace() {
+        int c = m_buf->sgetc();
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            c = m_buf->snextc();
+    }
+
+    // Return true if there are no more tokens in the current line
+    bool atEndOfLine() {
+        skipBlanks();
+        const int c = m_buf->sgetc();
+        return c == '\n' || c == EOF;
+    }
+
+    // Move to the beginning of the next line
+    void skipLine() {
+        int c = m_buf->sbumpc();
+        while (c != '\n' && c != EOF)
+            c = m_buf->sbumpc();
+    }
+
+    int readInt() {
+        skipWhitespace();
+        int c = m_buf->sgetc();
+        const bool negative = (c == '-');
+        if (c == '-' || c == '+')
+            c = m_buf->snextc();
+        if (c < '0' || c > '9')
+            throw std::runtime_error("GmshData::read(): Integer expected.");
+        int value = 0;
+        while (c >= '0' && c <= '9') {
+            value = 10 * value + (c - '0');
+            c = m_buf->snextc();
+        }
+        return negative ? -value : value;
+    }
+
+    double readDouble() {
+        const int MAX_LENGTH = 63;
+        char buffer[MAX_LENGTH + 1];
+        int length = 0;
+        skipWhitespace();
+        int c = m_buf->sgetc();
+        while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' &&
+               length < MAX_LENGTH) {
+            buffer[length++] = c;
+            c = m_buf->snextc();
+        }
+        buffer[length] = 0;
+        char* end;
+        const double value = std::strtod(buffer, &end);
+        if (length == 0 || *end != 0)
+            throw std::runtime_error("GmshData::read(): Real number expected.");
+        return value;
+    }
+
+    // Read a token, removing the quotes around it if present
+    std::string readString() {
+        std::string result;
+        skipWhitespace();
+        int c = m_buf->sgetc();
+        if (c == '\"') {
+            c = m_buf->snextc();
+            while (c != '\"' && c != '\n' && c != EOF) {
+                result += char(c);
+                c = m_buf->snextc();
+            }
+            if (c == '\"')
+                m_buf->sbumpc();
+        }
+        else
+            while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                result += char(c);
+                c = m_buf->snextc();
+            }
+        return result;
+    }
 
-    StringVector result;
-    boost::char_delimiters_separator<char> separator(false," ");
-    boost::tokenizer<boost::char_delimiters_separator<char> > tok(input,separator);
-    boost::tokenizer<>::iterator it;
-    for (it = tok.begin(); it != tok.end(); ++it)
-        result.push_back(*it);
-    return result;
+    // Read the rest of the current line, removing the quotes around it if
+    // present
+    std::string readQuotedLine() {
+        skipWhitespace();
+        std::string result;
+        int c = m_buf->sbumpc();
+        while (c != '\n' && c != EOF) {
+            if (c != '\"' && c != '\r')
+                result += char(c);
+            c = m_buf->sbumpc();
+        }
+        return result;
+    }
+
+private:
+    std::streambuf* m_buf;
+};
+
+template <typename T>
+void readBinary(std::istream& input, T* values, size_t count)
+{
+    const std::streamsize size = count * sizeof(T);
+    if (input.rdbuf()->sgetn(reinterpret_cast<char*>(values), size) != size)
+        throw std::runtime_error("GmshData::read(): Unexpected end of file.");
+}
+
+template <typename T>
+void writeBinary(std::ostream& output, const T* values, size_t count)
+{
+    output.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+// Number of nodes of an element of the given Gmsh type, or -1 if the type
+// is not known
+int nodesPerElement(int elementType)
+{
+    static const int counts[] = {
+        -1, 2, 3, 4, 4, 8, 6, 5, 3, 6, 9, 10, 27, 18, 14, 1, 8, 20, 15, 13,
+        9, 10, 12, 15, 15, 21, 4, 5, 6, 20, 35, 56};
+    if (elementType < 0 || elementType >= int(sizeof(counts) / sizeof(int)))
+        return -1;
+    return counts[elementType];
+}
+
+// Print a number with enough digits to recover it exactly
+void writeDouble(std::ostream& output, double value)
+{
+    char buffer[32];
+    std::sprintf(buffer, "%.17g", value);
+    output << buffer;
+}
+
+void checkSectionEnd(std::istream& input, AsciiTokenizer& tokenizer,
+                     const char* expected, const char* sectionName)
+{
+    std::string line;
+    tokenizer.skipWhitespace();
+    safeGetline(input, line);
+    if (line != expected)
+        throw std::runtime_error(std::string("GmshData::read(): Error reading ") +
+                                 sectionName + " section.");
 }
 
 } // namespace
@@ -165,15 +308,20 @@ int GmshData::numberOfInterpolationSchemeSets() const {
 
 void GmshData::addNode(int index, double x, double y, double z){
 
-    if (index>=m_nodes.size()) m_nodes.resize(index+1);
-    if (!m_nodes[index]) {
-        m_nodes[index] = shared_ptr<Node>(new Node());
+    if (index < 0) throw std::runtime_error(
+                "GmshData::addNode(): Index must be nonnegative.");
+    if (index >= m_nodeDefined.size()) {
+        m_nodeDefined.resize(index+1, 0);
+        m_nodeCoordinates.resize(3*(index+1));
+    }
+    if (!m_nodeDefined[index]) {
+        m_nodeDefined[index] = 1;
         ++m_numberOfNodes;
     }
 
-    m_nodes[index]->x = x;
-    m_nodes[index]->y = y;
-    m_nodes[index]->z = z;
+    m_nodeCoordinates[3*index] = x;
+    m_nodeCoordinates[3*index+1] = y;
+    m_nodeCoordinates[3*index+2] = z;
 
 }
 
@@ -181,18 +329,53 @@ void GmshData::addElement(int index, int elementType, const std::vector<int>& no
                 int physicalEntity, int elementaryEntity,
                 const std::vector<int>& partitions){
 
-    if (index>=m_elements.size()) m_elements.resize(index+1);
-    if (!m_elements[index]) {
-        m_elements[index] = shared_ptr<Element>(new Element());
+    addElement(index, elementType,
+               nodes.empty() ? 0 : &nodes[0], nodes.size(),
+               physicalEntity, elementaryEntity,
+               partitions.empty() ? 0 : &partitions[0], partitions.size());
+
+}
+
+void GmshData::addElement(int index, int elementType, const int* nodes, int nodeCount,
+                int physicalEntity, int elementaryEntity,
+                const int* partitions, int partitionCount){
+
+    if (index < 0) throw std::runtime_error(
+                "GmshData::addElement(): Index must be nonnegative.");
+    if (elementType <= 0) throw std::runtime_error(
+                "GmshData::addElement(): Invalid element type.");
+    if (index >= m_elements.size()) {
+        Element undefined;
+        undefined.type = 0;
+        m_elements.resize(index+1, undefined);
+    }
+    Element& element = m_elements[index];
+    const bool isNew = (element.type == 0);
+    if (isNew)
         ++m_numberOfElements;
+
+    element.type = elementType;
+    element.physicalEntity = physicalEntity;
+    element.elementaryEntity = elementaryEntity;
+    if (isNew || element.partitionCount + element.nodeCount <
+            partitionCount + nodeCount) {
+        // Redefinitions of elements are rare, so the space taken by the old
+        // connectivity data is not reclaimed
+        element.offset = m_elementConnectivity.size();
+        m_elementConnectivity.resize(element.offset + partitionCount + nodeCount);
     }
+    element.partitionCount = partitionCount;
+    element.nodeCount = nodeCount;
+    std::copy(partitions, partitions + partitionCount,
+              m_elementConnectivity.begin() + element.offset);
+    std::copy(nodes, nodes + nodeCount,
+              m_elementConnectivity.begin() + element.offset + partitionCount);
+
+}
 
-    m_elements[index]->type = elementType;
-    m_elements[index]->physicalEntity = physicalEntity;
-    m_elements[index]->elementaryEntity = elementaryEntity;
-    m_elements[index]->nodes = nodes;
-    m_elements[index]->partitions = partitions;
+bool GmshData::hasElement(int index) const {
 
+    return index >= 0 && index < m_elements.size() && m_elements[index].type != 0;
 
 }
 
@@ -317,8 +500,8 @@ void GmshData::getNodeIndices(std::vector<int>& indices) const {
 
     indices.clear();
     indices.reserve(m_numberOfNodes);
-    for (int i = 0; i < m_nodes.size(); i++ )
-        if (m_nodes[i]) indices.push_back(i);
+    for (int i = 0; i < m_nodeDefined.size(); i++ )
+        if (m_nodeDefined[i]) indices.push_back(i);
 
 
 }
@@ -328,7 +511,7 @@ void GmshData::getElementIndices(std::vector<int>& indices) const {
     indices.clear();
     indices.reserve(m_numberOfElements);
     for (int i = 0; i < m_elements.size(); i++ )
-        if (m_elements[i]) indices.push_back(i);
+        if (m_elements[i].type != 0) indices.push_back(i);
 
 
 }
@@ -336,33 +519,30 @@ void GmshData::getElementIndices(std::vector<int>& indices) const {
 
 void GmshData::getNode(int index, double& x, double& y, double& z) const {
 
-    if (index >= m_nodes.size()) throw std::runtime_error(
-                "GmshData::getNode(): Index does not exist.");
-    if (m_nodes[index]) {
-        x = m_nodes[index]->x;
-        y = m_nodes[index]->y;
-        z = m_nodes[index]->z;
-    }
-    else throw std::runtime_error(
+    if (index < 0 || index >= m_nodeDefined.size() || !m_nodeDefined[index])
+        throw std::runtime_error(
                 "GmshData::getNode(): Index does not exist.");
+    x = m_nodeCoordinates[3*index];
+    y = m_nodeCoordinates[3*index+1];
+    z = m_nodeCoordinates[3*index+2];
 
 }
 
 void GmshData::getElement(int index, int& elementType, std::vector<int>& nodes,
                 int& physicalEntity, int& elementaryEntity, std::vector<int>& partitions) const {
 
-    if (index >= m_elements.size()) throw std::runtime_error(
+    if (!hasElement(index)) throw std::runtime_error(
                 "GmshData::getElement(): Index does not exist.");
 
-    if (m_elements[index]) {
-        elementType = m_elements[index]->type;
-        nodes = m_elements[index]->nodes;
-        physicalEntity = m_elements[index]->physicalEntity;
-        elementaryEntity = m_elements[index]->elementaryEntity;
-        partitions = m_elements[index]->partitions;
-    }
-    else throw std::runtime_error(
-                "GmshData::getElement(): Index does not exist.");
+    const Element& element = m_elements[index];
+    elementType = element.type;
+    physicalEntity = element.physicalEntity;
+    elementaryEntity = element.elementaryEntity;
+    std::vector<int>::const_iterator begin =
+            m_elementConnectivity.begin() + element.offset;
+    partitions.assign(begin, begin + element.partitionCount);
+    nodes.assign(begin + element.partitionCount,
+                 begin + element.partitionCount + element.nodeCount);
 
 }
 void GmshData::getElement(int index, int& elementType, std::vector<int>& nodes,
@@ -512,61 +692,114 @@ void GmshData::getInterpolationSchemeSet(int index, std::string& name, int& topo
 
 void GmshData::reserveNumberOfNodes(int n) {
 
-    m_nodes.reserve(n+1);
+    m_nodeDefined.reserve(n+1);
+    m_nodeCoordinates.reserve(3*(n+1));
 
 }
 void GmshData::reserveNumberOfElements(int n) {
 
     m_elements.reserve(n+1);
+    // Assume triangles
+    m_elementConnectivity.reserve(3*n);
 }
 
-void GmshData::write(std::ostream& output) const {
+void GmshData::write(std::ostream& output, bool binary) const {
 
 
     output << "$MeshFormat" << std::endl;
     output << "2.2" << " " <<
-              0 << " " <<
+              (binary ? 1 : 0) << " " <<
               sizeof(double) << std::endl;
+    if (binary) {
+        const int one = 1; // allows the reader to detect the endianness
+        writeBinary(output, &one, 1);
+        output << std::endl;
+    }
     output << "$EndMeshFormat" << std::endl;
 
     if (m_numberOfNodes >0){
-        std::vector<int> nodeIndices;
-        getNodeIndices(nodeIndices);
-
         output << "$Nodes" << std::endl;
         output << m_numberOfNodes << std::endl;
-        for (int i=0; i < m_numberOfNodes;i++){
-            output << nodeIndices[i] << " " <<
-            boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->x) << " " <<
-            boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->y) << " " <<
-            boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->z) << std::endl;
+        for (int i = 0; i < m_nodeDefined.size(); i++){
+            if (!m_nodeDefined[i])
+                continue;
+            if (binary) {
+                writeBinary(output, &i, 1);
+                writeBinary(output, &m_nodeCoordinates[3*i], 3);
+            }
+            else {
+                output << i;
+                for (int j = 0; j < 3; j++) {
+                    output << " ";
+                    writeDouble(output, m_nodeCoordinates[3*i+j]);
+                }
+                output << "\n";
+            }
         }
+        if (binary)
+            output << std::endl;
         output << "$EndNodes" << std::endl;
     }
 
     if (m_numberOfElements>0) {
-        std::vector<int> elementIndices;
-        getElementIndices(elementIndices);
         output << "$Elements" << std::endl;
         output << m_numberOfElements << std::endl;
-        for (int i = 0; i< m_numberOfElements; i++) {
-            Element& element = *m_elements[elementIndices[i]];
-            int ntags;
-            if (element.partitions.size())
-                ntags = 3+element.partitions.size();
-            else
-                ntags = 2;
-            output << elementIndices[i] << " " <<
-                      element.type << " " <<
-                      ntags << " " <<
-                      element.physicalEntity << " " <<
-                      element.elementaryEntity;
-            for (int j = 0; j < element.partitions.size(); j++)
-                output << " " << element.partitions[j];
-            for (int j = 0; j < element.nodes.size(); j++)
-                output << " " << element.nodes[j];
-            output << std::endl;
+        std::vector<int> record;
+        for (int i = 0; i < m_elements.size(); ) {
+            const Element& element = m_elements[i];
+            if (element.type == 0) {
+                ++i;
+                continue;
+            }
+            const int ntags = element.partitionCount ? 3+element.partitionCount : 2;
+            // Binary files store elements in blocks of elements of the same
+            // type and with the same number of tags
+            int blockEnd = i + 1;
+            if (binary) {
+                if (element.nodeCount != nodesPerElement(element.type))
+                    throw std::runtime_error(
+                            "GmshData::write(): Elements of unknown type or with a "
+                            "wrong number of nodes cannot be written in binary format.");
+                int blockSize = 1;
+                for (; blockEnd < m_elements.size(); ++blockEnd) {
+                    const Element& next = m_elements[blockEnd];
+                    if (next.type == 0)
+                        continue;
+                    if (next.type != element.type ||
+                            next.partitionCount != element.partitionCount ||
+                            next.nodeCount != element.nodeCount)
+                        break;
+                    ++blockSize;
+                }
+                const int header[3] = {element.type, blockSize, ntags};
+                writeBinary(output, header, 3);
+            }
+            for (; i < blockEnd; ++i) {
+                const Element& current = m_elements[i];
+                if (current.type == 0)
+                    continue;
+                record.clear();
+                record.push_back(i);
+                record.push_back(current.physicalEntity);
+                record.push_back(current.elementaryEntity);
+                if (current.partitionCount)
+                    record.push_back(current.partitionCount);
+                record.insert(record.end(),
+                              m_elementConnectivity.begin() + current.offset,
+                              m_elementConnectivity.begin() + current.offset +
+                              current.partitionCount + current.nodeCount);
+                if (binary)
+                    writeBinary(output, &record[0], record.size());
+                else {
+                    output << i << " " << current.type << " " << ntags;
+                    for (int j = 1; j < record.size(); j++)
+                        output << " " << record[j];
+                    output << "\n";
+                }
+            }
         }
+        if (binary)
+            output << std::endl;
         output << "$EndElements" << std::endl;
     }
 
@@ -592,101 +825,133 @@ void GmshData::write(std::ostream& output) const {
 
     if (m_physicalNames.size() > 0) {
         output << "$PhysicalNames" << std::endl;
+        output << m_physicalNames.size() << std::endl;
         for (int i = 0;i < m_physicalNames.size(); ++i) {
             output << m_physicalNames[i].dimension << " " <<
                       m_physicalNames[i].number << " " <<
-                      m_physicalNames[i].name << std::endl;
+                      '\"'+m_physicalNames[i].name+'\"' << std::endl;
         }
         output << "$EndPhysicalNames" << std::endl;
     }
 
-    if (m_nodeDataSets.size() > 0) {
-        for (int i = 0; i < m_nodeDataSets.size(); ++i) {
+    for (int i = 0; i < m_nodeDataSets.size(); ++i) {
 
-            NodeDataSet& nodeDataSet = *m_nodeDataSets[i];
-            output << "$NodeData" << std::endl;
-            output << nodeDataSet.stringTags.size() << std::endl;
-            for (int i = 0; i< nodeDataSet.stringTags.size(); ++i) {
-                output << '\"'+nodeDataSet.stringTags[i]+'\"' << std::endl;
-            }
-            output << nodeDataSet.realTags.size() << std::endl;
-            for (int i = 0; i < nodeDataSet.realTags.size(); ++i) {
-                output << boost::lexical_cast<std::string>(nodeDataSet.realTags[i]) << std::endl;
+        NodeDataSet& nodeDataSet = *m_nodeDataSets[i];
+        output << "$NodeData" << std::endl;
+        output << nodeDataSet.stringTags.size() << std::endl;
+        for (int j = 0; j< nodeDataSet.stringTags.size(); ++j) {
+            output << '\"'+nodeDataSet.stringTags[j]+'\"' << std::endl;
+        }
+        output << nodeDataSet.realTags.size() << std::endl;
+        for (int j = 0; j < nodeDataSet.realTags.size(); ++j) {
+            writeDouble(output, nodeDataSet.realTags[j]);
+            output << std::endl;
+        }
+        output << 4 << std::endl; // Number of integer tags
+        output << nodeDataSet.timeStep << std::endl;
+        output << nodeDataSet.numberOfFieldComponents << std::endl;
+        output << nodeDataSet.values.size() << std::endl;
+        output << nodeDataSet.partition << std::endl;
+        for (int j = 0; j < nodeDataSet.values.size(); ++j ) {
+            const std::vector<double>& values = nodeDataSet.values[j];
+            if (binary) {
+                writeBinary(output, &nodeDataSet.nodeIndices[j], 1);
+                writeBinary(output, &values[0], values.size());
             }
-            output << 4 << std::endl; // Number of integer tags
-            output << nodeDataSet.timeStep << std::endl;
-            output << nodeDataSet.numberOfFieldComponents << std::endl;
-            output << nodeDataSet.values.size() << std::endl;
-            output << nodeDataSet.partition << std::endl;
-            for (int i = 0; i < nodeDataSet.values.size(); ++i ) {
-                output << nodeDataSet.nodeIndices[i];
-                for (int j = 0; j < nodeDataSet.values[i].size(); ++j) {
-                    output << " " << boost::lexical_cast<std::string>(nodeDataSet.values[i][j]);
+            else {
+                output << nodeDataSet.nodeIndices[j];
+                for (int k = 0; k < values.size(); ++k) {
+                    output << " ";
+                    writeDouble(output, values[k]);
                 }
-                output << std::endl;
+                output << "\n";
             }
-            output << "$EndNodeData" << std::endl;
         }
+        if (binary)
+            output << std::endl;
+        output << "$EndNodeData" << std::endl;
     }
 
-    if (m_elementDataSets.size() > 0) {
-        for (int i = 0; i < m_elementDataSets.size(); ++i) {
+    for (int i = 0; i < m_elementDataSets.size(); ++i) {
 
-            ElementDataSet& elementDataSet = *m_elementDataSets[i];
-            output << "$ElementData" << std::endl;
-            output << elementDataSet.stringTags.size() << std::endl;
-            for (int i = 0; i< elementDataSet.stringTags.size(); ++i) {
-                output << '\"'+elementDataSet.stringTags[i]+'\"' << std::endl;
-            }
-            output << elementDataSet.realTags.size() << std::endl;
-            for (int i = 0; i < elementDataSet.realTags.size(); ++i) {
-                output << boost::lexical_cast<std::string>(elementDataSet.realTags[i]) << std::endl;
+        ElementDataSet& elementDataSet = *m_elementDataSets[i];
+        output << "$ElementData" << std::endl;
+        output << elementDataSet.stringTags.size() << std::endl;
+        for (int j = 0; j< elementDataSet.stringTags.size(); ++j) {
+            output << '\"'+elementDataSet.stringTags[j]+'\"' << std::endl;
+        }
+        output << elementDataSet.realTags.size() << std::endl;
+        for (int j = 0; j < elementDataSet.realTags.size(); ++j) {
+            writeDouble(output, elementDataSet.realTags[j]);
+            output << std::endl;
+        }
+        output << 4 << std::endl; // Number of integer tags
+        output << elementDataSet.timeStep << std::endl;
+        output << elementDataSet.numberOfFieldComponents << std::endl;
+        output << elementDataSet.values.size() << std::endl;
+        output << elementDataSet.partition << std::endl;
+        for (int j = 0; j < elementDataSet.values.size(); ++j ) {
+            const std::vector<double>& values = elementDataSet.values[j];
+            if (binary) {
+                writeBinary(output, &elementDataSet.elementIndices[j], 1);
+                writeBinary(output, &values[0], values.size());
             }
-            output << 4 << std::endl; // Number of integer tags
-            output << elementDataSet.timeStep << std::endl;
-            output << elementDataSet.numberOfFieldComponents << std::endl;
-            output << elementDataSet.values.size() << std::endl;
-            output << elementDataSet.partition << std::endl;
-            for (int i = 0; i < elementDataSet.values.size(); ++i ) {
-                output << elementDataSet.elementIndices[i];
-                for (int j = 0; j < elementDataSet.values[i].size(); ++j) {
-                    output << " " << boost::lexical_cast<std::string>(elementDataSet.values[i][j]);
+            else {
+                output << elementDataSet.elementIndices[j];
+                for (int k = 0; k < values.size(); ++k) {
+                    output << " ";
+                    writeDouble(output, values[k]);
                 }
-                output << std::endl;
+                output << "\n";
             }
-            output << "$EndElementData" << std::endl;
         }
+        if (binary)
+            output << std::endl;
+        output << "$EndElementData" << std::endl;
     }
 
-    if (m_elementNodeDataSets.size() > 0) {
-        for (int i = 0; i < m_elementNodeDataSets.size(); ++i) {
+    for (int i = 0; i < m_elementNodeDataSets.size(); ++i) {
 
-            ElementNodeDataSet& elementNodeDataSet = *m_elementNodeDataSets[i];
-            output << "$ElementNodeData" << std::endl;
-            output << elementNodeDataSet.stringTags.size() << std::endl;
-            for (int i = 0; i< elementNodeDataSet.stringTags.size(); ++i) {
-                output << '\"'+elementNodeDataSet.stringTags[i]+'\"' << std::endl;
-            }
-            output << elementNodeDataSet.realTags.size() << std::endl;
-            for (int i = 0; i < elementNodeDataSet.realTags.size(); ++i) {
-                output << boost::lexical_cast<std::string>(elementNodeDataSet.realTags[i]) << std::endl;
-            }
-            output << 4 << std::endl; // Number of integer tags
-            output << elementNodeDataSet.timeStep << std::endl;
-            output << elementNodeDataSet.numberOfFieldComponents << std::endl;
-            output << elementNodeDataSet.values.size() << std::endl;
-            output << elementNodeDataSet.partition << std::endl;
-            for (int i = 0; i < elementNodeDataSet.values.size(); ++i ) {
-                output << elementNodeDataSet.elementIndices[i] << " " <<
-                          elementNodeDataSet.values[i].size();
-                for (int j = 0; j < elementNodeDataSet.values[i].size(); ++j) {
-                    for (int k = 0; k < elementNodeDataSet.values[i][j].size(); ++k)
-                        output << " " << boost::lexical_cast<std::string>(elementNodeDataSet.values[i][j][k]);
-                }
-                output << std::endl;
+        ElementNodeDataSet& elementNodeDataSet = *m_elementNodeDataSets[i];
+        output << "$ElementNodeData" << std::endl;
+        output << elementNodeDataSet.stringTags.size() << std::endl;
+        for (int j = 0; j< elementNodeDataSet.stringTags.size(); ++j) {
+            output << '\"'+elementNodeDataSet.stringTags[j]+'\"' << std::endl;
+        }
+        output << elementNodeDataSet.realTags.size() << std::endl;
+        for (int j = 0; j < elementNodeDataSet.realTags.size(); ++j) {
+            writeDouble(output, elementNodeDataSet.realTags[j]);
+            output << std::endl;
+        }
+        output << 4 << std::endl; // Number of integer tags
+        output << elementNodeDataSet.timeStep << std::endl;
+        output << elementNodeDataSet.numberOfFieldComponents << std::endl;
+        output << elementNodeDataSet.values.size() << std::endl;
+        output << elementNodeDataSet.partition << std::endl;
+        for (int j = 0; j < elementNodeDataSet.values.size(); ++j ) {
+            const std::vector<std::vector<double> >& values =
+                    elementNodeDataSet.values[j];
+            const int header[2] = {elementNodeDataSet.elementIndices[j],
+                                   int(values.size())};
+            if (binary)
+                writeBinary(output, header, 2);
+            else
+                output << header[0] << " " << header[1];
+            for (int k = 0; k < values.size(); ++k) {
+                if (binary)
+                    writeBinary(output, &values[k][0], values[k].size());
+                else
+                    for (int l = 0; l < values[k].size(); ++l) {
+                        output << " ";
+                        writeDouble(output, values[k][l]);
+                    }
             }
-            output << "$EndElementNodeData" << std::endl;
+            if (!binary)
+                output << "\n";
         }
+        if (binary)
+            output << std::endl;
+        output << "$EndElementNodeData" << std::endl;
     }
 
 
@@ -713,16 +978,15 @@ void GmshData::write(std::ostream& output) const {
         output << "$EndInterpolationScheme" << std::endl;
     }
 
-
-
-
-
 }
-void GmshData::write(const std::string& fileName) const {
+void GmshData::write(const std::string& fileName, bool binary) const {
 
     std::ofstream out;
-    out.open(fileName.c_str(), std::ios::trunc);
-    write(out);
+    out.open(fileName.c_str(), binary ? std::ios::trunc | std::ios::binary
+                                      : std::ios::trunc);
+    if (!out) throw std::runtime_error(
+                "GmshData::write(): Could not open file " + fileName + ".");
+    write(out, binary);
     out.close();
 
 }
@@ -735,8 +999,10 @@ GmshData GmshData::read(std::istream& input, int elementType, int physicalEntity
     bool haveElements = false;
     bool havePeriodic = false;
     bool havePhysicalNames = false;
+    bool binary = false;
 
     GmshData gmshData;
+    AsciiTokenizer tokenizer(input);
 
     std::string line;
     while (safeGetline(input,line)) {
@@ -744,20 +1010,28 @@ GmshData GmshData::read(std::istream& input, int elementType, int physicalEntity
             if (haveMeshFormat) throw std::runtime_error(
                         "GmshData::read(): MeshFormat Section appears more than once.");
             std::cout << "Reading MeshFormat..." << std::endl;
-            safeGetline(input,line);
-            StringVector tokens = stringTokens(line);
-            if (tokens.size() != 3) throw std::runtime_error(
-                        "GmshData::read(): Wrong format of MeshFormat");
-            if (tokens[0] != "2" & tokens[0] != "2.2") throw std::runtime_error(
+            std::string version = tokenizer.readString();
+            if (version != "2" && version != "2.1" && version != "2.2") throw std::runtime_error(
                         "GmshData::read(): Version of MSH file not supported.");
-            if (boost::lexical_cast<int>(tokens[1]) != 0) throw std::runtime_error(
+            int fileType = tokenizer.readInt();
+            if (fileType != 0 && fileType != 1) throw std::runtime_error(
                         "GmshData::read(): File Type not supported.");
-            int dataSize = boost::lexical_cast<int>(tokens[2]);
+            binary = (fileType == 1);
+            int dataSize = tokenizer.readInt();
             if (dataSize != sizeof(double)) throw std::runtime_error(
                         "MeshFormat::read(): Data size not supported.");
-            safeGetline(input,line);
-            if (line != "$EndMeshFormat") throw std::runtime_error(
-                        "GmshData::read(): Error reading MeshFormat section.");
+            tokenizer.skipLine();
+            if (binary) {
+                int one;
+                readBinary(input, &one, 1);
+                if (one != 1) throw std::runtime_error(
+                            "GmshData::read(): Binary files written on machines "
+                            "of different endianness are not supported.");
+            }
+            checkSectionEnd(input, tokenizer, "$EndMeshFormat", "MeshFormat");
+            gmshData.m_versionNumber = version;
+            gmshData.m_fileType = fileType;
+            gmshData.m_dataSize = dataSize;
             haveMeshFormat = true;
 
         }
@@ -765,56 +1039,81 @@ GmshData GmshData::read(std::istream& input, int elementType, int physicalEntity
             if (haveNodes) throw std::runtime_error(
                         "GmshData::read(): Nodes section appears more than once. ");
             std::cout << "Reading Nodes..." << std::endl;
-            safeGetline(input,line);
-            int numberOfNodes = boost::lexical_cast<int>(line);
+            int numberOfNodes = tokenizer.readInt();
+            tokenizer.skipLine();
             gmshData.reserveNumberOfNodes(numberOfNodes);
             for (int i = 0; i < numberOfNodes; ++i){
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 4) throw std::runtime_error(
-                            "GmshData::read(): Wrong format of node definition detected.");
-                int index = boost::lexical_cast<int>(tokens[0]);
-                double x = boost::lexical_cast<double>(tokens[1]);
-                double y = boost::lexical_cast<double>(tokens[2]);
-                double z = boost::lexical_cast<double>(tokens[3]);
-                gmshData.addNode(index,x,y,z);
+                int index;
+                double coords[3];
+                if (binary) {
+                    readBinary(input, &index, 1);
+                    readBinary(input, coords, 3);
+                }
+                else {
+                    index = tokenizer.readInt();
+                    for (int j = 0; j < 3; ++j)
+                        coords[j] = tokenizer.readDouble();
+                }
+                gmshData.addNode(index,coords[0],coords[1],coords[2]);
             }
-            safeGetline(input,line);
-            if (line != "$EndNodes") throw std::runtime_error(
-                        "GmshData::read(): Error reading Nodes section. ");
+            checkSectionEnd(input, tokenizer, "$EndNodes", "Nodes");
             haveNodes = true;
         }
         else if (line == "$Elements") {
             if (haveElements) throw std::runtime_error(
                         "GmshData::read(): Elements section appears more than once.");
             std::cout << "Reading Elements..." << std::endl;
-            safeGetline(input,line);
-            int numberOfElements = boost::lexical_cast<int>(line);
+            int numberOfElements = tokenizer.readInt();
+            tokenizer.skipLine();
+            gmshData.reserveNumberOfElements(numberOfElements);
+            std::vector<int> tags;
+            std::vector<int> nodes;
+            int currentElementType = 0;
+            int ntags = 0;
+            int elementsLeftInBlock = 0;
             for (int i = 0; i < numberOfElements; ++i) {
-                safeGetline(input,line);
-                    StringVector tokens = stringTokens(line);
-                    int index = boost::lexical_cast<int>(tokens.at(0));
-                    int currentElementType = boost::lexical_cast<int>(tokens.at(1));
-                    int ntags = boost::lexical_cast<int>(tokens.at(2));
-                    int currentPhysicalEntity = boost::lexical_cast<int>(tokens.at(3));
-                    int elementaryEntity = boost::lexical_cast<int>(tokens.at(4));
-                    int npartitions = 0;
-                    if (ntags > 5) npartitions = boost::lexical_cast<int>(tokens.at(5));
-                    std::vector<int> partitions;
-                    for (int i = 0;i < npartitions; ++i)
-                        partitions.push_back(boost::lexical_cast<int>(tokens.at(6+i)));
-                    std::vector<int> nodes;
-                    for (int i = 3 + ntags; i < tokens.size(); ++i)
-                        nodes.push_back(boost::lexical_cast<int>(tokens.at(i)));
-                    if ((elementType == -1 || currentElementType == elementType) &&
-                            (physicalEntity == -1 || currentPhysicalEntity == physicalEntity)) {
-                            gmshData.addElement(index,currentElementType,nodes,physicalEntity,elementaryEntity,partitions);
-                            gmshData.m_elementIndices.insert(index);
+                int index;
+                if (binary) {
+                    if (elementsLeftInBlock == 0) {
+                        int header[3];
+                        readBinary(input, header, 3);
+                        currentElementType = header[0];
+                        elementsLeftInBlock = header[1];
+                        ntags = header[2];
+                        if (nodesPerElement(currentElementType) < 0) throw std::runtime_error(
+                                    "GmshData::read(): Unknown element type.");
+                        tags.resize(ntags);
+                        nodes.resize(nodesPerElement(currentElementType));
                     }
+                    --elementsLeftInBlock;
+                    readBinary(input, &index, 1);
+                    if (ntags > 0)
+                        readBinary(input, &tags[0], ntags);
+                    readBinary(input, &nodes[0], nodes.size());
                 }
-            safeGetline(input,line);
-            if (line != "$EndElements") throw std::runtime_error(
-                        "GmshData::read(): Error reading Elements section. ");
+                else {
+                    index = tokenizer.readInt();
+                    currentElementType = tokenizer.readInt();
+                    ntags = tokenizer.readInt();
+                    tags.resize(ntags);
+                    for (int j = 0; j < ntags; ++j)
+                        tags[j] = tokenizer.readInt();
+                    nodes.clear();
+                    while (!tokenizer.atEndOfLine())
+                        nodes.push_back(tokenizer.readInt());
+                }
+                int currentPhysicalEntity = ntags > 0 ? tags[0] : 0;
+                int elementaryEntity = ntags > 1 ? tags[1] : 0;
+                int npartitions = 0;
+                if (ntags > 2) npartitions = std::min(tags[2], ntags - 3);
+                if ((elementType == -1 || currentElementType == elementType) &&
+                        (physicalEntity == -1 || currentPhysicalEntity == physicalEntity))
+                    gmshData.addElement(index,currentElementType,
+                                        nodes.empty() ? 0 : &nodes[0],nodes.size(),
+                                        currentPhysicalEntity,elementaryEntity,
+                                        npartitions > 0 ? &tags[3] : 0,npartitions);
+            }
+            checkSectionEnd(input, tokenizer, "$EndElements", "Elements");
             haveElements = true;
 
             }
@@ -822,276 +1121,154 @@ GmshData GmshData::read(std::istream& input, int elementType, int physicalEntity
             if (havePeriodic) throw std::runtime_error(
                         "GmshData::read(): Periodic section appears more than once.");
             std::cout << "Reading Periodic..." << std::endl;
-            safeGetline(input,line);
-            int numberOfPeriodicEntities = boost::lexical_cast<int>(line);
+            int numberOfPeriodicEntities = tokenizer.readInt();
             for (int i = 0;i < numberOfPeriodicEntities; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size()!= 3) throw std::runtime_error(
-                            "GmshData::read(): Wrong format for periodic entities.");
-                int dimension = boost::lexical_cast<int>(tokens[0]);
-                int slaveTag = boost::lexical_cast<int>(tokens[1]);
-                int masterTag = boost::lexical_cast<int>(tokens[2]);
+                int dimension = tokenizer.readInt();
+                int slaveTag = tokenizer.readInt();
+                int masterTag = tokenizer.readInt();
                 gmshData.addPeriodicEntity(dimension,slaveTag,masterTag);
             }
 
-            safeGetline(input,line);
-            int numberOfPeriodicNodes = boost::lexical_cast<int>(line);
+            int numberOfPeriodicNodes = tokenizer.readInt();
             for (int i = 0; i < numberOfPeriodicNodes; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 2) throw std::runtime_error(
-                            "GmshData::read(): Wrong format for periodic nodes.");
-                int slaveNode = boost::lexical_cast<int>(tokens[0]);
-                int masterNode = boost::lexical_cast<int>(tokens[1]);
+                int slaveNode = tokenizer.readInt();
+                int masterNode = tokenizer.readInt();
                 gmshData.addPeriodicNode(slaveNode,masterNode);
             }
-            safeGetline(input,line);
-            if (line != "$EndPeriodic") throw std::runtime_error(
-                        "GmshData::read(): Error reading Periodic section.");
+            checkSectionEnd(input, tokenizer, "$EndPeriodic", "Periodic");
             havePeriodic = true;
         }
         else if (line == "$PhysicalNames") {
             if (havePhysicalNames) throw std::runtime_error(
                         "GmshData::read(): PhysicalNames section appears more than once.");
             std::cout << "Reading PhysicalNames..." << std::endl;
-            safeGetline(input,line);
-            int numberOfPhysicalNames = boost::lexical_cast<int>(line);
+            int numberOfPhysicalNames = tokenizer.readInt();
             for (int i = 0; i< numberOfPhysicalNames; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 3) throw std::runtime_error(
-                            "PhysicalNamesSet::read(): Wrong format for physical names.");
-                int dimension = boost::lexical_cast<int>(tokens[0]);
-                int number = boost::lexical_cast<int>(tokens[1]);
-                std::string name = tokens[2];
+                int dimension = tokenizer.readInt();
+                int number = tokenizer.readInt();
+                std::string name = tokenizer.readString();
                 gmshData.addPhysicalName(dimension,number,name);
             }
-            safeGetline(input,line);
-            if (line != "$EndPhysicalNames") throw std::runtime_error(
-                        "GmshData::read(): Error reading PhysicalNames section.");
+            checkSectionEnd(input, tokenizer, "$EndPhysicalNames", "PhysicalNames");
             havePhysicalNames = true;
 
 
         }
-        else if (line == "$NodeData") {
-
-            std::cout << "Reading NodeData..." << std::endl;
-            safeGetline(input,line);
-            int numberOfStringTags = boost::lexical_cast<int>(line);
+        else if (line == "$NodeData" || line == "$ElementData" ||
+                 line == "$ElementNodeData") {
+
+            const bool nodeData = (line == "$NodeData");
+            const bool elementNodeData = (line == "$ElementNodeData");
+            std::cout << "Reading " << line.substr(1) << "..." << std::endl;
+            int numberOfStringTags = tokenizer.readInt();
+            tokenizer.skipLine();
             std::vector<std::string> stringTags;
-            for (int i = 0; i < numberOfStringTags; ++i) {
-                safeGetline(input,line);
-                line.erase(std::remove(line.begin(),line.end(),'\"'),line.end());
-                stringTags.push_back(line);
-            }
+            for (int i = 0; i < numberOfStringTags; ++i)
+                stringTags.push_back(tokenizer.readQuotedLine());
 
             // Real tags
-            safeGetline(input,line);
-            int numberOfRealTags = boost::lexical_cast<int>(line);
+            int numberOfRealTags = tokenizer.readInt();
             std::vector<double> realTags;
-            for (int i = 0; i < numberOfRealTags; ++i ) {
-                safeGetline(input,line);
-                realTags.push_back(boost::lexical_cast<double>(line));
-            }
+            for (int i = 0; i < numberOfRealTags; ++i )
+                realTags.push_back(tokenizer.readDouble());
 
             // Integer tags
-            safeGetline(input,line);
-            int numberOfIntegerTags = boost::lexical_cast<int>(line);
+            int numberOfIntegerTags = tokenizer.readInt();
             if (numberOfIntegerTags < 3) throw std::runtime_error(
                         "GmshData::read(): At least 3 integer tags required.");
             std::vector<int> integerTags;
-            for (int i = 0; i < numberOfIntegerTags; ++i) {
-                safeGetline(input,line);
-                integerTags.push_back(boost::lexical_cast<int>(line));
-            }
+            for (int i = 0; i < numberOfIntegerTags; ++i)
+                integerTags.push_back(tokenizer.readInt());
+            tokenizer.skipLine();
             int timeStep = integerTags[0];
             int numberOfFieldComponents = integerTags[1];
-            int numberOfNodes = integerTags[2];
+            int numberOfEntities = integerTags[2];
             int partition = 0;
             if (integerTags.size() > 3) partition = integerTags[3];
-            int dataSetIndex = gmshData.numberOfNodeDataSets();
-            gmshData.addNodeDataSet(stringTags,realTags,numberOfFieldComponents,numberOfNodes,timeStep,partition);
-
-            for (int i = 0; i < numberOfNodes; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 1+numberOfFieldComponents) throw std::runtime_error(
-                            "GmshData::read(): Data has wrong format.");
-                int index = boost::lexical_cast<int>(tokens[0]);
-                std::vector<double> values;
-                for (int j = 1; j < tokens.size(); ++j) {
-                    values.push_back(boost::lexical_cast<double>(tokens[j]));
-                }
-                gmshData.addNodeData(dataSetIndex,index,values);
+            int dataSetIndex;
+            if (nodeData) {
+                dataSetIndex = gmshData.numberOfNodeDataSets();
+                gmshData.addNodeDataSet(stringTags,realTags,numberOfFieldComponents,
+                                        numberOfEntities,timeStep,partition);
             }
-
-            safeGetline(input,line);
-            if (line != "$EndNodeData") throw std::runtime_error(
-                        "GmshData::read(): Error reading NodeData section.");
-
-
-        }
-        else if (line == "$ElementData") {
-
-            std::cout << "Reading ElementData..." << std::endl;
-            safeGetline(input,line);
-            int numberOfStringTags = boost::lexical_cast<int>(line);
-            std::vector<std::string> stringTags;
-            for (int i = 0; i < numberOfStringTags; ++i) {
-                safeGetline(input,line);
-                line.erase(std::remove(line.begin(),line.end(),'\"'),line.end());
-                stringTags.push_back(line);
+            else if (elementNodeData) {
+                dataSetIndex = gmshData.numberOfElementNodeDataSets();
+                gmshData.addElementNodeDataSet(stringTags,realTags,numberOfFieldComponents,
+                                               numberOfEntities,timeStep,partition);
             }
-
-            // Real tags
-            safeGetline(input,line);
-            int numberOfRealTags = boost::lexical_cast<int>(line);
-            std::vector<double> realTags;
-            for (int i = 0; i < numberOfRealTags; ++i ) {
-                safeGetline(input,line);
-                realTags.push_back(boost::lexical_cast<double>(line));
-            }
-
-            // Integer tags
-            safeGetline(input,line);
-            int numberOfIntegerTags = boost::lexical_cast<int>(line);
-            if (numberOfIntegerTags < 3) throw std::runtime_error(
-                        "GmshData::read(): At least 3 integer tags required.");
-            std::vector<int> integerTags;
-            for (int i = 0; i < numberOfIntegerTags; ++i) {
-                safeGetline(input,line);
-                integerTags.push_back(boost::lexical_cast<int>(line));
+            else {
+                dataSetIndex = gmshData.numberOfElementDataSets();
+                gmshData.addElementDataSet(stringTags,realTags,numberOfFieldComponents,
+                                           numberOfEntities,timeStep,partition);
             }
-            int timeStep = integerTags[0];
-            int numberOfFieldComponents = integerTags[1];
-            int numberOfElements = integerTags[2];
-            int partition = 0;
-            if (integerTags.size() > 3) partition = integerTags[3];
-            int dataSetIndex = gmshData.numberOfElementDataSets();
-            gmshData.addElementDataSet(stringTags,realTags,numberOfFieldComponents,numberOfElements,timeStep,partition);
 
-            for (int i = 0; i < numberOfElements; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 1+numberOfFieldComponents) throw std::runtime_error(
-                            "GmshData::read(): Data has wrong format.");
-                int index = boost::lexical_cast<int>(tokens[0]);
-                std::vector<double> values;
-                for (int j = 1; j < tokens.size(); ++j) {
-                    values.push_back(boost::lexical_cast<double>(tokens[j]));
+            std::vector<double> values;
+            std::vector<std::vector<double> > nodeValues;
+            for (int i = 0; i < numberOfEntities; ++i) {
+                int index;
+                int numberOfNodes = 1;
+                if (binary) {
+                    readBinary(input, &index, 1);
+                    if (elementNodeData)
+                        readBinary(input, &numberOfNodes, 1);
                 }
-                if (gmshData.m_elementIndices.find(index)!=gmshData.m_elementIndices.end())
-                    gmshData.addElementData(dataSetIndex,index,values);
-            }
-
-            safeGetline(input,line);
-            if (line != "$EndElementData") throw std::runtime_error(
-                        "GmshData::read(): Error reading ElementData section.");
-
-
-        }
-        else if (line == "$ElementNodeData") {
-
-            std::cout << "Reading ElementNodeData..." << std::endl;
-            safeGetline(input,line);
-            int numberOfStringTags = boost::lexical_cast<int>(line);
-            std::vector<std::string> stringTags;
-            for (int i = 0; i < numberOfStringTags; ++i) {
-                safeGetline(input,line);
-                line.erase(std::remove(line.begin(),line.end(),'\"'),line.end());
-                stringTags.push_back(line);
-            }
-
-            // Real tags
-            safeGetline(input,line);
-            int numberOfRealTags = boost::lexical_cast<int>(line);
-            std::vector<double> realTags;
-            for (int i = 0; i < numberOfRealTags; ++i ) {
-                safeGetline(input,line);
-                realTags.push_back(boost::lexical_cast<double>(line));
-            }
-
-            // Integer tags
-            safeGetline(input,line);
-            int numberOfIntegerTags = boost::lexical_cast<int>(line);
-            if (numberOfIntegerTags < 3) throw std::runtime_error(
-                        "GmshData::read(): At least 3 integer tags required.");
-            std::vector<int> integerTags;
-            for (int i = 0; i < numberOfIntegerTags; ++i) {
-                safeGetline(input,line);
-                integerTags.push_back(boost::lexical_cast<int>(line));
-            }
-            int timeStep = integerTags[0];
-            int numberOfFieldComponents = integerTags[1];
-            int numberOfElements = integerTags[2];
-            int partition = 0;
-            if (integerTags.size() > 3) partition = integerTags[3];
-            int dataSetIndex = gmshData.numberOfElementDataSets();
-            gmshData.addElementNodeDataSet(stringTags,realTags,numberOfFieldComponents,numberOfElements,timeStep,partition);
-
-            for (int i = 0; i < numberOfElements; ++i) {
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() < 2) throw std::runtime_error(
-                            "GmshData::read(): Data has wrong format.");
-                int numberOfNodes = boost::lexical_cast<int>(tokens[1]);
-                if (tokens.size() != 2+numberOfFieldComponents*numberOfNodes) throw std::runtime_error(
+                else {
+                    index = tokenizer.readInt();
+                    if (elementNodeData)
+                        numberOfNodes = tokenizer.readInt();
+                }
+                if (numberOfNodes < 0) throw std::runtime_error(
                             "GmshData::read(): Data has wrong format.");
-                int index = boost::lexical_cast<int>(tokens[0]);
-                std::vector<std::vector<double> > values;
-                for (int j = 0; j < numberOfNodes; ++j) {
-                    values.push_back(std::vector<double>());
-                    for (int k = 0; k < numberOfFieldComponents; ++k)
-                        values[j].push_back(boost::lexical_cast<double>(tokens[2+j*numberOfFieldComponents+k]));
+                values.resize(numberOfNodes*numberOfFieldComponents);
+                if (binary) {
+                    if (!values.empty())
+                        readBinary(input, &values[0], values.size());
+                }
+                else
+                    for (int j = 0; j < values.size(); ++j)
+                        values[j] = tokenizer.readDouble();
+                if (nodeData)
+                    gmshData.addNodeData(dataSetIndex,index,values);
+                else if (gmshData.hasElement(index)) {
+                    if (elementNodeData) {
+                        nodeValues.resize(numberOfNodes);
+                        for (int j = 0; j < numberOfNodes; ++j)
+                            nodeValues[j].assign(
+                                        values.begin() + j*numberOfFieldComponents,
+                                        values.begin() + (j+1)*numberOfFieldComponents);
+                        gmshData.addElementNodeData(dataSetIndex,index,nodeValues);
+                    }
+                    else
+                        gmshData.addElementData(dataSetIndex,index,values);
                 }
-                if (gmshData.m_elementIndices.find(index)!=gmshData.m_elementIndices.end())
-                    gmshData.addElementNodeData(dataSetIndex,index,values);
             }
 
-            safeGetline(input,line);
-            if (line != "$EndElementNodeData") throw std::runtime_error(
-                        "GmshData::read(): Error reading ElementNodeData section.");
+            checkSectionEnd(input, tokenizer, ("$End" + line.substr(1)).c_str(),
+                            line.substr(1).c_str());
 
 
         }
-        else if (line == "$InterpolationSchemeSet") {
-
-            std::cout << "Reading InterpolationSchemSet..." << std::endl;
-            safeGetline(input,line);
-            line.erase(std::remove(line.begin(),line.end(),'\"'),line.end());
-            std::string name = line;
-            safeGetline(input,line);
-            if (boost::lexical_cast<int>(line) != 1) throw std::runtime_error(
+        else if (line == "$InterpolationScheme" || line == "$InterpolationSchemeSet") {
+
+            std::cout << "Reading InterpolationScheme..." << std::endl;
+            std::string name = tokenizer.readQuotedLine();
+            if (tokenizer.readInt() != 1) throw std::runtime_error(
                         "GmshData::read(): Only one topology is currently supported.");
-            safeGetline(input,line);
-            int topology = boost::lexical_cast<int>(line);
+            int topology = tokenizer.readInt();
             int dataSetIndex = gmshData.numberOfInterpolationSchemeSets();
             gmshData.addInterpolationSchemeSet(name,topology);
-            safeGetline(input,line);
-            int numberOfInterpolationMatrices = boost::lexical_cast<int>(line);
+            int numberOfInterpolationMatrices = tokenizer.readInt();
             for (int i = 0; i < numberOfInterpolationMatrices; ++i) {
                 std::vector<double> matrix;
-                safeGetline(input,line);
-                StringVector tokens = stringTokens(line);
-                if (tokens.size() != 2) throw std::runtime_error(
-                            "GmshData::read(): Wrong format of interpolation matrices.");
-                int nrows = boost::lexical_cast<int>(tokens[0]);
-                int ncols = boost::lexical_cast<int>(tokens[1]);
+                int nrows = tokenizer.readInt();
+                int ncols = tokenizer.readInt();
                 matrix.reserve(nrows*ncols);
-                for (int j = 0; j < nrows; ++j) {
-                    safeGetline(input,line);
-                    StringVector tokens = stringTokens(line);
-                    if (tokens.size() != ncols) throw std::runtime_error(
-                                "GmshData::read(): Wrong format of interpolation matrices.");
-                    for (int k = 0;k < ncols; ++k)
-                        matrix.push_back(boost::lexical_cast<double>(tokens[k]));
-                }
+                for (int j = 0; j < nrows*ncols; ++j)
+                    matrix.push_back(tokenizer.readDouble());
                 gmshData.addInterpolationMatrix(dataSetIndex,nrows,ncols,matrix);
             }
-            safeGetline(input,line);
-            if (line != "$EndInterpolationSchemeSet") throw std::runtime_error(
-                        "GmshData::read(): Error reading InterpolationSchemeSet section.");
+            checkSectionEnd(input, tokenizer, ("$End" + line.substr(1)).c_str(),
+                            "InterpolationScheme");
         }
 
     }
@@ -1101,8 +1278,12 @@ GmshData GmshData::read(std::istream& input, int elementType, int physicalEntity
 
 GmshData GmshData::read(const std::string& fileName, int elementType, int physicalEntity) {
 
+    // Binary mode is needed for binary MSH files; line ends are handled by
+    // safeGetline()
     std::ifstream(input);
-    input.open(fileName.c_str());
+    input.open(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!input) throw std::runtime_error(
+                "GmshData::read(): Could not open file " + fileName + ".");
     GmshData gmshData = read(input,elementType,physicalEntity);
     input.close();
     return gmshData;
@@ -1195,65 +1376,61 @@ shared_ptr<const Grid> GmshIo::grid() const {
 
     if (m_grid) return m_grid;
 
-    // Sanity check on the Gmsh Data
+    // The arrays passed to the grid factory are built directly from the
+    // node coordinates and element connectivity stored in m_gmshData
 
-    std::vector<int> nodeIndices;
-    m_gmshData.getNodeIndices(nodeIndices);
-    std::vector<int> elementIndices;
-    m_gmshData.getElementIndices(elementIndices);
+    const std::vector<GmshData::Element>& gmshElements = m_gmshData.m_elements;
+    const std::vector<int>& connectivity = m_gmshData.m_elementConnectivity;
+    const std::vector<double>& coordinates = m_gmshData.m_nodeCoordinates;
+    const std::vector<char>& nodeDefined = m_gmshData.m_nodeDefined;
 
-    int maxNodeIndex = *(std::max_element(nodeIndices.begin(),nodeIndices.end()));
-    int maxElementIndex = *(std::max_element(elementIndices.begin(),elementIndices.end()));
+    int triangleCount = 0;
+    for (int i = 0; i < gmshElements.size(); ++i)
+        if (gmshElements[i].type == 2) {
+            if (gmshElements[i].nodeCount != 3) throw std::runtime_error(
+                        "GmshIo::grid(): Triangle with a wrong number of nodes.");
+            ++triangleCount;
+        }
 
-    std::vector<std::vector<int> > elements;
+    m_nodePermutation.clear();
+    m_elementPermutation.clear();
+    m_elementPermutation.reserve(triangleCount);
+    m_inverseNodePermutation.assign(nodeDefined.size(),-1);
+    m_inverseElementPermutation.assign(gmshElements.size(),-1);
 
-    m_inverseNodePermutation.resize(maxNodeIndex+1,-1);
-    m_inverseElementPermutation.resize(maxElementIndex+1,-1);
+    arma::Mat<int> armaElements(3,triangleCount);
     std::vector<int> domainIndices;
-
-    for (int i = 0; i < elementIndices.size(); ++i) {
-        int physicalEntity;
-        int elementaryEntity;
-        int elementType;
-        int index = elementIndices[i];
-        std::vector<int> nodes;
-
-        m_gmshData.getElement(index,elementType,nodes,physicalEntity,elementaryEntity);
-        if (elementType == 2) {
-            int elementIndex = m_elementPermutation.size();
-            m_elementPermutation.push_back(index);
-            m_inverseElementPermutation[index] = elementIndex;
-            elements.push_back(std::vector<int>());
-            domainIndices.push_back(physicalEntity);
-            std::vector<int>& currentNodes = elements.back();
-            for (int j = 0; j < nodes.size(); ++j) {
-                int nodeIndex;
-                if (m_inverseNodePermutation[nodes[j]] == -1) { // Node not yet assigned
-                    nodeIndex = m_nodePermutation.size();
-                    m_inverseNodePermutation[nodes[j]] = nodeIndex;
-                    m_nodePermutation.push_back(nodes[j]);
-                }
-                else {
-                    nodeIndex = m_inverseNodePermutation[nodes[j]];
-                }
-                currentNodes.push_back(nodeIndex);
+    domainIndices.reserve(triangleCount);
+
+    for (int index = 0; index < gmshElements.size(); ++index) {
+        const GmshData::Element& element = gmshElements[index];
+        if (element.type != 2)
+            continue;
+        int elementIndex = m_elementPermutation.size();
+        m_elementPermutation.push_back(index);
+        m_inverseElementPermutation[index] = elementIndex;
+        domainIndices.push_back(element.physicalEntity);
+        const int* nodes = &connectivity[element.offset + element.partitionCount];
+        for (int j = 0; j < 3; ++j) {
+            if (nodes[j] < 0 || nodes[j] >= nodeDefined.size() ||
+                    !nodeDefined[nodes[j]]) throw std::runtime_error(
+                        "GmshIo::grid(): Element refers to a nonexistent node.");
+            int nodeIndex;
+            if (m_inverseNodePermutation[nodes[j]] == -1) { // Node not yet assigned
+                nodeIndex = m_nodePermutation.size();
+                m_inverseNodePermutation[nodes[j]] = nodeIndex;
+                m_nodePermutation.push_back(nodes[j]);
+            }
+            else {
+                nodeIndex = m_inverseNodePermutation[nodes[j]];
             }
+            armaElements(j,elementIndex) = nodeIndex;
         }
     }
     arma::Mat<double> armaNodes(3,m_nodePermutation.size());
-    arma::Mat<int> armaElements(3,m_elementPermutation.size());
-    for (int i = 0; i < m_nodePermutation.size();++i){
-        double x,y,z;
-        m_gmshData.getNode(m_nodePermutation[i],x,y,z);
-        armaNodes(0,i) = x;
-        armaNodes(1,i) = y;
-        armaNodes(2,i) = z;
-    }
-    for (int i = 0; i < m_elementPermutation.size(); ++i) {
-        armaElements(0,i) = elements[i][0];
-        armaElements(1,i) = elements[i][1];
-        armaElements(2,i) = elements[i][2];
-    }
+    for (int i = 0; i < m_nodePermutation.size();++i)
+        for (int j = 0; j < 3; ++j)
+            armaNodes(j,i) = coordinates[3*m_nodePermutation[i]+j];
     GridParameters params;
     params.topology = GridParameters::TRIANGULAR;
     m_grid =  GridFactory::createGridFromConnectivityArrays
@@ -1298,9 +1475,9 @@ GmshData& GmshIo::gmshData() {
 
 }
 
-void GmshIo::write(std::string fileName) const {
+void GmshIo::write(std::string fileName, bool binary) const {
 
-    m_gmshData.write(fileName);
+    m_gmshData.write(fileName, binary);
 
 }
 
@@ -26,7 +26,6 @@
 #include <iostream>
 #include <string>
 #include <memory>
-#include <set>
 #include "../common/shared_ptr.hpp"
 #include "../assembly/grid_function.hpp"
 #include <armadillo>
@@ -138,14 +137,27 @@ public:
 
     void resetDataSets();
 
-    void write(std::ostream& output) const;
-    void write(const std::string& fileName) const;
+    /** \brief Write the data in the MSH 2.2 format.
+     *
+     *  If \p binary is \c true, the nodes, elements and data sets are
+     *  stored in binary form; the output stream should then have been
+     *  opened in binary mode. */
+    void write(std::ostream& output, bool binary = false) const;
+    void write(const std::string& fileName, bool binary = false) const;
+    /** \brief Read data stored in the ASCII or binary MSH 2 format. */
     static GmshData read(std::istream& input, int elementType = 2, int physicalEntity = -1);
     static GmshData read(const std::string& fileName, int elementType = 2, int physicalEntity = -1);
 
 
 private:
 
+    friend class GmshIo;
+
+    void addElement(int index, int elementType, const int* nodes, int nodeCount,
+                    int physicalEntity, int elementaryEntity,
+                    const int* partitions, int partitionCount);
+    bool hasElement(int index) const;
+
     struct NodeDataSet {
 
 
@@ -204,18 +216,15 @@ private:
 
     };
 
-    struct Node {
-        double x;
-        double y;
-        double z;
-    };
-
+    // Element record. The element's partitions and nodes are stored in
+    // m_elementConnectivity, starting at index offset, in this order.
     struct Element {
-        int type;
+        int type; // 0 if there is no element with this index
         int physicalEntity;
         int elementaryEntity;
-        std::vector<int> nodes;
-        std::vector<int> partitions;
+        int partitionCount;
+        int nodeCount;
+        size_t offset;
     };
 
     struct PeriodicEntity {
@@ -241,10 +250,14 @@ private:
     int m_numberOfNodes;
     int m_numberOfElements;
 
-    std::vector<shared_ptr<Node> > m_nodes;
-    std::vector<shared_ptr<Element> > m_elements;
-
-    std::set<int> m_elementIndices;
+    // Coordinates of the node with index i are stored at positions 3 * i,
+    // 3 * i + 1 and 3 * i + 2; m_nodeDefined[i] is nonzero if there is a node
+    // with index i
+    std::vector<double> m_nodeCoordinates;
+    std::vector<char> m_nodeDefined;
+    // Elements, indexed by their numbers
+    std::vector<Element> m_elements;
+    std::vector<int> m_elementConnectivity;
 
     std::vector<PeriodicEntity> m_periodicEntities;
     std::vector<PeriodicNode> m_periodicNodes;
@@ -273,7 +286,7 @@ public:
     const std::vector<int>& inverseNodePermutation() const;
     const std::vector<int>& inverseElementPermutation() const;
     const GmshData& gmshData() const;
-    void write(std::string fileName) const;
+    void write(std::string fileName, bool binary = false) const;
     GmshData& gmshData();
 
     void resetNodeDataSets();
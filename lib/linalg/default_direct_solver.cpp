@@ -24,31 +24,350 @@
 #include "../assembly/blocked_boundary_operator.hpp"
 #include "../assembly/boundary_operator.hpp"
 #include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/symmetry.hpp"
+#include "../common/complex_aux.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 
+#include <algorithm>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/type_traits/is_complex.hpp>
 #include <boost/variant.hpp>
+#include <complex>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <vector>
+
+extern "C" {
+
+typedef std::complex<float> lapack_cfloat;
+typedef std::complex<double> lapack_cdouble;
+typedef arma::blas_int lapack_int;
+
+void sgetrf_(const lapack_int* m, const lapack_int* n, float* a,
+             const lapack_int* lda, lapack_int* ipiv, lapack_int* info);
+void dgetrf_(const lapack_int* m, const lapack_int* n, double* a,
+             const lapack_int* lda, lapack_int* ipiv, lapack_int* info);
+void cgetrf_(const lapack_int* m, const lapack_int* n, lapack_cfloat* a,
+             const lapack_int* lda, lapack_int* ipiv, lapack_int* info);
+void zgetrf_(const lapack_int* m, const lapack_int* n, lapack_cdouble* a,
+             const lapack_int* lda, lapack_int* ipiv, lapack_int* info);
+
+void sgetrs_(const char* trans, const lapack_int* n, const lapack_int* nrhs,
+             const float* a, const lapack_int* lda, const lapack_int* ipiv,
+             float* b, const lapack_int* ldb, lapack_int* info);
+void dgetrs_(const char* trans, const lapack_int* n, const lapack_int* nrhs,
+             const double* a, const lapack_int* lda, const lapack_int* ipiv,
+             double* b, const lapack_int* ldb, lapack_int* info);
+void cgetrs_(const char* trans, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cfloat* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cfloat* b, const lapack_int* ldb, lapack_int* info);
+void zgetrs_(const char* trans, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cdouble* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cdouble* b, const lapack_int* ldb, lapack_int* info);
+
+void spotrf_(const char* uplo, const lapack_int* n, float* a,
+             const lapack_int* lda, lapack_int* info);
+void dpotrf_(const char* uplo, const lapack_int* n, double* a,
+             const lapack_int* lda, lapack_int* info);
+void cpotrf_(const char* uplo, const lapack_int* n, lapack_cfloat* a,
+             const lapack_int* lda, lapack_int* info);
+void zpotrf_(const char* uplo, const lapack_int* n, lapack_cdouble* a,
+             const lapack_int* lda, lapack_int* info);
+
+void spotrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const float* a, const lapack_int* lda,
+             float* b, const lapack_int* ldb, lapack_int* info);
+void dpotrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const double* a, const lapack_int* lda,
+             double* b, const lapack_int* ldb, lapack_int* info);
+void cpotrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cfloat* a, const lapack_int* lda,
+             lapack_cfloat* b, const lapack_int* ldb, lapack_int* info);
+void zpotrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cdouble* a, const lapack_int* lda,
+             lapack_cdouble* b, const lapack_int* ldb, lapack_int* info);
+
+void ssytrf_(const char* uplo, const lapack_int* n, float* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             float* work, const lapack_int* lwork, lapack_int* info);
+void dsytrf_(const char* uplo, const lapack_int* n, double* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             double* work, const lapack_int* lwork, lapack_int* info);
+void csytrf_(const char* uplo, const lapack_int* n, lapack_cfloat* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             lapack_cfloat* work, const lapack_int* lwork, lapack_int* info);
+void zsytrf_(const char* uplo, const lapack_int* n, lapack_cdouble* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             lapack_cdouble* work, const lapack_int* lwork, lapack_int* info);
+void chetrf_(const char* uplo, const lapack_int* n, lapack_cfloat* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             lapack_cfloat* work, const lapack_int* lwork, lapack_int* info);
+void zhetrf_(const char* uplo, const lapack_int* n, lapack_cdouble* a,
+             const lapack_int* lda, lapack_int* ipiv,
+             lapack_cdouble* work, const lapack_int* lwork, lapack_int* info);
+
+void ssytrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const float* a, const lapack_int* lda, const lapack_int* ipiv,
+             float* b, const lapack_int* ldb, lapack_int* info);
+void dsytrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const double* a, const lapack_int* lda, const lapack_int* ipiv,
+             double* b, const lapack_int* ldb, lapack_int* info);
+void csytrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cfloat* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cfloat* b, const lapack_int* ldb, lapack_int* info);
+void zsytrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cdouble* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cdouble* b, const lapack_int* ldb, lapack_int* info);
+void chetrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cfloat* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cfloat* b, const lapack_int* ldb, lapack_int* info);
+void zhetrs_(const char* uplo, const lapack_int* n, const lapack_int* nrhs,
+             const lapack_cdouble* a, const lapack_int* lda, const lapack_int* ipiv,
+             lapack_cdouble* b, const lapack_int* ldb, lapack_int* info);
+
+} // extern "C"
 
 namespace Bempp
 {
 
+namespace
+{
+
+using arma::blas_int;
+
+// Type-dispatching wrappers of the LAPACK routines used by the solver. The
+// factors are always stored in the lower triangle of symmetric matrices.
+// For real types, Hermitian matrices are symmetric.
+
+template <typename ValueType> struct Lapack;
+
+#define BEMPP_DEFINE_LAPACK_WRAPPERS(TYPE, PREFIX, HE_PREFIX)                \
+template <> struct Lapack<TYPE>                                             \
+{                                                                           \
+    static void getrf(blas_int n, TYPE* a, blas_int* ipiv, blas_int& info) { \
+        PREFIX##getrf_(&n, &n, a, &n, ipiv, &info);                         \
+    }                                                                       \
+    static void getrs(blas_int n, blas_int nrhs, const TYPE* a,             \
+                      const blas_int* ipiv, TYPE* b, blas_int& info) {      \
+        const char trans = 'N';                                             \
+        PREFIX##getrs_(&trans, &n, &nrhs, a, &n, ipiv, b, &n, &info);       \
+    }                                                                       \
+    static void potrf(blas_int n, TYPE* a, blas_int& info) {                \
+        const char uplo = 'L';                                              \
+        PREFIX##potrf_(&uplo, &n, a, &n, &info);                            \
+    }                                                                       \
+    static void potrs(blas_int n, blas_int nrhs, const TYPE* a,             \
+                      TYPE* b, blas_int& info) {                            \
+        const char uplo = 'L';                                              \
+        PREFIX##potrs_(&uplo, &n, &nrhs, a, &n, b, &n, &info);              \
+    }                                                                       \
+    static void sytrf(blas_int n, TYPE* a, blas_int* ipiv,                  \
+                      TYPE* work, blas_int lwork, blas_int& info) {         \
+        const char uplo = 'L';                                              \
+        PREFIX##sytrf_(&uplo, &n, a, &n, ipiv, work, &lwork, &info);        \
+    }                                                                       \
+    static void sytrs(blas_int n, blas_int nrhs, const TYPE* a,             \
+                      const blas_int* ipiv, TYPE* b, blas_int& info) {      \
+        const char uplo = 'L';                                              \
+        PREFIX##sytrs_(&uplo, &n, &nrhs, a, &n, ipiv, b, &n, &info);        \
+    }                                                                       \
+    static void hetrf(blas_int n, TYPE* a, blas_int* ipiv,                  \
+                      TYPE* work, blas_int lwork, blas_int& info) {         \
+        const char uplo = 'L';                                              \
+        HE_PREFIX##trf_(&uplo, &n, a, &n, ipiv, work, &lwork, &info);       \
+    }                                                                       \
+    static void hetrs(blas_int n, blas_int nrhs, const TYPE* a,             \
+                      const blas_int* ipiv, TYPE* b, blas_int& info) {      \
+        const char uplo = 'L';                                              \
+        HE_PREFIX##trs_(&uplo, &n, &nrhs, a, &n, ipiv, b, &n, &info);       \
+    }                                                                       \
+}
+
+BEMPP_DEFINE_LAPACK_WRAPPERS(float, s, ssy);
+BEMPP_DEFINE_LAPACK_WRAPPERS(double, d, dsy);
+BEMPP_DEFINE_LAPACK_WRAPPERS(std::complex<float>, c, che);
+BEMPP_DEFINE_LAPACK_WRAPPERS(std::complex<double>, z, zhe);
+
+#undef BEMPP_DEFINE_LAPACK_WRAPPERS
+
+enum FactorizationType
+{
+    LU,
+    CHOLESKY,
+    SYMMETRIC_INDEFINITE,
+    HERMITIAN_INDEFINITE
+};
+
+tbb::atomic<unsigned int> scratchFileCounter;
+
+// Return the name of a file in the given directory that does not exist yet
+std::string makeScratchFileName(const std::string& directory)
+{
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/')
+        prefix += '/';
+    prefix += "bempp-factors-" + toString(std::time(0)) + "-";
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        std::string name = prefix + toString(scratchFileCounter++) + ".tmp";
+        std::ifstream test(name.c_str());
+        if (!test)
+            return name;
+    }
+    throw std::runtime_error("DefaultDirectSolver::factorize(): "
+                             "cannot find an unused scratch file name in "
+                             "directory '" + directory + "'");
+}
+
+// Factors of a square matrix, stored either in memory or in a memory-mapped
+// scratch file
+template <typename ValueType>
+class Factors
+{
+public:
+    Factors(size_t size, bool memoryMapped, const std::string& directory) :
+        m_size(size), m_type(LU), m_memoryMapped(memoryMapped)
+    {
+        if (!m_memoryMapped || m_size == 0)
+            return;
+        namespace bi = boost::interprocess;
+        m_fileName = makeScratchFileName(directory);
+        const size_t byteCount = m_size * m_size * sizeof(ValueType);
+        {
+            std::filebuf file;
+            if (!file.open(m_fileName.c_str(), std::ios_base::in |
+                           std::ios_base::out | std::ios_base::trunc |
+                           std::ios_base::binary))
+                throw std::runtime_error("DefaultDirectSolver::factorize(): "
+                                         "cannot create scratch file '" +
+                                         m_fileName + "'");
+            file.pubseekoff(byteCount - 1, std::ios_base::beg);
+            file.sputc(0);
+        }
+        try {
+            bi::file_mapping mapping(m_fileName.c_str(), bi::read_write);
+            m_region.reset(new bi::mapped_region(mapping, bi::read_write));
+        }
+        catch (...) {
+            bi::file_mapping::remove(m_fileName.c_str());
+            throw;
+        }
+    }
+
+    ~Factors() {
+        if (!m_region)
+            return;
+        m_region.reset();
+        boost::interprocess::file_mapping::remove(m_fileName.c_str());
+    }
+
+    // Overwrite the stored values with the matrix representation of op
+    void load(const DiscreteBoundaryOperator<ValueType>& op) {
+        if (!m_memoryMapped)
+            m_values = op.asMatrix();
+        else if (m_size > 0) {
+            // The extracted matrix is released as soon as it has been copied
+            arma::Mat<ValueType> mat = op.asMatrix();
+            std::copy(mat.memptr(), mat.memptr() + mat.n_elem, data());
+        }
+    }
+
+    size_t size() const { return m_size; }
+
+    ValueType* data() {
+        return m_memoryMapped ?
+                    static_cast<ValueType*>(m_region->get_address()) :
+                    m_values.memptr();
+    }
+
+    const ValueType* data() const {
+        return const_cast<Factors*>(this)->data();
+    }
+
+    FactorizationType type() const { return m_type; }
+    void setType(FactorizationType type) { m_type = type; }
+
+    std::vector<blas_int>& pivots() { return m_pivots; }
+    const std::vector<blas_int>& pivots() const { return m_pivots; }
+
+private:
+    Factors(const Factors&);
+    Factors& operator=(const Factors&);
+
+    size_t m_size;
+    FactorizationType m_type;
+    bool m_memoryMapped;
+    arma::Mat<ValueType> m_values;
+    std::string m_fileName;
+    boost::scoped_ptr<boost::interprocess::mapped_region> m_region;
+    std::vector<blas_int> m_pivots;
+};
+
+// Compute a symmetric- or Hermitian-indefinite factorisation of the matrix
+// stored in factors; return the LAPACK error code
+template <typename ValueType>
+blas_int factorizeIndefinite(Factors<ValueType>& factors, bool hermitian)
+{
+    typedef Lapack<ValueType> L;
+    const blas_int n = factors.size();
+    factors.pivots().resize(n);
+    ValueType optimalWorkSize;
+    blas_int info = 0;
+    if (hermitian)
+        L::hetrf(n, factors.data(), &factors.pivots()[0], &optimalWorkSize,
+                 -1, info);
+    else
+        L::sytrf(n, factors.data(), &factors.pivots()[0], &optimalWorkSize,
+                 -1, info);
+    const blas_int lwork = std::max<blas_int>(
+                1, static_cast<blas_int>(realPart(optimalWorkSize)));
+    std::vector<ValueType> work(lwork);
+    if (hermitian)
+        L::hetrf(n, factors.data(), &factors.pivots()[0], &work[0],
+                 lwork, info);
+    else
+        L::sytrf(n, factors.data(), &factors.pivots()[0], &work[0],
+                 lwork, info);
+    factors.setType(hermitian ? HERMITIAN_INDEFINITE : SYMMETRIC_INDEFINITE);
+    return info;
+}
+
+} // namespace
+
 /** \cond HIDDEN_INTERNAL */
 
 template <typename BasisFunctionType, typename ResultType>
 struct DefaultDirectSolver<BasisFunctionType, ResultType>::Impl
 {
     Impl(const BoundaryOperator<BasisFunctionType, ResultType>& op_) :
-        op(op_)
+        op(op_), memoryMapped(false)
     {
     }
 
     Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType>& op_) :
-        op(op_)
+        op(op_), memoryMapped(false)
     {
     }
 
+    // Compute the factors unless they are already available. Must be
+    // called with the mutex locked.
+    void ensureFactorized();
+
     boost::variant<
         BoundaryOperator<BasisFunctionType, ResultType>,
         BlockedBoundaryOperator<BasisFunctionType, ResultType> > op;
+    bool memoryMapped;
+    std::string scratchDirectory;
+    // Shared with the solves in progress, which keep the factors alive if
+    // they are discarded in the meantime
+    shared_ptr<const Factors<ResultType> > factors;
+    tbb::mutex mutex;
 };
 
 /** \endcond */
@@ -72,6 +391,147 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::~DefaultDirectSolver()
 {
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void DefaultDirectSolver<BasisFunctionType, ResultType>::
+enableMemoryMappedFactorStorage(const std::string& directory)
+{
+    tbb::mutex::scoped_lock lock(m_impl->mutex);
+    m_impl->memoryMapped = true;
+    m_impl->scratchDirectory = directory;
+    m_impl->factors.reset();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultDirectSolver<BasisFunctionType, ResultType>::
+disableMemoryMappedFactorStorage()
+{
+    tbb::mutex::scoped_lock lock(m_impl->mutex);
+    m_impl->memoryMapped = false;
+    m_impl->factors.reset();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool DefaultDirectSolver<BasisFunctionType, ResultType>::isFactorized() const
+{
+    tbb::mutex::scoped_lock lock(m_impl->mutex);
+    return m_impl->factors.get() != 0;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultDirectSolver<BasisFunctionType, ResultType>::factorize() const
+{
+    tbb::mutex::scoped_lock lock(m_impl->mutex);
+    m_impl->ensureFactorized();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultDirectSolver<BasisFunctionType, ResultType>::Impl::
+ensureFactorized()
+{
+    typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+    typedef BlockedBoundaryOperator<BasisFunctionType, ResultType>
+            BlockedBoundaryOp;
+    typedef Lapack<ResultType> L;
+
+    if (factors)
+        return;
+
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > weakForm;
+    int symmetry = NO_SYMMETRY;
+    if (const BoundaryOp* boundaryOp = boost::get<BoundaryOp>(&op)) {
+        weakForm = boundaryOp->weakForm();
+        symmetry = boundaryOp->abstractOperator()->symmetry();
+    } else
+        weakForm = boost::get<BlockedBoundaryOp>(op).weakForm();
+    if (weakForm->rowCount() != weakForm->columnCount())
+        throw std::invalid_argument(
+                "DefaultDirectSolver::factorize(): "
+                "the discretised operator is not square");
+
+    const size_t size = weakForm->rowCount();
+    shared_ptr<Factors<ResultType> > newFactors(
+                new Factors<ResultType>(size, memoryMapped, scratchDirectory));
+    newFactors->load(*weakForm);
+    if (size == 0) {
+        factors = newFactors;
+        return;
+    }
+
+    const bool isComplex = boost::is_complex<ResultType>();
+    const bool hermitian = (symmetry & HERMITIAN) ||
+            (!isComplex && (symmetry & SYMMETRIC));
+    blas_int info = 0;
+    if (hermitian) {
+        newFactors->setType(CHOLESKY);
+        L::potrf(size, newFactors->data(), info);
+        if (info > 0) {
+            // Not positive definite: start again from the original matrix
+            newFactors->load(*weakForm);
+            info = factorizeIndefinite(*newFactors, true /* hermitian */);
+        }
+    } else if (symmetry & SYMMETRIC)
+        info = factorizeIndefinite(*newFactors, false /* hermitian */);
+    else {
+        newFactors->pivots().resize(size);
+        L::getrf(size, newFactors->data(), &newFactors->pivots()[0], info);
+    }
+    if (info != 0)
+        throw std::runtime_error(
+                "DefaultDirectSolver::factorize(): the discretised operator "
+                "is singular");
+    factors = newFactors;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+DefaultDirectSolver<BasisFunctionType, ResultType>::solveProjections(
+        const arma::Mat<ResultType>& rhsProjections) const
+{
+    typedef Lapack<ResultType> L;
+
+    // Hold a reference to the factors, so that they stay valid even if
+    // another thread discards them while the solve is in progress
+    shared_ptr<const Factors<ResultType> > sharedFactors;
+    {
+        tbb::mutex::scoped_lock lock(m_impl->mutex);
+        m_impl->ensureFactorized();
+        sharedFactors = m_impl->factors;
+    }
+    const Factors<ResultType>& factors = *sharedFactors;
+    if (rhsProjections.n_rows != factors.size())
+        throw std::invalid_argument(
+                "DefaultDirectSolver::solveProjections(): "
+                "rhsProjections has an incorrect number of rows");
+
+    arma::Mat<ResultType> solution = rhsProjections;
+    if (solution.n_elem == 0)
+        return solution;
+    const blas_int n = factors.size(), nrhs = solution.n_cols;
+    blas_int info = 0;
+    switch (factors.type()) {
+    case LU:
+        L::getrs(n, nrhs, factors.data(), &factors.pivots()[0],
+                 solution.memptr(), info);
+        break;
+    case CHOLESKY:
+        L::potrs(n, nrhs, factors.data(), solution.memptr(), info);
+        break;
+    case SYMMETRIC_INDEFINITE:
+        L::sytrs(n, nrhs, factors.data(), &factors.pivots()[0],
+                 solution.memptr(), info);
+        break;
+    case HERMITIAN_INDEFINITE:
+        L::hetrs(n, nrhs, factors.data(), &factors.pivots()[0],
+                 solution.memptr(), info);
+        break;
+    }
+    if (info != 0)
+        throw std::runtime_error(
+                "DefaultDirectSolver::solveProjections(): "
+                "LAPACK reported an error (info = " + toString(info) + ")");
+    return solution;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 Solution<BasisFunctionType, ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
@@ -88,8 +548,7 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
     Solver<BasisFunctionType, ResultType>::checkConsistency(
         *boundaryOp, rhs, ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
 
-    arma::Col<ResultType> armaSolution = arma::solve(
-                boundaryOp->weakForm()->asMatrix(),
+    arma::Col<ResultType> armaSolution = solveProjections(
                 rhs.projections(boundaryOp->dualToRange()));
 
     return Solution<BasisFunctionType, ResultType>(
@@ -133,9 +592,7 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
     }
 
     // Solve
-    arma::Col<ResultType> armaSolution = arma::solve(
-                boundaryOp->weakForm()->asMatrix(),
-                armaRhs);
+    arma::Col<ResultType> armaSolution = solveProjections(armaRhs);
 
     // Convert chunks of the solution vector into grid functions
     std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
@@ -23,7 +23,10 @@
 
 #include "solver.hpp"
 
+#include "../common/armadillo_fwd.hpp"
+
 #include <boost/scoped_ptr.hpp>
+#include <string>
 
 namespace Bempp
 {
@@ -33,6 +36,15 @@ namespace Bempp
   *
   * This class can be used to solve boundary integral equations using standard
   * dense LU decomposition.
+  *
+  * The weak form of the operator is converted to a dense matrix and
+  * factorised by LAPACK on the first call to solve(); the factors are kept
+  * and reused by all subsequent solves. If the operator is declared
+  * Hermitian (or symmetric and real), a Cholesky factorisation is attempted
+  * first, with a fallback to a symmetric-indefinite (LDL^H) one if the matrix
+  * turns out not to be positive definite. Complex symmetric operators are
+  * factorised as LDL^T. Otherwise LU decomposition with partial pivoting is
+  * used.
   */
 template <typename BasisFunctionType, typename ResultType>
 class DefaultDirectSolver : public Solver<BasisFunctionType, ResultType>
@@ -48,6 +60,48 @@ public:
             const BlockedBoundaryOperator<BasisFunctionType, ResultType>& boundaryOp);
     ~DefaultDirectSolver();
 
+    using Base::solve;
+
+    /** \brief Solve the equation for several right-hand sides at once.
+     *
+     *  \param[in] rhsProjections
+     *    Matrix whose columns contain the projections of the right-hand sides
+     *    on the basis functions of the dual to the range of the operator (for
+     *    blocked operators: on the concatenated bases of all the duals to
+     *    ranges).
+     *
+     *  \returns Matrix whose columns contain the expansion coefficients of the
+     *  corresponding solutions in the basis of the domain (for blocked
+     *  operators: of all the domains, concatenated). */
+    arma::Mat<ResultType> solveProjections(
+            const arma::Mat<ResultType>& rhsProjections) const;
+
+    /** \brief Factorise the discretised operator.
+     *
+     *  This function is called automatically by the first solve; it can be
+     *  called explicitly to perform the factorisation in advance. Does nothing
+     *  if the factors have already been computed. */
+    void factorize() const;
+
+    /** \brief Return true if the factors of the discretised operator have
+     *  been computed. */
+    bool isFactorized() const;
+
+    /** \brief Store the factors in a memory-mapped scratch file.
+     *
+     *  This makes it possible to factorise dense matrices larger than the
+     *  available memory, with the operating system paging the factors in and
+     *  out as needed. The file is created in directory \p directory (by
+     *  default, the current working directory) and deleted when the factors
+     *  are discarded. Any factors computed previously are discarded. */
+    void enableMemoryMappedFactorStorage(
+            const std::string& directory = std::string());
+
+    /** \brief Store the factors in memory (default).
+     *
+     *  Any factors computed previously are discarded. */
+    void disableMemoryMappedFactorStorage();
+
 private:
     virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
             const GridFunction<BasisFunctionType, ResultType>& rhs) const;
@@ -45,7 +45,6 @@
 #include <boost/make_shared.hpp>
 #include <boost/variant.hpp>
 
-#include <tbb/task_scheduler_init.h>
 
 namespace Bempp
 {
@@ -276,27 +275,11 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
     armaSolution.fill(static_cast<ResultType>(0.));
     Teuchos::RCP<TrilinosVector> solutionVector = wrapInTrilinosVector(armaSolution);
 
-    // Get number of threads
-    Fiber::ParallelizationOptions parallelOptions =
-        boundaryOp->context()->assemblyOptions().parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-
-    // Solve
-    Thyra::SolveStatus<MagnitudeType> status;
-    {
-        // Initialize TBB threads here (to prevent their construction and
-        // destruction on every matrix-vector multiplication)
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-        status = m_impl->solverWrapper->solve(
+    // Solve (the TBB threads used by matrix-vector multiplications are kept
+    // alive by Fiber::ExecutionContext between iterations)
+    Thyra::SolveStatus<MagnitudeType> status =
+        m_impl->solverWrapper->solve(
             Thyra::NOTRANS, *rhsVector, solutionVector.ptr());
-    }
 
     // Construct grid function and return
     return Solution<BasisFunctionType, ResultType>(
@@ -369,27 +352,11 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
         }
     assert(context);
 
-    // Get number of threads
-    Fiber::ParallelizationOptions parallelOptions =
-        context->assemblyOptions().parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-
-    // Solve
-    Thyra::SolveStatus<MagnitudeType> status;
-    {
-        // Initialize TBB threads here (to prevent their construction and
-        // destruction on every matrix-vector multiplication)
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-        status = m_impl->solverWrapper->solve(
+    // Solve (the TBB threads used by matrix-vector multiplications are kept
+    // alive by Fiber::ExecutionContext between iterations)
+    Thyra::SolveStatus<MagnitudeType> status =
+        m_impl->solverWrapper->solve(
             Thyra::NOTRANS, *rhsVector, solutionVector.ptr());
-    }
 
     // Convert chunks of the solution vector into grid functions
     std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
@@ -364,6 +364,10 @@ return pointers to the SWIG wrappers of the Numpy array and the Armadillo array
 }
 
 /* Typemap suite for (DATA_TYPE* INPLACE_ARRAY1, DIM_TYPE DIM1, DIM_TYPE DIM2)
+ *
+ * The array must be Fortran-contiguous, since Armadillo stores matrices in
+ * column-major order. (Vectors and n x 1 arrays are both C- and
+ * Fortran-contiguous.)
  */
 %typecheck(SWIG_TYPECHECK_DOUBLE_ARRAY,
            fragment="NumPy_Macros")
@@ -378,8 +382,14 @@ return pointers to the SWIG wrappers of the Numpy array and the Armadillo array
   (PyArrayObject* array=NULL, arma::Mat< DATA_TYPE > arma_array)
 {
   array = obj_to_array_no_conversion($input, DATA_TYPECODE);
-  if (!array || !require_dimensions(array, 2) || !require_contiguous(array)
-      || !require_native(array)) SWIG_fail;
+  if (!array || !require_dimensions(array, 2) || !require_native(array))
+      SWIG_fail;
+  if (!array_is_fortran(array)) {
+      PyErr_SetString(PyExc_TypeError,
+                      "Array must be Fortran-contiguous. "
+                      "A non-Fortran-contiguous array was given");
+      SWIG_fail;
+  }
   // Use placement new to reinitialise the Armadillo array using the
   // "advanced" constructor taking a pointer to existing data. This is needed
   // because SWIG initialises variables with the default constructor.
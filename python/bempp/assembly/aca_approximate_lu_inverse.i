@@ -8,6 +8,7 @@
 %}
 
 %define NUMERICAL_ACA_LU_APPROXIMATE_INVERSE(VALUE,PY_VALUE)
+     %threadallow createAcaApproximateLuInverse_## PY_VALUE;
      %inline %{
      namespace Bempp{
      boost::shared_ptr<const DiscreteBoundaryOperator< VALUE > > createAcaApproximateLuInverse_## PY_VALUE (
@@ -19,6 +19,11 @@ namespace Bempp
 %feature("autodoc", "recompress -> bool") AcaOptions::recompress;
 %feature("autodoc", "scaling -> float") AcaOptions::scaling;
 %feature("autodoc", "firstClusterIndex -> int") AcaOptions::firstClusterIndex;
+%feature("autodoc", "outOfCore -> bool") AcaOptions::outOfCore;
+%feature("autodoc", "outOfCoreDirectory -> string") AcaOptions::outOfCoreDirectory;
+%feature("autodoc", "outOfCoreMemoryBudget -> int") AcaOptions::outOfCoreMemoryBudget;
+%feature("autodoc", "storagePrecision -> \"full\", \"single_low_rank_blocks\" or \"single_all_blocks\"")
+     AcaOptions::storagePrecision;
 %feature("autodoc", "globalAssemblyBeforeCompression (deprecated) -> bool")
      AcaOptions::globalAssemblyBeforeCompression;
 
@@ -114,6 +119,52 @@ namespace Bempp
     }
 }
 
+// Handle the enum AcaOptions::StoragePrecision like a string
+%typemap(typecheck) AcaOptions::StoragePrecision
+{
+    $1 = PyString_Check($input);
+}
+%typemap(in) AcaOptions::StoragePrecision
+{
+    if (!PyString_Check($input))
+    {
+        PyErr_SetString(PyExc_TypeError, 
+                        "in method '$symname', argument $argnum: expected a string");
+        SWIG_fail;
+    }
+    const std::string s(PyString_AsString($input));
+    if (s == "full")
+        $1 = Bempp::AcaOptions::FULL_PRECISION;
+    else if (s == "single_low_rank_blocks")
+        $1 = Bempp::AcaOptions::SINGLE_PRECISION_LOW_RANK_BLOCKS;
+    else if (s == "single_all_blocks")
+        $1 = Bempp::AcaOptions::SINGLE_PRECISION_ALL_BLOCKS;
+    else
+    {
+        PyErr_SetString(PyExc_ValueError,
+                        "in method '$symname', argument $argnum: "
+                        "expected one of 'full', "
+                        "'single_low_rank_blocks' or 'single_all_blocks'");
+        SWIG_fail;
+    }
+}
+
+%typemap(out) AcaOptions::StoragePrecision
+{
+    if ($1 == Bempp::AcaOptions::FULL_PRECISION)
+        $result = PyString_FromString("full");
+    else if ($1 == Bempp::AcaOptions::SINGLE_PRECISION_LOW_RANK_BLOCKS)
+        $result = PyString_FromString("single_low_rank_blocks");
+    else if ($1 == Bempp::AcaOptions::SINGLE_PRECISION_ALL_BLOCKS)
+        $result = PyString_FromString("single_all_blocks");
+    else
+    {
+        PyErr_SetString(PyExc_ValueError, 
+                        "in method '$symname', unknown storage precision.");
+        SWIG_fail;
+    }
+}
+
 } // namespace Bempp
 
 %include "assembly/aca_options.hpp"
@@ -16,6 +16,8 @@ BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(AssembledPotentialOper
     %apply arma::Mat<std::complex<double> >& ARGOUT_MAT
         { arma::Mat<std::complex<double> >& result_ };
 
+    %threadallow _apply;
+
     void _apply(
         arma::Mat<ResultType>& result_,
         const GridFunction<BasisFunctionType, ResultType>& argument)
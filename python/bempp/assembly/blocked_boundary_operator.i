@@ -8,6 +8,9 @@ namespace Bempp
 
   %extend BlockedBoundaryOperator {
     %ignore apply;
+
+    // Release the GIL during assembly of the weak form
+    %threadallow weakForm;
   }
 
   BEMPP_EXTEND_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(BlockedBoundaryOperator);
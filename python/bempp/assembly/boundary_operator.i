@@ -28,6 +28,10 @@ class Symmetry;
 {
     %ignore BoundaryOperator;
 
+    // Release the GIL during assembly of the weak form
+    %threadallow weakForm;
+    %threadallow __mul__;
+
     BoundaryOperator<BasisFunctionType, ResultType> __pos__()
     {
         return +(*$self);
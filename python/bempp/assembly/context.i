@@ -21,6 +21,9 @@ class AssemblyOptions;
 
 BEMPP_EXTEND_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(Context);
 
+// this function is only for internal use
+%ignore localAssemblerConstructionDataCache;
+
 } // namespace Bempp
 
 #define shared_ptr boost::shared_ptr
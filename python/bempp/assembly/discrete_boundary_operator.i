@@ -40,6 +40,12 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
     // this function is only for internal use
     %ignore addBlock;
 
+    // Release the GIL while operators are applied or converted
+    %threadallow apply;
+    %threadallow asMatrix;
+    %threadallow asDiscreteAcaBoundaryOperator;
+    %threadallow __applyInPlaceImpl;
+
     %apply const arma::Mat<float>& IN_MAT {
         const arma::Mat<float>& x_in
     };
@@ -122,42 +128,14 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
         return op1*op2;
     }
 
-    static void
-    __matrixMultImpl(const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op,
-                     const arma::Mat<ValueType>& mat_in,
-                     arma::Mat<ValueType>& mat_out){
-
-        const int opRows = op->rowCount();
-        const int opCols = op->columnCount();
-        const int matCols = mat_in.n_cols;
-        const int matRows = mat_in.n_rows;
-        mat_out.zeros(opRows,matCols);
-        if (opCols!=matRows)
-            throw std::invalid_argument("__matrixMultImpl(): Wrong dimensions.");
-        for (int i=0;i<matCols;i++){
-            arma::Col< ValueType > tmp1 = mat_in.unsafe_col(i);
-            arma::Col< ValueType > tmp2 = mat_out.unsafe_col(i);
-            op->apply(Bempp::NO_TRANSPOSE,tmp1,tmp2,1.0,0.0);
-        }
-    }
-
-    static void
-    __matrixHMultImpl(const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op,
-                     const arma::Mat<ValueType>& mat_in,
-                     arma::Mat<ValueType>& mat_out){
-
-        const int opRows = op->rowCount();
-        const int opCols = op->columnCount();
-        const int matCols = mat_in.n_cols;
-        const int matRows = mat_in.n_rows;
-        mat_out.zeros(opCols,matCols);
-        if (opRows!=matRows)
-            throw std::invalid_argument("__matrixHMultImpl(): Wrong dimensions.");
-        for (int i=0;i<matCols;i++){
-            arma::Col< ValueType > tmp1 = mat_in.unsafe_col(i);
-            arma::Col< ValueType > tmp2 = mat_out.unsafe_col(i);
-            op->apply(Bempp::CONJUGATE_TRANSPOSE,tmp1,tmp2,1.0,0.0);
-        }
+    // Calculate y_inout := op(self) * mat_in, writing directly to the
+    // buffer of the NumPy array passed as y_inout
+    void __applyInPlaceImpl(TranspositionMode trans,
+                            const arma::Mat<ValueType>& mat_in,
+                            arma::Mat<ValueType>& y_inout) const
+    {
+        $self->apply(trans, mat_in, y_inout,
+                     static_cast<ValueType>(1.), static_cast<ValueType>(0.));
     }
 
     %feature("compactdefaultargs") asDiscreteAcaBoundaryOperator;
@@ -178,10 +156,8 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
                 ndim = other.ndim
                 if ndim==0:
                     return self.__scalarMultImpl(other,self)
-                elif ndim==1:
-                    return self.__matrixMultImpl(self,other[:,np.newaxis])[:,0]
-                elif ndim==2:
-                    return self.__matrixMultImpl(self,other)
+                elif ndim==1 or ndim==2:
+                    return self.matvec(other)
                 else:
                     raise ValueError("Discrete boundary operators do not support "
                                      "multiplication by arrays with more than 2 "
@@ -211,26 +187,49 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
                 raise ValueError("Discrete boundary operators do not support "
                                  "multiplication with this type.")
 
-        def matvec(self, other):
+        def __applyToArray(self, trans, other, out, resultRowCount):
+            import numpy as np
+            x = np.asarray(other)
+            isVector = x.ndim == 1
+            if isVector:
+                x = x.reshape(x.shape[0], 1)
+            if out is None:
+                y = np.zeros((resultRowCount, x.shape[1]), dtype=self.dtype,
+                             order='F')
+            else:
+                if (out.dtype != self.dtype or not out.flags.f_contiguous or
+                        out.size != resultRowCount * x.shape[1]):
+                    raise ValueError("'out' must be a Fortran-contiguous "
+                                     "array of type " + str(self.dtype) +
+                                     " and shape " +
+                                     str((resultRowCount, x.shape[1])))
+                y = out.reshape((resultRowCount, x.shape[1]), order='F')
+            self.__applyInPlaceImpl(trans, x, y)
+            if out is not None:
+                return out
+            elif isVector:
+                return y[:, 0]
+            else:
+                return y
+
+        def matvec(self, other, out=None):
             """
             Multiply this operator with 'other' and return the result.
 
             *Parameters:*
                - other (1D or 2D ndarray)
                     Vector or matrix that should be multiplied with this operator.
+               - out (1D or 2D ndarray, optional)
+                    Fortran-contiguous array of the operator's dtype in which
+                    the result is stored. If not given, a new array is
+                    allocated.
+
+            Inputs that are Fortran-contiguous (in particular, all contiguous
+            vectors) and of the operator's dtype are used without copying.
             """
-            sn = len(other.shape)
-            if sn == 1:
-               data = other.reshape(other.shape[0],1)
-            else:
-               data = other
-            res = self.__matrixMultImpl(self,data)
-            if sn == 1:
-               return res.reshape(self.rowCount())
-            else:
-               return res
+            return self.__applyToArray("n", other, out, self.rowCount())
 
-        def rmatvec(self, other):
+        def rmatvec(self, other, out=None):
             """
             Multiply the conjugate transpose of this operator with 'other'
             and return the result.
@@ -239,27 +238,26 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
                - other (1D or 2D ndarray)
                     Vector or matrix that should be multiplied with the
                     conjugate transpose of this operator.
+               - out (1D or 2D ndarray, optional)
+                    Fortran-contiguous array of the operator's dtype in which
+                    the result is stored. If not given, a new array is
+                    allocated.
             """
-            sn = len(other.shape)
-            if sn == 1:
-               data = other.reshape(other.shape[0],1)
-            else:
-               data = other
-            res = self.__matrixHMultImpl(self,data)
-            if sn == 1:
-               return res.reshape(self.columnCount())
-            else:
-               return res
+            return self.__applyToArray("h", other, out, self.columnCount())
 
-        def matmat(self, other):
+        def matmat(self, other, out=None):
             """
             Multiply this operator with the matrix 'other' and return the result.
 
             *Parameters:*
                - other (2D ndarray)
                     Matrix that should be multiplied with this operator.
+               - out (2D ndarray, optional)
+                    Fortran-contiguous array of the operator's dtype in which
+                    the result is stored. If not given, a new array is
+                    allocated.
             """
-            return self.__matrixMultImpl(self,other)
+            return self.__applyToArray("n", other, out, self.rowCount())
 
         def asPyTrilinosOperator(self,label="",pid=0):
             """
@@ -8,6 +8,8 @@ namespace Bempp
 %extend EvaluationOptions
 {
     %ignore switchToTbb;
+    %feature("compactdefaultargs") switchToHierarchicalMode;
+    %feature("compactdefaultargs") enableNearFieldQuadrature;
 }
 
 } // namespace Bempp
@@ -11,6 +11,13 @@
 %newobject gridFunctionFromPythonSurfaceNormalDependentFunctor;
 %newobject gridFunctionFromPythonSurfaceNormalIndependentFunctor;
 
+// Release the GIL while the projections of Python functions are calculated;
+// the Python functors reacquire it whenever they are evaluated
+%threadallow gridFunctionFromPythonDomainIndexDependentFunctor;
+%threadallow gridFunctionFromPythonSurfaceNormalAndDomainIndexDependentFunctor;
+%threadallow gridFunctionFromPythonSurfaceNormalDependentFunctor;
+%threadallow gridFunctionFromPythonSurfaceNormalIndependentFunctor;
+
 namespace Bempp {
 
     %apply const arma::Col<float>& IN_COL {
@@ -30,6 +30,8 @@ BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(PotentialOperator);
 
     %ignore evaluateOnGrid;
 
+    %threadallow _evaluateAtPoints;
+
     void _evaluateAtPoints(
         arma::Mat<ResultType>& result_,
         const GridFunction<BasisFunctionType_, ResultType_>& argument,
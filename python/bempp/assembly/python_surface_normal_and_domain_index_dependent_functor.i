@@ -28,6 +28,7 @@ public:
     }
 
     ~PythonSurfaceNormalAndDomainIndexDependentFunctor() {
+        PythonGilGuard gilGuard;
         Py_DECREF(m_pyFunc);
     }
 
@@ -44,6 +45,9 @@ public:
                   int domainIndex,
                   arma::Col<ValueType>& result_) const
     {
+        // Assembly may call this function from threads not holding the GIL
+        PythonGilGuard gilGuard;
+
         const int coordinateNumpyType = PythonScalarTraits<CoordinateType>::numpyType;
         const int valueNumpyType = PythonScalarTraits<ValueType>::numpyType;
 
@@ -28,6 +28,7 @@ public:
     }
 
     ~PythonSurfaceNormalDependentFunctor() {
+        PythonGilGuard gilGuard;
         Py_DECREF(m_pyFunc);
     }
 
@@ -43,6 +44,9 @@ public:
                   const arma::Col<CoordinateType>& normal,
           arma::Col<ValueType>& result_) const
     {
+        // Assembly may call this function from threads not holding the GIL
+        PythonGilGuard gilGuard;
+
         const int coordinateNumpyType = PythonScalarTraits<CoordinateType>::numpyType;
         const int valueNumpyType = PythonScalarTraits<ValueType>::numpyType;
 
@@ -29,6 +29,7 @@ public:
     }
 
     ~PythonSurfaceNormalIndependentFunctor() {
+        PythonGilGuard gilGuard;
         Py_DECREF(m_pyFunc);
     }
 
@@ -43,6 +44,9 @@ public:
     void evaluate(const arma::Col<CoordinateType>& point,
                   arma::Col<ValueType>& result_) const
     {
+        // Assembly may call this function from threads not holding the GIL
+        PythonGilGuard gilGuard;
+
         const int coordinateNumpyType = PythonScalarTraits<CoordinateType>::numpyType;
         const int valueNumpyType = PythonScalarTraits<ValueType>::numpyType;
 
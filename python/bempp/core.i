@@ -18,8 +18,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-// Construct a Swig module
-%module(directors="1") core
+// Construct a Swig module. Thread support is enabled so that the wrappers of
+// long-running C++ routines, marked with %threadallow in the individual
+// interface files, can release the global interpreter lock; all the other
+// wrappers keep it.
+%module(directors="1", threads="1") core
+%nothreadallow;
 %{
 #define SWIG_FILE_WITH_INIT
 
@@ -144,6 +148,8 @@ AUTO_PTR_TYPEMAPS_FOR_CLASS_TEMPLATED_ON_RESULT(Bempp::InterpolatedFunction)
 %include "fiber/parallelization_options.i"
 %include "fiber/quadrature_options.i"
 %include "fiber/accuracy_options.i"
+%include "fiber/hierarchical_evaluation_options.i"
+%include "fiber/near_field_evaluation_options.i"
 %include "fiber/quadrature_strategy.i"
 %include "fiber/verbosity_level.i"
 
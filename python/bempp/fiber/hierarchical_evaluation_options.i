@@ -0,0 +1,5 @@
+%{
+#include "fiber/hierarchical_evaluation_options.hpp"
+%}
+
+%include "fiber/hierarchical_evaluation_options.hpp"
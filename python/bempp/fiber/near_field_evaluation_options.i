@@ -0,0 +1,5 @@
+%{
+#include "fiber/near_field_evaluation_options.hpp"
+%}
+
+%include "fiber/near_field_evaluation_options.hpp"
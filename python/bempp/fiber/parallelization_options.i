@@ -8,6 +8,7 @@ namespace Fiber
 %extend ParallelizationOptions
 {
 %feature("compactdefaultargs") setMaxThreadCount;
+%feature("compactdefaultargs") setGrainSize;
 }
 
 }
@@ -42,8 +42,10 @@ namespace Bempp
         %}
 
 
-    // this function is only for internal use
+    // these functions are only for internal use
     %ignore elementGeometryFactory;
+    %ignore elementAdjacency;
+    %ignore triangleBvh;
 }
 
 %apply const arma::Mat<float>& IN_MAT {
@@ -262,7 +262,7 @@ public:
     void resetDataSets();
 
 
-    void write(const std::string& fname) const;
+    void write(const std::string& fname, bool binary = false) const;
     static GmshData read(const std::string& fname, int elementType = 2, int physicalEntity = -1);
 
 
@@ -351,7 +351,7 @@ public:
     const std::vector<int>& elementPermutation() const;
     const std::vector<int>& inverseNodePermutation() const;
     const std::vector<int>& inverseElementPermutation() const;
-    void write(std::string fileName) const;
+    void write(std::string fileName, bool binary = false) const;
     const GmshData& gmshData() const;
 
     void resetNodeDataSets();
@@ -2462,6 +2462,14 @@ def createEvaluationOptions():
     """Create and return an EvaluationOptions object with default settings."""
     return core.EvaluationOptions()
 
+def createHierarchicalEvaluationOptions():
+    """Create and return a HierarchicalEvaluationOptions object with default settings."""
+    return core.HierarchicalEvaluationOptions()
+
+def createNearFieldEvaluationOptions():
+    """Create and return a NearFieldEvaluationOptions object with default settings."""
+    return core.NearFieldEvaluationOptions()
+
 def createBlockedOperatorStructure(context):
     """
     Create and return a BlockedOperatorStructure object.
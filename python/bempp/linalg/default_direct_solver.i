@@ -11,6 +11,46 @@ namespace Bempp
 
 BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DefaultDirectSolver);
 
+%extend DefaultDirectSolver
+{
+    // The solve() overloads are wrapped in the base class
+    %ignore solve;
+
+    %apply const arma::Mat<float>& IN_MAT {
+        const arma::Mat<float>& rhsProjections };
+    %apply const arma::Mat<double>& IN_MAT {
+        const arma::Mat<double>& rhsProjections };
+    %apply const arma::Mat<std::complex<float> >& IN_MAT {
+        const arma::Mat<std::complex<float> >& rhsProjections };
+    %apply const arma::Mat<std::complex<double> >& IN_MAT {
+        const arma::Mat<std::complex<double> >& rhsProjections };
+
+    %apply arma::Mat<float>& ARGOUT_MAT { arma::Mat<float>& result_ };
+    %apply arma::Mat<double>& ARGOUT_MAT { arma::Mat<double>& result_ };
+    %apply arma::Mat<std::complex<float> >& ARGOUT_MAT
+        { arma::Mat<std::complex<float> >& result_ };
+    %apply arma::Mat<std::complex<double> >& ARGOUT_MAT
+        { arma::Mat<std::complex<double> >& result_ };
+
+    // Release the GIL during factorisation and solution
+    %threadallow factorize;
+    %threadallow _solveProjections;
+
+    void _solveProjections(
+        arma::Mat<ResultType>& result_,
+        const arma::Mat<ResultType>& rhsProjections) const
+    {
+        result_ = $self->solveProjections(rhsProjections);
+    }
+
+    %ignore solveProjections;
+
+    %pythoncode {
+        def solveProjections(self, rhsProjections):
+            return self._solveProjections(rhsProjections)
+    }
+}
+
 } // namespace Bempp
 
 #define shared_ptr boost::shared_ptr
@@ -20,4 +60,14 @@ BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DefaultDirectSolver);
 namespace Bempp
 {
 BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(DefaultDirectSolver);
+
+%clear const arma::Mat<float>& rhsProjections;
+%clear const arma::Mat<double>& rhsProjections;
+%clear const arma::Mat<std::complex<float> >& rhsProjections;
+%clear const arma::Mat<std::complex<double> >& rhsProjections;
+
+%clear arma::Mat<float>& result_;
+%clear arma::Mat<double>& result_;
+%clear arma::Mat<std::complex<float> >& result_;
+%clear arma::Mat<std::complex<double> >& result_;
 } // namespace Bempp
@@ -61,6 +61,8 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(Solver);
 %define BEMPP_EXTEND_SOLVER(BASIS, RESULT, PYBASIS, PYRESULT)
     %extend Solver< BASIS, RESULT >
     {
+        %threadallow solve;
+
         %pythonprepend solve %{
             try:
                 newargs = ([],)
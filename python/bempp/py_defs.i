@@ -1,2 +1,27 @@
 // Useful Python tools
 
+%{
+
+namespace Bempp
+{
+
+// Acquire the global interpreter lock for the lifetime of the object. Must be
+// used by C++ code calling into Python, since such code may run in a thread
+// not holding the lock (e.g. a TBB worker or a thread executing a wrapper that
+// has released it).
+class PythonGilGuard
+{
+public:
+    PythonGilGuard() : m_state(PyGILState_Ensure()) {}
+    ~PythonGilGuard() { PyGILState_Release(m_state); }
+
+private:
+    PythonGilGuard(const PythonGilGuard&);
+    PythonGilGuard& operator=(const PythonGilGuard&);
+
+    PyGILState_STATE m_state;
+};
+
+} // namespace Bempp
+
+%}
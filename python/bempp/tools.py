@@ -221,7 +221,7 @@ class RealOperator(object):
     def operator(self):
         return self.__operator
 
-    def matvec(self,x):
+    def matvec(self,x,out=None):
 
         if len(x.shape) == 1:
             if x.shape[0] != self.shape[1]:
@@ -233,17 +233,25 @@ class RealOperator(object):
         res = self.__operator.matvec(x[:self.__operator_shape[1]]+1j*x[self.__operator_shape[1]:])
         
         if len(res.shape)==1:
-            return np.hstack([np.real(res),np.imag(res)])
+            result = np.hstack([np.real(res),np.imag(res)])
         else:
-            return np.vstack([np.real(res),np.imag(res)])
+            result = np.vstack([np.real(res),np.imag(res)])
+        if out is None:
+            return result
+        out[...] = result.reshape(out.shape)
+        return out
 
-    def matmat(self,x):
+    def matmat(self,x,out=None):
 
         if x.shape[0] != self.shape[1]:
             raise Exception("RealOperator.matmat: wrong dimension")
 
         res = self.__operator.matmat(x[:self.__operator_shape[1]]+1j*x[self.__operator_shape[1]:])
-        return np.vstack([np.real(res),np.imag(res)])
+        result = np.vstack([np.real(res),np.imag(res)])
+        if out is None:
+            return result
+        out[...] = result
+        return out
 
             
         
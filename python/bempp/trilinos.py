@@ -91,7 +91,10 @@ class PyTrilinosOperator(Epetra.Operator):
             if self.__comm.MyPID() == self.__pid:
                 xvec = x.ExtractView().T
                 yvec = y.ExtractView().T
-                if len(xvec.shape) == 1:
+                if yvec.dtype == self.__operator.dtype:
+                    # Write the result directly to the Epetra buffer
+                    self.__operator.matvec(xvec, out=yvec)
+                elif len(xvec.shape) == 1:
                     yvec[:] = self.__operator.matvec(xvec)
                 else:
                     yvec[:] = self.__operator.matmat(xvec)
@@ -169,7 +172,10 @@ class PyTrilinosInverseOperator(Epetra.Operator):
             if self.__comm.MyPID() == self.__pid:
                 xvec = x.ExtractView().T
                 yvec = y.ExtractView().T
-                if len(xvec.shape) == 1:
+                if yvec.dtype == self.__operator.dtype:
+                    # Write the result directly to the Epetra buffer
+                    self.__operator.matvec(xvec, out=yvec)
+                elif len(xvec.shape) == 1:
                     yvec[:] = self.__operator.matvec(xvec)
                 else:
                     yvec[:] = self.__operator.matmat(xvec)
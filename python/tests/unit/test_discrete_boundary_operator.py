@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Import the bempp module
+import sys
+sys.path.append("../..")
+import bempp
+import bempp.lib as lib
+
+import numpy as np
+import pytest
+import threading
+
+class TestDiscreteBoundaryOperatorProducts:
+    def setup_method(self, method):
+        np.random.seed(1)
+        self.mat = (np.random.rand(7, 5) +
+                    1j * np.random.rand(7, 5)).astype(np.complex128)
+        self.op = lib.discreteDenseBoundaryOperator(self.mat)
+
+    def test_matvec_agrees_with_numpy(self):
+        x = np.random.rand(5) + 1j * np.random.rand(5)
+        assert np.allclose(self.op.matvec(x), np.dot(self.mat, x))
+
+    def test_matvec_writes_to_out_and_returns_it(self):
+        x = np.random.rand(5) + 1j * np.random.rand(5)
+        out = np.empty(7, dtype=np.complex128)
+        result = self.op.matvec(x, out=out)
+        assert result is out
+        assert np.allclose(out, np.dot(self.mat, x))
+
+    def test_matmat_writes_to_fortran_out(self):
+        x = np.asfortranarray(np.random.rand(5, 3) + 1j * np.random.rand(5, 3))
+        out = np.empty((7, 3), dtype=np.complex128, order='F')
+        self.op.matmat(x, out=out)
+        assert np.allclose(out, np.dot(self.mat, x))
+
+    def test_matmat_agrees_with_numpy_for_c_ordered_input(self):
+        x = np.ascontiguousarray(np.random.rand(5, 3) + 1j * np.random.rand(5, 3))
+        assert np.allclose(self.op.matmat(x), np.dot(self.mat, x))
+
+    def test_rmatvec_agrees_with_numpy(self):
+        y = np.random.rand(7) + 1j * np.random.rand(7)
+        out = np.empty(5, dtype=np.complex128)
+        self.op.rmatvec(y, out=out)
+        assert np.allclose(out, np.dot(self.mat.conj().T, y))
+
+    def test_matmat_rejects_c_ordered_out(self):
+        x = np.asfortranarray(np.random.rand(5, 3) + 1j * np.random.rand(5, 3))
+        out = np.empty((7, 3), dtype=np.complex128)
+        pytest.raises(ValueError, self.op.matmat, x, out=out)
+
+    def test_matvec_rejects_out_of_wrong_dtype(self):
+        x = np.random.rand(5) + 1j * np.random.rand(5)
+        out = np.empty(7, dtype=np.float64)
+        pytest.raises(ValueError, self.op.matvec, x, out=out)
+
+    def test_concurrent_matvecs_agree_with_numpy(self):
+        xs = [np.random.rand(5) + 1j * np.random.rand(5) for i in range(4)]
+        outs = [np.empty(7, dtype=np.complex128) for i in range(4)]
+        def work(i):
+            for k in range(100):
+                self.op.matvec(xs[i], out=outs[i])
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for x, out in zip(xs, outs):
+            assert np.allclose(out, np.dot(self.mat, x))
@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Import the bempp module
+import sys
+sys.path.append("../..")
+import bempp
+import bempp.lib as lib
+
+import numpy as np
+import threading
+
+def evalFunction(point):
+    x, y, z = point
+    return np.sin(x) * np.cos(y) + z
+
+class TestGridFunctionFromPythonFunction:
+    def setup_method(self, method):
+        self.grid = bempp.GridFactory.createStructuredGrid(
+            "triangular", (0., 0.), (1., 2.), (12, 15))
+
+    def createGridFunction(self, maxThreadCount):
+        accuracyOptions = lib.createAccuracyOptions()
+        quadStrategy = lib.createNumericalQuadratureStrategy(
+            "float64", "float64", accuracyOptions)
+        assemblyOptions = lib.createAssemblyOptions()
+        assemblyOptions.setMaxThreadCount(maxThreadCount)
+        context = lib.createContext(quadStrategy, assemblyOptions)
+        space = lib.createPiecewiseConstantScalarSpace(context, self.grid)
+        return lib.createGridFunction(context, space, space, evalFunction)
+
+    def createGridFunctionWithTimeout(self, maxThreadCount):
+        # The projections are calculated in a separate thread so that a
+        # deadlock on the global interpreter lock makes the test fail instead
+        # of hanging
+        result = []
+        worker = threading.Thread(
+            target=lambda: result.append(self.createGridFunction(maxThreadCount)))
+        worker.daemon = True
+        worker.start()
+        worker.join(60.)
+        assert not worker.is_alive(), "projection of a Python function deadlocked"
+        assert len(result) == 1
+        return result[0]
+
+    def test_multithreaded_projections_agree_with_single_threaded_ones(self):
+        serial = self.createGridFunctionWithTimeout(1)
+        parallel = self.createGridFunctionWithTimeout(4)
+        assert np.allclose(parallel.projections(), serial.projections())
+
@@ -0,0 +1,100 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_potential_evaluation_fixture_hpp
+#define bempp_potential_evaluation_fixture_hpp
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/surface_normal_independent_function.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include <cmath>
+
+// Points scattered over the shell minRadius <= |x| <= maxRadius along the
+// golden-angle spiral; they lie on a sphere if both radii are equal
+template <typename CoordinateType>
+arma::Mat<CoordinateType> goldenAnglePoints(int pointCount,
+                                            CoordinateType minRadius,
+                                            CoordinateType maxRadius)
+{
+    arma::Mat<CoordinateType> points(3, pointCount);
+    const CoordinateType goldenAngle = M_PI * (3. - std::sqrt(5.));
+    for (int i = 0; i < pointCount; ++i) {
+        CoordinateType z = 1. - (2. * i + 1.) / pointCount;
+        CoordinateType rho = std::sqrt(1. - z * z);
+        CoordinateType phi = goldenAngle * i;
+        CoordinateType radius =
+            minRadius + (maxRadius - minRadius) * ((i * 7) % 11) / 10.;
+        points(0, i) = radius * rho * std::cos(phi);
+        points(1, i) = radius * rho * std::sin(phi);
+        points(2, i) = radius * z;
+    }
+    return points;
+}
+
+// Grid function defined on the mesh of the unit sphere, whose potentials
+// are evaluated by the tests
+template <typename BFT, typename RT>
+struct PotentialEvaluationFixture
+{
+    explicit PotentialEvaluationFixture(const Bempp::AccuracyOptions& accuracyOptions)
+    {
+        Bempp::GridParameters params;
+        params.topology = Bempp::GridParameters::TRIANGULAR;
+        grid = Bempp::GridFactory::importGmshGrid(
+            params, "../../examples/meshes/sphere-h-0.2.msh",
+            false /* verbose */);
+
+        quadStrategy.reset(
+            new Bempp::NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+        Bempp::AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(Bempp::VerbosityLevel::LOW);
+        context.reset(
+            new Bempp::Context<BFT, RT>(quadStrategy, assemblyOptions));
+    }
+
+    // Expand 'function' in the space 'space_' (used both as the primal and
+    // the dual space)
+    template <typename Function>
+    void setGridFunction(const Bempp::shared_ptr<Bempp::Space<BFT> >& space_,
+                         const Function& function)
+    {
+        space = space_;
+        fun.reset(new Bempp::GridFunction<BFT, RT>(
+                      context, space, space,
+                      Bempp::surfaceNormalIndependentFunction(function)));
+    }
+
+    Bempp::shared_ptr<Bempp::Grid> grid;
+    Bempp::shared_ptr<Bempp::NumericalQuadratureStrategy<BFT, RT> > quadStrategy;
+    Bempp::shared_ptr<Bempp::Context<BFT, RT> > context;
+    Bempp::shared_ptr<Bempp::Space<BFT> > space;
+    Bempp::shared_ptr<Bempp::GridFunction<BFT, RT> > fun;
+};
+
+#endif
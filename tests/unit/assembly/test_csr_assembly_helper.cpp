@@ -0,0 +1,213 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "assembly/csr_assembly_helper.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <armadillo>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WITH_TRILINOS
+#include <Epetra_CrsMatrix.h>
+#endif
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+// Chain of elementCount elements. Element e carries test DOFs 2e, 2e + 1 and
+// 2e + 2 and trial DOFs e and e + 1, so that neighbouring elements share DOFs.
+// The last local test DOF of every third element is not associated with any
+// global DOF.
+template <typename ValueType>
+struct ElementChain
+{
+    explicit ElementChain(size_t elementCount) :
+        testGlobalDofs(elementCount), trialGlobalDofs(elementCount),
+        testLocalDofWeights(elementCount), trialLocalDofWeights(elementCount),
+        localWeakForms(elementCount),
+        testGlobalDofCount(2 * elementCount + 1),
+        trialGlobalDofCount(elementCount + 1)
+    {
+        for (size_t e = 0; e < elementCount; ++e) {
+            for (int i = 0; i < 3; ++i) {
+                testGlobalDofs[e].push_back(
+                            (e % 3 == 0 && i == 2) ? -1 : int(2 * e + i));
+                testLocalDofWeights[e].push_back(i % 2 ? -1. : 1.);
+            }
+            for (int j = 0; j < 2; ++j) {
+                trialGlobalDofs[e].push_back(e + j);
+                trialLocalDofWeights[e].push_back(1. + 0.5 * j);
+            }
+            localWeakForms[e].set_size(3, 2);
+            for (int j = 0; j < 2; ++j)
+                for (int i = 0; i < 3; ++i)
+                    localWeakForms[e](i, j) = static_cast<ValueType>(
+                                1. + i + 3 * j + 0.01 * e);
+        }
+    }
+
+    arma::Mat<ValueType> denseMatrix() const {
+        arma::Mat<ValueType> result(testGlobalDofCount, trialGlobalDofCount);
+        result.fill(0.);
+        for (size_t e = 0; e < testGlobalDofs.size(); ++e)
+            for (size_t j = 0; j < trialGlobalDofs[e].size(); ++j)
+                for (size_t i = 0; i < testGlobalDofs[e].size(); ++i)
+                    if (testGlobalDofs[e][i] >= 0)
+                        result(testGlobalDofs[e][i], trialGlobalDofs[e][j]) +=
+                                testLocalDofWeights[e][i] *
+                                trialLocalDofWeights[e][j] *
+                                localWeakForms[e](i, j);
+        return result;
+    }
+
+    void assemble(int maxThreadCount,
+                  std::vector<size_t>& rowOffsets,
+                  std::vector<int>& columnIndices,
+                  std::vector<ValueType>& values) const {
+        ParallelizationOptions options;
+        options.setMaxThreadCount(maxThreadCount);
+        CsrAssemblyHelper<ValueType, ValueType>::assembleFromLocalWeakForms(
+                    testGlobalDofs, trialGlobalDofs,
+                    testLocalDofWeights, trialLocalDofWeights,
+                    localWeakForms, testGlobalDofCount, options,
+                    rowOffsets, columnIndices, values);
+    }
+
+    std::vector<std::vector<int> > testGlobalDofs, trialGlobalDofs;
+    std::vector<std::vector<ValueType> > testLocalDofWeights, trialLocalDofWeights;
+    std::vector<arma::Mat<ValueType> > localWeakForms;
+    size_t testGlobalDofCount, trialGlobalDofCount;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(CsrAssemblyHelper)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(assembled_matrix_agrees_with_dense_assembly,
+                              ValueType, real_numeric_types)
+{
+    ElementChain<ValueType> chain(100);
+    std::vector<size_t> rowOffsets;
+    std::vector<int> columnIndices;
+    std::vector<ValueType> values;
+    chain.assemble(4, rowOffsets, columnIndices, values);
+
+    BOOST_REQUIRE_EQUAL(rowOffsets.size(), chain.testGlobalDofCount + 1);
+    BOOST_REQUIRE_EQUAL(columnIndices.size(), rowOffsets.back());
+    BOOST_REQUIRE_EQUAL(values.size(), rowOffsets.back());
+
+    arma::Mat<ValueType> expected = chain.denseMatrix();
+    arma::Mat<ValueType> actual(chain.testGlobalDofCount,
+                                chain.trialGlobalDofCount);
+    actual.fill(0.);
+    for (size_t row = 0; row < chain.testGlobalDofCount; ++row) {
+        // Columns must be sorted and unique
+        for (size_t i = rowOffsets[row] + 1; i < rowOffsets[row + 1]; ++i)
+            BOOST_CHECK_LT(columnIndices[i - 1], columnIndices[i]);
+        for (size_t i = rowOffsets[row]; i < rowOffsets[row + 1]; ++i)
+            actual(row, columnIndices[i]) = values[i];
+    }
+
+    const double tol = 100. * std::numeric_limits<ValueType>::epsilon();
+    for (size_t j = 0; j < chain.trialGlobalDofCount; ++j)
+        for (size_t i = 0; i < chain.testGlobalDofCount; ++i)
+            BOOST_CHECK_SMALL(actual(i, j) - expected(i, j),
+                              static_cast<ValueType>(tol));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(sparsity_pattern_contains_only_coupled_dofs,
+                              ValueType, real_numeric_types)
+{
+    ElementChain<ValueType> chain(10);
+    std::vector<size_t> rowOffsets;
+    std::vector<int> columnIndices;
+    std::vector<ValueType> values;
+    chain.assemble(1, rowOffsets, columnIndices, values);
+
+    // Test DOF 2e + 1 lies only on element e; test DOF 2e (0 < e < 10) is
+    // shared by elements e - 1 and e, unless e - 1 is a multiple of 3
+    BOOST_CHECK_EQUAL(rowOffsets[2] - rowOffsets[1], 2u);
+    BOOST_CHECK_EQUAL(rowOffsets[3] - rowOffsets[2], 2u); // element 0 has no DOF 2
+    BOOST_CHECK_EQUAL(rowOffsets[5] - rowOffsets[4], 3u);
+    BOOST_CHECK_EQUAL(rowOffsets[4] - rowOffsets[3], 2u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(result_does_not_depend_on_thread_count,
+                              ValueType, real_numeric_types)
+{
+    ElementChain<ValueType> chain(1000);
+    std::vector<size_t> serialRowOffsets, parallelRowOffsets;
+    std::vector<int> serialColumnIndices, parallelColumnIndices;
+    std::vector<ValueType> serialValues, parallelValues;
+    chain.assemble(1, serialRowOffsets, serialColumnIndices, serialValues);
+    chain.assemble(4, parallelRowOffsets, parallelColumnIndices, parallelValues);
+
+    BOOST_CHECK(serialRowOffsets == parallelRowOffsets);
+    BOOST_CHECK(serialColumnIndices == parallelColumnIndices);
+    BOOST_CHECK(serialValues == parallelValues);
+}
+
+#ifdef WITH_TRILINOS
+BOOST_AUTO_TEST_CASE_TEMPLATE(createEpetraCrsMatrix_accepts_complex_matrix_with_real_entries,
+                              ValueType, complex_result_types)
+{
+    std::vector<size_t> rowOffsets(3);
+    rowOffsets[0] = 0; rowOffsets[1] = 1; rowOffsets[2] = 2;
+    std::vector<int> columnIndices(2);
+    columnIndices[0] = 1; columnIndices[1] = 0;
+    std::vector<ValueType> values(2);
+    values[0] = ValueType(2.); values[1] = ValueType(-3.);
+
+    shared_ptr<Epetra_CrsMatrix> mat = createEpetraCrsMatrix(
+                2, 2, rowOffsets, columnIndices, values);
+    BOOST_CHECK_EQUAL(mat->NumGlobalNonzeros(), 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(createEpetraCrsMatrix_throws_for_nonzero_imaginary_parts,
+                              ValueType, complex_result_types)
+{
+    std::vector<size_t> rowOffsets(3);
+    rowOffsets[0] = 0; rowOffsets[1] = 1; rowOffsets[2] = 2;
+    std::vector<int> columnIndices(2);
+    columnIndices[0] = 1; columnIndices[1] = 0;
+    std::vector<ValueType> values(2);
+    values[0] = ValueType(2.); values[1] = ValueType(-3., 1.);
+
+    BOOST_CHECK_THROW(createEpetraCrsMatrix(2, 2, rowOffsets, columnIndices,
+                                            values),
+                      std::invalid_argument);
+}
+#endif // WITH_TRILINOS
+
+BOOST_AUTO_TEST_SUITE_END()
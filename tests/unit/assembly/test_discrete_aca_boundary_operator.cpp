@@ -35,6 +35,7 @@
 #include "assembly/context.hpp"
 #include "assembly/identity_operator.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/out_of_core_mblock_store.hpp"
 
 #include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
 #include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
@@ -73,7 +74,14 @@ template <> std::complex<double> initWaveNumber()
 template <typename BFT, typename RT>
 struct DiscreteAcaBoundaryOperatorFixture
 {
-    DiscreteAcaBoundaryOperatorFixture()
+    // Small enough for the mblocks of an operator stored out of core to be
+    // evicted from memory during each matrix-vector product
+    enum { OUT_OF_CORE_MEMORY_BUDGET = 1024 };
+
+    explicit DiscreteAcaBoundaryOperatorFixture(
+            bool outOfCore = false,
+            AcaOptions::StoragePrecision storagePrecision =
+                AcaOptions::FULL_PRECISION)
     {
         grid = createRegularTriangularGrid(4, 7);
 
@@ -86,6 +94,9 @@ struct DiscreteAcaBoundaryOperatorFixture
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
         AcaOptions acaOptions;
         acaOptions.minimumBlockSize = 2;
+        acaOptions.outOfCore = outOfCore;
+        acaOptions.outOfCoreMemoryBudget = OUT_OF_CORE_MEMORY_BUDGET;
+        acaOptions.storagePrecision = storagePrecision;
         assemblyOptions.switchToAcaMode(acaOptions);
         AccuracyOptions accuracyOptions;
         accuracyOptions.doubleRegular.setRelativeQuadratureOrder(4);
@@ -109,7 +120,11 @@ struct DiscreteAcaBoundaryOperatorFixture
 template <typename BFT, typename RT>
 struct DiscreteRealSymmetricAcaBoundaryOperatorFixture
 {
-    DiscreteRealSymmetricAcaBoundaryOperatorFixture()
+    // Small enough for the mblocks of an operator stored out of core to be
+    // evicted from memory during each matrix-vector product
+    enum { OUT_OF_CORE_MEMORY_BUDGET = 1024 };
+
+    explicit DiscreteRealSymmetricAcaBoundaryOperatorFixture(bool outOfCore = false)
     {
         grid = createRegularTriangularGrid(4, 7);
 
@@ -120,6 +135,8 @@ struct DiscreteRealSymmetricAcaBoundaryOperatorFixture
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
         AcaOptions acaOptions;
         acaOptions.minimumBlockSize = 2;
+        acaOptions.outOfCore = outOfCore;
+        acaOptions.outOfCoreMemoryBudget = OUT_OF_CORE_MEMORY_BUDGET;
         assemblyOptions.switchToAcaMode(acaOptions);
         AccuracyOptions accuracyOptions;
         accuracyOptions.doubleRegular.setRelativeQuadratureOrder(4);
@@ -389,6 +406,38 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(repeated_builtin_apply_works_correctly_for_alternating_transposition_modes, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(0.);
+
+    arma::Col<RT> x = generateRandomVector<RT>(dop->columnCount());
+    arma::Col<RT> xt = generateRandomVector<RT>(dop->rowCount());
+    arma::Col<RT> y(dop->rowCount());
+    arma::Col<RT> yt(dop->columnCount());
+
+    arma::Col<RT> expected = alpha * dop->asMatrix() * x;
+    arma::Col<RT> expectedt = alpha * dop->asMatrix().t() * xt;
+
+    for (int i = 0; i < 3; ++i) {
+        dop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+        BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+        dop->apply(CONJUGATE_TRANSPOSE, xt, yt, alpha, beta);
+        BOOST_CHECK(check_arrays_are_close<RT>(yt, expectedt,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2_and_beta_equal_to_3_and_real_symmetric_operator, ResultType, result_types)
 {
     if (boost::is_same<ResultType, std::complex<float> >())
@@ -563,6 +612,153 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and_alpha_equal_to_2_and_beta_equal_to_3, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const int rhsCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+
+    arma::Mat<RT> expected = alpha * dop->asMatrix() * x + beta * y;
+
+    dop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and_alpha_equal_to_2_plus_3j_and_beta_equal_to_4_minus_5j_and_conjugate_transpose, ResultType, complex_result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    std::complex<double> tempa(2.,3.);
+    RT alpha = static_cast<RT>(tempa);
+    std::complex<double> tempb(4.,-5.);
+    RT beta = static_cast<RT>(tempb);
+
+    const int rhsCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+
+    arma::Mat<RT> expected = alpha * dop->asMatrix().t() * x + beta * y;
+
+    dop->apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and_alpha_equal_to_2_plus_3j_and_beta_equal_to_4_minus_5j_and_transpose, ResultType, complex_result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    std::complex<double> tempa(2.,3.);
+    RT alpha = static_cast<RT>(tempa);
+    std::complex<double> tempb(4.,-5.);
+    RT beta = static_cast<RT>(tempb);
+
+    const int rhsCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+
+    arma::Mat<RT> expected = alpha * dop->asMatrix().st() * x + beta * y;
+
+    dop->apply(TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and_alpha_equal_to_2_and_beta_equal_to_3_and_real_symmetric_operator, ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteRealSymmetricAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const int rhsCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+
+    arma::Mat<RT> expected = alpha * dop->asMatrix() * x + beta * y;
+
+    dop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and_alpha_equal_to_2_and_beta_equal_to_3_and_conjugate_transpose_and_complex_symmetric_operator,
+                              ResultType, complex_result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteComplexSymmetricAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const int rhsCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+
+    // .t() gives conjugate transpose for complex matrices
+    arma::Mat<RT> expected = alpha * dop->asMatrix().t() * x + beta * y;
+
+    dop->apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(acaOperatorSum_works_correctly_for_nonsymmetric_operators, ResultType, result_types)
 {
     typedef ResultType RT;
@@ -915,6 +1111,317 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(scaledAcaOperator_works_correctly_for_complex_symm
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(recompress_reduces_memory_usage_and_preserves_matrix_to_within_eps,
+                              ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(10, 3);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AcaOptions acaOptions;
+    acaOptions.minimumBlockSize = 2;
+    // Assemble much more accurately than the recompression tolerance below,
+    // so that recompression is guaranteed to lower some block ranks
+    acaOptions.eps = 1e-6;
+    assemblyOptions.switchToAcaMode(acaOptions);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const RT waveNumber = initWaveNumber<RT>();
+
+    BoundaryOperator<BFT, RT> op =
+            modifiedHelmholtz3dSingleLayerBoundaryOperator<BFT, RT, RT>(
+        context, pwiseConstants, pwiseConstants, pwiseLinears, waveNumber);
+    shared_ptr<DiscreteAcaBoundaryOperator<RT> > acaOp =
+            boost::const_pointer_cast<DiscreteAcaBoundaryOperator<RT> >(
+                DiscreteAcaBoundaryOperator<RT>::castToAca(op.weakForm()));
+    op = BoundaryOperator<BFT, RT>(); // release the block cluster tree
+
+    arma::Mat<RT> expected = acaOp->asMatrix();
+    const size_t memoryBefore = acaOp->memoryUsage();
+
+    const CT eps = 1e-3;
+    acaOp->recompress(eps);
+
+    BOOST_CHECK(acaOp->memoryUsage() < memoryBefore);
+    BOOST_CHECK(check_arrays_are_close<RT>(acaOp->asMatrix(), expected,
+                                           10. * eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(recompress_throws_if_agglomeration_of_shared_block_cluster_tree_is_requested,
+                              ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    shared_ptr<DiscreteAcaBoundaryOperator<RT> > scaled =
+            boost::const_pointer_cast<DiscreteAcaBoundaryOperator<RT> >(
+                DiscreteAcaBoundaryOperator<RT>::castToAca(
+                    scaledAcaOperator(dop, static_cast<RT>(2.))));
+
+    BOOST_CHECK_THROW(scaled->recompress(), std::runtime_error);
+
+    // Truncation alone does not modify the tree
+    arma::Mat<RT> expected = scaled->asMatrix();
+    scaled->recompress(-1., -1, false /* agglomerate */);
+    BOOST_CHECK(check_arrays_are_close<RT>(scaled->asMatrix(), expected,
+                                           CT(10. * scaled->eps())));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_after_recompression,
+                              ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(10, 3);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AcaOptions acaOptions;
+    acaOptions.minimumBlockSize = 2;
+    assemblyOptions.switchToAcaMode(acaOptions);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const RT waveNumber = initWaveNumber<RT>();
+
+    BoundaryOperator<BFT, RT> op =
+            modifiedHelmholtz3dSingleLayerBoundaryOperator<BFT, RT, RT>(
+        context, pwiseConstants, pwiseConstants, pwiseLinears, waveNumber);
+    shared_ptr<DiscreteAcaBoundaryOperator<RT> > acaOp =
+            boost::const_pointer_cast<DiscreteAcaBoundaryOperator<RT> >(
+                DiscreteAcaBoundaryOperator<RT>::castToAca(op.weakForm()));
+
+    const int rhsCount = 3;
+    arma::Mat<RT> x = generateRandomMatrix<RT>(acaOp->columnCount(), rhsCount);
+    arma::Mat<RT> y(acaOp->rowCount(), rhsCount);
+
+    // Apply the operator before recompression, so that the matrix-vector
+    // product schedule is built for the original block ranks
+    acaOp->apply(NO_TRANSPOSE, x, y, static_cast<RT>(1.), static_cast<RT>(0.));
+
+    // Truncation changes the ranks of the blocks, but not the tree
+    acaOp->recompress(1e-3, -1, false /* agglomerate */);
+
+    arma::Mat<RT> expected = acaOp->asMatrix() * x;
+    acaOp->apply(NO_TRANSPOSE, x, y, static_cast<RT>(1.), static_cast<RT>(0.));
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    y, expected, 100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(out_of_core_apply_agrees_with_in_core_apply_for_matrix_input,
+                              ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> inCoreFixture;
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> outOfCoreFixture(true);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > inCoreDop =
+            inCoreFixture.op.weakForm();
+    shared_ptr<const DiscreteBoundaryOperator<RT> > outOfCoreDop =
+            outOfCoreFixture.op.weakForm();
+    BOOST_CHECK(DiscreteAcaBoundaryOperator<RT>::castToAca(
+                    outOfCoreDop)->isOutOfCore());
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const int rhsCount = 3;
+    const TranspositionMode modes[] = {
+        NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE, NO_TRANSPOSE
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+        const bool transposed = (modes[i] != NO_TRANSPOSE);
+        const size_t xRowCount = transposed ? inCoreDop->rowCount()
+                                            : inCoreDop->columnCount();
+        const size_t yRowCount = transposed ? inCoreDop->columnCount()
+                                            : inCoreDop->rowCount();
+        arma::Mat<RT> x = generateRandomMatrix<RT>(xRowCount, rhsCount);
+        arma::Mat<RT> y = generateRandomMatrix<RT>(yRowCount, rhsCount);
+        arma::Mat<RT> expected = y;
+
+        inCoreDop->apply(modes[i], x, expected, alpha, beta);
+        outOfCoreDop->apply(modes[i], x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        y, expected, 10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(out_of_core_operator_stays_within_memory_budget,
+                              ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+    typedef DiscreteAcaBoundaryOperatorFixture<BFT, RT> Fixture;
+
+    Fixture inCoreFixture;
+    Fixture outOfCoreFixture(true);
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > inCoreAcaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                inCoreFixture.op.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > outOfCoreAcaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                outOfCoreFixture.op.weakForm());
+
+    arma::Col<RT> x = generateRandomVector<RT>(outOfCoreAcaOp->columnCount());
+    arma::Col<RT> y(outOfCoreAcaOp->rowCount());
+    outOfCoreAcaOp->apply(NO_TRANSPOSE, x, y,
+                          static_cast<RT>(1.), static_cast<RT>(0.));
+
+    BOOST_CHECK(outOfCoreAcaOp->outOfCoreStore()->residentBytes() <=
+                size_t(Fixture::OUT_OF_CORE_MEMORY_BUDGET));
+    BOOST_CHECK_EQUAL(outOfCoreAcaOp->actualMaximumRank(),
+                      inCoreAcaOp->actualMaximumRank());
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    outOfCoreAcaOp->asMatrix(), inCoreAcaOp->asMatrix(),
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(out_of_core_storage_of_symmetric_operator_produces_general_h_matrix,
+                              ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteRealSymmetricAcaBoundaryOperatorFixture<BFT, RT> inCoreFixture;
+    DiscreteRealSymmetricAcaBoundaryOperatorFixture<BFT, RT>
+            outOfCoreFixture(true);
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > outOfCoreAcaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                outOfCoreFixture.op.weakForm());
+
+    BOOST_CHECK(outOfCoreAcaOp->isOutOfCore());
+    BOOST_CHECK_EQUAL(outOfCoreAcaOp->symmetry(), int(NO_SYMMETRY));
+    const CT eps = outOfCoreAcaOp->eps();
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    outOfCoreAcaOp->asMatrix(),
+                    inCoreFixture.op.weakForm()->asMatrix(), 10. * eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(mixed_precision_apply_agrees_with_full_precision_apply_for_matrix_input,
+                              ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef DiscreteAcaBoundaryOperatorFixture<BFT, RT> Fixture;
+
+    Fixture fullPrecisionFixture;
+    Fixture mixedPrecisionFixture(false, AcaOptions::SINGLE_PRECISION_ALL_BLOCKS);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > fullPrecisionDop =
+            fullPrecisionFixture.op.weakForm();
+    shared_ptr<const DiscreteBoundaryOperator<RT> > mixedPrecisionDop =
+            mixedPrecisionFixture.op.weakForm();
+    // Single-precision operators are never converted
+    BOOST_CHECK_EQUAL(DiscreteAcaBoundaryOperator<RT>::castToAca(
+                          mixedPrecisionDop)->isMixedPrecision(),
+                      sizeof(BFT) == sizeof(double));
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const int rhsCount = 3;
+    const TranspositionMode modes[] = {
+        NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+        const bool transposed = (modes[i] != NO_TRANSPOSE);
+        const size_t xRowCount = transposed ? fullPrecisionDop->rowCount()
+                                            : fullPrecisionDop->columnCount();
+        const size_t yRowCount = transposed ? fullPrecisionDop->columnCount()
+                                            : fullPrecisionDop->rowCount();
+        arma::Mat<RT> x = generateRandomMatrix<RT>(xRowCount, rhsCount);
+        arma::Mat<RT> y = generateRandomMatrix<RT>(yRowCount, rhsCount);
+        arma::Mat<RT> expected = y;
+
+        fullPrecisionDop->apply(modes[i], x, expected, alpha, beta);
+        mixedPrecisionDop->apply(modes[i], x, y, alpha, beta);
+
+        // The rounding of the mblocks to single precision is the only source
+        // of discrepancies
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        y, expected, 100. * std::numeric_limits<float>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(mixed_precision_storage_reduces_memory_usage,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef DiscreteAcaBoundaryOperatorFixture<BFT, RT> Fixture;
+    if (sizeof(BFT) != sizeof(double))
+        return; // single-precision operators are never converted
+
+    Fixture fullPrecisionFixture;
+    Fixture lowRankFixture(false, AcaOptions::SINGLE_PRECISION_LOW_RANK_BLOCKS);
+    Fixture allBlocksFixture(false, AcaOptions::SINGLE_PRECISION_ALL_BLOCKS);
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > fullPrecisionOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                fullPrecisionFixture.op.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > lowRankOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                lowRankFixture.op.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > allBlocksOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(
+                allBlocksFixture.op.weakForm());
+
+    BOOST_CHECK(allBlocksOp->memoryUsage() <= lowRankOp->memoryUsage());
+    BOOST_CHECK(lowRankOp->memoryUsage() <= fullPrecisionOp->memoryUsage());
+    BOOST_CHECK(2 * allBlocksOp->memoryUsage() <= fullPrecisionOp->memoryUsage());
+    BOOST_CHECK_EQUAL(allBlocksOp->actualMaximumRank(),
+                      fullPrecisionOp->actualMaximumRank());
+    BOOST_CHECK_EQUAL(allBlocksOp->symmetry(), int(NO_SYMMETRY));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // WITH_AHMED
@@ -317,4 +317,73 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+// Apply in the other transposition modes
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_transpose_and_alpha_equal_to_2_plus_3j_and_beta_equal_to_4_minus_5j, ResultType, complex_result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteDenseBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    std::complex<double> tempa(2.,3.);
+    RT alpha = static_cast<RT>(tempa);
+    std::complex<double> tempb(4.,-5.);
+    RT beta = static_cast<RT>(tempb);
+
+    const int rhsCount = 3;
+    arma::Mat<RT> mat = dop->asMatrix();
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), rhsCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+    arma::Mat<RT> expected = alpha * mat.st() * x + beta * y;
+    dop->apply(TRANSPOSE, x, y, alpha, beta);
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+
+    y = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+    expected = alpha * mat.t() * x + beta * y;
+    dop->apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_conjugate_and_alpha_equal_to_2_plus_3j_and_beta_equal_to_4_minus_5j, ResultType, complex_result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteDenseBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    std::complex<double> tempa(2.,3.);
+    RT alpha = static_cast<RT>(tempa);
+    std::complex<double> tempb(4.,-5.);
+    RT beta = static_cast<RT>(tempb);
+
+    arma::Col<RT> x = generateRandomVector<RT>(dop->columnCount());
+    arma::Col<RT> y = generateRandomVector<RT>(dop->rowCount());
+    arma::Col<RT> expected = alpha * arma::conj(dop->asMatrix()) * x + beta * y;
+    dop->apply(CONJUGATE, x, y, alpha, beta);
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+
+    const int rhsCount = 3;
+    arma::Mat<RT> xs = generateRandomMatrix<RT>(dop->columnCount(), rhsCount);
+    arma::Mat<RT> ys(dop->rowCount(), rhsCount);
+    ys.fill(std::numeric_limits<CT>::quiet_NaN());
+    arma::Mat<RT> expectedMat = alpha * arma::conj(dop->asMatrix()) * xs;
+    dop->apply(CONJUGATE, xs, ys, alpha, static_cast<RT>(0.));
+    BOOST_CHECK(ys.is_finite());
+    BOOST_CHECK(check_arrays_are_close<RT>(ys, expectedMat,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
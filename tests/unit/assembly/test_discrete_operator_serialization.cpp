@@ -0,0 +1,211 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_ahmed.hpp"
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "../random_arrays.hpp"
+
+#include "create_regular_grid.hpp"
+
+#include "assembly/aca_options.hpp"
+#include "assembly/discrete_dense_boundary_operator.hpp"
+#include "assembly/discrete_operator_serialization.hpp"
+#include "assembly/weak_form_cache_key.hpp"
+
+#ifdef WITH_AHMED
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_aca_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "grid/grid.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+#endif
+
+#include "common/armadillo_fwd.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+const char FILE_NAME[] = "test_discrete_operator_serialization.bin";
+
+template <typename ValueType>
+bool areIdentical(const arma::Mat<ValueType>& a, const arma::Mat<ValueType>& b)
+{
+    if (a.n_rows != b.n_rows || a.n_cols != b.n_cols)
+        return false;
+    for (size_t i = 0; i < a.n_elem; ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DiscreteOperatorSerialization)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(dense_operator_is_restored_exactly,
+                              ValueType, result_types)
+{
+    std::srand(1);
+    arma::Mat<ValueType> mat = generateRandomMatrix<ValueType>(7, 5);
+    DiscreteDenseBoundaryOperator<ValueType> op(mat);
+
+    saveDiscreteDenseBoundaryOperator(op, FILE_NAME);
+    std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> > loadedOp =
+            loadDiscreteDenseBoundaryOperator<ValueType>(FILE_NAME);
+    std::remove(FILE_NAME);
+
+    BOOST_CHECK_EQUAL(loadedOp->rowCount(), 7u);
+    BOOST_CHECK_EQUAL(loadedOp->columnCount(), 5u);
+    BOOST_CHECK(areIdentical(loadedOp->asMatrix(), mat));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(cached_dense_operator_is_loaded_only_with_matching_key,
+                              ValueType, result_types)
+{
+    std::srand(1);
+    arma::Mat<ValueType> mat = generateRandomMatrix<ValueType>(4, 6);
+    DiscreteDenseBoundaryOperator<ValueType> op(mat);
+
+    WeakFormCacheKey key, otherKey;
+    key.add(1);
+    otherKey.add(2);
+    saveCachedDiscreteDenseBoundaryOperator(op, FILE_NAME, key.contents());
+    std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> > loadedOp =
+            loadCachedDiscreteDenseBoundaryOperator<ValueType>(
+                FILE_NAME, key.contents());
+    std::auto_ptr<DiscreteDenseBoundaryOperator<ValueType> > otherOp =
+            loadCachedDiscreteDenseBoundaryOperator<ValueType>(
+                FILE_NAME, otherKey.contents());
+    std::remove(FILE_NAME);
+
+    BOOST_REQUIRE(loadedOp.get());
+    BOOST_CHECK(areIdentical(loadedOp->asMatrix(), mat));
+    BOOST_CHECK(!otherOp.get());
+    BOOST_CHECK(!loadCachedDiscreteDenseBoundaryOperator<ValueType>(
+                    FILE_NAME, key.contents()).get());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(loading_a_file_of_another_format_throws,
+                              ValueType, result_types)
+{
+    {
+        std::ofstream file(FILE_NAME);
+        file << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n";
+    }
+    BOOST_CHECK_THROW(loadDiscreteDenseBoundaryOperator<ValueType>(FILE_NAME),
+                      std::runtime_error);
+    std::remove(FILE_NAME);
+}
+
+BOOST_AUTO_TEST_CASE(cache_key_depends_on_contents_only)
+{
+    std::vector<double> values(10, 1.);
+    WeakFormCacheKey key1, key2;
+    key1.add(values);
+    key2.add(values);
+    BOOST_CHECK_EQUAL(key1.toString(), key2.toString());
+    BOOST_CHECK_EQUAL(key1.toString().size(), 16u);
+    BOOST_CHECK_EQUAL(key1.fileName("cache", "dense"),
+                      "cache/" + key1.toString() + ".dense");
+
+    values[9] = 2.;
+    WeakFormCacheKey key3;
+    key3.add(values);
+    BOOST_CHECK(key1.toString() != key3.toString());
+    BOOST_CHECK(key1.contents() == key2.contents());
+    BOOST_CHECK(key1.contents() != key3.contents());
+}
+
+BOOST_AUTO_TEST_CASE(cache_key_depends_on_result_type_and_all_aca_options)
+{
+    WeakFormCacheKey floatKey, doubleKey;
+    floatKey.addType<float>();
+    doubleKey.addType<double>();
+    BOOST_CHECK(floatKey.toString() != doubleKey.toString());
+
+    AcaOptions acaOptions;
+    WeakFormCacheKey key1;
+    key1.addAcaOptions(acaOptions);
+    acaOptions.globalAssemblyBeforeCompression =
+            !acaOptions.globalAssemblyBeforeCompression;
+    WeakFormCacheKey key2;
+    key2.addAcaOptions(acaOptions);
+    acaOptions.firstClusterIndex = 3;
+    WeakFormCacheKey key3;
+    key3.addAcaOptions(acaOptions);
+    BOOST_CHECK(key1.toString() != key2.toString());
+    BOOST_CHECK(key2.toString() != key3.toString());
+}
+
+#ifdef WITH_AHMED
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(aca_operator_is_restored_exactly,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType BFT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(16, 16);
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AcaOptions acaOptions;
+    acaOptions.minimumBlockSize = 4;
+    assemblyOptions.switchToAcaMode(acaOptions);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    BoundaryOperator<BFT, RT> op = laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, pwiseConstants, pwiseConstants, pwiseConstants);
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > acaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(op.weakForm());
+
+    saveDiscreteAcaBoundaryOperator(*acaOp, FILE_NAME);
+    std::auto_ptr<DiscreteAcaBoundaryOperator<RT> > loadedOp =
+            loadDiscreteAcaBoundaryOperator<RT>(FILE_NAME, acaOp->blockCluster());
+    std::remove(FILE_NAME);
+
+    BOOST_CHECK_EQUAL(loadedOp->rowCount(), acaOp->rowCount());
+    BOOST_CHECK_EQUAL(loadedOp->columnCount(), acaOp->columnCount());
+    BOOST_CHECK_EQUAL(loadedOp->symmetry(), acaOp->symmetry());
+    BOOST_CHECK(loadedOp->domainPermutation() == acaOp->domainPermutation());
+    BOOST_CHECK(loadedOp->rangePermutation() == acaOp->rangePermutation());
+    BOOST_CHECK(areIdentical(loadedOp->asMatrix(), acaOp->asMatrix()));
+}
+
+#endif // WITH_AHMED
+
+BOOST_AUTO_TEST_SUITE_END()
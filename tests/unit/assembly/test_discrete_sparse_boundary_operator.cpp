@@ -28,11 +28,15 @@
 #include "assembly/discrete_boundary_operator.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
+#include "assembly/csr_matrix.hpp"
+#include "assembly/discrete_sparse_boundary_operator.hpp"
 #include "assembly/identity_operator.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
 
 #include "bempp/common/config_ahmed.hpp"
 
+#include "fiber/parallelization_options.hpp"
+
 #include "grid/grid.hpp"
 
 #include "space/piecewise_linear_continuous_scalar_space.hpp"
@@ -56,7 +60,8 @@ template <typename BFT, typename RT>
 struct DiscreteSparseBoundaryOperatorFixture
 {
     DiscreteSparseBoundaryOperatorFixture(
-            bool acaMode = false, int nElementsX = 3, int nElementsY = 4)
+            bool acaMode = false, int nElementsX = 3, int nElementsY = 4,
+            bool sparseMode = true)
     {
         grid = createRegularTriangularGrid(nElementsX, nElementsY);
 
@@ -67,6 +72,7 @@ struct DiscreteSparseBoundaryOperatorFixture
 
         AssemblyOptions assemblyOptions;
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.enableSparseStorageOfLocalOperators(sparseMode);
         if (acaMode) {
             AcaOptions acaOptions;
             acaOptions.minimumBlockSize = 2;
@@ -85,6 +91,23 @@ struct DiscreteSparseBoundaryOperatorFixture
     BoundaryOperator<BFT, RT> op;
 };
 
+// Random sparse matrix with (roughly) every fifth entry nonzero
+template <typename RT>
+shared_ptr<const CsrMatrix<RT> > generateRandomCsrMatrix(
+        int rowCount, int colCount)
+{
+    shared_ptr<CsrMatrix<RT> > result(new CsrMatrix<RT>(rowCount, colCount));
+    arma::Mat<RT> dense = generateRandomMatrix<RT>(rowCount, colCount);
+    for (int row = 0; row < rowCount; ++row) {
+        for (int col = row % 5; col < colCount; col += 5) {
+            result->columnIndices.push_back(col);
+            result->values.push_back(dense(row, col));
+        }
+        result->rowOffsets[row + 1] = result->columnIndices.size();
+    }
+    return result;
+}
+
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(DiscreteSparseBoundaryOperator)
@@ -248,6 +271,132 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(sparse_and_dense_mode_assembly_give_the_same_matrix, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSparseBoundaryOperatorFixture<BFT, RT> sparseFixture(
+                false /* acaMode */, 6, 8, true /* sparseMode */);
+    DiscreteSparseBoundaryOperatorFixture<BFT, RT> denseFixture(
+                false /* acaMode */, 6, 8, false /* sparseMode */);
+    arma::Mat<RT> sparseMat = sparseFixture.op.weakForm()->asMatrix();
+    arma::Mat<RT> denseMat = denseFixture.op.weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(sparseMat, denseMat,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_of_csr_matrix_works_correctly_for_all_transposition_modes, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    Bempp::DiscreteSparseBoundaryOperator<RT> op(generateRandomCsrMatrix<RT>(70, 40));
+    arma::Mat<RT> mat = op.asMatrix();
+    BOOST_REQUIRE_EQUAL(op.rowCount(), 70u);
+    BOOST_REQUIRE_EQUAL(op.columnCount(), 40u);
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, CONJUGATE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+    for (int m = 0; m < 4; ++m) {
+        arma::Mat<RT> transformedMat;
+        switch (modes[m]) {
+        case NO_TRANSPOSE: transformedMat = mat; break;
+        case CONJUGATE: transformedMat = arma::conj(mat); break;
+        case TRANSPOSE: transformedMat = mat.st(); break;
+        case CONJUGATE_TRANSPOSE: transformedMat = mat.t(); break;
+        }
+
+        arma::Col<RT> x = generateRandomVector<RT>(transformedMat.n_cols);
+        arma::Col<RT> y = generateRandomVector<RT>(transformedMat.n_rows);
+
+        arma::Col<RT> expected = alpha * transformedMat * x + beta * y;
+
+        op.apply(modes[m], x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        y, expected, 10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multivector_apply_of_csr_matrix_works_correctly, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    Bempp::DiscreteSparseBoundaryOperator<RT> op(
+                generateRandomCsrMatrix<RT>(70, 40), NO_SYMMETRY, TRANSPOSE);
+    arma::Mat<RT> mat = op.asMatrix();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(0.);
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(op.columnCount(), 3);
+    arma::Mat<RT> y(op.rowCount(), 3);
+    y.fill(std::numeric_limits<CT>::quiet_NaN());
+
+    arma::Mat<RT> expected = alpha * mat * x;
+
+    op.apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(y.is_finite());
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_of_csr_matrix_does_not_depend_on_thread_count, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Bempp::DiscreteSparseBoundaryOperator<RT>::AhmedBemBlcluster
+            AhmedBemBlcluster;
+
+    shared_ptr<const CsrMatrix<RT> > mat = generateRandomCsrMatrix<RT>(2000, 1500);
+    ParallelizationOptions serialOptions;
+    serialOptions.setMaxThreadCount(1);
+    ParallelizationOptions parallelOptions;
+    parallelOptions.setMaxThreadCount(4);
+    parallelOptions.setGrainSize(16);
+    Bempp::DiscreteSparseBoundaryOperator<RT> serialOp(
+                mat, NO_SYMMETRY, NO_TRANSPOSE, shared_ptr<AhmedBemBlcluster>(),
+                shared_ptr<IndexPermutation>(), shared_ptr<IndexPermutation>(),
+                serialOptions);
+    Bempp::DiscreteSparseBoundaryOperator<RT> parallelOp(
+                mat, NO_SYMMETRY, NO_TRANSPOSE, shared_ptr<AhmedBemBlcluster>(),
+                shared_ptr<IndexPermutation>(), shared_ptr<IndexPermutation>(),
+                parallelOptions);
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const TranspositionMode modes[] = { NO_TRANSPOSE, CONJUGATE_TRANSPOSE };
+    for (int m = 0; m < 2; ++m) {
+        const size_t colCount = m == 0 ? mat->columnCount : mat->rowCount;
+        const size_t rowCount = m == 0 ? mat->rowCount : mat->columnCount;
+        arma::Mat<RT> x = generateRandomMatrix<RT>(colCount, 2);
+        arma::Mat<RT> serialY = generateRandomMatrix<RT>(rowCount, 2);
+        arma::Mat<RT> parallelY = serialY;
+
+        serialOp.apply(modes[m], x, serialY, alpha, beta);
+        parallelOp.apply(modes[m], x, parallelY, alpha, beta);
+
+        // Each row is accumulated by a single thread in a fixed order, so
+        // the results should be bitwise identical
+        BOOST_CHECK(std::equal(serialY.begin(), serialY.end(),
+                               parallelY.begin()));
+    }
+}
+
 #ifdef WITH_AHMED
 BOOST_AUTO_TEST_CASE_TEMPLATE(asDiscreteAcaBoundaryOperator_works_correctly, ResultType, result_types)
 {
@@ -38,6 +38,8 @@
 #include "space/piecewise_constant_scalar_space.hpp"
 
 #include <boost/test/floating_point_comparison.hpp>
+#include <limits>
+#include <vector>
 
 using namespace Bempp;
 
@@ -187,4 +189,94 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(L2Norm_works_for_exponential_function_and_piecewis
     BOOST_CHECK_CLOSE(norm, expectedNorm, 1 /* percent */);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(gridFunctionsFromFunctions_agrees_with_separately_constructed_grid_functions, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.4.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    ConstantFunction<RT> constantFunctor;
+    SinusoidalFunction<RT> sinusoidalFunctor;
+    SurfaceNormalIndependentFunction<ConstantFunction<RT> > constantFunction(
+                constantFunctor);
+    SurfaceNormalIndependentFunction<SinusoidalFunction<RT> > sinusoidalFunction(
+                sinusoidalFunctor);
+    std::vector<const Function<RT>*> functions;
+    functions.push_back(&constantFunction);
+    functions.push_back(&sinusoidalFunction);
+
+    std::vector<Bempp::GridFunction<BFT, RT> > funs =
+            gridFunctionsFromFunctions<BFT, RT>(
+                context, pwiseConstants, pwiseLinears, functions);
+    BOOST_REQUIRE_EQUAL(funs.size(), functions.size());
+
+    for (size_t i = 0; i < functions.size(); ++i) {
+        Bempp::GridFunction<BFT, RT> expected(
+                    context, pwiseConstants, pwiseLinears, *functions[i]);
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        funs[i].projections(pwiseLinears),
+                        expected.projections(pwiseLinears),
+                        100. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(projections_do_not_depend_on_thread_count, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.4.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions serialOptions;
+    serialOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    serialOptions.setMaxThreadCount(1);
+    AssemblyOptions parallelOptions;
+    parallelOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    parallelOptions.setMaxThreadCount(4);
+    shared_ptr<Context<BFT, RT> > serialContext(
+        new Context<BFT, RT>(quadStrategy, serialOptions));
+    shared_ptr<Context<BFT, RT> > parallelContext(
+        new Context<BFT, RT>(quadStrategy, parallelOptions));
+
+    SinusoidalFunction<RT> functor;
+    SurfaceNormalIndependentFunction<SinusoidalFunction<RT> > function(functor);
+
+    Bempp::GridFunction<BFT, RT> serialFun(serialContext, space, space, function);
+    Bempp::GridFunction<BFT, RT> parallelFun(parallelContext, space, space,
+                                             function);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    parallelFun.projections(space),
+                    serialFun.projections(space),
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "potential_evaluation_fixture.hpp"
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/evaluation_options.hpp"
+#include "assembly/laplace_3d_double_layer_potential_operator.hpp"
+#include "assembly/laplace_3d_single_layer_potential_operator.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename ValueType_>
+class LinearFunction
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = 1. + point(0) - 2. * point(2);
+    }
+};
+
+// Linear function on piecewise linears, evaluated at points scattered over
+// the shell 1.5 <= |x| <= 3 surrounding the unit sphere
+template <typename BFT, typename RT>
+struct HierarchicalEvaluationFixture : PotentialEvaluationFixture<BFT, RT>
+{
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    HierarchicalEvaluationFixture() :
+        PotentialEvaluationFixture<BFT, RT>(AccuracyOptions())
+    {
+        this->setGridFunction(
+            shared_ptr<Space<BFT> >(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(this->grid)),
+            LinearFunction<RT>());
+        points = goldenAnglePoints<CT>(500, 1.5, 3.);
+    }
+
+    arma::Mat<CT> points;
+};
+
+HierarchicalEvaluationOptions accurateHierarchicalOptions()
+{
+    HierarchicalEvaluationOptions hierarchicalOptions;
+    hierarchicalOptions.interpolationOrder = 6;
+    hierarchicalOptions.maximumLeafSize = 16;
+    return hierarchicalOptions;
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(HierarchicalPotentialEvaluation)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(single_layer_potential_agrees_with_dense_mode, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    HierarchicalEvaluationFixture<BFT, RT> fixture;
+    Laplace3dSingleLayerPotentialOperator<BFT, RT> op;
+
+    EvaluationOptions denseOptions;
+    arma::Mat<RT> expected = op.evaluateAtPoints(
+        *fixture.fun, fixture.points, *fixture.quadStrategy, denseOptions);
+
+    EvaluationOptions hierarchicalOptions;
+    hierarchicalOptions.switchToHierarchicalMode(accurateHierarchicalOptions());
+    arma::Mat<RT> actual = op.evaluateAtPoints(
+        *fixture.fun, fixture.points, *fixture.quadStrategy,
+        hierarchicalOptions);
+
+    CT tolerance = std::max(CT(1e-5),
+                            100 * std::numeric_limits<CT>::epsilon());
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, tolerance));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(double_layer_potential_agrees_with_dense_mode, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    HierarchicalEvaluationFixture<BFT, RT> fixture;
+    Laplace3dDoubleLayerPotentialOperator<BFT, RT> op;
+
+    EvaluationOptions denseOptions;
+    arma::Mat<RT> expected = op.evaluateAtPoints(
+        *fixture.fun, fixture.points, *fixture.quadStrategy, denseOptions);
+
+    EvaluationOptions hierarchicalOptions;
+    hierarchicalOptions.switchToHierarchicalMode(accurateHierarchicalOptions());
+    arma::Mat<RT> actual = op.evaluateAtPoints(
+        *fixture.fun, fixture.points, *fixture.quadStrategy,
+        hierarchicalOptions);
+
+    CT tolerance = std::max(CT(1e-5),
+                            100 * std::numeric_limits<CT>::epsilon());
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, tolerance));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(assemble_throws_in_hierarchical_mode, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    HierarchicalEvaluationFixture<BFT, RT> fixture;
+    Laplace3dSingleLayerPotentialOperator<BFT, RT> op;
+
+    EvaluationOptions options;
+    options.switchToHierarchicalMode();
+    shared_ptr<const arma::Mat<CT> > points(
+        new arma::Mat<CT>(fixture.points));
+    BOOST_CHECK_THROW(op.assemble(fixture.space, points,
+                                  *fixture.quadStrategy, options),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -37,6 +37,7 @@
 #include "space/piecewise_constant_scalar_space.hpp"
 
 #include <algorithm>
+#include <limits>
 #include "common/armadillo_fwd.hpp"
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
@@ -105,4 +106,58 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(symmetric_matches_nonsymmetric_in_aca_mode,
                     matNonsymmetric, matSymmetric, 2 * acaOptions.eps));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(parallel_dense_assembly_matches_serial,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../examples/meshes/sphere-h-0.2.msh",
+                false /* verbose */);
+
+    // Continuous space: neighbouring elements share DOFs, so the scatter of
+    // local weak forms needs to be protected against concurrent writes. The
+    // grid is fine enough (about 600 elements in about 10 colours) for the
+    // assembler to scatter the colours without locking.
+    PiecewiseLinearContinuousScalarSpace<BFT> pwiseLinears(grid);
+
+    AccuracyOptions accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+
+    AssemblyOptions serialAssemblyOptions;
+    serialAssemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    serialAssemblyOptions.setMaxThreadCount(1);
+    Context<BFT, RT> serialContext(make_shared_from_ref(quadStrategy),
+                                   serialAssemblyOptions);
+
+    AssemblyOptions parallelAssemblyOptions;
+    parallelAssemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    Context<BFT, RT> parallelContext(make_shared_from_ref(quadStrategy),
+                                     parallelAssemblyOptions);
+
+    BoundaryOperator<BFT, RT> serialOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(serialContext),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears));
+    BoundaryOperator<BFT, RT> parallelOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(parallelContext),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears));
+
+    arma::Mat<RT> serialMat = serialOp.weakForm()->asMatrix();
+    arma::Mat<RT> parallelMat = parallelOp.weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    serialMat, parallelMat,
+                    100 * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
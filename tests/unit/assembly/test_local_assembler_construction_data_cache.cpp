@@ -0,0 +1,174 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "create_regular_grid.hpp"
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/local_assembler_construction_data_cache.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "fiber/element_adjacency.hpp"
+#include "fiber/element_sizes_and_centers.hpp"
+#include "fiber/raw_grid_geometry.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <limits>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(LocalAssemblerConstructionDataCache)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(spaces_on_the_same_grid_share_raw_geometry,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef Bempp::LocalAssemblerConstructionDataCache<BFT> Cache;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    shared_ptr<Space<BFT> > pconsts(
+            new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > plins(
+            new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    Cache cache;
+    AssemblyOptions options;
+    shared_ptr<typename Cache::RawGridGeometry> rawGeometry1, rawGeometry2;
+    shared_ptr<GeometryFactory> geometryFactory1, geometryFactory2;
+    cache.getGridData(*pconsts, options, rawGeometry1, geometryFactory1);
+    cache.getGridData(*plins, options, rawGeometry2, geometryFactory2);
+
+    BOOST_CHECK(rawGeometry1);
+    BOOST_CHECK(rawGeometry1 == rawGeometry2);
+    BOOST_CHECK(geometryFactory1 == geometryFactory2);
+    BOOST_CHECK_EQUAL(rawGeometry1->elementCount(),
+                      int(grid->leafView()->entityCount(0)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(raw_geometry_carries_precalculated_data,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef Bempp::LocalAssemblerConstructionDataCache<BFT> Cache;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    shared_ptr<Space<BFT> > space(
+            new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    Cache cache;
+    AssemblyOptions options;
+    options.enableSingularIntegralCaching(true);
+    shared_ptr<typename Cache::RawGridGeometry> rawGeometry;
+    shared_ptr<GeometryFactory> geometryFactory;
+    cache.getGridData(*space, options, rawGeometry, geometryFactory);
+
+    BOOST_REQUIRE(rawGeometry->elementSizesAndCenters());
+    BOOST_CHECK_EQUAL(rawGeometry->elementSizesAndCenters()->sizesSquared.size(),
+                      size_t(rawGeometry->elementCount()));
+    BOOST_REQUIRE(rawGeometry->elementAdjacency());
+    BOOST_CHECK_EQUAL(rawGeometry->elementAdjacency()->elementCount(),
+                      rawGeometry->elementCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(shapesets_are_reused_until_cache_is_cleared,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef Bempp::LocalAssemblerConstructionDataCache<BFT> Cache;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    shared_ptr<const Space<BFT> > space(
+            new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    Cache cache;
+    shared_ptr<typename Cache::ShapesetPtrVector> shapesets1, shapesets2, shapesets3;
+    cache.getShapesets(space, shapesets1);
+    cache.getShapesets(space, shapesets2);
+    BOOST_CHECK(shapesets1 == shapesets2);
+    BOOST_CHECK_EQUAL(shapesets1->size(), grid->leafView()->entityCount(0));
+
+    cache.clear();
+    cache.getShapesets(space, shapesets3);
+    BOOST_CHECK(shapesets1 != shapesets3);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(operators_assembled_with_shared_context_agree_with_separately_assembled_ones,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    shared_ptr<Space<BFT> > pconsts(
+            new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > plins(
+            new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+            new NumericalQuadratureStrategy<BFT, RT>);
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+
+    // Both operators assembled with the same context, which shares grid
+    // and space data between them
+    shared_ptr<Context<BFT, RT> > sharedContext(
+            new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    BoundaryOperator<BFT, RT> slpShared =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                sharedContext, pconsts, pconsts, pconsts);
+    BoundaryOperator<BFT, RT> dlpShared =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                sharedContext, plins, pconsts, pconsts);
+    arma::Mat<RT> slpSharedMat = slpShared.weakForm()->asMatrix();
+    arma::Mat<RT> dlpSharedMat = dlpShared.weakForm()->asMatrix();
+
+    // Each operator assembled with its own context
+    shared_ptr<Context<BFT, RT> > slpContext(
+            new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    shared_ptr<Context<BFT, RT> > dlpContext(
+            new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    BoundaryOperator<BFT, RT> slpSeparate =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                slpContext, pconsts, pconsts, pconsts);
+    BoundaryOperator<BFT, RT> dlpSeparate =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                dlpContext, plins, pconsts, pconsts);
+
+    const RealType tolerance = 10 * std::numeric_limits<RealType>::epsilon();
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    slpSharedMat, slpSeparate.weakForm()->asMatrix(),
+                    tolerance));
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    dlpSharedMat, dlpSeparate.weakForm()->asMatrix(),
+                    tolerance));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
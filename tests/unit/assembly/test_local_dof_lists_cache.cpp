@@ -0,0 +1,120 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "create_regular_grid.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/local_dof_lists_cache.hpp"
+#include "grid/grid.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(LocalDofListsCache)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(single_index_lists_are_cached,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+    const size_t dofCount = space.globalDofCount();
+    std::vector<unsigned int> p2o(dofCount);
+    for (size_t i = 0; i < dofCount; ++i)
+        p2o[i] = dofCount - 1 - i;
+
+    Bempp::LocalDofListsCache<BFT> cache(space, p2o,
+                                         true /* indexWithGlobalDofs */);
+    for (size_t i = 0; i < dofCount; ++i) {
+        shared_ptr<const LocalDofLists<BFT> > lists1 = cache.get(i, 1);
+        shared_ptr<const LocalDofLists<BFT> > lists2 = cache.get(i, 1);
+        BOOST_CHECK(lists1.get() == lists2.get());
+        BOOST_REQUIRE_EQUAL(lists1->originalIndices.size(), size_t(1));
+        BOOST_CHECK_EQUAL(lists1->originalIndices[0], int(p2o[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(repeated_pivot_requests_do_not_rebuild_lists,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+    const size_t dofCount = space.globalDofCount();
+    std::vector<unsigned int> p2o(dofCount);
+    for (size_t i = 0; i < dofCount; ++i)
+        p2o[i] = i;
+
+    Bempp::LocalDofListsCache<BFT> cache(space, p2o,
+                                         true /* indexWithGlobalDofs */);
+    // Mimic ACA, which requests the same pivot rows and columns of a block
+    // row several times, and the same ranges for each block of a cluster
+    const int requestCount = 5;
+    for (int r = 0; r < requestCount; ++r) {
+        for (size_t i = 0; i < dofCount; ++i)
+            cache.get(i, 1);
+        cache.get(0, dofCount / 2);
+        cache.get(dofCount / 2, dofCount - dofCount / 2);
+    }
+
+    BOOST_CHECK_EQUAL(cache.builtListCount(), dofCount + 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(single_index_lists_agree_with_range_lists,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+    const size_t dofCount = space.globalDofCount();
+    std::vector<unsigned int> p2o(dofCount);
+    for (size_t i = 0; i < dofCount; ++i)
+        p2o[i] = i;
+
+    Bempp::LocalDofListsCache<BFT> cache(space, p2o,
+                                         true /* indexWithGlobalDofs */);
+    shared_ptr<const LocalDofLists<BFT> > all = cache.get(0, dofCount);
+    for (size_t i = 0; i < dofCount; ++i) {
+        shared_ptr<const LocalDofLists<BFT> > single = cache.get(i, 1);
+        for (size_t e = 0; e < single->elementIndices.size(); ++e) {
+            const int element = single->elementIndices[e];
+            const size_t pos = std::find(all->elementIndices.begin(),
+                                         all->elementIndices.end(), element) -
+                    all->elementIndices.begin();
+            BOOST_REQUIRE(pos < all->elementIndices.size());
+            const std::vector<int>& arrayIndices = all->arrayIndices[pos];
+            const size_t k = std::find(arrayIndices.begin(), arrayIndices.end(),
+                                       int(i)) - arrayIndices.begin();
+            BOOST_REQUIRE(k < arrayIndices.size());
+            BOOST_CHECK_EQUAL(all->localDofIndices[pos][k],
+                              single->localDofIndices[e][0]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "potential_evaluation_fixture.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/evaluation_options.hpp"
+#include "assembly/laplace_3d_double_layer_potential_operator.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename ValueType_>
+class UnitFunction
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = 1.;
+    }
+};
+
+// Without this, the far-field rule for piecewise constants has a single
+// point and its error dominates even away from the surface
+AccuracyOptions nearFieldAccuracyOptions()
+{
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.singleRegular.setRelativeQuadratureOrder(2);
+    return accuracyOptions;
+}
+
+// The double-layer potential of a unit charge distribution on a closed
+// (polyhedral) surface is constant inside and vanishes outside, so its
+// exact values are known arbitrarily close to the surface
+template <typename BFT, typename RT>
+struct NearFieldEvaluationFixture : PotentialEvaluationFixture<BFT, RT>
+{
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    NearFieldEvaluationFixture() :
+        PotentialEvaluationFixture<BFT, RT>(nearFieldAccuracyOptions())
+    {
+        this->setGridFunction(
+            shared_ptr<Space<BFT> >(
+                new PiecewiseConstantScalarSpace<BFT>(this->grid)),
+            UnitFunction<RT>());
+    }
+
+    // Largest deviation of the potential at 'points' from 'exactValue'
+    CT maxError(const arma::Mat<CT>& points, CT exactValue,
+                const EvaluationOptions& options) const
+    {
+        Laplace3dDoubleLayerPotentialOperator<BFT, RT> op;
+        arma::Mat<RT> values =
+            op.evaluateAtPoints(*this->fun, points, *this->quadStrategy,
+                                options);
+        CT error = 0.;
+        for (size_t i = 0; i < values.n_cols; ++i)
+            error = std::max(error, std::abs(values(0, i) - exactValue));
+        return error;
+    }
+};
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(NearFieldPotentialEvaluation)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(near_field_quadrature_is_accurate_just_inside_the_surface, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    NearFieldEvaluationFixture<BFT, RT> fixture;
+    // The vertices of the mesh lie on the unit sphere and its elements are
+    // about 0.2 wide, so these points lie well within one element size from
+    // the surface
+    arma::Mat<CT> points = goldenAnglePoints<CT>(200, 0.96, 0.96);
+
+    EvaluationOptions farFieldOptions;
+    EvaluationOptions nearFieldOptions;
+    nearFieldOptions.enableNearFieldQuadrature();
+
+    const CT farFieldError = fixture.maxError(points, -1., farFieldOptions);
+    const CT nearFieldError = fixture.maxError(points, -1., nearFieldOptions);
+    BOOST_CHECK_LT(nearFieldError, 1e-3);
+    BOOST_CHECK_LT(nearFieldError, farFieldError);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(near_field_quadrature_is_accurate_just_outside_the_surface, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    NearFieldEvaluationFixture<BFT, RT> fixture;
+    arma::Mat<CT> points = goldenAnglePoints<CT>(200, 1.04, 1.04);
+
+    EvaluationOptions farFieldOptions;
+    EvaluationOptions nearFieldOptions;
+    nearFieldOptions.enableNearFieldQuadrature();
+
+    const CT farFieldError = fixture.maxError(points, 0., farFieldOptions);
+    const CT nearFieldError = fixture.maxError(points, 0., nearFieldOptions);
+    BOOST_CHECK_LT(nearFieldError, 1e-3);
+    BOOST_CHECK_LT(nearFieldError, farFieldError);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(near_field_quadrature_does_not_affect_distant_points, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    NearFieldEvaluationFixture<BFT, RT> fixture;
+    arma::Mat<CT> points = goldenAnglePoints<CT>(50, 3., 3.);
+
+    Laplace3dDoubleLayerPotentialOperator<BFT, RT> op;
+    EvaluationOptions farFieldOptions;
+    arma::Mat<RT> expected = op.evaluateAtPoints(
+        *fixture.fun, points, *fixture.quadStrategy, farFieldOptions);
+    EvaluationOptions nearFieldOptions;
+    nearFieldOptions.enableNearFieldQuadrature();
+    arma::Mat<RT> actual = op.evaluateAtPoints(
+        *fixture.fun, points, *fixture.quadStrategy, nearFieldOptions);
+
+    for (size_t i = 0; i < points.n_cols; ++i)
+        BOOST_CHECK_EQUAL(actual(0, i), expected(0, i));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -232,4 +232,31 @@ BOOST_AUTO_TEST_CASE(quadratureOrder_agrees_with_setDoubleRegular_for_three_rela
     BOOST_CHECK_EQUAL(orderFar, defaultOrder + order3);
 }
 
+BOOST_AUTO_TEST_CASE(toString_is_equal_for_equal_options)
+{
+    Fiber::AccuracyOptionsEx opts1, opts2;
+    opts1.setDoubleRegular(4., 2, 1);
+    opts2.setDoubleRegular(4., 2, 1);
+
+    BOOST_CHECK_EQUAL(opts1.toString(), opts2.toString());
+}
+
+BOOST_AUTO_TEST_CASE(toString_distinguishes_relative_and_absolute_orders)
+{
+    Fiber::AccuracyOptionsEx opts1, opts2;
+    opts1.setDoubleSingular(3);
+    opts2.setDoubleSingular(3, false /* absolute */);
+
+    BOOST_CHECK(opts1.toString() != opts2.toString());
+}
+
+BOOST_AUTO_TEST_CASE(toString_distinguishes_different_distance_thresholds)
+{
+    Fiber::AccuracyOptionsEx opts1, opts2;
+    opts1.setSingleRegular(4., 2, 1);
+    opts2.setSingleRegular(5., 2, 1);
+
+    BOOST_CHECK(opts1.toString() != opts2.toString());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/default_collection_of_kernels.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/laplace_3d_adjoint_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_adjoint_double_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_maxwell_3d_double_layer_operators_kernel_functor.hpp"
+#include "fiber/modified_maxwell_3d_single_layer_boundary_operator_kernel_functor.hpp"
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+#include "../random_arrays.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <complex>
+#include <limits>
+
+namespace
+{
+
+// Evaluates the kernels with DefaultCollectionOfKernels::evaluateOnGrid(),
+// which uses the functor's evaluateBatch() member, and compares the results
+// with those obtained by calling the functor's evaluate() member for each
+// pair of points. The number of test points is chosen so that the test
+// points are split into several blocks, the last of which is incomplete.
+template <typename Functor>
+boost::test_tools::predicate_result
+batchedEvaluationAgreesWithPointwiseEvaluation(const Functor& functor)
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+    Fiber::DefaultCollectionOfKernels<Functor> kernels(functor);
+
+    const int worldDim = 3;
+    const int testPointCount = 2 * Fiber::GEOMETRICAL_DATA_BLOCK_SIZE + 5;
+    const int trialPointCount = 7;
+    Fiber::GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    testGeomData.globals =
+            generateRandomMatrix<CoordinateType>(worldDim, testPointCount);
+    testGeomData.normals =
+            generateRandomMatrix<CoordinateType>(worldDim, testPointCount);
+    // Keep the trial points away from the test points
+    trialGeomData.globals =
+            generateRandomMatrix<CoordinateType>(worldDim, trialPointCount);
+    trialGeomData.globals += 2.;
+    trialGeomData.normals =
+            generateRandomMatrix<CoordinateType>(worldDim, trialPointCount);
+
+    Fiber::CollectionOf4dArrays<ValueType> result;
+    kernels.evaluateOnGrid(testGeomData, trialGeomData, result);
+
+    const int kernelCount = functor.kernelCount();
+    Fiber::CollectionOf4dArrays<ValueType> expected(kernelCount);
+    for (int k = 0; k < kernelCount; ++k)
+        expected[k].set_size(functor.kernelRowCount(k),
+                             functor.kernelColCount(k),
+                             testPointCount, trialPointCount);
+    for (int trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+        for (int testPoint = 0; testPoint < testPointCount; ++testPoint)
+            functor.evaluate(testGeomData.const_slice(testPoint),
+                             trialGeomData.const_slice(trialPoint),
+                             expected.slice(testPoint, trialPoint).self());
+
+    const CoordinateType tol =
+            100 * std::numeric_limits<CoordinateType>::epsilon();
+    for (int k = 0; k < kernelCount; ++k) {
+        boost::test_tools::predicate_result kernelResult =
+                check_arrays_are_close<ValueType>(result[k], expected[k], tol);
+        if (!kernelResult)
+            return kernelResult;
+    }
+    return true;
+}
+
+template <typename ValueType>
+ValueType testWaveNumber()
+{
+    return ValueType(1.3);
+}
+
+template <>
+std::complex<float> testWaveNumber<std::complex<float> >()
+{
+    return std::complex<float>(0.5f, -2.f);
+}
+
+template <>
+std::complex<double> testWaveNumber<std::complex<double> >()
+{
+    return std::complex<double>(0.5, -2.);
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(BatchedKernelEvaluation)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(works_for_laplace_3d_kernels,
+                              ValueType, kernel_types)
+{
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::Laplace3dSingleLayerPotentialKernelFunctor<ValueType>()));
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::Laplace3dDoubleLayerPotentialKernelFunctor<ValueType>()));
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::Laplace3dAdjointDoubleLayerPotentialKernelFunctor<ValueType>()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(works_for_modified_helmholtz_3d_kernels,
+                              ValueType, kernel_types)
+{
+    const ValueType waveNumber = testWaveNumber<ValueType>();
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::ModifiedHelmholtz3dSingleLayerPotentialKernelFunctor<ValueType>(
+                        waveNumber)));
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::ModifiedHelmholtz3dDoubleLayerPotentialKernelFunctor<ValueType>(
+                        waveNumber)));
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::ModifiedHelmholtz3dAdjointDoubleLayerPotentialKernelFunctor<ValueType>(
+                        waveNumber)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(works_for_modified_maxwell_3d_kernels,
+                              ValueType, kernel_types)
+{
+    const ValueType waveNumber = testWaveNumber<ValueType>();
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::ModifiedMaxwell3dSingleLayerBoundaryOperatorKernelFunctor<ValueType>(
+                        waveNumber)));
+    BOOST_CHECK(batchedEvaluationAgreesWithPointwiseEvaluation(
+                    Fiber::ModifiedMaxwell3dDoubleLayerOperatorsKernelFunctor<ValueType>(
+                        waveNumber)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
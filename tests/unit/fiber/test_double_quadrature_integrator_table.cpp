@@ -0,0 +1,120 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/double_quadrature_integrator_table.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <set>
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(DoubleQuadratureIntegratorTable)
+
+namespace
+{
+
+struct DummyIntegrator
+{
+    explicit DummyIntegrator(int id_) : id(id_) {}
+    int id;
+};
+
+typedef Fiber::DoubleQuadratureIntegratorTable<DummyIntegrator> Table;
+
+Fiber::DoubleQuadratureDescriptor makeDescriptor(
+        Fiber::ElementPairTopology::Type type, int testOrder, int trialOrder)
+{
+    Fiber::DoubleQuadratureDescriptor desc;
+    desc.topology.type = type;
+    desc.topology.testVertexCount = 3;
+    desc.topology.trialVertexCount = 3;
+    if (type == Fiber::ElementPairTopology::SharedVertex ||
+            type == Fiber::ElementPairTopology::SharedEdge) {
+        desc.topology.testSharedVertex0 = 1;
+        desc.topology.trialSharedVertex0 = 2;
+    }
+    if (type == Fiber::ElementPairTopology::SharedEdge) {
+        desc.topology.testSharedVertex1 = 2;
+        desc.topology.trialSharedVertex1 = 0;
+    }
+    desc.testOrder = testOrder;
+    desc.trialOrder = trialOrder;
+    return desc;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_returns_null_for_missing_descriptor)
+{
+    Table table;
+    BOOST_CHECK(!table.find(makeDescriptor(
+                                Fiber::ElementPairTopology::Disjoint, 2, 2)));
+    BOOST_CHECK(!table.find(makeDescriptor(
+                                Fiber::ElementPairTopology::Disjoint, 50, 2)));
+    BOOST_CHECK_EQUAL(table.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(find_returns_inserted_integrators)
+{
+    Table table;
+    std::vector<Fiber::DoubleQuadratureDescriptor> descs;
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::Disjoint, 2, 3));
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::Disjoint, 3, 2));
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::SharedVertex, 6, 6));
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::SharedEdge, 6, 6));
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::Coincident, 6, 6));
+    // Orders outside the dense array
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::Disjoint,
+                                   Table::MAX_DENSE_ORDER + 1, 2));
+    descs.push_back(makeDescriptor(Fiber::ElementPairTopology::Coincident,
+                                   2, Table::MAX_DENSE_ORDER + 5));
+    Fiber::DoubleQuadratureDescriptor quadrilateral =
+            makeDescriptor(Fiber::ElementPairTopology::Disjoint, 2, 3);
+    quadrilateral.topology.trialVertexCount = 4;
+    descs.push_back(quadrilateral);
+
+    for (size_t i = 0; i < descs.size(); ++i) {
+        const DummyIntegrator& integrator = table.insert(
+                    descs[i], std::auto_ptr<DummyIntegrator>(
+                        new DummyIntegrator(i)));
+        BOOST_CHECK_EQUAL(integrator.id, int(i));
+    }
+    BOOST_CHECK_EQUAL(table.size(), descs.size());
+    for (size_t i = 0; i < descs.size(); ++i) {
+        const DummyIntegrator* integrator = table.find(descs[i]);
+        BOOST_REQUIRE(integrator);
+        BOOST_CHECK_EQUAL(integrator->id, int(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(insert_keeps_existing_integrator)
+{
+    Table table;
+    const Fiber::DoubleQuadratureDescriptor desc =
+            makeDescriptor(Fiber::ElementPairTopology::SharedEdge, 4, 4);
+    table.insert(desc, std::auto_ptr<DummyIntegrator>(new DummyIntegrator(1)));
+    const DummyIntegrator& integrator = table.insert(
+                desc, std::auto_ptr<DummyIntegrator>(new DummyIntegrator(2)));
+    BOOST_CHECK_EQUAL(integrator.id, 1);
+    BOOST_CHECK_EQUAL(table.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/element_adjacency.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <armadillo>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(ElementAdjacency)
+
+namespace
+{
+
+// Structured triangulation of a square divided into n x n cells, each split
+// into two triangles
+arma::Mat<int> makeTriangulation(int n)
+{
+    arma::Mat<int> elementCornerIndices(3, 2 * n * n);
+    int e = 0;
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < n; ++i) {
+            const int v00 = j * (n + 1) + i, v10 = v00 + 1;
+            const int v01 = v00 + n + 1, v11 = v01 + 1;
+            elementCornerIndices(0, e) = v00;
+            elementCornerIndices(1, e) = v10;
+            elementCornerIndices(2, e) = v11;
+            ++e;
+            elementCornerIndices(0, e) = v00;
+            elementCornerIndices(1, e) = v11;
+            elementCornerIndices(2, e) = v01;
+            ++e;
+        }
+    return elementCornerIndices;
+}
+
+// Reference implementation: set of all pairs of elements sharing a vertex
+std::set<std::pair<int, int> > findAdjacentPairs(
+        const arma::Mat<int>& elementCornerIndices)
+{
+    std::set<std::pair<int, int> > pairs;
+    const int elementCount = elementCornerIndices.n_cols;
+    const int cornerCount = elementCornerIndices.n_rows;
+    for (int e1 = 0; e1 < elementCount; ++e1)
+        for (int e2 = 0; e2 < elementCount; ++e2)
+            for (int c1 = 0; c1 < cornerCount; ++c1)
+                for (int c2 = 0; c2 < cornerCount; ++c2)
+                    if (elementCornerIndices(c1, e1) >= 0 &&
+                            elementCornerIndices(c1, e1) ==
+                            elementCornerIndices(c2, e2))
+                        pairs.insert(std::make_pair(e1, e2));
+    return pairs;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(lists_agree_with_brute_force_search)
+{
+    const int n = 12;
+    const arma::Mat<int> elementCornerIndices = makeTriangulation(n);
+    Fiber::ElementAdjacency adjacency(elementCornerIndices, (n + 1) * (n + 1));
+
+    const std::set<std::pair<int, int> > expected =
+            findAdjacentPairs(elementCornerIndices);
+    BOOST_CHECK_EQUAL(adjacency.elementCount(), 2 * n * n);
+    BOOST_CHECK_EQUAL(adjacency.pairCount(), expected.size());
+
+    std::set<std::pair<int, int> > actual;
+    const std::vector<int>& offsets = adjacency.offsets();
+    const std::vector<int>& neighbours = adjacency.neighbours();
+    for (int e = 0; e < adjacency.elementCount(); ++e) {
+        BOOST_CHECK(std::adjacent_find(
+                        neighbours.begin() + offsets[e],
+                        neighbours.begin() + offsets[e + 1],
+                        std::greater_equal<int>()) ==
+                    neighbours.begin() + offsets[e + 1]);
+        for (int i = offsets[e]; i < offsets[e + 1]; ++i)
+            actual.insert(std::make_pair(e, neighbours[i]));
+    }
+    BOOST_CHECK(actual == expected);
+}
+
+BOOST_AUTO_TEST_CASE(lists_do_not_depend_on_thread_count)
+{
+    const int n = 40;
+    const arma::Mat<int> elementCornerIndices = makeTriangulation(n);
+    Fiber::ParallelizationOptions serialOptions;
+    serialOptions.setMaxThreadCount(1);
+    Fiber::ElementAdjacency serial(elementCornerIndices, (n + 1) * (n + 1),
+                                   serialOptions);
+    Fiber::ElementAdjacency parallel(elementCornerIndices, (n + 1) * (n + 1));
+
+    BOOST_CHECK(serial.offsets() == parallel.offsets());
+    BOOST_CHECK(serial.neighbours() == parallel.neighbours());
+}
+
+BOOST_AUTO_TEST_CASE(missing_corners_are_ignored)
+{
+    // A triangle and a quadrilateral sharing the edge (1, 2), and an isolated
+    // triangle
+    arma::Mat<int> elementCornerIndices(4, 3);
+    elementCornerIndices.fill(-1);
+    elementCornerIndices(0, 0) = 0;
+    elementCornerIndices(1, 0) = 1;
+    elementCornerIndices(2, 0) = 2;
+    elementCornerIndices(0, 1) = 1;
+    elementCornerIndices(1, 1) = 3;
+    elementCornerIndices(2, 1) = 4;
+    elementCornerIndices(3, 1) = 2;
+    elementCornerIndices(0, 2) = 5;
+    elementCornerIndices(1, 2) = 6;
+    elementCornerIndices(2, 2) = 7;
+    Fiber::ElementAdjacency adjacency(elementCornerIndices, 8);
+
+    const int expectedOffsets[] = { 0, 2, 4, 5 };
+    const int expectedNeighbours[] = { 0, 1, 0, 1, 2 };
+    BOOST_CHECK(adjacency.offsets() ==
+                std::vector<int>(expectedOffsets, expectedOffsets + 4));
+    BOOST_CHECK(adjacency.neighbours() ==
+                std::vector<int>(expectedNeighbours, expectedNeighbours + 5));
+}
+
+BOOST_AUTO_TEST_CASE(constructor_throws_for_invalid_vertex_index)
+{
+    arma::Mat<int> elementCornerIndices(3, 1);
+    elementCornerIndices(0, 0) = 0;
+    elementCornerIndices(1, 0) = 1;
+    elementCornerIndices(2, 0) = 3;
+    BOOST_CHECK_THROW(Fiber::ElementAdjacency(elementCornerIndices, 3),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
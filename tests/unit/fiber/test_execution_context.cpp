@@ -0,0 +1,202 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/execution_context.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+#include <tbb/blocked_range.h>
+
+// Tests
+
+using namespace Fiber;
+
+namespace
+{
+
+// Restores the thread pinning state of the execution context on destruction
+class ThreadPinningStateGuard
+{
+public:
+    ThreadPinningStateGuard() :
+        m_wasActive(ExecutionContext::instance().isThreadPinningActive()) {
+    }
+
+    ~ThreadPinningStateGuard() {
+        if (!m_wasActive)
+            ExecutionContext::instance().disableThreadPinning();
+    }
+
+private:
+    bool m_wasActive;
+};
+
+struct SumLoopBody
+{
+    SumLoopBody() : sum(0) {}
+    SumLoopBody(SumLoopBody&, tbb::split) : sum(0) {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i)
+            sum += i;
+    }
+
+    void join(const SumLoopBody& other) {
+        sum += other.sum;
+    }
+
+    size_t sum;
+};
+
+struct FillLoopBody
+{
+    FillLoopBody(std::vector<int>& values, size_t offset) :
+        m_values(values), m_offset(offset) {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t i = r.begin(); i != r.end(); ++i)
+            m_values[m_offset + i] = 1;
+    }
+
+    std::vector<int>& m_values;
+    size_t m_offset;
+};
+
+struct NestedFillLoopBody
+{
+    NestedFillLoopBody(std::vector<int>& values, size_t innerSize,
+                       const ParallelizationOptions& innerOptions) :
+        m_values(values), m_innerSize(innerSize),
+        m_innerOptions(innerOptions) {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t i = r.begin(); i != r.end(); ++i)
+            ExecutionContext::instance().parallelFor(
+                        m_innerOptions,
+                        tbb::blocked_range<size_t>(0, m_innerSize),
+                        FillLoopBody(m_values, i * m_innerSize));
+    }
+
+    std::vector<int>& m_values;
+    size_t m_innerSize;
+    const ParallelizationOptions& m_innerOptions;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ParallelExecutionContext)
+
+BOOST_AUTO_TEST_CASE(parallelReduce_works_for_two_threads)
+{
+    ParallelizationOptions options;
+    options.setMaxThreadCount(2);
+    const size_t n = 100000;
+
+    SumLoopBody body;
+    ExecutionContext::instance().parallelReduce(
+                options, tbb::blocked_range<size_t>(0, n), body);
+
+    BOOST_CHECK_EQUAL(body.sum, n * (n - 1) / 2);
+}
+
+BOOST_AUTO_TEST_CASE(repeated_parallelReduce_works_for_varying_thread_counts)
+{
+    const size_t n = 1000;
+    for (int threadCount = 1; threadCount <= 4; ++threadCount) {
+        ParallelizationOptions options;
+        options.setMaxThreadCount(threadCount);
+        options.setGrainSize(threadCount * 10);
+        SumLoopBody body;
+        ExecutionContext::instance().parallelReduce(
+                    options,
+                    tbb::blocked_range<size_t>(
+                        0, n, ExecutionContext::grainSize(options)),
+                    body);
+        BOOST_CHECK_EQUAL(body.sum, n * (n - 1) / 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(nested_parallelFor_visits_all_iterations)
+{
+    ParallelizationOptions outerOptions;
+    ParallelizationOptions innerOptions;
+    innerOptions.setMaxThreadCount(2);
+    const size_t outerSize = 50, innerSize = 40;
+    std::vector<int> values(outerSize * innerSize, 0);
+
+    ExecutionContext::instance().parallelFor(
+                outerOptions,
+                tbb::blocked_range<size_t>(0, outerSize),
+                NestedFillLoopBody(values, innerSize, innerOptions));
+
+    for (size_t i = 0; i < values.size(); ++i)
+        BOOST_CHECK_EQUAL(values[i], 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFor_works_with_thread_pinning)
+{
+    ThreadPinningStateGuard pinningGuard;
+    ParallelizationOptions options;
+    options.enableThreadPinning();
+    const size_t n = 1000;
+    std::vector<int> values(n, 0);
+
+    ExecutionContext::instance().parallelFor(
+                options, tbb::blocked_range<size_t>(0, n),
+                FillLoopBody(values, 0));
+
+    for (size_t i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(values[i], 1);
+    BOOST_CHECK(ExecutionContext::instance().isThreadPinningActive());
+}
+
+BOOST_AUTO_TEST_CASE(disableThreadPinning_removes_pinning_observer)
+{
+    ThreadPinningStateGuard pinningGuard;
+    ParallelizationOptions options;
+    options.enableThreadPinning();
+    const size_t n = 100;
+    std::vector<int> values(n, 0);
+
+    ExecutionContext::instance().parallelFor(
+                options, tbb::blocked_range<size_t>(0, n),
+                FillLoopBody(values, 0));
+    ExecutionContext::instance().disableThreadPinning();
+
+    BOOST_CHECK(!ExecutionContext::instance().isThreadPinningActive());
+}
+
+BOOST_AUTO_TEST_CASE(grainSize_is_1_for_automatic_grain_size)
+{
+    ParallelizationOptions options;
+    BOOST_CHECK_EQUAL(ExecutionContext::grainSize(options), 1u);
+    options.setGrainSize(16);
+    BOOST_CHECK_EQUAL(ExecutionContext::grainSize(options), 16u);
+}
+
+BOOST_AUTO_TEST_CASE(setGrainSize_throws_for_nonpositive_argument)
+{
+    ParallelizationOptions options;
+    BOOST_CHECK_THROW(options.setGrainSize(0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
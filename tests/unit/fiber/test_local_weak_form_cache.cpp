@@ -0,0 +1,168 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/local_weak_form_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(LocalWeakFormCache)
+
+namespace
+{
+
+typedef Fiber::LocalWeakFormCache<double> Cache;
+typedef Cache::ElementIndexPair ElementIndexPair;
+
+// Cache with entries (test, trial) = (2, 0), (0, 0), (1, 2), (4, 2), (3, 2),
+// with dimensions 3 x 3, except for (1, 2), which is 1 x 3.
+void setUpCache(Cache& cache)
+{
+    std::vector<ElementIndexPair> pairs;
+    pairs.push_back(ElementIndexPair(2, 0));
+    pairs.push_back(ElementIndexPair(0, 0));
+    pairs.push_back(ElementIndexPair(1, 2));
+    pairs.push_back(ElementIndexPair(4, 2));
+    pairs.push_back(ElementIndexPair(3, 2));
+    std::vector<int> rowCounts(pairs.size(), 3), colCounts(pairs.size(), 3);
+    rowCounts[2] = 1;
+    cache.reset(4, pairs, rowCounts, colCounts);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_returns_entries_of_cached_pairs)
+{
+    Cache cache;
+    setUpCache(cache);
+
+    BOOST_CHECK_EQUAL(cache.entryCount(), 5u);
+    const int pairs[5][2] = { {2, 0}, {0, 0}, {1, 2}, {4, 2}, {3, 2} };
+    std::vector<bool> entryFound(cache.entryCount(), false);
+    for (int i = 0; i < 5; ++i) {
+        const int entry = cache.find(pairs[i][0], pairs[i][1]);
+        BOOST_REQUIRE(entry >= 0 && entry < int(cache.entryCount()));
+        BOOST_CHECK(!entryFound[entry]);
+        entryFound[entry] = true;
+    }
+    const int entry = cache.find(1, 2);
+    BOOST_CHECK_EQUAL(cache.rowCount(entry), 1);
+    BOOST_CHECK_EQUAL(cache.colCount(entry), 3);
+}
+
+BOOST_AUTO_TEST_CASE(find_rejects_uncached_pairs)
+{
+    Cache cache;
+    setUpCache(cache);
+
+    BOOST_CHECK_EQUAL(cache.find(1, 0), -1); // inside the range of row 0
+    BOOST_CHECK_EQUAL(cache.find(5, 0), -1); // outside the range of row 0
+    BOOST_CHECK_EQUAL(cache.find(0, 1), -1); // empty row
+    BOOST_CHECK_EQUAL(cache.find(0, 2), -1);
+    BOOST_CHECK_EQUAL(cache.find(0, 3), -1);
+    BOOST_CHECK_EQUAL(cache.find(0, 4), -1); // invalid trial element
+    BOOST_CHECK_EQUAL(cache.find(0, -1), -1);
+}
+
+BOOST_AUTO_TEST_CASE(entries_occupy_disjoint_memory)
+{
+    Cache cache;
+    setUpCache(cache);
+
+    const int pairs[5][2] = { {2, 0}, {0, 0}, {1, 2}, {4, 2}, {3, 2} };
+    for (int i = 0; i < 5; ++i) {
+        const int entry = cache.find(pairs[i][0], pairs[i][1]);
+        double* data = cache.data(entry);
+        const int size = cache.rowCount(entry) * cache.colCount(entry);
+        for (int j = 0; j < size; ++j)
+            data[j] = 10 * i + j;
+    }
+    for (int i = 0; i < 5; ++i) {
+        const int entry = cache.find(pairs[i][0], pairs[i][1]);
+        const double* data = cache.data(entry);
+        const int size = cache.rowCount(entry) * cache.colCount(entry);
+        for (int j = 0; j < size; ++j)
+            BOOST_CHECK_EQUAL(data[j], 10 * i + j);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(clear_empties_cache)
+{
+    Cache cache;
+    BOOST_CHECK(cache.isEmpty());
+    BOOST_CHECK_EQUAL(cache.find(0, 0), -1);
+    setUpCache(cache);
+    BOOST_CHECK(!cache.isEmpty());
+    cache.clear();
+    BOOST_CHECK(cache.isEmpty());
+    BOOST_CHECK_EQUAL(cache.find(2, 0), -1);
+}
+
+BOOST_AUTO_TEST_CASE(reset_throws_for_invalid_trial_element_index)
+{
+    Cache cache;
+    std::vector<ElementIndexPair> pairs(1, ElementIndexPair(0, 7));
+    std::vector<int> counts(1, 3);
+    BOOST_CHECK_THROW(cache.reset(4, pairs, counts, counts),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(csr_reset_preserves_entry_order)
+{
+    Cache cache;
+    std::vector<int> rowStarts, testElementIndices;
+    rowStarts.push_back(0);
+    rowStarts.push_back(2);
+    rowStarts.push_back(2);
+    rowStarts.push_back(5);
+    testElementIndices.push_back(0);
+    testElementIndices.push_back(2);
+    testElementIndices.push_back(1);
+    testElementIndices.push_back(3);
+    testElementIndices.push_back(4);
+    std::vector<int> counts(testElementIndices.size(), 3);
+    cache.reset(rowStarts, testElementIndices, counts, counts);
+
+    BOOST_CHECK_EQUAL(cache.find(0, 0), 0);
+    BOOST_CHECK_EQUAL(cache.find(2, 0), 1);
+    BOOST_CHECK_EQUAL(cache.find(1, 2), 2);
+    BOOST_CHECK_EQUAL(cache.find(3, 2), 3);
+    BOOST_CHECK_EQUAL(cache.find(4, 2), 4);
+    BOOST_CHECK_EQUAL(cache.find(0, 1), -1);
+}
+
+BOOST_AUTO_TEST_CASE(csr_reset_throws_for_unsorted_row)
+{
+    Cache cache;
+    std::vector<int> rowStarts, testElementIndices;
+    rowStarts.push_back(0);
+    rowStarts.push_back(2);
+    testElementIndices.push_back(2);
+    testElementIndices.push_back(1);
+    std::vector<int> counts(2, 3);
+    BOOST_CHECK_THROW(cache.reset(rowStarts, testElementIndices, counts, counts),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
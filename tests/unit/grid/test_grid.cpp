@@ -19,7 +19,10 @@
 // THE SOFTWARE.
 
 #include "test_grid.hpp"
+#include "fiber/element_adjacency.hpp"
+#include "fiber/parallelization_options.hpp"
 #include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
 #include "grid/structured_grid_factory.hpp"
 
 #include <boost/test/unit_test.hpp>
@@ -83,4 +86,15 @@ BOOST_AUTO_TEST_CASE(maxLevel_agrees_with_Dune)
     BOOST_CHECK_EQUAL(bemppGrid->maxLevel(), duneGrid->maxLevel());
 }
 
+BOOST_AUTO_TEST_CASE(elementAdjacency_covers_leaf_view_and_is_cached)
+{
+    Fiber::ParallelizationOptions parallelizationOptions;
+    Bempp::shared_ptr<const Fiber::ElementAdjacency> adjacency =
+            bemppGrid->elementAdjacency(parallelizationOptions);
+    std::auto_ptr<Bempp::GridView> view = bemppGrid->leafView();
+    BOOST_CHECK_EQUAL(adjacency->elementCount(), (int)view->entityCount(0));
+    BOOST_CHECK(bemppGrid->elementAdjacency(parallelizationOptions) ==
+                adjacency);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
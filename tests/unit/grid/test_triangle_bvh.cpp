@@ -0,0 +1,151 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/triangle_bvh.hpp"
+
+#include "fiber/parallelization_options.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdlib>
+
+using namespace Bempp;
+
+namespace
+{
+
+// Octahedron |x| + |y| + |z| <= 1
+struct OctahedronFixture
+{
+    OctahedronFixture() : vertices(3, 6), triangles(3, 8) {
+        vertices.fill(0.);
+        for (int i = 0; i < 6; ++i)
+            vertices(i / 2, i) = (i % 2 == 0) ? 1. : -1.;
+        int t = 0;
+        for (int x = 0; x < 2; ++x)
+            for (int y = 2; y < 4; ++y)
+                for (int z = 4; z < 6; ++z, ++t) {
+                    triangles(0, t) = x;
+                    triangles(1, t) = y;
+                    triangles(2, t) = z;
+                }
+    }
+
+    static double l1Norm(const arma::Mat<double>& points, int pt) {
+        return std::abs(points(0, pt)) + std::abs(points(1, pt)) +
+                std::abs(points(2, pt));
+    }
+
+    arma::Mat<double> vertices;
+    arma::Mat<int> triangles;
+};
+
+arma::Mat<double> generateRandomPoints(int pointCount, double halfWidth)
+{
+    arma::Mat<double> points(3, pointCount);
+    for (int pt = 0; pt < pointCount; ++pt)
+        for (int d = 0; d < 3; ++d)
+            points(d, pt) = halfWidth * (2. * std::rand() / RAND_MAX - 1.);
+    return points;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TriangleBvh)
+
+BOOST_FIXTURE_TEST_CASE(areInside_works_for_octahedron, OctahedronFixture)
+{
+    std::srand(1);
+    Bempp::TriangleBvh bvh(vertices, triangles);
+    BOOST_CHECK_EQUAL(bvh.triangleCount(), 8u);
+
+    const int pointCount = 5000;
+    arma::Mat<double> points = generateRandomPoints(pointCount, 1.2);
+    std::vector<bool> inside = bvh.areInside(points);
+    BOOST_REQUIRE_EQUAL(inside.size(), (size_t)pointCount);
+    for (int pt = 0; pt < pointCount; ++pt)
+        if (std::abs(l1Norm(points, pt) - 1.) > 1e-9)
+            BOOST_CHECK_EQUAL(inside[pt], l1Norm(points, pt) < 1.);
+}
+
+BOOST_FIXTURE_TEST_CASE(areInside_counts_intersections_with_shared_edges_and_vertices_once, OctahedronFixture)
+{
+    Bempp::TriangleBvh bvh(vertices, triangles);
+
+    arma::Mat<double> points(3, 4);
+    // rays passing through the top vertex
+    points(0, 0) = 0.;  points(1, 0) = 0.;  points(2, 0) = -0.5;
+    points(0, 1) = 0.;  points(1, 1) = 0.;  points(2, 1) = -2.;
+    // rays passing through edges
+    points(0, 2) = 0.3; points(1, 2) = 0.;  points(2, 2) = -0.2;
+    points(0, 3) = 0.;  points(1, 3) = -0.4; points(2, 3) = 0.1;
+    std::vector<bool> inside = bvh.areInside(points);
+    BOOST_CHECK(inside[0]);
+    BOOST_CHECK(!inside[1]);
+    BOOST_CHECK(inside[2]);
+    BOOST_CHECK(inside[3]);
+}
+
+BOOST_FIXTURE_TEST_CASE(areInside_does_not_depend_on_thread_count, OctahedronFixture)
+{
+    std::srand(1);
+    Bempp::TriangleBvh bvh(vertices, triangles);
+    arma::Mat<double> points = generateRandomPoints(5000, 1.2);
+
+    Fiber::ParallelizationOptions serialOptions;
+    serialOptions.setMaxThreadCount(1);
+    Fiber::ParallelizationOptions parallelOptions;
+    parallelOptions.setMaxThreadCount(4);
+    BOOST_CHECK(bvh.areInside(points, serialOptions) ==
+                bvh.areInside(points, parallelOptions));
+}
+
+BOOST_AUTO_TEST_CASE(areInside_works_for_sphere_and_reuses_cached_bvh)
+{
+    std::srand(1);
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "meshes/sphere-ico-2.msh", false /* verbose */);
+
+    const int pointCount = 2000;
+    arma::Mat<double> points = generateRandomPoints(pointCount, 1.5);
+    std::vector<bool> inside = areInside(*grid, points);
+    for (int pt = 0; pt < pointCount; ++pt) {
+        const double r = std::sqrt(points(0, pt) * points(0, pt) +
+                                   points(1, pt) * points(1, pt) +
+                                   points(2, pt) * points(2, pt));
+        if (r < 0.9)
+            BOOST_CHECK(inside[pt]);
+        else if (r > 1.)
+            BOOST_CHECK(!inside[pt]);
+    }
+
+    shared_ptr<const Bempp::TriangleBvh> bvh = grid->triangleBvh();
+    BOOST_CHECK_EQUAL(bvh->triangleCount(), (size_t)grid->leafView()->entityCount(0));
+    areInside(*grid, points);
+    BOOST_CHECK(grid->triangleBvh() == bvh);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+// Copyright (C) 2011-2013 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "io/gmsh.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Bempp;
+
+namespace
+{
+
+void checkGmshDataAreEqual(const GmshData& expected, const GmshData& actual)
+{
+    std::vector<int> expectedIndices, actualIndices;
+    expected.getNodeIndices(expectedIndices);
+    actual.getNodeIndices(actualIndices);
+    BOOST_REQUIRE(expectedIndices == actualIndices);
+    for (size_t i = 0; i < expectedIndices.size(); ++i) {
+        double x1, y1, z1, x2, y2, z2;
+        expected.getNode(expectedIndices[i], x1, y1, z1);
+        actual.getNode(expectedIndices[i], x2, y2, z2);
+        BOOST_CHECK_EQUAL(x1, x2);
+        BOOST_CHECK_EQUAL(y1, y2);
+        BOOST_CHECK_EQUAL(z1, z2);
+    }
+
+    expected.getElementIndices(expectedIndices);
+    actual.getElementIndices(actualIndices);
+    BOOST_REQUIRE(expectedIndices == actualIndices);
+    for (size_t i = 0; i < expectedIndices.size(); ++i) {
+        int type1, type2, physical1, physical2, elementary1, elementary2;
+        std::vector<int> nodes1, nodes2;
+        expected.getElement(expectedIndices[i], type1, nodes1,
+                            physical1, elementary1);
+        actual.getElement(expectedIndices[i], type2, nodes2,
+                          physical2, elementary2);
+        BOOST_CHECK_EQUAL(type1, type2);
+        BOOST_CHECK(nodes1 == nodes2);
+        BOOST_CHECK_EQUAL(physical1, physical2);
+        BOOST_CHECK_EQUAL(elementary1, elementary2);
+    }
+
+    BOOST_REQUIRE_EQUAL(expected.numberOfElementNodeDataSets(),
+                        actual.numberOfElementNodeDataSets());
+    for (int s = 0; s < expected.numberOfElementNodeDataSets(); ++s) {
+        std::vector<std::string> stringTags1, stringTags2;
+        std::vector<double> realTags1, realTags2;
+        int componentCount1, componentCount2;
+        std::vector<std::vector<std::vector<double> > > values1, values2;
+        expected.getElementNodeDataSet(s, stringTags1, realTags1, componentCount1,
+                                       expectedIndices, values1);
+        actual.getElementNodeDataSet(s, stringTags2, realTags2, componentCount2,
+                                     actualIndices, values2);
+        BOOST_CHECK(stringTags1 == stringTags2);
+        BOOST_CHECK(realTags1 == realTags2);
+        BOOST_CHECK_EQUAL(componentCount1, componentCount2);
+        BOOST_CHECK(expectedIndices == actualIndices);
+        BOOST_CHECK(values1 == values2);
+    }
+}
+
+GmshData readMeshWithData()
+{
+    GmshData data = GmshData::read("meshes/cube-domains.msh",
+                                   -1 /* all element types */);
+    std::vector<int> elementIndices;
+    data.getElementIndices(elementIndices);
+    data.addElementNodeDataSet(std::vector<std::string>(1, "test data"),
+                               std::vector<double>(1, 0.25), 1);
+    for (size_t i = 0; i < elementIndices.size(); ++i)
+        data.addElementNodeData(
+                    0, elementIndices[i],
+                    std::vector<std::vector<double> >(
+                        3, std::vector<double>(1, 1. / (i + 3))));
+    return data;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(Gmsh)
+
+BOOST_AUTO_TEST_CASE(ascii_write_and_read_reproduce_the_data)
+{
+    GmshData data = readMeshWithData();
+    std::stringstream stream;
+    data.write(stream);
+    checkGmshDataAreEqual(data, GmshData::read(stream, -1));
+}
+
+BOOST_AUTO_TEST_CASE(binary_write_and_read_reproduce_the_data)
+{
+    GmshData data = readMeshWithData();
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    data.write(stream, true /* binary */);
+    checkGmshDataAreEqual(data, GmshData::read(stream, -1));
+}
+
+BOOST_AUTO_TEST_CASE(read_keeps_physical_entities_of_elements)
+{
+    GmshData data = GmshData::read("meshes/cube-domains.msh");
+    std::vector<int> elementIndices;
+    data.getElementIndices(elementIndices);
+    BOOST_REQUIRE(!elementIndices.empty());
+    bool haveNonzeroPhysicalEntity = false;
+    for (size_t i = 0; i < elementIndices.size(); ++i) {
+        int type, physicalEntity, elementaryEntity;
+        std::vector<int> nodes;
+        data.getElement(elementIndices[i], type, nodes,
+                        physicalEntity, elementaryEntity);
+        BOOST_CHECK_EQUAL(type, 2);
+        BOOST_CHECK_EQUAL(nodes.size(), 3u);
+        haveNonzeroPhysicalEntity |= (physicalEntity > 0);
+    }
+    BOOST_CHECK(haveNonzeroPhysicalEntity);
+}
+
+BOOST_AUTO_TEST_CASE(grid_read_from_binary_file_agrees_with_grid_read_from_ascii_file)
+{
+    const char* fileName = "gmsh_binary_test.msh";
+    GmshData::read("meshes/sphere-ico-2.msh").write(fileName, true /* binary */);
+
+    GmshIo asciiIo("meshes/sphere-ico-2.msh");
+    GmshIo binaryIo(fileName);
+    std::remove(fileName);
+
+    std::auto_ptr<GridView> asciiView = asciiIo.grid()->leafView();
+    std::auto_ptr<GridView> binaryView = binaryIo.grid()->leafView();
+    BOOST_CHECK_EQUAL(asciiView->entityCount(0), binaryView->entityCount(0));
+    BOOST_CHECK_EQUAL(asciiView->entityCount(2), binaryView->entityCount(2));
+    BOOST_CHECK(asciiIo.nodePermutation() == binaryIo.nodePermutation());
+    BOOST_CHECK(asciiIo.elementPermutation() == binaryIo.elementPermutation());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
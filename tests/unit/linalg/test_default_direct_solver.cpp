@@ -25,6 +25,8 @@
 
 #include "assembly/blocked_boundary_operator.hpp"
 #include "assembly/blocked_operator_structure.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/symmetry.hpp"
 #include "linalg/default_direct_solver.hpp"
 
 #include <boost/test/unit_test.hpp>
@@ -165,4 +167,163 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_2x2_blocked_boundary
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(solve_projections_agrees_with_solve_for_multiple_rhs,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    DirectSolver solver(fixture.lhsOp);
+    BOOST_CHECK(!solver.isFactorized());
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK(solver.isFactorized());
+    arma::Col<RT> expected = solution.gridFunction().coefficients();
+
+    arma::Col<RT> projections =
+            fixture.rhs.projections(fixture.lhsOp.dualToRange());
+    arma::Mat<RT> rhsProjections(projections.n_rows, 3);
+    rhsProjections.col(0) = projections;
+    rhsProjections.col(1) = static_cast<RT>(2.) * projections;
+    rhsProjections.col(2) = static_cast<RT>(-3.) * projections;
+    arma::Mat<RT> coefficients = solver.solveProjections(rhsProjections);
+
+    BOOST_CHECK_EQUAL(coefficients.n_cols, 3u);
+    arma::Col<RT> col0 = coefficients.col(0);
+    arma::Col<RT> col1 = coefficients.col(1) / static_cast<RT>(2.);
+    arma::Col<RT> col2 = coefficients.col(2) / static_cast<RT>(-3.);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(col0, expected, solverTol));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(col1, expected, solverTol));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(col2, expected, solverTol));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(memory_mapped_factor_storage_gives_the_same_solution,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    DirectSolver solver(fixture.lhsOp);
+    arma::Col<RT> expected = solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    solver.enableMemoryMappedFactorStorage();
+    BOOST_CHECK(!solver.isFactorized());
+    arma::Col<RT> actual = solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(actual, expected, solverTol));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(symmetric_factorization_agrees_with_lu_factorization,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    DirectSolver solver(fixture.lhsOp);
+    arma::Col<RT> expected = solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    // The fixture's single-layer operator acts on piecewise constants and is
+    // tested with piecewise constants, so its weak form is symmetric
+    BoundaryOperator<BFT, RT> symmetricOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.lhsOp.context(),
+                fixture.lhsOp.domain(),
+                fixture.lhsOp.range(),
+                fixture.lhsOp.dualToRange(),
+                "", SYMMETRIC | HERMITIAN);
+    DirectSolver symmetricSolver(symmetricOp);
+    arma::Col<RT> actual =
+            symmetricSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    // Only the lower triangle is used by the symmetric factorisation, and
+    // quadrature does not make the assembled matrix exactly symmetric
+    BOOST_CHECK(check_arrays_are_close<ValueType>(actual, expected, solverTol * 10));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(complex_symmetric_factorization_agrees_with_lu_factorization,
+                              ValueType, complex_result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    // Scaling by a non-real number preserves symmetry but not Hermiticity,
+    // so the symmetric operator is factorised with sytrf
+    const RT multiplier(1., 1.);
+    BoundaryOperator<BFT, RT> generalOp = multiplier * fixture.lhsOp;
+    DirectSolver solver(generalOp);
+    arma::Col<RT> expected = solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    BoundaryOperator<BFT, RT> symmetricOp = multiplier *
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.lhsOp.context(),
+                fixture.lhsOp.domain(),
+                fixture.lhsOp.range(),
+                fixture.lhsOp.dualToRange(),
+                "", SYMMETRIC);
+    BOOST_REQUIRE_EQUAL(symmetricOp.abstractOperator()->symmetry(),
+                        int(SYMMETRIC));
+    DirectSolver symmetricSolver(symmetricOp);
+    arma::Col<RT> actual =
+            symmetricSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(actual, expected, solverTol * 10));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(hermitian_factorization_falls_back_to_indefinite_factorization,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    // The negated single-layer operator is Hermitian but not positive
+    // definite, so the Cholesky factorisation fails and hetrf is used instead
+    const RT multiplier = static_cast<RT>(-1.);
+    BoundaryOperator<BFT, RT> generalOp = multiplier * fixture.lhsOp;
+    DirectSolver solver(generalOp);
+    arma::Col<RT> expected = solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    BoundaryOperator<BFT, RT> hermitianOp = multiplier *
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.lhsOp.context(),
+                fixture.lhsOp.domain(),
+                fixture.lhsOp.range(),
+                fixture.lhsOp.dualToRange(),
+                "", SYMMETRIC | HERMITIAN);
+    BOOST_REQUIRE(hermitianOp.abstractOperator()->symmetry() & HERMITIAN);
+    DirectSolver hermitianSolver(hermitianOp);
+    arma::Col<RT> actual =
+            hermitianSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(actual, expected, solverTol * 10));
+}
+
 BOOST_AUTO_TEST_SUITE_END()